@@ -377,6 +377,12 @@ DXGI_FORMAT D3D11Mapping::Mapping( VertexElementFormat format )
 	case VEF_UInt2: return DXGI_FORMAT_R32G32_UINT;
 	case VEF_UInt3: return DXGI_FORMAT_R32G32B32_UINT;
 	case VEF_UInt4: return DXGI_FORMAT_R32G32B32A32_UINT;
+	case VEF_Half2: return DXGI_FORMAT_R16G16_FLOAT;
+	case VEF_Half4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case VEF_UShort4N: return DXGI_FORMAT_R16G16B16A16_UNORM;
+	case VEF_Short2N: return DXGI_FORMAT_R16G16_SNORM;
+	case VEF_UByte4N: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case VEF_UByte4: return DXGI_FORMAT_R8G8B8A8_UINT;
 	default:
 		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid VertexElementFormat", "D3D11Mapping::Mapping");
 	}
@@ -4,7 +4,7 @@
 #include "D3D11Shader.h"
 #include <Core/Exception.h>
 
-#define MAX_ATTRIBUTES 8
+#define MAX_ATTRIBUTES 16
 
 namespace RcEngine {
 
@@ -26,13 +26,30 @@ void D3D11VertexDeclaration::CreateInputLayout( const RenderOperation& operation
 	const D3D11VertexShader* vertexShaderD3D11 = static_cast_checked<const  D3D11VertexShader*>(&vertexShader);
 
 	/**
-	 * May partial match
+	 * May partial match. Per instance elements follow vertex elements and map to the last shader inputs.
 	 */
+	size_t numInstanceElements = 0;
+	for (const VertexElement& element : mVertexElemets)
+	{
+		if (element.InstanceStepRate > 0)
+			numInstanceElements++;
+	}
+
+	if (vertexShaderD3D11->InputSignatures.size() < numInstanceElements)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Error: Vertex shader has no per instance input!", "D3D11VertexDeclaration::CreateInputLayout");
+
+	size_t numVertexInputs = vertexShaderD3D11->InputSignatures.size() - numInstanceElements;
+
 	//assert(mVertexElemets.size() == vertexShaderD3D11->InputSignatures.size());
 	assert(mVertexElemets.size() >= vertexShaderD3D11->InputSignatures.size());
+	assert(vertexShaderD3D11->InputSignatures.size() <= MAX_ATTRIBUTES);
 	for (size_t i = 0; i < vertexShaderD3D11->InputSignatures.size(); ++i) //for (size_t i = 0; i < mVertexElemets.size(); ++i)
 	{
-		const VertexElement& element = mVertexElemets[i];
+		size_t elementIndex = i;
+		if (i >= numVertexInputs)
+			elementIndex = mVertexElemets.size() - numInstanceElements + (i - numVertexInputs);
+
+		const VertexElement& element = mVertexElemets[elementIndex];
 		layoutD3D11[i].SemanticName = vertexShaderD3D11->InputSignatures[i].Semantic.c_str();
 		layoutD3D11[i].SemanticIndex = element.UsageIndex;
 		layoutD3D11[i].Format = D3D11Mapping::Mapping(element.Type);
@@ -170,6 +170,81 @@ void main()
 }	
 
 
+[[Fragment=IrradianceVolumePSMain]]
+
+#include "/DeferredUtil.glsl"
+
+// Irradiance volume, L2 SH probes packed by IrradianceVolume::CreateTextures
+uniform vec3 IrradianceVolumeMin;
+uniform vec3 IrradianceVolumeMax;
+uniform vec3 IrradianceVolumeDims;
+
+uniform sampler3D IrradianceCoeffs0;
+uniform sampler3D IrradianceCoeffs1;
+uniform sampler3D IrradianceCoeffs2;
+uniform sampler3D IrradianceCoeffs3;
+uniform sampler3D IrradianceCoeffs4;
+uniform sampler3D IrradianceCoeffs5;
+uniform sampler3D IrradianceCoeffs6;
+
+// SamplerState binding
+#pragma IrradianceCoeffs0 : IrradianceSampler
+#pragma IrradianceCoeffs1 : IrradianceSampler
+#pragma IrradianceCoeffs2 : IrradianceSampler
+#pragma IrradianceCoeffs3 : IrradianceSampler
+#pragma IrradianceCoeffs4 : IrradianceSampler
+#pragma IrradianceCoeffs5 : IrradianceSampler
+#pragma IrradianceCoeffs6 : IrradianceSampler
+
+in vec3 oViewRay;
+
+layout(location = 0) out vec4 oFragColor;
+
+vec3 EvalIrradianceVolume(vec3 position, vec3 N)
+{
+	// Probes on grid corners, map to texel centers
+	vec3 coord = clamp((position - IrradianceVolumeMin) / (IrradianceVolumeMax - IrradianceVolumeMin), 0.0, 1.0);
+	vec3 uvw = (coord * (IrradianceVolumeDims - 1.0) + 0.5) / IrradianceVolumeDims;
+
+	vec4 c0 = textureLod(IrradianceCoeffs0, uvw, 0.0);
+	vec4 c1 = textureLod(IrradianceCoeffs1, uvw, 0.0);
+	vec4 c2 = textureLod(IrradianceCoeffs2, uvw, 0.0);
+	vec4 c3 = textureLod(IrradianceCoeffs3, uvw, 0.0);
+	vec4 c4 = textureLod(IrradianceCoeffs4, uvw, 0.0);
+	vec4 c5 = textureLod(IrradianceCoeffs5, uvw, 0.0);
+	vec4 c6 = textureLod(IrradianceCoeffs6, uvw, 0.0);
+
+	// Basis scaled by clamped cosine lobe of its band
+	const float A0 = 3.141593, A1 = 2.094395, A2 = 0.785398;
+
+	vec3 irradiance = c0.xyz * (A0 * 0.282095);
+	irradiance += vec3(c0.w, c1.xy) * (A1 * 0.488603 * N.y);
+	irradiance += vec3(c1.zw, c2.x) * (A1 * 0.488603 * N.z);
+	irradiance += c2.yzw * (A1 * 0.488603 * N.x);
+	irradiance += c3.xyz * (A2 * 1.092548 * N.x * N.y);
+	irradiance += vec3(c3.w, c4.xy) * (A2 * 1.092548 * N.y * N.z);
+	irradiance += vec3(c4.zw, c5.x) * (A2 * 0.315392 * (3.0 * N.z * N.z - 1.0));
+	irradiance += c5.yzw * (A2 * 1.092548 * N.x * N.z);
+	irradiance += c6.xyz * (A2 * 0.546274 * (N.x * N.x - N.y * N.y));
+
+	return max(irradiance, vec3(0.0));
+}
+
+void main()
+{
+	ivec2 sampleIndex = ivec2(gl_FragCoord.xy);
+
+	vec2 ndcXY = gl_FragCoord.xy / vec2(textureSize(DepthBuffer, 0)) * 2.0 - 1.0;
+	vec3 worldPosition = ReconstructWorldPosition(sampleIndex, vec4(ndcXY, 0.0, 1.0));
+
+	vec3 N;
+	float shininess;
+	GetNormalAndShininess(sampleIndex, N, shininess);
+
+	// Same scale as light color, shading pass multiplies by albedo
+	oFragColor = vec4(EvalIrradianceVolume(worldPosition, N) / 3.141593, 0.0);
+}
+
 [[Fragment=DeferredShadingPSMain]]
 
 #include "/DeferredUtil.glsl"
@@ -3,7 +3,9 @@
 #include "/ModelVertexFactory.glsl"
 
 // Shader uniforms	
-uniform mat4 World;	
+#ifndef _Instancing
+	uniform mat4 World;	
+#endif
 uniform mat4 ViewProj;
 
 // VS Outputs
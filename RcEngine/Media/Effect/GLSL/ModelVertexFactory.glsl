@@ -3,7 +3,13 @@
 #define POSISTION 0
 
 // Attributes
-layout (location = POSISTION) in vec3 iPos;
+#ifdef _QuantizedVertex
+	// UShort4N position within mesh bounds, Short2N octahedral normal/tangent/binormal,
+	// half float texcoord, UByte4N blend weights and UByte4 blend indices.
+	layout (location = POSISTION) in vec4 iPosQ;
+#else
+	layout (location = POSISTION) in vec3 iPos;
+#endif
 
 #ifdef _Skinning
 	#define BLENDWEIGHTS (POSISTION+1)
@@ -18,7 +24,11 @@ layout (location = POSISTION) in vec3 iPos;
 	#define NORMAL (POSISTION+1)
 #endif
 
-layout (location = NORMAL) in vec3 iNormal;
+#ifdef _QuantizedVertex
+	layout (location = NORMAL) in vec2 iNormalQ;
+#else
+	layout (location = NORMAL) in vec3 iNormal;
+#endif
 
 #define TEXCOORD (NORMAL+1)
 layout (location = TEXCOORD) in vec2 iTex;
@@ -26,8 +36,51 @@ layout (location = TEXCOORD) in vec2 iTex;
 #ifdef _NormalMap
 	#define TANGENT (TEXCOORD+1)
 	#define BINORMAL (TANGENT+1)
-	layout (location = TANGENT) in vec3 iTangent;
-	layout (location = BINORMAL) in vec3 iBinormal;
+	#ifdef _QuantizedVertex
+		layout (location = TANGENT) in vec2 iTangentQ;
+		layout (location = BINORMAL) in vec2 iBinormalQ;
+	#else
+		layout (location = TANGENT) in vec3 iTangent;
+		layout (location = BINORMAL) in vec3 iBinormal;
+	#endif
+#endif
+
+// Per instance world matrix columns, must be the last inputs. Replaces World uniform of model shaders.
+#ifdef _Instancing
+	#ifdef _NormalMap
+		#define INSTANCE_WORLD (BINORMAL+1)
+	#else
+		#define INSTANCE_WORLD (TEXCOORD+1)
+	#endif
+	layout (location = INSTANCE_WORLD) in vec4 iWorld0;
+	layout (location = INSTANCE_WORLD+1) in vec4 iWorld1;
+	layout (location = INSTANCE_WORLD+2) in vec4 iWorld2;
+	layout (location = INSTANCE_WORLD+3) in vec4 iWorld3;
+
+	#define World mat4(iWorld0, iWorld1, iWorld2, iWorld3)
+#endif
+
+// Dequantize compact vertex attributes, shaders use iPos, iNormal, iTangent and iBinormal either way
+#ifdef _QuantizedVertex
+
+	uniform vec3 PositionScale;
+	uniform vec3 PositionBias;
+
+	vec3 DecodeOctahedral(vec2 e)
+	{
+		vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+		if (n.z < 0.0)
+			n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+		return normalize(n);
+	}
+
+	#define iPos (iPosQ.xyz * PositionScale + PositionBias)
+	#define iNormal DecodeOctahedral(iNormalQ)
+	#ifdef _NormalMap
+		#define iTangent DecodeOctahedral(iTangentQ)
+		#define iBinormal DecodeOctahedral(iBinormalQ)
+	#endif
+
 #endif
 
 // Helper function for skin mesh
@@ -2,7 +2,12 @@
 
 #include "/ModelVertexFactory.glsl"
 
-uniform mat4 WorldView;	
+#ifdef _Instancing
+	uniform mat4 View;
+	#define WorldView (World * View)
+#else
+	uniform mat4 WorldView;	
+#endif
 uniform mat4 Projection;
 
 #ifdef _AlphaTest
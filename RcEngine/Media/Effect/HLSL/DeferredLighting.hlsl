@@ -184,6 +184,71 @@ void SpotLightingPSMain(
 	}
 }
 
+//--------------------------------------------------------
+// Irradiance volume, L2 SH probes packed by IrradianceVolume::CreateTextures
+float3 IrradianceVolumeMin;
+float3 IrradianceVolumeMax;
+float3 IrradianceVolumeDims;
+
+Texture3D IrradianceCoeffs0;
+Texture3D IrradianceCoeffs1;
+Texture3D IrradianceCoeffs2;
+Texture3D IrradianceCoeffs3;
+Texture3D IrradianceCoeffs4;
+Texture3D IrradianceCoeffs5;
+Texture3D IrradianceCoeffs6;
+SamplerState IrradianceSampler;
+
+float3 EvalIrradianceVolume(float3 position, float3 N)
+{
+	// Probes on grid corners, map to texel centers
+	float3 coord = saturate((position - IrradianceVolumeMin) / (IrradianceVolumeMax - IrradianceVolumeMin));
+	float3 uvw = (coord * (IrradianceVolumeDims - 1.0) + 0.5) / IrradianceVolumeDims;
+
+	float4 c0 = IrradianceCoeffs0.SampleLevel(IrradianceSampler, uvw, 0);
+	float4 c1 = IrradianceCoeffs1.SampleLevel(IrradianceSampler, uvw, 0);
+	float4 c2 = IrradianceCoeffs2.SampleLevel(IrradianceSampler, uvw, 0);
+	float4 c3 = IrradianceCoeffs3.SampleLevel(IrradianceSampler, uvw, 0);
+	float4 c4 = IrradianceCoeffs4.SampleLevel(IrradianceSampler, uvw, 0);
+	float4 c5 = IrradianceCoeffs5.SampleLevel(IrradianceSampler, uvw, 0);
+	float4 c6 = IrradianceCoeffs6.SampleLevel(IrradianceSampler, uvw, 0);
+
+	// Basis scaled by clamped cosine lobe of its band
+	const float A0 = 3.141593, A1 = 2.094395, A2 = 0.785398;
+
+	float3 irradiance = c0.xyz * (A0 * 0.282095);
+	irradiance += float3(c0.w, c1.xy) * (A1 * 0.488603 * N.y);
+	irradiance += float3(c1.zw, c2.x) * (A1 * 0.488603 * N.z);
+	irradiance += c2.yzw * (A1 * 0.488603 * N.x);
+	irradiance += c3.xyz * (A2 * 1.092548 * N.x * N.y);
+	irradiance += float3(c3.w, c4.xy) * (A2 * 1.092548 * N.y * N.z);
+	irradiance += float3(c4.zw, c5.x) * (A2 * 0.315392 * (3.0 * N.z * N.z - 1.0));
+	irradiance += c5.yzw * (A2 * 1.092548 * N.x * N.z);
+	irradiance += c6.xyz * (A2 * 0.546274 * (N.x * N.x - N.y * N.y));
+
+	return max(irradiance, 0.0);
+}
+
+void IrradianceVolumePSMain(
+	in float3 iViewRay	  : TEXCOORD0,
+	in float4 iFragCoord  : SV_POSITION,
+	out float4 oFragColor : SV_Target0 )
+{
+	int3 sampleIndex = int3(iFragCoord.xy, 0);
+
+	uint width, height;
+	DepthBuffer.GetDimensions(width, height);
+	float2 ndcXY = (iFragCoord.xy / float2(width, height)) * float2(2.0, -2.0) + float2(-1.0, 1.0);
+	float3 worldPosition = ReconstructWorldPosition(sampleIndex, float4(ndcXY, 0.0, 1.0));
+
+	float3 N;
+	float shininess;
+	GetNormalAndShininess(sampleIndex, N, shininess);
+
+	// Same scale as light color, shading pass multiplies by albedo
+	oFragColor = float4(EvalIrradianceVolume(worldPosition, N) / 3.141593, 0.0);
+}
+
 //--------------------------------------------------------
 // Final Shading Pass
 void DeferredShadingPSMain(
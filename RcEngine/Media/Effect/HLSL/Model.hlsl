@@ -1,7 +1,9 @@
 #include "ModelVertexFactory.hlsl"
 
 // Unifroms
+#ifndef _Instancing
 float4x4 World;
+#endif
 float4x4 ViewProj;
 
 //-------------------------------------------------------------------------------------
@@ -13,26 +15,26 @@ VSOutput ModelVS(VSInput input)
 #ifdef _Skinning
 	float4x4 Skin = CalculateSkinMatrix(input.BlendWeights, input.BlendIndices);
 	float4x4 SkinWorld = mul(Skin, World);
-	output.PosWS = mul( float4(input.Pos, 1.0), SkinWorld );
+	output.PosWS = mul( float4(DecodePosition(input.Pos), 1.0), SkinWorld );
 #else
-	output.PosWS = mul( float4(input.Pos, 1.0), World );
+	output.PosWS = mul( float4(DecodePosition(input.Pos), 1.0), World );
 #endif
 
 	// calculate view space normal.
 #ifdef _Skinning
-	float3 normal = normalize( mul(input.Normal, (float3x3)SkinWorld) );
+	float3 normal = normalize( mul(DecodeDirection(input.Normal), (float3x3)SkinWorld) );
 #else
-	float3 normal = normalize( mul(input.Normal, (float3x3)World) );
+	float3 normal = normalize( mul(DecodeDirection(input.Normal), (float3x3)World) );
 #endif
 
 	// calculate tangent and binormal.
 #ifdef _NormalMap
 	#ifdef _Skinning
-		float3 tangent = normalize( mul(input.Tangent, (float3x3)SkinWorld) );
-		float3 binormal = normalize( mul(input.Binormal, (float3x3)SkinWorld) );
+		float3 tangent = normalize( mul(DecodeDirection(input.Tangent), (float3x3)SkinWorld) );
+		float3 binormal = normalize( mul(DecodeDirection(input.Binormal), (float3x3)SkinWorld) );
 	#else
-		float3 tangent = normalize( mul(input.Tangent, (float3x3)World) );
-		float3 binormal = normalize( mul(input.Binormal, (float3x3)World) );
+		float3 tangent = normalize( mul(DecodeDirection(input.Tangent), (float3x3)World) );
+		float3 binormal = normalize( mul(DecodeDirection(input.Binormal), (float3x3)World) );
 	#endif
 
 	// actualy this is a world to tangent matrix, because we always use V * Mat.
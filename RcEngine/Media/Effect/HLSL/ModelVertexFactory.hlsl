@@ -1,24 +1,76 @@
+#ifdef _QuantizedVertex
+	// UShort4N position within mesh bounds, Short2N octahedral normal/tangent/binormal,
+	// half float texcoord, UByte4N blend weights and UByte4 blend indices.
+	#define VertexPosType float4
+	#define VertexDirType float2
+#else
+	#define VertexPosType float3
+	#define VertexDirType float3
+#endif
+
 struct VSInput 
 {
-	float3 Pos 		 	 : POSITION;
+	VertexPosType Pos 	 : POSITION;
 
 #ifdef _Skinning
 	float4 BlendWeights  : BLENDWEIGHTS;
 	uint4  BlendIndices  : BLENDINDICES;
 #endif
 
-	float3 Normal		 : NORMAL;
+	VertexDirType Normal : NORMAL;
 
 #if defined(_DiffuseMap)
 	float2 Tex			 : TEXCOORD0;
 #endif
 
 #ifdef _NormalMap
-	float3 Tangent		 : TANGENT;
-	float3 Binormal      : BINORMAL;
+	VertexDirType Tangent  : TANGENT;
+	VertexDirType Binormal : BINORMAL;
+#endif
+
+// Per instance world matrix columns, must be the last inputs
+#ifdef _Instancing
+	float4 World0 : INSTANCE_WORLD0;
+	float4 World1 : INSTANCE_WORLD1;
+	float4 World2 : INSTANCE_WORLD2;
+	float4 World3 : INSTANCE_WORLD3;
 #endif
 };
 
+// Replaces World uniform of model shaders, vertex input is named input
+#ifdef _Instancing
+	float4x4 InstanceWorld(VSInput input)
+	{
+		return transpose(float4x4(input.World0, input.World1, input.World2, input.World3));
+	}
+
+	#define World InstanceWorld(input)
+#endif
+
+// Dequantize compact vertex attributes
+#ifdef _QuantizedVertex
+
+	float3 PositionScale;
+	float3 PositionBias;
+
+	float3 DecodeOctahedral(float2 e)
+	{
+		float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+		if (n.z < 0.0)
+			n.xy = (1.0 - abs(n.yx)) * (n.xy >= 0.0 ? 1.0 : -1.0);
+		return normalize(n);
+	}
+
+	float3 DecodePosition(float4 pos)		{ return pos.xyz * PositionScale + PositionBias; }
+	float3 DecodeDirection(float2 dir)		{ return DecodeOctahedral(dir); }
+
+#else
+
+	float3 DecodePosition(float3 pos)		{ return pos; }
+	float3 DecodeDirection(float3 dir)		{ return dir; }
+
+#endif
+
 // Outputs
 struct VSOutput
 {
@@ -1,7 +1,12 @@
 #include "ModelVertexFactory.hlsl"
 #include "ModelMaterialFactory.hlsl"
 
+#ifdef _Instancing
+float4x4 View;
+#define WorldView mul(World, View)
+#else
 float4x4 WorldView;
+#endif
 float4x4 Projection;
 
 void ShadowMapVS(VSInput input, 
@@ -14,9 +19,9 @@ void ShadowMapVS(VSInput input,
 
 #ifdef _Skinning
 	float4x4 Skin = CalculateSkinMatrix(input.BlendWeights, input.BlendIndices);
-	oPosCS = mul(float4(input.Pos, 1.0), mul(Skin, wvp));
+	oPosCS = mul(float4(DecodePosition(input.Pos), 1.0), mul(Skin, wvp));
 #else
-	oPosCS = mul(float4(input.Pos, 1.0), wvp);
+	oPosCS = mul(float4(DecodePosition(input.Pos), 1.0), wvp);
 #endif
 	
 #if defined(_AlphaTest)
@@ -44,6 +44,20 @@ GLenum OpenGLMapping::Mapping( VertexElementFormat format )
 	case VEF_Bool4:
 		return GL_BOOL;
 
+	case VEF_Half2:
+	case VEF_Half4:
+		return GL_HALF_FLOAT;
+
+	case VEF_UShort4N:
+		return GL_UNSIGNED_SHORT;
+
+	case VEF_Short2N:
+		return GL_SHORT;
+
+	case VEF_UByte4N:
+	case VEF_UByte4:
+		return GL_UNSIGNED_BYTE;
+
 	}
 	ENGINE_EXCEPT(Exception::ERR_RENDERINGAPI_ERROR, "Unsupported vertex format", "OpenGLGraphicCommon::Mapping");
 }
@@ -59,6 +59,7 @@ public:
 private:
 	friend class OpenGLShaderReflection;
 	friend class OpenGLShaderPipeline;
+	friend class OpenGLVertexDeclaration;
 	friend class GLSLScriptCompiler;
 
 	GLuint mShaderOGL;
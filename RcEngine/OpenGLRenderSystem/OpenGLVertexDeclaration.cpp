@@ -1,7 +1,9 @@
 #include "OpenGLVertexDeclaration.h"
 #include "OpenGLGraphicCommon.h"
 #include "OpenGLBuffer.h"
+#include "OpenGLShader.h"
 #include <Graphics/RenderOperation.h>
+#include <Core/Exception.h>
 
 namespace RcEngine {
 
@@ -26,6 +28,29 @@ void OpenGLVertexDeclaration::CreateVertexArrayOGL( const RenderOperation& opera
 	glBindVertexArray(mVertexArrayOGL);
 
 	OpenGLVertexDeclaration* vertexDeclOGL = static_cast_checked<OpenGLVertexDeclaration*>(operation.VertexDecl.get());
+	const OpenGLShader* vertexShaderOGL = static_cast_checked<const OpenGLShader*>(&vertexShader);
+	const vector<InputSignature>& inputSignatures = vertexShaderOGL->mInputSignatures;
+
+	/**
+	 * Per instance elements follow vertex elements and map to the last shader inputs, sorted by location. 
+	 * Vertex elements at or after the first instance input location are not read by shader.
+	 */
+	uint32_t numElements = vertexDeclOGL->mVertexElemets.size();
+	uint32_t numInstanceElements = 0;
+	for (const VertexElement& attribute : vertexDeclOGL->mVertexElemets)
+	{
+		if (attribute.InstanceStepRate > 0)
+			numInstanceElements++;
+	}
+
+	uint32_t firstInstanceInput = 0;
+	if (numInstanceElements)
+	{
+		if (inputSignatures.size() < numInstanceElements)
+			ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Vertex shader has no per instance input!", "OpenGLVertexDeclaration::CreateVertexArrayOGL");
+		
+		firstInstanceInput = inputSignatures.size() - numInstanceElements;
+	}
 
 	GLuint vertexSlotBind = -1;
 	for (GLuint attribIndex = 0; attribIndex < vertexDeclOGL->mVertexElemets.size(); ++attribIndex)
@@ -46,22 +71,31 @@ void OpenGLVertexDeclaration::CreateVertexArrayOGL( const RenderOperation& opera
 		uint32_t stride =  vertexDeclOGL->GetStreamStride(attribute.InputSlot);
 		uint32_t offset = attribute.Offset;
 			
+		GLuint location = attribIndex;
 		bool isMatchVertexShader = true;
+
+		if (attribute.InstanceStepRate > 0)
+		{
+			assert(attribIndex >= numElements - numInstanceElements);
+			location = inputSignatures[firstInstanceInput + attribIndex - (numElements - numInstanceElements)].AttributeSlot;
+		}
+		else if (numInstanceElements)
+			isMatchVertexShader = (attribIndex < inputSignatures[firstInstanceInput].AttributeSlot);
 		
 		if (isMatchVertexShader)
 		{
-			glEnableVertexAttribArray(attribIndex);
+			glEnableVertexAttribArray(location);
 
-			if (OpenGLMapping::IsIntegerType(type))
-				glVertexAttribIPointer(attribIndex, size, type, stride, BUFFER_OFFSET(offset));	
+			if (VertexElementUtil::IsNormalized(attribute))
+				glVertexAttribPointer(location, size, type, true, stride, BUFFER_OFFSET(offset));	
+			else if (OpenGLMapping::IsIntegerType(type))
+				glVertexAttribIPointer(location, size, type, stride, BUFFER_OFFSET(offset));	
 			else
-				glVertexAttribPointer(attribIndex, size, type, false, stride, BUFFER_OFFSET(offset));	
+				glVertexAttribPointer(location, size, type, false, stride, BUFFER_OFFSET(offset));	
 
 			if (attribute.InstanceStepRate > 0)
-				glVertexAttribDivisor(attribIndex, attribute.InstanceStepRate);
+				glVertexAttribDivisor(location, attribute.InstanceStepRate);
 		}
-		else 
-			glDisableVertexAttribArray(attribIndex);
 	}
 
 	glBindVertexArray(0);
@@ -20,5 +20,10 @@ namespace RcEngine
 #endif
 }
 
+// SSE2 intrinsics in CPU side texture processing, always available on x86-64
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#	define RC_SSE2 1
+#endif
+
 
 #endif // CompileConfig_h__
@@ -0,0 +1,170 @@
+#include <Core/ThreadPool.h>
+
+namespace RcEngine {
+
+ThreadPool::ThreadPool()
+	: mActiveTasks(0),
+	  mShutdown(false)
+{
+	uint32_t numThreads = std::thread::hardware_concurrency();
+	Start( (std::max)(numThreads, 2U) - 1 );
+}
+
+ThreadPool::ThreadPool( uint32_t numThreads )
+	: mActiveTasks(0),
+	  mShutdown(false)
+{
+	Start( (std::max)(numThreads, 1U) );
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mShutdown = true;
+	}
+	mTaskCondition.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+void ThreadPool::Start( uint32_t numThreads )
+{
+	mWorkers.reserve(numThreads);
+	for (uint32_t i = 0; i < numThreads; ++i)
+		mWorkers.push_back( std::thread(&ThreadPool::WorkerThread, this) );
+}
+
+void ThreadPool::Submit( const Task& task )
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mTasks.push(task);
+	}
+	mTaskCondition.notify_one();
+}
+
+void ThreadPool::WorkerThread()
+{
+	for (;;)
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			while (!mShutdown && mTasks.empty())
+				mTaskCondition.wait(lock);
+
+			if (mShutdown && mTasks.empty())
+				return;
+
+			task = mTasks.front();
+			mTasks.pop();
+			mActiveTasks++;
+		}
+
+		task();
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mActiveTasks--;
+		}
+		mIdleCondition.notify_all();
+	}
+}
+
+bool ThreadPool::RunPendingTask()
+{
+	Task task;
+
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (mTasks.empty())
+			return false;
+
+		task = mTasks.front();
+		mTasks.pop();
+		mActiveTasks++;
+	}
+
+	task();
+
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mActiveTasks--;
+	}
+	mIdleCondition.notify_all();
+
+	return true;
+}
+
+void ThreadPool::ParallelFor( uint32_t begin, uint32_t end, const IndexTask& func )
+{
+	if (begin >= end)
+		return;
+
+	uint32_t count = end - begin;
+	if (count == 1)
+	{
+		func(begin);
+		return;
+	}
+
+	// Every job pulls indices until range exhausted, calling thread works as well
+	std::atomic<uint32_t> nextIndex(begin);
+	std::atomic<uint32_t> pendingJobs(0);
+
+	std::function<void()> job = [&]() {
+		for (uint32_t i = nextIndex++; i < end; i = nextIndex++)
+			func(i);
+	};
+
+	uint32_t numJobs = (std::min)(count - 1, GetNumThreads());
+	pendingJobs = numJobs;
+
+	for (uint32_t i = 0; i < numJobs; ++i)
+	{
+		Submit( [&]() {
+			job();
+			pendingJobs--;
+		});
+	}
+
+	job();
+
+	// Jobs may still sit in the queue if workers are busy, help run them
+	while (pendingJobs > 0)
+	{
+		if (!RunPendingTask())
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (pendingJobs > 0)
+				mIdleCondition.wait_for(lock, std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void ThreadPool::WaitAll()
+{
+	while (RunPendingTask());
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (!mTasks.empty() || mActiveTasks > 0)
+		mIdleCondition.wait(lock);
+}
+
+void ParallelFor( uint32_t begin, uint32_t end, const ThreadPool::IndexTask& func )
+{
+	ThreadPool* threadPool = ThreadPool::GetSingletonPtr();
+
+	if (threadPool)
+		threadPool->ParallelFor(begin, end, func);
+	else
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			func(i);
+	}
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,67 @@
+#ifndef ThreadPool_h__
+#define ThreadPool_h__
+
+#include <Core/Prerequisites.h>
+#include <Core/Singleton.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+namespace RcEngine {
+
+/**
+ * Fixed size pool of worker threads. Tasks are executed in FIFO order. A thread waiting
+ * on a ParallelFor helps executing queued tasks, so it is safe to nest ParallelFor calls
+ * inside of tasks.
+ */
+class _ApiExport ThreadPool : public Singleton<ThreadPool>
+{
+public:
+	typedef std::function<void()> Task;
+	typedef std::function<void(uint32_t)> IndexTask;
+
+public:
+	ThreadPool();
+	ThreadPool(uint32_t numThreads);
+	~ThreadPool();
+
+	uint32_t GetNumThreads() const			{ return mWorkers.size(); }
+
+	void Submit(const Task& task);
+
+	/**
+	 * Run func(i) for every i in [begin, end) across the pool, return after all finished.
+	 */
+	void ParallelFor(uint32_t begin, uint32_t end, const IndexTask& func);
+
+	/**
+	 * Block until the task queue is empty and all workers are idle.
+	 */
+	void WaitAll();
+
+private:
+	void Start(uint32_t numThreads);
+	void WorkerThread();
+	bool RunPendingTask();
+
+private:
+	vector<std::thread> mWorkers;
+	std::queue<Task> mTasks;
+
+	std::mutex mMutex;
+	std::condition_variable mTaskCondition;
+	std::condition_variable mIdleCondition;
+
+	uint32_t mActiveTasks;
+	bool mShutdown;
+};
+
+/**
+ * Use ThreadPool if exits, otherwise run in calling thread.
+ */
+_ApiExport void ParallelFor(uint32_t begin, uint32_t end, const ThreadPool::IndexTask& func);
+
+} // Namespace RcEngine
+
+#endif // ThreadPool_h__
@@ -33,7 +33,7 @@ AnimationClip::~AnimationClip()
 	
 }
 
-void AnimationClip::LoadImpl()
+void AnimationClip::PrepareImpl()
 {
 	FileSystem& fileSystem = FileSystem::GetSingleton();
 
@@ -70,6 +70,11 @@ void AnimationClip::LoadImpl()
 	}
 }
 
+void AnimationClip::LoadImpl()
+{
+	// Animation clip has no GPU resource, all loaded in PrepareImpl
+}
+
 void AnimationClip::UnloadImpl()
 {
 
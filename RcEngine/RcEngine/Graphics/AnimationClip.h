@@ -46,6 +46,7 @@ public:
 	float GetDuration() const { return mDuration; }
 
 protected:
+	void PrepareImpl();
 	void LoadImpl();
 	void UnloadImpl();
 
@@ -0,0 +1,818 @@
+#include <Graphics/BlockCompression.h>
+#include <Core/ThreadPool.h>
+#include <Core/Exception.h>
+
+#ifdef RC_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace RcEngine {
+
+namespace {
+
+enum BlockFormat
+{
+	BF_BC1,			// Opaque, 4 color mode
+	BF_BC1A,		// 3 color mode with transparent black for blocks with alpha below 128
+	BF_BC3,
+	BF_BC4,
+	BF_BC5,
+	BF_BC7,
+	BF_Unsupported
+};
+
+BlockFormat GetBlockFormat(PixelFormat format)
+{
+	switch (format)
+	{
+	case PF_RGB_DXT1_UNORM:
+	case PF_SRGB_DXT1_UNORM:
+		return BF_BC1;
+	case PF_RGBA_DXT1_UNORM:
+	case PF_SRGB_ALPHA_DXT1_UNORM:
+		return BF_BC1A;
+	case PF_RGBA_DXT5_UNORM:
+	case PF_SRGB_ALPHA_DXT5_UNORM:
+		return BF_BC3;
+	case PF_R_ATI1N_UNORM:
+		return BF_BC4;
+	case PF_RG_ATI2N_UNORM:
+		return BF_BC5;
+	case PF_RGB_BP_UNORM:
+	case PF_SRGB_BP_UNORM:
+		return BF_BC7;
+	default:
+		return BF_Unsupported;
+	}
+}
+
+// BC7 4 bit index interpolation weights, out of 64
+const uint32_t BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// BC7Weights / 64, constant so blocks can be encoded on several threads
+const float BC7IndexFactors[16] = {
+	0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+	34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+};
+
+/**
+ * Block pixels as structure of arrays, Weights is 0 for pixels ignored by endpoint fit.
+ */
+struct BlockPixels
+{
+	float Channels[4][16];
+	float Weights[16];
+	uint32_t NumChannels;
+};
+
+/**
+ * Nearest palette entry of each pixel, return weighted squared error of block.
+ */
+float FindIndices(const BlockPixels& pixels, const float palette[][4], uint32_t paletteSize, uint8_t indices[16])
+{
+#ifdef RC_SSE2
+	__m128 totalError = _mm_setzero_ps();
+	for (uint32_t i = 0; i < 16; i += 4)
+	{
+		__m128 bestError = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+
+		for (uint32_t p = 0; p < paletteSize; ++p)
+		{
+			__m128 error = _mm_setzero_ps();
+			for (uint32_t c = 0; c < pixels.NumChannels; ++c)
+			{
+				__m128 diff = _mm_sub_ps(_mm_loadu_ps(&pixels.Channels[c][i]), _mm_set1_ps(palette[p][c]));
+				error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+			}
+
+			__m128i less = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+			bestError = _mm_min_ps(error, bestError);
+			bestIndex = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(p)), _mm_andnot_si128(less, bestIndex));
+		}
+
+		totalError = _mm_add_ps(totalError, _mm_mul_ps(bestError, _mm_loadu_ps(&pixels.Weights[i])));
+
+		int32_t index[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(index), bestIndex);
+		for (uint32_t k = 0; k < 4; ++k)
+			indices[i + k] = static_cast<uint8_t>(index[k]);
+	}
+
+	float errors[4];
+	_mm_storeu_ps(errors, totalError);
+	return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+	float totalError = 0.0f;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		float bestError = FLT_MAX;
+		for (uint32_t p = 0; p < paletteSize; ++p)
+		{
+			float error = 0.0f;
+			for (uint32_t c = 0; c < pixels.NumChannels; ++c)
+			{
+				float diff = pixels.Channels[c][i] - palette[p][c];
+				error += diff * diff;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = static_cast<uint8_t>(p);
+			}
+		}
+		totalError += bestError * pixels.Weights[i];
+	}
+	return totalError;
+#endif
+}
+
+/**
+ * Initial endpoints, bounding box diagonal for fast quality, otherwise extent of pixels along
+ * principal axis of weighted covariance.
+ */
+void ComputeEndpoints(const BlockPixels& pixels, BlockCompressionQuality quality, float e0[4], float e1[4])
+{
+	const uint32_t numChannels = pixels.NumChannels;
+
+	float minColor[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float maxColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float weightSum = 0.0f;
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		if (pixels.Weights[i] == 0.0f)
+			continue;
+
+		weightSum += pixels.Weights[i];
+		for (uint32_t c = 0; c < numChannels; ++c)
+		{
+			minColor[c] = (std::min)(minColor[c], pixels.Channels[c][i]);
+			maxColor[c] = (std::max)(maxColor[c], pixels.Channels[c][i]);
+			mean[c] += pixels.Channels[c][i] * pixels.Weights[i];
+		}
+	}
+
+	if (weightSum == 0.0f)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			e0[c] = e1[c] = 0.0f;
+		return;
+	}
+
+	for (uint32_t c = 0; c < numChannels; ++c)
+		mean[c] /= weightSum;
+
+	if (quality == BCQ_Fast)
+	{
+		// Box diagonal, channels correlated negatively with the widest one go the other way
+		uint32_t mainChannel = 0;
+		for (uint32_t c = 1; c < numChannels; ++c)
+		{
+			if (maxColor[c] - minColor[c] > maxColor[mainChannel] - minColor[mainChannel])
+				mainChannel = c;
+		}
+
+		for (uint32_t c = 0; c < numChannels; ++c)
+		{
+			float covariance = 0.0f;
+			for (uint32_t i = 0; i < 16; ++i)
+				covariance += (pixels.Channels[c][i] - mean[c]) * (pixels.Channels[mainChannel][i] - mean[mainChannel]) * pixels.Weights[i];
+
+			// Inset box, extremes are rarely hit by interpolated colors
+			float inset = (maxColor[c] - minColor[c]) / 16.0f;
+			e0[c] = maxColor[c] - inset;
+			e1[c] = minColor[c] + inset;
+
+			if (covariance < 0.0f)
+				std::swap(e0[c], e1[c]);
+		}
+		return;
+	}
+
+	float covariance[4][4] = { 0 };
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t a = 0; a < numChannels; ++a)
+		{
+			float da = (pixels.Channels[a][i] - mean[a]) * pixels.Weights[i];
+			for (uint32_t b = a; b < numChannels; ++b)
+				covariance[a][b] += da * (pixels.Channels[b][i] - mean[b]);
+		}
+	}
+
+	for (uint32_t a = 0; a < numChannels; ++a)
+		for (uint32_t b = 0; b < a; ++b)
+			covariance[a][b] = covariance[b][a];
+
+	// Power iteration, start from box diagonal
+	float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (uint32_t c = 0; c < numChannels; ++c)
+		axis[c] = maxColor[c] - minColor[c];
+
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float maxComponent = 0.0f;
+		for (uint32_t a = 0; a < numChannels; ++a)
+		{
+			for (uint32_t b = 0; b < numChannels; ++b)
+				next[a] += covariance[a][b] * axis[b];
+			maxComponent = (std::max)(maxComponent, fabsf(next[a]));
+		}
+
+		if (maxComponent < 1e-6f)
+			break;
+
+		for (uint32_t c = 0; c < numChannels; ++c)
+			axis[c] = next[c] / maxComponent;
+	}
+
+	float axisLength = 0.0f;
+	for (uint32_t c = 0; c < numChannels; ++c)
+		axisLength += axis[c] * axis[c];
+
+	if (axisLength < 1e-12f)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			e0[c] = e1[c] = mean[c];
+		return;
+	}
+
+	axisLength = sqrtf(axisLength);
+	for (uint32_t c = 0; c < numChannels; ++c)
+		axis[c] /= axisLength;
+
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		if (pixels.Weights[i] == 0.0f)
+			continue;
+
+		float t = 0.0f;
+		for (uint32_t c = 0; c < numChannels; ++c)
+			t += (pixels.Channels[c][i] - mean[c]) * axis[c];
+
+		minT = (std::min)(minT, t);
+		maxT = (std::max)(maxT, t);
+	}
+
+	for (uint32_t c = 0; c < numChannels; ++c)
+	{
+		e0[c] = (std::min)(255.0f, (std::max)(0.0f, mean[c] + axis[c] * maxT));
+		e1[c] = (std::min)(255.0f, (std::max)(0.0f, mean[c] + axis[c] * minT));
+	}
+}
+
+/**
+ * Least squares endpoints for fixed indices, indexFactors maps index to interpolation factor
+ * toward e1. Return false if system is singular, e.g. all pixels use one index.
+ */
+bool RefineEndpoints(const BlockPixels& pixels, const uint8_t indices[16], const float* indexFactors, float e0[4], float e1[4])
+{
+	float a = 0.0f, b = 0.0f, c = 0.0f;
+	float x0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float x1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		float w = pixels.Weights[i];
+		float t = indexFactors[indices[i]];
+		float s = 1.0f - t;
+
+		a += w * s * s;
+		b += w * s * t;
+		c += w * t * t;
+
+		for (uint32_t ch = 0; ch < pixels.NumChannels; ++ch)
+		{
+			x0[ch] += w * s * pixels.Channels[ch][i];
+			x1[ch] += w * t * pixels.Channels[ch][i];
+		}
+	}
+
+	float det = a * c - b * b;
+	if (fabsf(det) < 1e-6f)
+		return false;
+
+	float invDet = 1.0f / det;
+	for (uint32_t ch = 0; ch < pixels.NumChannels; ++ch)
+	{
+		e0[ch] = (std::min)(255.0f, (std::max)(0.0f, (c * x0[ch] - b * x1[ch]) * invDet));
+		e1[ch] = (std::min)(255.0f, (std::max)(0.0f, (a * x1[ch] - b * x0[ch]) * invDet));
+	}
+
+	return true;
+}
+
+uint32_t GetRefineIterations(BlockCompressionQuality quality)
+{
+	switch (quality)
+	{
+	case BCQ_Fast:	 return 0;
+	case BCQ_Normal: return 2;
+	default:		 return 6;
+	}
+}
+
+void LoadBlockPixels(const uint8_t pixels[64], uint32_t numChannels, BlockPixels& block)
+{
+	block.NumChannels = numChannels;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			block.Channels[c][i] = pixels[i * 4 + c];
+		block.Weights[i] = 1.0f;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC1
+
+uint16_t QuantizeColor565(const float color[4])
+{
+	uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void ExpandColor565(uint16_t color, float expanded[4])
+{
+	uint32_t r = (color >> 11) & 31;
+	uint32_t g = (color >> 5) & 63;
+	uint32_t b = color & 31;
+
+	expanded[0] = static_cast<float>((r << 3) | (r >> 2));
+	expanded[1] = static_cast<float>((g << 2) | (g >> 4));
+	expanded[2] = static_cast<float>((b << 3) | (b >> 2));
+	expanded[3] = 255.0f;
+}
+
+/**
+ * Encode color block. In 3 color mode pixels with alpha below 128 use index 3, transparent black.
+ */
+void EncodeBC1(const uint8_t pixels[64], uint8_t* block, bool threeColorMode, BlockCompressionQuality quality)
+{
+	// Index to interpolation factor toward color1
+	static const float FourColorFactors[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	static const float ThreeColorFactors[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+	BlockPixels blockPixels;
+	LoadBlockPixels(pixels, 3, blockPixels);
+
+	bool transparent[16];
+	uint32_t numTransparent = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		transparent[i] = threeColorMode && pixels[i * 4 + 3] < 128;
+		if (transparent[i])
+		{
+			blockPixels.Weights[i] = 0.0f;
+			numTransparent++;
+		}
+	}
+
+	uint16_t* colors = reinterpret_cast<uint16_t*>(block);
+	uint32_t* indexBits = reinterpret_cast<uint32_t*>(block + 4);
+
+	if (numTransparent == 16)
+	{
+		colors[0] = colors[1] = 0;
+		*indexBits = 0xFFFFFFFF;
+		return;
+	}
+
+	// 3 color mode only needed for blocks with transparent pixels
+	threeColorMode = numTransparent > 0;
+	const float* indexFactors = threeColorMode ? ThreeColorFactors : FourColorFactors;
+
+	float e0[4], e1[4];
+	ComputeEndpoints(blockPixels, quality, e0, e1);
+
+	float bestError = FLT_MAX;
+	uint32_t numIterations = GetRefineIterations(quality);
+	for (uint32_t iteration = 0; iteration <= numIterations; ++iteration)
+	{
+		uint16_t color0 = QuantizeColor565(e0);
+		uint16_t color1 = QuantizeColor565(e1);
+
+		// 4 color mode needs color0 > color1, 3 color mode color0 <= color1
+		if ((threeColorMode && color0 > color1) || (!threeColorMode && color0 < color1))
+			std::swap(color0, color1);
+
+		float palette[4][4];
+		ExpandColor565(color0, palette[0]);
+		ExpandColor565(color1, palette[1]);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			if (threeColorMode)
+				palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+			else
+			{
+				palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+				palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+			}
+		}
+
+		uint8_t indices[16];
+		float error;
+		if (!threeColorMode && color0 == color1)
+		{
+			// Equal colors decode as 3 color mode, index 0 is safe
+			memset(indices, 0, sizeof(indices));
+			error = 0.0f;
+			for (uint32_t i = 0; i < 16; ++i)
+				for (uint32_t c = 0; c < 3; ++c)
+					error += (blockPixels.Channels[c][i] - palette[0][c]) * (blockPixels.Channels[c][i] - palette[0][c]);
+		}
+		else
+			error = FindIndices(blockPixels, palette, threeColorMode ? 3 : 4, indices);
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (transparent[i])
+				indices[i] = 3;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			colors[0] = color0;
+			colors[1] = color1;
+
+			uint32_t bits = 0;
+			for (uint32_t i = 0; i < 16; ++i)
+				bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+			*indexBits = bits;
+		}
+
+		if (bestError == 0.0f || iteration == numIterations)
+			break;
+
+		// Refit from quantized palette order
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			e0[c] = palette[0][c];
+			e1[c] = palette[1][c];
+		}
+
+		if (!RefineEndpoints(blockPixels, indices, indexFactors, e0, e1))
+			break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC4
+
+void BuildBC4Palette(uint8_t a0, uint8_t a1, uint8_t palette[8])
+{
+	palette[0] = a0;
+	palette[1] = a1;
+
+	if (a0 > a1)
+	{
+		for (uint32_t i = 1; i < 7; ++i)
+			palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+	}
+	else
+	{
+		for (uint32_t i = 1; i < 5; ++i)
+			palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+/**
+ * Nearest of 8 palette values for 16 values, return squared error.
+ */
+uint32_t FindBC4Indices(const uint8_t values[16], const uint8_t palette[8], uint8_t indices[16])
+{
+	uint8_t errors[16];
+
+#ifdef RC_SSE2
+	// All 16 values in one register, unsigned absolute difference per byte
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+	__m128i bestError = _mm_set1_epi8(static_cast<char>(0xFF));
+	__m128i bestIndex = _mm_setzero_si128();
+
+	for (uint32_t p = 0; p < 8; ++p)
+	{
+		__m128i entry = _mm_set1_epi8(static_cast<char>(palette[p]));
+		__m128i error = _mm_or_si128(_mm_subs_epu8(v, entry), _mm_subs_epu8(entry, v));
+
+		__m128i lessEqual = _mm_cmpeq_epi8(_mm_min_epu8(error, bestError), error);
+		__m128i less = _mm_andnot_si128(_mm_cmpeq_epi8(error, bestError), lessEqual);
+
+		bestError = _mm_min_epu8(error, bestError);
+		bestIndex = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi8(static_cast<char>(p))), _mm_andnot_si128(less, bestIndex));
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(errors), bestError);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+#else
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		errors[i] = 255;
+		indices[i] = 0;
+		for (uint32_t p = 0; p < 8; ++p)
+		{
+			uint8_t error = static_cast<uint8_t>(abs(static_cast<int32_t>(values[i]) - palette[p]));
+			if (error < errors[i])
+			{
+				errors[i] = error;
+				indices[i] = static_cast<uint8_t>(p);
+			}
+		}
+	}
+#endif
+
+	uint32_t totalError = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+		totalError += static_cast<uint32_t>(errors[i]) * errors[i];
+
+	return totalError;
+}
+
+/**
+ * Encode one channel, stride is byte distance between channel values of adjacent pixels.
+ */
+void EncodeBC4(const uint8_t* channel, uint32_t stride, uint8_t* block, BlockCompressionQuality quality)
+{
+	uint8_t values[16];
+	uint8_t minValue = 255, maxValue = 0;
+	uint8_t minInner = 255, maxInner = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		values[i] = channel[i * stride];
+		minValue = (std::min)(minValue, values[i]);
+		maxValue = (std::max)(maxValue, values[i]);
+
+		if (values[i] != 0 && values[i] != 255)
+		{
+			minInner = (std::min)(minInner, values[i]);
+			maxInner = (std::max)(maxInner, values[i]);
+		}
+	}
+
+	uint32_t bestError = UINT32_MAX;
+	uint8_t bestEndpoints[2];
+	uint8_t bestIndices[16];
+
+	auto TryEndpoints = [&](uint8_t a0, uint8_t a1) {
+		uint8_t palette[8];
+		uint8_t indices[16];
+		BuildBC4Palette(a0, a1, palette);
+
+		uint32_t error = FindBC4Indices(values, palette, indices);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestEndpoints[0] = a0;
+			bestEndpoints[1] = a1;
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+	};
+
+	// 8 value mode spans the full range
+	TryEndpoints(maxValue, minValue);
+
+	if (quality != BCQ_Fast && bestError > 0)
+	{
+		// 6 value mode has exact 0 and 255, interpolants only span the inner values
+		if (minInner <= maxInner && (minValue == 0 || maxValue == 255))
+			TryEndpoints(minInner, maxInner);
+
+		if (quality == BCQ_High)
+		{
+			for (int32_t d0 = -2; d0 <= 2; ++d0)
+			{
+				for (int32_t d1 = -2; d1 <= 2; ++d1)
+				{
+					int32_t a0 = (std::min)(255, (std::max)(0, static_cast<int32_t>(maxValue) + d0));
+					int32_t a1 = (std::min)(255, (std::max)(0, static_cast<int32_t>(minValue) + d1));
+					if (a0 > a1)
+						TryEndpoints(static_cast<uint8_t>(a0), static_cast<uint8_t>(a1));
+				}
+			}
+		}
+	}
+
+	block[0] = bestEndpoints[0];
+	block[1] = bestEndpoints[1];
+
+	uint64_t bits = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+		bits |= static_cast<uint64_t>(bestIndices[i]) << (i * 3);
+
+	for (uint32_t i = 0; i < 6; ++i)
+		block[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC7 mode 6
+
+struct BitWriter
+{
+	BitWriter(uint8_t* data) : Data(data), Position(0) {}
+
+	void Write(uint32_t value, uint32_t numBits)
+	{
+		for (uint32_t i = 0; i < numBits; ++i, ++Position)
+		{
+			if ((value >> i) & 1)
+				Data[Position >> 3] |= static_cast<uint8_t>(1 << (Position & 7));
+		}
+	}
+
+	uint8_t* Data;
+	uint32_t Position;
+};
+
+/**
+ * Quantize RGBA endpoint to 7 bits per channel and shared p-bit, choose p-bit with lower error.
+ */
+void QuantizeBC7Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& pbit)
+{
+	float bestError = FLT_MAX;
+	for (uint32_t p = 0; p < 2; ++p)
+	{
+		uint32_t q[4];
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			int32_t value = static_cast<int32_t>((endpoint[c] - p) * 0.5f + 0.5f);
+			q[c] = static_cast<uint32_t>((std::min)(127, (std::max)(0, value)));
+
+			float diff = static_cast<float>(q[c] * 2 + p) - endpoint[c];
+			error += diff * diff;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			pbit = p;
+			memcpy(quantized, q, sizeof(q));
+		}
+	}
+}
+
+void EncodeBC7(const uint8_t pixels[64], uint8_t* block, BlockCompressionQuality quality)
+{
+	BlockPixels blockPixels;
+	LoadBlockPixels(pixels, 4, blockPixels);
+
+	float e0[4], e1[4];
+	ComputeEndpoints(blockPixels, quality, e0, e1);
+
+	float bestError = FLT_MAX;
+	uint32_t numIterations = GetRefineIterations(quality);
+	for (uint32_t iteration = 0; iteration <= numIterations; ++iteration)
+	{
+		uint32_t q0[4], q1[4], p0, p1;
+		QuantizeBC7Endpoint(e0, q0, p0);
+		QuantizeBC7Endpoint(e1, q1, p1);
+
+		float palette[16][4];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				uint32_t v0 = q0[c] * 2 + p0;
+				uint32_t v1 = q1[c] * 2 + p1;
+				palette[i][c] = static_cast<float>(((64 - BC7Weights[i]) * v0 + BC7Weights[i] * v1 + 32) >> 6);
+			}
+		}
+
+		uint8_t indices[16];
+		float error = FindIndices(blockPixels, palette, 16, indices);
+
+		if (error < bestError)
+		{
+			bestError = error;
+
+			// Anchor index MSB is implicit 0, mirror palette if needed, weights are symmetric
+			uint8_t blockIndices[16];
+			memcpy(blockIndices, indices, sizeof(indices));
+			if (blockIndices[0] >= 8)
+			{
+				std::swap(q0, q1);
+				std::swap(p0, p1);
+				for (uint32_t i = 0; i < 16; ++i)
+					blockIndices[i] = static_cast<uint8_t>(15 - blockIndices[i]);
+			}
+
+			memset(block, 0, 16);
+			BitWriter writer(block);
+			writer.Write(1 << 6, 7);
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				writer.Write(q0[c], 7);
+				writer.Write(q1[c], 7);
+			}
+			writer.Write(p0, 1);
+			writer.Write(p1, 1);
+
+			writer.Write(blockIndices[0], 3);
+			for (uint32_t i = 1; i < 16; ++i)
+				writer.Write(blockIndices[i], 4);
+
+			assert(writer.Position == 128);
+		}
+
+		if (bestError == 0.0f || iteration == numIterations)
+			break;
+
+		if (!RefineEndpoints(blockPixels, indices, BC7IndexFactors, e0, e1))
+			break;
+	}
+}
+
+} // Namespace
+
+bool BlockCompression::IsSupported( PixelFormat format )
+{
+	return GetBlockFormat(format) != BF_Unsupported;
+}
+
+uint32_t BlockCompression::GetBlockSize( PixelFormat format )
+{
+	switch (GetBlockFormat(format))
+	{
+	case BF_BC1:
+	case BF_BC1A:
+	case BF_BC4:
+		return 8;
+	case BF_BC3:
+	case BF_BC5:
+	case BF_BC7:
+		return 16;
+	default:
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Unsupported block compression format", "BlockCompression::GetBlockSize");
+	}
+}
+
+void BlockCompression::EncodeBlock( PixelFormat format, const uint8_t pixels[64], void* block, BlockCompressionQuality quality )
+{
+	uint8_t* blockData = static_cast<uint8_t*>(block);
+
+	switch (GetBlockFormat(format))
+	{
+	case BF_BC1:
+		EncodeBC1(pixels, blockData, false, quality);
+		break;
+	case BF_BC1A:
+		EncodeBC1(pixels, blockData, true, quality);
+		break;
+	case BF_BC3:
+		EncodeBC4(pixels + 3, 4, blockData, quality);
+		EncodeBC1(pixels, blockData + 8, false, quality);
+		break;
+	case BF_BC4:
+		EncodeBC4(pixels, 4, blockData, quality);
+		break;
+	case BF_BC5:
+		EncodeBC4(pixels, 4, blockData, quality);
+		EncodeBC4(pixels + 1, 4, blockData + 8, quality);
+		break;
+	case BF_BC7:
+		EncodeBC7(pixels, blockData, quality);
+		break;
+	default:
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Unsupported block compression format", "BlockCompression::EncodeBlock");
+	}
+}
+
+void BlockCompression::CompressSurface( PixelFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint32_t srcRowPitch,
+	void* dest, BlockCompressionQuality quality )
+{
+	const uint32_t blockSize = GetBlockSize(format);
+	const uint32_t numBlocksX = (width + 3) / 4;
+	const uint32_t numBlocksY = (height + 3) / 4;
+	const uint32_t destRowPitch = numBlocksX * blockSize;
+
+	uint8_t* destData = static_cast<uint8_t*>(dest);
+
+	ParallelFor(0, numBlocksY, [&](uint32_t blockY) {
+		uint8_t pixels[64];
+		for (uint32_t blockX = 0; blockX < numBlocksX; ++blockX)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				uint32_t srcY = (std::min)(blockY * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					uint32_t srcX = (std::min)(blockX * 4 + x, width - 1);
+					memcpy(pixels + (y * 4 + x) * 4, src + srcY * srcRowPitch + srcX * 4, 4);
+				}
+			}
+
+			EncodeBlock(format, pixels, destData + blockY * destRowPitch + blockX * blockSize, quality);
+		}
+	});
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,45 @@
+#ifndef BlockCompression_h__
+#define BlockCompression_h__
+
+#include <Core/Prerequisites.h>
+#include <Graphics/PixelFormat.h>
+
+namespace RcEngine {
+
+enum BlockCompressionQuality
+{
+	BCQ_Fast = 0,		// Bounding box endpoints, no refinement
+	BCQ_Normal,			// Principal axis endpoints, least squares refinement
+	BCQ_High			// More refinement iterations and endpoint trials
+};
+
+/**
+ * CPU encoder of BC1/BC3/BC4/BC5/BC7 blocks from RGBA8 pixels, index search uses SSE2 when
+ * available. BC7 only uses mode 6 (one subset, RGBA, 4 bit indices), good for smooth content
+ * but worse than a full mode search on blocks with several distinct colors.
+ */
+class _ApiExport BlockCompression
+{
+public:
+	/// Return if format can be encoded, sRGB variants included.
+	static bool IsSupported(PixelFormat format);
+
+	/// Bytes of a 4x4 block, 8 for BC1/BC4 and 16 for others.
+	static uint32_t GetBlockSize(PixelFormat format);
+
+	/**
+	 * Encode 16 RGBA8 pixels in row order into one block. BC4 encodes red, BC5 red and green.
+	 */
+	static void EncodeBlock(PixelFormat format, const uint8_t pixels[64], void* block, BlockCompressionQuality quality);
+
+	/**
+	 * Encode RGBA8 surface, edge blocks repeat edge pixels. Block rows are encoded in parallel,
+	 * dest row pitch is GetBlockSize * ((width + 3) / 4).
+	 */
+	static void CompressSurface(PixelFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint32_t srcRowPitch,
+		void* dest, BlockCompressionQuality quality);
+};
+
+} // Namespace RcEngine
+
+#endif // BlockCompression_h__
@@ -815,14 +815,22 @@ static DXGI_FORMAT GetDXGIFormat(const DDS_PIXELFORMAT& ddpf)
 }
 
 
-bool Image::LoadImageFromDDS( const String& filename )
+bool Image::LoadImageFromDDS( const String& filename, uint32_t firstLevel /*= 0*/ )
 {
-	// clear any previously loaded images
-	Clear();
-
 	FileStream stream;
 	if (stream.Open(filename, FILE_READ) == false)
+	{
+		Clear();
 		return false;
+	}
+
+	return LoadImageFromDDS(stream, firstLevel);
+}
+
+bool Image::LoadImageFromDDS( Stream& stream, uint32_t firstLevel /*= 0*/ )
+{
+	// clear any previously loaded images
+	Clear();
 
 	// Need at least enough data to fill the header and magic number to be a valid DDS
 	if (stream.GetSize() < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
@@ -1027,18 +1035,46 @@ bool Image::LoadImageFromDDS( const String& filename )
 	// Unmaping to Engine Pixel Format
 	mFormat = DXGI2PixelFormat[format];
 
-	uint32_t imageDataSize = stream.GetSize() - stream.GetPosition();
-	uint8_t* pData = new uint8_t[imageDataSize];
-	stream.Read(pData, imageDataSize);
+	// Levels above firstLevel are skipped, at least one level is loaded
+	mFirstLevel = (std::min)(firstLevel, mLevels - 1);
 
+	const uint32_t numSurfaces = (mType == TT_TextureCube) ? mLayers * 6 : mLayers;
+
+	// Size of all levels and of loaded levels of one surface
 	size_t NumBytes = 0;
 	size_t RowBytes = 0;
 
+	size_t surfaceSize = 0, loadedSize = 0;
+	{
+		size_t w = mWidth;
+		size_t h = mHeight;
+		size_t d = mDepth;
+
+		for (uint32_t i = 0; i < mLevels; ++i)
+		{
+			GetSurfaceInfo(w, h, format, &NumBytes, &RowBytes, nullptr);
+
+			surfaceSize += NumBytes * d;
+			if (i >= mFirstLevel)
+				loadedSize += NumBytes * d;
+
+			w = std::max<size_t>(1, w >> 1);
+			h = std::max<size_t>(1, h >> 1);
+			d = std::max<size_t>(1, d >> 1);
+		}
+	}
+
+	if (stream.GetPosition() + surfaceSize * numSurfaces > stream.GetSize())
+	{
+		return false;
+		// return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+	}
+
+	uint8_t* pData = new uint8_t[loadedSize * numSurfaces];
 	uint8_t* pSrcBits = pData;
-	uint8_t* pEndBits = pData + imageDataSize;
 
 	// load all surfaces for the image (6 surfaces for cubemaps)
-	for (uint32_t j = 0; j < uint32_t(mType == TT_TextureCube ? mLayers * 6 : mLayers); j++) 
+	for (uint32_t j = 0; j < numSurfaces; j++) 
 	{
 		size_t w = mWidth;
 		size_t h = mHeight;
@@ -1050,160 +1086,210 @@ bool Image::LoadImageFromDDS( const String& filename )
 
 			size_t totalSize = NumBytes*d;
 
-			SurfaceInfo surface = { pSrcBits, RowBytes, NumBytes };
-			mSurfaces.push_back(surface);
-
-			if (pSrcBits + totalSize > pEndBits)
+			if (i < mFirstLevel)
 			{
-				return false;
-				// return HRESULT_FROM_WIN32( ERROR_HANDLE_EOF );
+				// Seek over skipped level, only mip tail is read
+				stream.Seek(stream.GetPosition() + totalSize);
 			}
+			else
+			{
+				stream.Read(pSrcBits, totalSize);
 
-			pSrcBits += totalSize;
+				SurfaceInfo surface = { pSrcBits, RowBytes, NumBytes };
+				mSurfaces.push_back(surface);
 
-			w = std::max(1U, w >> 1);
-			h = std::max(1U, h >> 1);
-			d = std::max(1U, d >> 1);
-		}
+				pSrcBits += totalSize;
+			}
 
+			w = std::max<size_t>(1, w >> 1);
+			h = std::max<size_t>(1, h >> 1);
+			d = std::max<size_t>(1, d >> 1);
+		}
 	}
 
 	assert(stream.GetPosition() == stream.GetSize());
 
+	// Image describes loaded levels only
+	mWidth = std::max(1U, mWidth >> mFirstLevel);
+	mHeight = std::max(1U, mHeight >> mFirstLevel);
+	mDepth = std::max(1U, mDepth >> mFirstLevel);
+	mLevels -= mFirstLevel;
+
 	mValid = true;
 	return mValid;
 }
 
-//bool Image::SaveImageToDDS( const String& filename )
-//{
-//	// Setup header
-//	const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
-//	uint8_t fileHeader[ MAX_HEADER_SIZE ];
-//
-//	*reinterpret_cast<uint32_t*>(&fileHeader[0]) = DDS_MAGIC;
-//
-//	auto header = reinterpret_cast<DDS_HEADER*>( &fileHeader[0] + sizeof(uint32_t) );
-//	size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
-//	memset( header, 0, sizeof(DDS_HEADER) );
-//	header->size = sizeof( DDS_HEADER );
-//	header->flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
-//	header->height = mWidth;
-//	header->width = mHeight;
-//	header->mipMapCount = 1;
-//	header->caps = DDS_SURFACE_FLAGS_TEXTURE;
-//
-//	// Try to use a legacy .DDS pixel format for better tools support, otherwise fallback to 'DX10' header extension
-//	DDS_HEADER_DXT10* extHeader = nullptr;
-//	switch(mFormat)
-//	{
-//	case PF_RGBA8_UNORM:					memcpy(&header->ddspf,  &DDSPF_A8B8G8R8, sizeof(DDS_PIXELFORMAT) );    break;
-//	case PF_RG16_UNORM:						memcpy( &header->ddspf, &DDSPF_G16R16, sizeof(DDS_PIXELFORMAT) );      break;
-//	case PF_RG8_UNORM:						memcpy( &header->ddspf, &DDSPF_A8L8, sizeof(DDS_PIXELFORMAT) );        break;
-//	case PF_R16_UNORM:						memcpy( &header->ddspf, &DDSPF_L16, sizeof(DDS_PIXELFORMAT) );         break;
-//	case PF_R8_UNORM:						memcpy( &header->ddspf, &DDSPF_L8, sizeof(DDS_PIXELFORMAT) );          break;
-//	//case PF_A8_UNORM:						memcpy( &header->ddspf, &DDSPF_A8, sizeof(DDS_PIXELFORMAT) );          break;
-//	//case PF_R8G8_B8G8_UNORM:				memcpy( &header->ddspf, &DDSPF_R8G8_B8G8, sizeof(DDS_PIXELFORMAT) );   break;
-//	//case PF_G8R8_G8B8_UNORM:				memcpy( &header->ddspf, &DDSPF_G8R8_G8B8, sizeof(DDS_PIXELFORMAT) );   break;
-//	case PF_RGBA_DXT1_UNORM:				memcpy( &header->ddspf, &DDSPF_DXT1, sizeof(DDS_PIXELFORMAT) );        break;
-//	case PF_RGBA_DXT3_UNORM:				memcpy( &header->ddspf, &DDSPF_DXT3, sizeof(DDS_PIXELFORMAT) );        break;
-//	case PF_RGBA_DXT5_UNORM:				memcpy( &header->ddspf, &DDSPF_DXT5, sizeof(DDS_PIXELFORMAT) );        break;
-//	case PF_R_ATI1N_UNORM:					memcpy( &header->ddspf, &DDSPF_BC4_UNORM, sizeof(DDS_PIXELFORMAT) );   break;
-//	case PF_R_ATI1N_SNORM:					memcpy( &header->ddspf, &DDSPF_BC4_SNORM, sizeof(DDS_PIXELFORMAT) );   break;
-//	case PF_RG_ATI2N_UNORM:					memcpy( &header->ddspf, &DDSPF_BC5_UNORM, sizeof(DDS_PIXELFORMAT) );   break;
-//	case PF_RG_ATI2N_SNORM:					memcpy( &header->ddspf, &DDSPF_BC5_SNORM, sizeof(DDS_PIXELFORMAT) );   break;
-//	case PF_B5G6R5:							memcpy( &header->ddspf, &DDSPF_R5G6B5, sizeof(DDS_PIXELFORMAT) );      break;
-//	case PF_BGR5A1:							memcpy( &header->ddspf, &DDSPF_A1R5G5B5, sizeof(DDS_PIXELFORMAT) );    break;
-//	case PF_BGRA8_UNORM:					memcpy( &header->ddspf, &DDSPF_A8R8G8B8, sizeof(DDS_PIXELFORMAT) );    break; // DXGI 1.1
-//	case PF_BGRX8_UNORM:					memcpy( &header->ddspf, &DDSPF_X8R8G8B8, sizeof(DDS_PIXELFORMAT) );    break; // DXGI 1.1
-//	//case PF_YUY2:							memcpy( &header->ddspf, &DDSPF_YUY2, sizeof(DDS_PIXELFORMAT) );        break; // DXGI 1.2
-//	//case PF_B4G4R4A4_UNORM:				memcpy( &header->ddspf, &DDSPF_A4R4G4B4, sizeof(DDS_PIXELFORMAT) );    break; // DXGI 1.2
-//		
-//	// Legacy D3DX formats using D3DFMT enum value as FourCC
-//	case PF_RGBA32F:					    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 116; break; // D3DFMT_A32B32G32R32F
-//	case PF_RGBA16F:					    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 113; break; // D3DFMT_A16B16G16R16F
-//	case PF_RGBA16_UNORM:				    header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 36;  break; // D3DFMT_A16B16G16R16
-//	case PF_RGBA16_SNORM:					header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 110; break; // D3DFMT_Q16W16V16U16
-//	case PF_RG32F:							header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 115; break; // D3DFMT_G32R32F
-//	case PF_RG16F:							header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 112; break; // D3DFMT_G16R16F
-//	case PF_R32F:							header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 114; break; // D3DFMT_R32F
-//	case PF_R16F:							header->ddspf.size = sizeof(DDS_PIXELFORMAT); header->ddspf.flags = DDS_FOURCC; header->ddspf.fourCC = 111; break; // D3DFMT_R16F
-//
-//	//case PF_AI44:
-//	//case PF_IA44:
-//	//case PF_P8:
-//	//case PF_A8P8:
-//	//	return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
-//
-//	default:
-//		memcpy_s( &header->ddspf, sizeof(header->ddspf), &DDSPF_DX10, sizeof(DDS_PIXELFORMAT) );
-//
-//		headerSize += sizeof(DDS_HEADER_DXT10);
-//		extHeader = reinterpret_cast<DDS_HEADER_DXT10*>( reinterpret_cast<uint8_t*>(&fileHeader[0]) + sizeof(uint32_t) + sizeof(DDS_HEADER) );
-//		memset( extHeader, 0, sizeof(DDS_HEADER_DXT10) );
-//		extHeader->dxgiFormat = desc.Format;
-//		extHeader->resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
-//		extHeader->arraySize = 1;
-//		break;
-//	}
-//
-//	//size_t rowPitch, slicePitch, rowCount;
-//	//GetSurfaceInfo( desc.Width, desc.Height, desc.Format, &slicePitch, &rowPitch, &rowCount );
-//
-//	//if ( IsCompressed( desc.Format ) )
-//	//{
-//	//	header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
-//	//	header->pitchOrLinearSize = static_cast<uint32_t>( slicePitch );
-//	//}
-//	//else
-//	//{
-//	//	header->flags |= DDS_HEADER_FLAGS_PITCH;
-//	//	header->pitchOrLinearSize = static_cast<uint32_t>( rowPitch );
-//	//}
-//
-//	//// Setup pixels
-//	//std::unique_ptr<uint8_t[]> pixels( new (std::nothrow) uint8_t[ slicePitch ] );
-//	//if (!pixels)
-//	//	return E_OUTOFMEMORY;
-//
-//	//D3D11_MAPPED_SUBRESOURCE mapped;
-//	//hr = pContext->Map( pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped );
-//	//if ( FAILED(hr) )
-//	//	return hr;
-//
-//	//auto sptr = reinterpret_cast<const uint8_t*>( mapped.pData );
-//	//if ( !sptr )
-//	//{
-//	//	pContext->Unmap( pStaging.Get(), 0 );
-//	//	return E_POINTER;
-//	//}
-//
-//	//uint8_t* dptr = pixels.get();
-//
-//	//size_t msize = std::min<size_t>( rowPitch, mapped.RowPitch );
-//	//for( size_t h = 0; h < rowCount; ++h )
-//	//{
-//	//	memcpy_s( dptr, rowPitch, sptr, msize );
-//	//	sptr += mapped.RowPitch;
-//	//	dptr += rowPitch;
-//	//}
-//
-//	//pContext->Unmap( pStaging.Get(), 0 );
-//
-//	//// Write header & pixels
-//	//DWORD bytesWritten;
-//	//if ( !WriteFile( hFile.get(), fileHeader, static_cast<DWORD>( headerSize ), &bytesWritten, 0 ) )
-//	//	return HRESULT_FROM_WIN32( GetLastError() );
-//
-//	//if ( bytesWritten != headerSize )
-//	//	return E_FAIL;
-//
-//	//if ( !WriteFile( hFile.get(), pixels.get(), static_cast<DWORD>( slicePitch ), &bytesWritten, 0 ) )
-//	//	return HRESULT_FROM_WIN32( GetLastError() );
-//
-//	//if ( bytesWritten != slicePitch )
-//	//	return E_FAIL;
-//
-//	//return S_OK;
-//}
+static DXGI_FORMAT PixelFormat2DXGI(PixelFormat format)
+{
+	// BC1 with punch through alpha has no own DXGI format
+	if (format == PF_RGBA_DXT1_UNORM)
+		return DXGI_FORMAT_BC1_UNORM;
+	if (format == PF_SRGB_ALPHA_DXT1_UNORM)
+		return DXGI_FORMAT_BC1_UNORM_SRGB;
+
+	const uint32_t numFormats = sizeof(DXGI2PixelFormat) / sizeof(DXGI2PixelFormat[0]);
+	for (uint32_t i = 0; i < numFormats; ++i)
+	{
+		if (DXGI2PixelFormat[i] == format)
+			return static_cast<DXGI_FORMAT>(i);
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+bool Image::SaveImageToDDS( const String& filename )
+{
+	if (!mValid)
+		return false;
+
+	DXGI_FORMAT format = PixelFormat2DXGI(mFormat);
+	if (format == DXGI_FORMAT_UNKNOWN || format == DXGI_FORMAT_R8G8B8_UNORM || format == DXGI_FORMAT_B8G8R8_UNORM)
+		return false;
+
+	DDS_HEADER header;
+	memset(&header, 0, sizeof(DDS_HEADER));
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+	header.width = mWidth;
+	header.height = mHeight;
+	header.depth = (mType == TT_Texture3D) ? mDepth : 1;
+	header.mipMapCount = mLevels;
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE;
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+
+	if (mLevels > 1)
+		header.caps |= 0x00400008; // DDSCAPS_MIPMAP | DDSCAPS_COMPLEX
+
+	if (mType == TT_Texture3D)
+	{
+		header.flags |= DDS_HEADER_FLAGS_VOLUME;
+		header.caps2 |= 0x00200000; // DDSCAPS2_VOLUME
+	}
+	else if (mType == TT_TextureCube)
+	{
+		header.caps |= 0x00000008; // DDSCAPS_COMPLEX
+		header.caps2 |= DDS_CUBEMAP_ALLFACES;
+	}
+
+	// Legacy header for better tools support, array and 1D textures need DX10 extension
+	bool legacyHeader = (mLayers == 1 && mType != TT_Texture1D);
+	if (legacyHeader)
+	{
+		switch (mFormat)
+		{
+		case PF_RGB_DXT1_UNORM:
+		case PF_RGBA_DXT1_UNORM:
+			header.ddspf.flags = DDS_FOURCC;
+			header.ddspf.fourCC = MAKEFOURCC('D', 'X', 'T', '1');
+			break;
+		case PF_RGBA_DXT5_UNORM:
+			header.ddspf.flags = DDS_FOURCC;
+			header.ddspf.fourCC = MAKEFOURCC('D', 'X', 'T', '5');
+			break;
+		case PF_R_ATI1N_UNORM:
+			header.ddspf.flags = DDS_FOURCC;
+			header.ddspf.fourCC = MAKEFOURCC('A', 'T', 'I', '1');
+			break;
+		case PF_RG_ATI2N_UNORM:
+			header.ddspf.flags = DDS_FOURCC;
+			header.ddspf.fourCC = MAKEFOURCC('A', 'T', 'I', '2');
+			break;
+		case PF_RGBA8_UNORM:
+			header.ddspf.flags = DDS_RGBA;
+			header.ddspf.RGBBitCount = 32;
+			header.ddspf.RBitMask = 0x000000ff;
+			header.ddspf.GBitMask = 0x0000ff00;
+			header.ddspf.BBitMask = 0x00ff0000;
+			header.ddspf.ABitMask = 0xff000000;
+			break;
+		default:
+			legacyHeader = false;
+			break;
+		}
+	}
+
+	DDS_HEADER_DXT10 extHeader;
+	memset(&extHeader, 0, sizeof(DDS_HEADER_DXT10));
+	if (!legacyHeader)
+	{
+		header.ddspf.flags = DDS_FOURCC;
+		header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+
+		extHeader.dxgiFormat = format;
+		extHeader.arraySize = mLayers;
+		switch (mType)
+		{
+		case TT_Texture1D:
+			extHeader.resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE1D;
+			break;
+		case TT_Texture3D:
+			extHeader.resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
+			break;
+		case TT_TextureCube:
+			extHeader.resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+			extHeader.miscFlag = D3D11_RESOURCE_MISC_TEXTURECUBE;
+			break;
+		default:
+			extHeader.resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+			break;
+		}
+	}
+
+	size_t rowPitch, slicePitch, numRows;
+	GetSurfaceInfo(mWidth, mHeight, format, &slicePitch, &rowPitch, &numRows);
+
+	if (PixelFormatUtils::IsCompressed(mFormat))
+	{
+		header.flags |= DDS_HEADER_FLAGS_LINEARSIZE;
+		header.pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
+	}
+	else
+	{
+		header.flags |= DDS_HEADER_FLAGS_PITCH;
+		header.pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
+	}
+
+	FileStream stream;
+	if (stream.Open(filename, FILE_WRITE) == false)
+		return false;
+
+	stream.WriteUInt(DDS_MAGIC);
+	stream.Write(&header, sizeof(DDS_HEADER));
+	if (!legacyHeader)
+		stream.Write(&extHeader, sizeof(DDS_HEADER_DXT10));
+
+	// Same surface order as LoadImageFromDDS, all levels of one face or layer after another
+	uint32_t surfaceIndex = 0;
+	for (uint32_t j = 0; j < uint32_t(mType == TT_TextureCube ? mLayers * 6 : mLayers); j++) 
+	{
+		size_t w = mWidth;
+		size_t h = mHeight;
+		size_t d = (mType == TT_Texture3D) ? mDepth : 1;
+
+		for (uint32_t i = 0; i < mLevels; ++i)
+		{
+			GetSurfaceInfo(w, h, format, &slicePitch, &rowPitch, &numRows);
+
+			// Surface rows may be padded, e.g. copied from a mapped texture
+			const SurfaceInfo& surface = mSurfaces[surfaceIndex++];
+			const uint8_t* pSrcBits = static_cast<const uint8_t*>(surface.pData);
+			uint32_t srcRowPitch = surface.RowPitch ? surface.RowPitch : static_cast<uint32_t>(rowPitch);
+			uint32_t srcSlicePitch = surface.SlicePitch ? surface.SlicePitch : static_cast<uint32_t>(slicePitch);
+
+			for (size_t slice = 0; slice < d; ++slice)
+			{
+				for (size_t row = 0; row < numRows; ++row)
+					stream.Write(pSrcBits + slice * srcSlicePitch + row * srcRowPitch, static_cast<uint32_t>(rowPitch));
+			}
+
+			w = std::max<size_t>(1, w >> 1);
+			h = std::max<size_t>(1, h >> 1);
+			d = std::max<size_t>(1, d >> 1);
+		}
+	}
+
+	stream.Close();
+	return true;
+}
 
 }
\ No newline at end of file
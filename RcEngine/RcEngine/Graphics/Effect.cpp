@@ -3,6 +3,7 @@
 #include <Graphics/RenderDevice.h>
 #include <Graphics/RenderFactory.h>
 #include <Graphics/GraphicsResource.h>
+#include <Graphics/RenderState.h>
 #include <Resource/ResourceManager.h>
 #include <Core/Exception.h>
 #include <Core/Utility.h>
@@ -12,6 +13,29 @@
 #include <IO/FileStream.h>
 #include <Graphics/GraphicsScriptLoader.h>
 
+namespace {
+
+using namespace RcEngine;
+
+// Split the effect name to get effect file and flags
+vector<String> SplitEffectFlags(const String& effectName)
+{
+	vector<String> effectFlags;
+
+	StringStream iss(effectName); 
+	do 
+	{ 
+		String sub; 
+		iss >> sub; 
+		if (!sub.empty())
+			effectFlags.push_back(sub);	
+	} while (iss); 
+
+	return effectFlags;
+}
+
+}
+
 namespace RcEngine {
 
 Effect::Effect( ResourceManager* creator, ResourceHandle handle, const String& name, const String& group )
@@ -87,6 +111,25 @@ EffectParameter* Effect::GetParameterByUsage( EffectParameterUsage usage ) const
 	return nullptr;
 }
 
+bool Effect::IsBackFaceCulled() const
+{
+	for (EffectTechnique* technique : mTechniques)
+	{
+		for (EffectPass* pass : technique->GetPasses())
+		{
+			const shared_ptr<RasterizerState>& rasterizerState = pass->GetRasterizerState();
+			if (rasterizerState)
+			{
+				const RasterizerStateDesc& desc = rasterizerState->GetDesc();
+				if (desc.PolygonCullMode != CM_Back || desc.FrontCounterClockwise)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 EffectParameter* Effect::FetchSRVParameter( const String& name, EffectParameterType effectType )
 {
 	switch (effectType)
@@ -340,79 +383,72 @@ EffectConstantBuffer* Effect::CreateConstantBuffer( const String& name, uint32_t
 	return buffer;
 }
 
-void Effect::LoadImpl()
+void Effect::PrepareImpl()
 {
 	FileSystem& fileSystem = FileSystem::GetSingleton();
-	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
 
-	// Effect flags used to build shader macro
-	vector<String> effectFlags;
+	String effectFile = SplitEffectFlags(mResourceName).front();
 
-	// Split the effect name to get effect file and flags
-	StringStream iss(mResourceName); 
-	do 
-	{ 
-		String sub; 
-		iss >> sub; 
-		if (!sub.empty())
-			effectFlags.push_back(sub);	
-	} while (iss); 
+	// Prefer cooked binary effect if up to date, no XML parsing and state lookup
+	mScript = std::make_shared<Internal::EffectScript>();
+
+	if (shared_ptr<Stream> effectStream = Internal::OpenCookedScript(effectFile, mGroup, Internal::EffectScriptId))
+	{
+		Internal::LoadEffectScript(*effectStream, *mScript);
+	}
+	else
+	{
+		shared_ptr<Stream> xmlStream = fileSystem.OpenStream(effectFile, mGroup);
+		Stream& source = *xmlStream;	
+
+		XMLDoc doc;
+		XMLNodePtr root = doc.Parse(source);
+		Internal::LoadEffectScript(root, *mScript);
+	}
+}
 
-	shared_ptr<Stream> effectStream = fileSystem.OpenStream(effectFlags[0], mGroup);
-	Stream& source = *effectStream;	
+void Effect::LoadImpl()
+{
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+
+	// Effect flags used to build shader macro
+	vector<String> effectFlags = SplitEffectFlags(mResourceName);
 
-	XMLDoc doc;
-	XMLNodePtr root = doc.Parse(source);
+	const Internal::EffectScript& script = *mScript;
 
 	// Effect name 
-	mEffectName = root->AttributeString("name", "");
+	mEffectName = script.Name;
 
-	// Parse techniques
-	XMLNodePtr technqueNode, passNode, shaderNode;
-	for (technqueNode = root->FirstNode("Technique");  technqueNode; technqueNode = technqueNode->NextSibling("Technique"))
+	// Create techniques
+	for (const Internal::EffectTechniqueScript& techniqueScript : script.Techniques)
 	{
 		EffectTechnique* technique = new EffectTechnique(*this);
-		technique->mName = technqueNode->AttributeString("name", "");
+		technique->mName = techniqueScript.Name;
 		
-		String filename, entryPoint;
-		for (passNode = technqueNode->FirstNode("Pass");  passNode; passNode = passNode->NextSibling("Pass"))
+		for (const Internal::EffectPassScript& passScript : techniqueScript.Passes)
 		{
 			EffectPass* pass = new EffectPass;
-			pass->mName = passNode->AttributeString("name", "");
+			pass->mName = passScript.Name;
 			pass->mShaderPipeline = factory->CreateShaderPipeline(*this);
 
-			bool hasComputeShader = false;
-
 			// Load shader 
-			static const String ShaderNodeNames[] = {"VertexShader", "TessControlShader", "TessEvalShader", "GeometryShader", "PixelShader", "ComputeShader"};
-			for (uint32_t i = 0; i < ST_Count; ++i)
+			for (const Internal::EffectShaderScript& shaderScript : passScript.Shaders)
 			{
-				if (shaderNode = passNode->FirstNode(ShaderNodeNames[i]))
+				vector<ShaderMacro> shaderMacros = shaderScript.Macros;
+
+				for (size_t j = 1; j < effectFlags.size(); ++j)
 				{
-					filename = shaderNode->AttributeString("file", "");
-					entryPoint = shaderNode->AttributeString("entry", "");
-
-					vector<ShaderMacro> shaderMacros;
-					Internal::CollectShaderMacro(shaderNode, shaderMacros);
-
-					for (size_t j = 1; j < effectFlags.size(); ++j)
-					{
-						ShaderMacro macro = { effectFlags[j], "" };
-						shaderMacros.push_back(macro);
-					}
-
-					pass->mShaderPipeline->AttachShader(
-						factory->LoadShaderFromFile(
-						ShaderType(ST_Vertex + i),
-						filename, 
-						shaderMacros.empty() ? nullptr : &shaderMacros[0],
-						shaderMacros.size(),
-						entryPoint) );
-
-					// Compute pass
-					if (i == ST_Compute)
-						hasComputeShader = true;
+					ShaderMacro macro = { effectFlags[j], "" };
+					shaderMacros.push_back(macro);
 				}
+
+				pass->mShaderPipeline->AttachShader(
+					factory->LoadShaderFromFile(
+					shaderScript.Type,
+					shaderScript.File, 
+					shaderMacros.empty() ? nullptr : &shaderMacros[0],
+					shaderMacros.size(),
+					shaderScript.Entry) );
 			}
 
 			if (pass->mShaderPipeline->LinkPipeline() == false)
@@ -421,17 +457,16 @@ void Effect::LoadImpl()
 			}
 
 			// Compute shader pass has no render state
-			if (!hasComputeShader)
+			if (passScript.HasRenderStates)
 			{
-				DepthStencilStateDesc dsDesc;
-				BlendStateDesc blendDesc;
-				RasterizerStateDesc rasDesc;
-
-				Internal::CollectRenderStates(passNode, dsDesc, blendDesc, rasDesc, pass->mBlendColor, pass->mSampleMask, pass->mFrontStencilRef, pass->mBackStencilRef);
-
-				pass->mDepthStencilState = factory->CreateDepthStencilState(dsDesc);
-				pass->mBlendState = factory->CreateBlendState(blendDesc);
-				pass->mRasterizerState = factory->CreateRasterizerState(rasDesc);
+				pass->mBlendColor = passScript.BlendColor;
+				pass->mSampleMask = passScript.SampleMask;
+				pass->mFrontStencilRef = passScript.FrontStencilRef;
+				pass->mBackStencilRef = passScript.BackStencilRef;
+
+				pass->mDepthStencilState = factory->CreateDepthStencilState(passScript.DepthStencilDesc);
+				pass->mBlendState = factory->CreateBlendState(passScript.BlendDesc);
+				pass->mRasterizerState = factory->CreateRasterizerState(passScript.RasterizerDesc);
 			}
 
 			technique->mPasses.push_back(pass);	
@@ -440,103 +475,36 @@ void Effect::LoadImpl()
 		mTechniques.push_back(technique);
 	}
 
-	// Parse sampler states
-	for (XMLNodePtr samplerNode = root->FirstNode("Sampler"); samplerNode; samplerNode = samplerNode->NextSibling("Sampler"))
+	// Create sampler states
+	for (const Internal::EffectSamplerScript& samplerScript : script.Samplers)
 	{
-		String samplerName = samplerNode->AttributeString("name", "");
-		EffectParameter* effectSamplerStateParam = GetParameterByName(samplerName);
+		EffectParameter* effectSamplerStateParam = GetParameterByName(samplerScript.Name);
 		
 		if (effectSamplerStateParam)
 		{
-			SamplerStateDesc desc;
-			for (XMLNodePtr stateNode = samplerNode->FirstNode("State"); stateNode; stateNode = stateNode->NextSibling("State"))
-			{	
-				String stateName = stateNode->AttributeString("name", "");
-				if (stateName == "Filter")
-				{
-					String value = stateNode->Attribute("value")->ValueString();
-					desc.Filter = (TextureFilter)Internal::SamplerDefs::GetSingleton().GetSamplerState(value);
-				}
-				else if (stateName == "AddressU")
-				{
-					String value = stateNode->Attribute("value")->ValueString();
-					desc.AddressU = (TextureAddressMode)Internal::SamplerDefs::GetSingleton().GetSamplerState(value);
-				}
-				else if (stateName == "AddressV")
-				{
-					String value = stateNode->Attribute("value")->ValueString();
-					desc.AddressV = (TextureAddressMode)Internal::SamplerDefs::GetSingleton().GetSamplerState(value);
-				}
-				else if (stateName == "AddressW")
-				{
-					String value = stateNode->Attribute("value")->ValueString();
-					desc.AddressW = (TextureAddressMode)Internal::SamplerDefs::GetSingleton().GetSamplerState(value);
-				}
-				else if (stateName == "MaxAnisotropy")
-				{
-					uint32_t value = stateNode->Attribute("value")->ValueUInt();
-					if (value < 1 || value > 16)
-						ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "MaxAnisotropy range invalid, only[1, 16] supported!",  "Material::LoadImpl");
-					desc.MaxAnisotropy = value;
-				}
-				else if (stateName == "MinLOD")
-				{
-					float value = stateNode->Attribute("value")->ValueFloat();
-					desc.MinLOD = value;
-				}
-				else if (stateName == "MaxLOD")
-				{
-					float value = stateNode->Attribute("value")->ValueFloat();
-					desc.MaxLOD = value;
-				}
-				else if (stateName == "MipLODBias")
-				{
-					float value = stateNode->Attribute("value")->ValueFloat();
-					desc.MipLODBias = value;
-				}
-				else if (stateName == "ComparisonFunc")
-				{
-					String value = stateNode->Attribute("value")->ValueString();
-					desc.ComparisonFunc = (CompareFunction)Internal::SamplerDefs::GetSingleton().GetSamplerState(value);
-				}
-				else if (stateName == "BorderColor")
-				{
-					float r = stateNode->Attribute("r")->ValueFloat();
-					float g = stateNode->Attribute("g")->ValueFloat();
-					float b = stateNode->Attribute("b")->ValueFloat();
-					float a = stateNode->Attribute("a")->ValueFloat();
-					desc.BorderColor = ColorRGBA(r,g,b,a);
-				}
-				else
-				{
-					ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Unknown sampler state: " + stateName, 
-						"Material::LoadFrom");
-				}
-			}
+			shared_ptr<SamplerState> sampler = factory->CreateSamplerState(samplerScript.Desc);
+			mSamplerStates.insert( std::make_pair(samplerScript.Name, sampler) );
 
-			shared_ptr<SamplerState> sampler = factory->CreateSamplerState(desc);
-			mSamplerStates.insert( std::make_pair(samplerName, sampler) );
-
-			effectSamplerStateParam->SetValue(mSamplerStates[samplerName]);
+			effectSamplerStateParam->SetValue(mSamplerStates[samplerScript.Name]);
 		}
 	}
 
 	// Auto-binding effect parameters
-	for (XMLNodePtr paramNode = root->FirstNode("AutoBinding"); paramNode; paramNode = paramNode->NextSibling("AutoBinding"))
+	for (const Internal::EffectAutoBindingScript& binding : script.AutoBindings)
 	{
-		String paramName = paramNode->AttributeString("name", "");
-		EffectParameter* effectParam = GetParameterByName(paramName);
+		EffectParameter* effectParam = GetParameterByName(binding.Name);
 
 		if (effectParam)
 		{
-			String semantic = paramNode->AttributeString("semantic", "");
-			effectParam->mParameterUsage = Internal::EffectParamsUsageDefs::GetInstance().GetUsageType(semantic);
+			effectParam->mParameterUsage = binding.Usage;
 
 			// Validate effect type
 		}
 	}
 
 	mCurrTechnique = mTechniques.front();
+
+	mScript.reset();
 }
 
 void Effect::UnloadImpl()
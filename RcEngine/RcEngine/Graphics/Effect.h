@@ -10,6 +10,8 @@ namespace RcEngine {
 
 class EffectConstantBuffer;
 
+namespace Internal { struct EffectScript; }
+
 class _ApiExport Effect : public Resource
 {
 public:
@@ -30,7 +32,11 @@ public:
 	
 	const std::map<String, EffectParameter*>& GetParameters() const			{ return mParameters; }
 
+	/// All passes of all techniques cull back faces, clockwise front.
+	bool IsBackFaceCulled() const;
+
 protected:
+	void PrepareImpl();
 	void LoadImpl();
 	void UnloadImpl();
 
@@ -62,6 +68,9 @@ protected:
 	std::map<String, EffectParameter*> mParameters;
 
 	std::map<String, shared_ptr<SamplerState> > mSamplerStates;
+
+	// Effect script parsed by PrepareImpl
+	shared_ptr<Internal::EffectScript> mScript;
 };
 
 class _ApiExport EffectTechnique 
@@ -98,6 +107,7 @@ public:
 
 	inline const String& GetPassName() const									{ return mName; }
 	inline const shared_ptr<ShaderPipeline>& GetShaderPipeline() const		{ return mShaderPipeline; }
+	inline const shared_ptr<RasterizerState>& GetRasterizerState() const	{ return mRasterizerState; }
 
 	void BeginPass();
 	void EndPass();
@@ -112,6 +112,9 @@ EffectParameter::~EffectParameter( void )
 	UnimplentedSetArrayMethod(float4x4)
 #undef UnimplentedSetArrayMethod
 
+void EffectParameter::CopyValue( const EffectParameter& src )
+{ ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Shoudn't call this", "EffectParameter::CopyValue"); }
+
 void EffectParameter::SetArrayStride( uint32_t stride )
 { ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Shoudn't call this", "EffectParameter::SetArrayStride"); }
 
@@ -125,6 +125,9 @@ public:
 	virtual void SetValue(const shared_ptr<UnorderedAccessView>& value);  // Need to consider D3D11 Atomic Counter 
 	virtual void SetValue(const shared_ptr<SamplerState>& value);
 
+	// Copy value from parameter of the same type and element size, used to sync effect variants
+	virtual void CopyValue(const EffectParameter& src);
+
 public_internal:
 	// Make constant buffer dirty
 	inline TimeStamp GetTimeStamp() const					{ return mLastModifiedTime; }
@@ -161,6 +164,7 @@ public:
 		: EffectParameter(name, type, pCB) {}
 
 	void GetValue(T& value) const { value = mValue; }
+	void CopyValue(const EffectParameter& src) { T value; src.GetValue(value); SetValue(value); }
 	void SetValue(const T& value)
 	{
 		if (value != mValue)
@@ -207,6 +211,13 @@ public:
 		value = mValue;
 	}
 
+	void CopyValue(const EffectParameter& src)
+	{
+		T* value;
+		src.GetValue(value);
+		SetValue(value, mElementSize);
+	}
+
 	void SetValue(const T* value, uint32_t count)
 	{
 		assert(count <= mElementSize);
@@ -250,6 +261,7 @@ public:
 
 	virtual void SetMatrixStride(uint32_t stride)	 { mMatrixStride = stride; }
 	virtual void GetValue(float4x4& value) const	 { value = mValue; }
+	virtual void CopyValue(const EffectParameter& src) { float4x4 value; src.GetValue(value); SetValue(value); }
 	virtual void SetValue(const float4x4& value)
 	{
 		if (value != mValue)
@@ -291,6 +303,7 @@ public:
 	virtual void SetMatrixStride(uint32_t stride) { mMatrixStride = stride; }
 	virtual void SetArrayStride(uint32_t stride)  { mArrayStrides = stride; }
 	virtual void GetValue(float4x4*& value) const { value = mValue; }
+	virtual void CopyValue(const EffectParameter& src) { float4x4* value; src.GetValue(value); SetValue(value, mElementSize); }
 
 	virtual void SetValue(const float4x4* value, uint32_t count)
 	{
@@ -394,6 +407,13 @@ public:
 		value = mSRV;
 	}
 
+	void CopyValue(const EffectParameter& src)
+	{
+		weak_ptr<ShaderResourceView> value;
+		src.GetValue(value);
+		SetValue(value.lock());
+	}
+
 	void SetValue(const shared_ptr<ShaderResourceView>& value)
 	{
 		if (mSRV.lock() != value)
@@ -418,6 +438,13 @@ public:
 		value = mUAV;
 	}
 
+	void CopyValue(const EffectParameter& src)
+	{
+		weak_ptr<UnorderedAccessView> value;
+		src.GetValue(value);
+		SetValue(value.lock());
+	}
+
 	void SetValue(const shared_ptr<UnorderedAccessView>& value)
 	{
 		if (mUAV.lock() != value)
@@ -441,6 +468,13 @@ public:
 		value = mSamplerState;
 	}
 
+	void CopyValue(const EffectParameter& src)
+	{
+		weak_ptr<SamplerState> value;
+		src.GetValue(value);
+		SetValue(value.lock());
+	}
+
 	void SetValue(const shared_ptr<SamplerState>& value)
 	{
 		if (mSamplerState.lock() != value)
@@ -233,6 +233,14 @@ enum VertexElementFormat
 	VEF_Bool2,
 	VEF_Bool3,
 	VEF_Bool4,
+
+	// Compact formats, normalized ones are read as float in [0, 1] or [-1, 1]
+	VEF_Half2,
+	VEF_Half4,
+	VEF_UShort4N,
+	VEF_Short2N,
+	VEF_UByte4N,
+	VEF_UByte4,
 	VEF_Count
 };
 
@@ -1,7 +1,25 @@
 #include <Graphics/GraphicsScriptLoader.h>
+#include <IO/Stream.h>
+#include <IO/FileSystem.h>
 
 namespace RcEngine {
 
+namespace {
+
+// Function local statics are not thread safe in VC11, construct definitions before 
+// scripts are parsed in parallel by resource prepare.
+struct ScriptDefsInitializer
+{
+	ScriptDefsInitializer()
+	{
+		Internal::StateDescDefs::GetInstance();
+		Internal::SamplerDefs::GetSingleton();
+		Internal::EffectParamsUsageDefs::GetInstance();
+	}
+} gScriptDefsInitializer;
+
+}
+
 void Internal::CollectRenderStates( XMLNodePtr passNode, DepthStencilStateDesc& dsDesc, BlendStateDesc& blendDesc, RasterizerStateDesc& rasDesc, ColorRGBA& blendFactor, uint32_t& sampleMask, uint16_t& frontStencilRef, uint16_t& backStencilRef )
 {
 	XMLNodePtr stateNode;
@@ -190,4 +208,384 @@ void Internal::CollectShaderMacro( const XMLNodePtr& node, std::vector<ShaderMac
 	}
 }
 
+void Internal::CollectSamplerStates( const XMLNodePtr& samplerNode, SamplerStateDesc& desc )
+{
+	for (XMLNodePtr stateNode = samplerNode->FirstNode("State"); stateNode; stateNode = stateNode->NextSibling("State"))
+	{	
+		String stateName = stateNode->AttributeString("name", "");
+		if (stateName == "Filter")
+		{
+			String value = stateNode->Attribute("value")->ValueString();
+			desc.Filter = (TextureFilter)SamplerDefs::GetSingleton().GetSamplerState(value);
+		}
+		else if (stateName == "AddressU")
+		{
+			String value = stateNode->Attribute("value")->ValueString();
+			desc.AddressU = (TextureAddressMode)SamplerDefs::GetSingleton().GetSamplerState(value);
+		}
+		else if (stateName == "AddressV")
+		{
+			String value = stateNode->Attribute("value")->ValueString();
+			desc.AddressV = (TextureAddressMode)SamplerDefs::GetSingleton().GetSamplerState(value);
+		}
+		else if (stateName == "AddressW")
+		{
+			String value = stateNode->Attribute("value")->ValueString();
+			desc.AddressW = (TextureAddressMode)SamplerDefs::GetSingleton().GetSamplerState(value);
+		}
+		else if (stateName == "MaxAnisotropy")
+		{
+			uint32_t value = stateNode->Attribute("value")->ValueUInt();
+			if (value < 1 || value > 16)
+				ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "MaxAnisotropy range invalid, only[1, 16] supported!",  "CollectSamplerStates");
+			desc.MaxAnisotropy = value;
+		}
+		else if (stateName == "MinLOD")
+		{
+			float value = stateNode->Attribute("value")->ValueFloat();
+			desc.MinLOD = value;
+		}
+		else if (stateName == "MaxLOD")
+		{
+			float value = stateNode->Attribute("value")->ValueFloat();
+			desc.MaxLOD = value;
+		}
+		else if (stateName == "MipLODBias")
+		{
+			float value = stateNode->Attribute("value")->ValueFloat();
+			desc.MipLODBias = value;
+		}
+		else if (stateName == "ComparisonFunc")
+		{
+			String value = stateNode->Attribute("value")->ValueString();
+			desc.ComparisonFunc = (CompareFunction)SamplerDefs::GetSingleton().GetSamplerState(value);
+		}
+		else if (stateName == "BorderColor")
+		{
+			float r = stateNode->Attribute("r")->ValueFloat();
+			float g = stateNode->Attribute("g")->ValueFloat();
+			float b = stateNode->Attribute("b")->ValueFloat();
+			float a = stateNode->Attribute("a")->ValueFloat();
+			desc.BorderColor = ColorRGBA(r,g,b,a);
+		}
+		else
+		{
+			ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Unknown sampler state: " + stateName, "CollectSamplerStates");
+		}
+	}
+}
+
+String Internal::GetCookedScriptName( const String& file )
+{
+	size_t extPos = file.rfind(".xml");
+	if (extPos != String::npos && extPos + 4 == file.length())
+		return file.substr(0, extPos) + ".bin";
+	
+	return file + ".bin";
+}
+
+uint64_t Internal::HashScriptSource( Stream& source )
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	uint8_t buffer[4096];
+	while (uint32_t numRead = source.Read(buffer, sizeof(buffer)))
+	{
+		for (uint32_t i = 0; i < numRead; ++i)
+			hash = (hash ^ buffer[i]) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+shared_ptr<Stream> Internal::OpenCookedScript( const String& file, const String& group, uint32_t scriptId )
+{
+	FileSystem& fileSystem = FileSystem::GetSingleton();
+
+	String cookedFile = GetCookedScriptName(file);
+	if (!fileSystem.Exits(cookedFile, group))
+		return nullptr;
+
+	shared_ptr<Stream> cookedStream = fileSystem.OpenStream(cookedFile, group);
+
+	// Cooked by older version
+	uint64_t cookedHash;
+	if (cookedStream->ReadUInt() != scriptId || cookedStream->Read(&cookedHash, sizeof(cookedHash)) != sizeof(cookedHash))
+		return nullptr;
+
+	if (fileSystem.Exits(file, group))
+	{
+		shared_ptr<Stream> sourceStream = fileSystem.OpenStream(file, group);
+		if (HashScriptSource(*sourceStream) != cookedHash)
+			return nullptr;
+	}
+
+	cookedStream->Seek(0);
+	return cookedStream;
+}
+
+void Internal::LoadEffectScript( const XMLNodePtr& root, EffectScript& script )
+{
+	static const String ShaderNodeNames[] = {"VertexShader", "TessControlShader", "TessEvalShader", "GeometryShader", "PixelShader", "ComputeShader"};
+
+	script.Name = root->AttributeString("name", "");
+
+	for (XMLNodePtr technqueNode = root->FirstNode("Technique");  technqueNode; technqueNode = technqueNode->NextSibling("Technique"))
+	{
+		script.Techniques.resize(script.Techniques.size() + 1);
+
+		EffectTechniqueScript& technique = script.Techniques.back();
+		technique.Name = technqueNode->AttributeString("name", "");
+
+		for (XMLNodePtr passNode = technqueNode->FirstNode("Pass");  passNode; passNode = passNode->NextSibling("Pass"))
+		{
+			technique.Passes.resize(technique.Passes.size() + 1);
+
+			EffectPassScript& pass = technique.Passes.back();
+			pass.Name = passNode->AttributeString("name", "");
+
+			for (uint32_t i = 0; i < ST_Count; ++i)
+			{
+				if (XMLNodePtr shaderNode = passNode->FirstNode(ShaderNodeNames[i]))
+				{
+					EffectShaderScript shader;
+					shader.Type = ShaderType(ST_Vertex + i);
+					shader.File = shaderNode->AttributeString("file", "");
+					shader.Entry = shaderNode->AttributeString("entry", "");
+					CollectShaderMacro(shaderNode, shader.Macros);
+					
+					// Compute pass has no render state
+					if (i == ST_Compute)
+						pass.HasRenderStates = false;
+
+					pass.Shaders.push_back(shader);
+				}
+			}
+
+			if (pass.HasRenderStates)
+			{
+				CollectRenderStates(passNode, pass.DepthStencilDesc, pass.BlendDesc, pass.RasterizerDesc,
+					pass.BlendColor, pass.SampleMask, pass.FrontStencilRef, pass.BackStencilRef);
+			}
+		}
+	}
+
+	for (XMLNodePtr samplerNode = root->FirstNode("Sampler"); samplerNode; samplerNode = samplerNode->NextSibling("Sampler"))
+	{
+		EffectSamplerScript sampler;
+		sampler.Name = samplerNode->AttributeString("name", "");
+		CollectSamplerStates(samplerNode, sampler.Desc);
+		script.Samplers.push_back(sampler);
+	}
+
+	for (XMLNodePtr paramNode = root->FirstNode("AutoBinding"); paramNode; paramNode = paramNode->NextSibling("AutoBinding"))
+	{
+		EffectAutoBindingScript binding;
+		binding.Name = paramNode->AttributeString("name", "");
+		binding.Usage = EffectParamsUsageDefs::GetInstance().GetUsageType(paramNode->AttributeString("semantic", ""));
+		script.AutoBindings.push_back(binding);
+	}
+}
+
+void Internal::LoadEffectScript( Stream& source, EffectScript& script )
+{
+	if (source.ReadUInt() != EffectScriptId)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid cooked effect file: " + source.GetName(), "LoadEffectScript");
+
+	uint64_t sourceHash;
+	source.Read(&sourceHash, sizeof(sourceHash));
+
+	script.Name = source.ReadString();
+
+	script.Techniques.resize(source.ReadUInt());
+	for (EffectTechniqueScript& technique : script.Techniques)
+	{
+		technique.Name = source.ReadString();
+
+		technique.Passes.resize(source.ReadUInt());
+		for (EffectPassScript& pass : technique.Passes)
+		{
+			pass.Name = source.ReadString();
+
+			pass.Shaders.resize(source.ReadUInt());
+			for (EffectShaderScript& shader : pass.Shaders)
+			{
+				shader.Type = (ShaderType)source.ReadUInt();
+				shader.File = source.ReadString();
+				shader.Entry = source.ReadString();
+
+				shader.Macros.resize(source.ReadUInt());
+				for (ShaderMacro& macro : shader.Macros)
+				{
+					macro.Name = source.ReadString();
+					macro.Definition = source.ReadString();
+				}
+			}
+
+			pass.HasRenderStates = source.ReadBool();
+			if (pass.HasRenderStates)
+			{
+				// States are POD with pack(1), stored as it is
+				source.Read(&pass.DepthStencilDesc, sizeof(DepthStencilStateDesc));
+				source.Read(&pass.BlendDesc, sizeof(BlendStateDesc));
+				source.Read(&pass.RasterizerDesc, sizeof(RasterizerStateDesc));
+				source.Read(&pass.BlendColor, sizeof(ColorRGBA));
+				pass.SampleMask = source.ReadUInt();
+				pass.FrontStencilRef = source.ReadUShort();
+				pass.BackStencilRef = source.ReadUShort();
+			}
+		}
+	}
+
+	script.Samplers.resize(source.ReadUInt());
+	for (EffectSamplerScript& sampler : script.Samplers)
+	{
+		sampler.Name = source.ReadString();
+		source.Read(&sampler.Desc, sizeof(SamplerStateDesc));
+	}
+
+	script.AutoBindings.resize(source.ReadUInt());
+	for (EffectAutoBindingScript& binding : script.AutoBindings)
+	{
+		binding.Name = source.ReadString();
+		binding.Usage = (EffectParameterUsage)source.ReadUInt();
+	}
+}
+
+void Internal::SaveEffectScript( Stream& dest, const EffectScript& script, uint64_t sourceHash )
+{
+	dest.WriteUInt(EffectScriptId);
+	dest.Write(&sourceHash, sizeof(sourceHash));
+	dest.WriteString(script.Name);
+
+	dest.WriteUInt(script.Techniques.size());
+	for (const EffectTechniqueScript& technique : script.Techniques)
+	{
+		dest.WriteString(technique.Name);
+
+		dest.WriteUInt(technique.Passes.size());
+		for (const EffectPassScript& pass : technique.Passes)
+		{
+			dest.WriteString(pass.Name);
+
+			dest.WriteUInt(pass.Shaders.size());
+			for (const EffectShaderScript& shader : pass.Shaders)
+			{
+				dest.WriteUInt(shader.Type);
+				dest.WriteString(shader.File);
+				dest.WriteString(shader.Entry);
+
+				dest.WriteUInt(shader.Macros.size());
+				for (const ShaderMacro& macro : shader.Macros)
+				{
+					dest.WriteString(macro.Name);
+					dest.WriteString(macro.Definition);
+				}
+			}
+
+			dest.WriteBool(pass.HasRenderStates);
+			if (pass.HasRenderStates)
+			{
+				dest.Write(&pass.DepthStencilDesc, sizeof(DepthStencilStateDesc));
+				dest.Write(&pass.BlendDesc, sizeof(BlendStateDesc));
+				dest.Write(&pass.RasterizerDesc, sizeof(RasterizerStateDesc));
+				dest.Write(&pass.BlendColor, sizeof(ColorRGBA));
+				dest.WriteUInt(pass.SampleMask);
+				dest.WriteUShort(pass.FrontStencilRef);
+				dest.WriteUShort(pass.BackStencilRef);
+			}
+		}
+	}
+
+	dest.WriteUInt(script.Samplers.size());
+	for (const EffectSamplerScript& sampler : script.Samplers)
+	{
+		dest.WriteString(sampler.Name);
+		dest.Write(&sampler.Desc, sizeof(SamplerStateDesc));
+	}
+
+	dest.WriteUInt(script.AutoBindings.size());
+	for (const EffectAutoBindingScript& binding : script.AutoBindings)
+	{
+		dest.WriteString(binding.Name);
+		dest.WriteUInt(binding.Usage);
+	}
+}
+
+void Internal::LoadMaterialScript( const XMLNodePtr& root, MaterialScript& script )
+{
+	XMLNodePtr effectNode = root->FirstNode("Effect");
+	script.EffectFile = effectNode->AttributeString("name", "");
+
+	for (XMLNodePtr effectFlagNode = effectNode->FirstNode("Flag"); effectFlagNode; effectFlagNode = effectFlagNode->NextSibling("Flag"))
+		script.EffectFlags.push_back( effectFlagNode->AttributeString("name", "") );
+
+	for (XMLNodePtr paramNode = root->FirstNode("Parameter"); paramNode; paramNode = paramNode->NextSibling("Parameter"))
+	{
+		if (XMLAttributePtr sematicAttrib = paramNode->FirstAttribute("semantic"))
+		{
+			MaterialParamScript param;
+			param.Usage = EffectParamsUsageDefs::GetInstance().GetUsageType(sematicAttrib->ValueString());
+			param.Value = paramNode->AttributeString("value", "");
+			param.NumericValue = float3(0, 0, 0);
+			std::sscanf(param.Value.c_str(), "%f %f %f", &param.NumericValue[0], &param.NumericValue[1], &param.NumericValue[2]);
+			script.Params.push_back(param);
+		}
+	}
+
+	if (XMLNodePtr queueNode = root->FirstNode("Queue"))
+	{
+		script.HasQueueBucket = true;
+		script.QueueBucket = GetRenderQueueBucket( queueNode->AttributeString("name", "") );
+	}
+}
+
+void Internal::LoadMaterialScript( Stream& source, MaterialScript& script )
+{
+	if (source.ReadUInt() != MaterialScriptId)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid cooked material file: " + source.GetName(), "LoadMaterialScript");
+
+	uint64_t sourceHash;
+	source.Read(&sourceHash, sizeof(sourceHash));
+
+	script.EffectFile = source.ReadString();
+
+	script.EffectFlags.resize(source.ReadUInt());
+	for (String& flag : script.EffectFlags)
+		flag = source.ReadString();
+
+	script.Params.resize(source.ReadUInt());
+	for (MaterialParamScript& param : script.Params)
+	{
+		param.Usage = (EffectParameterUsage)source.ReadUInt();
+		param.Value = source.ReadString();
+		source.Read(&param.NumericValue, sizeof(float3));
+	}
+
+	script.HasQueueBucket = source.ReadBool();
+	script.QueueBucket = source.ReadUInt();
+}
+
+void Internal::SaveMaterialScript( Stream& dest, const MaterialScript& script, uint64_t sourceHash )
+{
+	dest.WriteUInt(MaterialScriptId);
+	dest.Write(&sourceHash, sizeof(sourceHash));
+	dest.WriteString(script.EffectFile);
+
+	dest.WriteUInt(script.EffectFlags.size());
+	for (const String& flag : script.EffectFlags)
+		dest.WriteString(flag);
+
+	dest.WriteUInt(script.Params.size());
+	for (const MaterialParamScript& param : script.Params)
+	{
+		dest.WriteUInt(param.Usage);
+		dest.WriteString(param.Value);
+		dest.Write(&param.NumericValue, sizeof(float3));
+	}
+
+	dest.WriteBool(script.HasQueueBucket);
+	dest.WriteUInt(script.QueueBucket);
+}
+
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <Graphics/GraphicsCommon.h>
 #include <Graphics/RenderState.h>
 #include <Graphics/GraphicsResource.h>
+#include <Graphics/RenderQueue.h>
 #include <Core/XMLDom.h>
 #include <Core/Exception.h>
 #include <Core/Utility.h>
@@ -210,12 +211,139 @@ private:
 	unordered_map<String, EffectParameterUsage> mDefs;
 };
 
+inline uint32_t GetRenderQueueBucket(const String& str) 
+{
+	if (str == "Overlay")
+		return RenderQueue::BucketOverlay;
+	else if (str == "Background")
+		return RenderQueue::BucketBackground;
+	else if (str == "Opaque")
+		return RenderQueue::BucketOpaque;
+	else if (str == "Transparent")
+		return RenderQueue::BucketTransparent;
+	else if (str == "Translucent")
+		return RenderQueue::BucketTranslucent;
+	else 
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Undefined Queue Bucket", "GetQueueBucket");
+
+	return RenderQueue::BucketOpaque;
+}
+
+/************************************************************************/
+/* Parsed effect and material script. Scripts are either parsed from    */
+/* XML, or loaded from the binary file cooked by XML2Binary, in which   */
+/* all state strings are already resolved to enums.                     */
+/************************************************************************/
+
+struct EffectShaderScript
+{
+	ShaderType Type;
+	String File;
+	String Entry;
+	vector<ShaderMacro> Macros;
+};
+
+struct EffectPassScript
+{
+	EffectPassScript()
+		: HasRenderStates(true),
+		  BlendColor(0, 0, 0, 0),
+		  SampleMask(0xffffffff),
+		  FrontStencilRef(0),
+		  BackStencilRef(0) {}
+
+	String Name;
+	vector<EffectShaderScript> Shaders;
+
+	// Compute shader pass has no render state
+	bool HasRenderStates;
+	DepthStencilStateDesc DepthStencilDesc;
+	BlendStateDesc BlendDesc;
+	RasterizerStateDesc RasterizerDesc;
+	ColorRGBA BlendColor;
+	uint32_t SampleMask;
+	uint16_t FrontStencilRef, BackStencilRef;
+};
+
+struct EffectTechniqueScript
+{
+	String Name;
+	vector<EffectPassScript> Passes;
+};
+
+struct EffectSamplerScript
+{
+	String Name;
+	SamplerStateDesc Desc;
+};
+
+struct EffectAutoBindingScript
+{
+	String Name;
+	EffectParameterUsage Usage;
+};
+
+struct EffectScript
+{
+	String Name;
+	vector<EffectTechniqueScript> Techniques;
+	vector<EffectSamplerScript> Samplers;
+	vector<EffectAutoBindingScript> AutoBindings;
+};
+
+struct MaterialParamScript
+{
+	EffectParameterUsage Usage;
+	String Value;
+	float3 NumericValue;		// Value parsed as color or power
+};
+
+struct MaterialScript
+{
+	MaterialScript() : HasQueueBucket(false), QueueBucket(0) {}
+
+	String EffectFile;
+	vector<String> EffectFlags;
+	vector<MaterialParamScript> Params;
+
+	bool HasQueueBucket;
+	uint32_t QueueBucket;
+};
+
+// Version 2 stores hash of source XML after id
+static const uint32_t EffectScriptId = ('E' << 24) | ('F' << 16) | ('X' << 8) | ('2');
+static const uint32_t MaterialScriptId = ('M' << 24) | ('T' << 16) | ('L' << 8) | ('2');
+
+/**
+ * Cooked binary file name of a script, "Name.effect.xml" -> "Name.effect.bin".
+ */
+_ApiExport String GetCookedScriptName(const String& file);
+
+/// FNV-1a hash of script XML, stored in cooked file.
+_ApiExport uint64_t HashScriptSource(Stream& source);
+
+/**
+ * Open cooked binary of script file if it's cooked from current XML, return null otherwise,
+ * so edited XML is used until cooked again. Cooked file without XML is always used.
+ */
+_ApiExport shared_ptr<Stream> OpenCookedScript(const String& file, const String& group, uint32_t scriptId);
+
+_ApiExport void LoadEffectScript(const XMLNodePtr& root, EffectScript& script);
+_ApiExport void LoadEffectScript(Stream& source, EffectScript& script);
+_ApiExport void SaveEffectScript(Stream& dest, const EffectScript& script, uint64_t sourceHash);
+
+_ApiExport void LoadMaterialScript(const XMLNodePtr& root, MaterialScript& script);
+_ApiExport void LoadMaterialScript(Stream& source, MaterialScript& script);
+_ApiExport void SaveMaterialScript(Stream& dest, const MaterialScript& script, uint64_t sourceHash);
+
 void CollectRenderStates(XMLNodePtr passNode, DepthStencilStateDesc& dsDesc, BlendStateDesc& blendDesc, RasterizerStateDesc& rasDesc,
 								ColorRGBA& blendFactor, uint32_t& sampleMask, uint16_t& frontStencilRef, uint16_t& backStencilRef);
 
 
 void CollectShaderMacro(const XMLNodePtr& node, std::vector<ShaderMacro>& shaderMacros);
 
+void CollectSamplerStates(const XMLNodePtr& samplerNode, SamplerStateDesc& desc);
+
 }
 
 }
@@ -7,7 +7,8 @@
 namespace RcEngine {
 
 Image::Image()
-	: mValid(false)
+	: mFirstLevel(0),
+	  mValid(false)
 {
 
 }
@@ -29,13 +30,14 @@ void Image::Clear()
 		mSurfaces.clear();
 	}
 
+	mFirstLevel = 0;
 	mValid = false;
 }
 
 uint32_t Image::GetRowPitch( uint32_t level )
 {
-	uint32_t index = (mType == TT_TextureCube) ? (level*6) : level;
-	return mSurfaces[index].RowPitch;
+	// First layer or face surfaces are the first mLevels ones
+	return mSurfaces[level].RowPitch;
 }
 
 uint32_t Image::GetSlicePitch( uint32_t level )
@@ -46,7 +48,54 @@ uint32_t Image::GetSlicePitch( uint32_t level )
 
 uint32_t Image::GetSurfaceSize( uint32_t level )
 {
-	return 0;
+	return mSurfaces[level].SlicePitch * (std::max)(1U, mDepth >> level);
+}
+
+uint32_t Image::CalculateSurfaceSize( PixelFormat format, uint32_t width, uint32_t height, uint32_t* rowPitch /*= nullptr*/ )
+{
+	uint32_t pitch, numRows;
+	if (PixelFormatUtils::IsCompressed(format))
+	{
+		uint32_t blockBytes = 0;
+		switch (format)
+		{
+		case PF_RGB_DXT1_UNORM:
+		case PF_RGBA_DXT1_UNORM:
+		case PF_SRGB_DXT1_UNORM:
+		case PF_SRGB_ALPHA_DXT1_UNORM:
+		case PF_R_ATI1N_UNORM:
+		case PF_R_ATI1N_SNORM:
+			blockBytes = 8;
+			break;
+		case PF_RGBA_DXT3_UNORM:
+		case PF_SRGB_ALPHA_DXT3_UNORM:
+		case PF_RGBA_DXT5_UNORM:
+		case PF_SRGB_ALPHA_DXT5_UNORM:
+		case PF_RG_ATI2N_UNORM:
+		case PF_RG_ATI2N_SNORM:
+		case PF_RGB_BP_UNORM:
+		case PF_SRGB_BP_UNORM:
+		case PF_RGB_BP_UNSIGNED_FLOAT:
+		case PF_RGB_BP_SIGNED_FLOAT:
+			blockBytes = 16;
+			break;
+		default:
+			ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Unsupported compressed format", "Image::CalculateSurfaceSize");
+		}
+
+		pitch = ((width + 3) / 4) * blockBytes;
+		numRows = (height + 3) / 4;
+	}
+	else
+	{
+		pitch = width * PixelFormatUtils::GetNumElemBytes(format);
+		numRows = height;
+	}
+
+	if (rowPitch)
+		*rowPitch = pitch;
+
+	return pitch * numRows;
 }
 
 const void* Image::GetLevel( uint32_t level, uint32_t layer /*= 0*/, CubeMapFace face /*= CMF_PositiveX*/ ) const
@@ -73,6 +122,50 @@ void* Image::GetLevel( uint32_t level, uint32_t layer /*= 0*/, CubeMapFace face
 	return mSurfaces[index].pData;
 }
 
+void Image::CreateImage( TextureType type, PixelFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t levels, uint32_t layers )
+{
+	Clear();
+
+	mType = type;
+	mFormat = format;
+	mWidth = width;
+	mHeight = (type == TT_Texture1D) ? 1 : height;
+	mDepth = (type == TT_Texture3D) ? depth : 1;
+	mLevels = (std::max)(1U, levels);
+	mLayers = (std::max)(1U, layers);
+
+	// Row pitch and 2D surface size of each level
+	vector<uint32_t> rowPitches(mLevels), surfaceSizes(mLevels), depths(mLevels);
+	uint32_t layerSize = 0;
+	for (uint32_t level = 0; level < mLevels; ++level)
+	{
+		uint32_t levelWidth = (std::max)(1U, mWidth >> level);
+		uint32_t levelHeight = (std::max)(1U, mHeight >> level);
+		depths[level] = (std::max)(1U, mDepth >> level);
+
+		surfaceSizes[level] = CalculateSurfaceSize(mFormat, levelWidth, levelHeight, &rowPitches[level]);
+
+		layerSize += surfaceSizes[level] * depths[level];
+	}
+
+	uint32_t numFaces = (mType == TT_TextureCube) ? CMF_Count : 1;
+	uint8_t* pImageData = new uint8_t[layerSize * numFaces * mLayers];
+
+	mSurfaces.reserve(mLayers * numFaces * mLevels);
+	for (uint32_t i = 0; i < mLayers * numFaces; ++i)
+	{
+		for (uint32_t level = 0; level < mLevels; ++level)
+		{
+			SurfaceInfo surface = { pImageData, rowPitches[level], surfaceSizes[level] };
+			mSurfaces.push_back(surface);
+
+			pImageData += surfaceSizes[level] * depths[level];
+		}
+	}
+
+	mValid = true;
+}
+
 bool Image::CopyImageFromTexture( const shared_ptr<Texture>& texture )
 {
 	Clear();
@@ -506,5 +599,172 @@ void Image::SaveLinearDepthToFile( const String& filename, float projM33, float
 	}
 }
 
+bool Image::LoadImageFromTGA( const String& filename )
+{
+	Clear();
+
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	TGAHeader header;
+	if (!file.read((char*)&header, sizeof(TGAHeader)))
+		return false;
+
+	// Only true color and grey images, palette ones are rare for textures
+	bool rle = (header.imageType == 10 || header.imageType == 11);
+	bool grey = (header.imageType == 3 || header.imageType == 11);
+	if (header.imageType != 2 && header.imageType != 3 && !rle)
+		return false;
+
+	uint32_t srcBytes = header.depth / 8;
+	if ((grey && srcBytes != 1) || (!grey && srcBytes != 3 && srcBytes != 4))
+		return false;
+
+	if (header.width == 0 || header.height == 0)
+		return false;
+
+	// Skip identification and palette
+	file.seekg(header.idLength + header.paletteType * header.numPaletteEntries * ((header.paletteBits + 7) / 8), std::ios::cur);
+
+	const uint32_t numPixels = header.width * header.height;
+	vector<uint8_t> srcData(numPixels * srcBytes);
+
+	if (rle)
+	{
+		uint32_t pixel = 0;
+		while (pixel < numPixels)
+		{
+			int packet = file.get();
+			if (packet == EOF)
+				return false;
+
+			uint32_t count = (packet & 0x7F) + 1;
+			if (pixel + count > numPixels)
+				return false;
+
+			if (packet & 0x80)
+			{
+				// Run length packet, one pixel repeated
+				uint8_t value[4];
+				if (!file.read((char*)value, srcBytes))
+					return false;
+
+				for (uint32_t i = 0; i < count; ++i)
+					memcpy(&srcData[(pixel + i) * srcBytes], value, srcBytes);
+			}
+			else if (!file.read((char*)&srcData[pixel * srcBytes], count * srcBytes))
+				return false;
+
+			pixel += count;
+		}
+	}
+	else if (!file.read((char*)&srcData[0], srcData.size()))
+		return false;
+
+	CreateImage(TT_Texture2D, PF_RGBA8_UNORM, header.width, header.height, 1, 1, 1);
+
+	// Rows are stored bottom up unless descriptor bit 5 is set
+	bool flip = (header.descriptor & 0x20) == 0;
+
+	uint8_t* pDest = static_cast<uint8_t*>(mSurfaces.front().pData);
+	for (uint32_t y = 0; y < header.height; ++y)
+	{
+		const uint8_t* pSrcRow = &srcData[(flip ? (header.height - y - 1) : y) * header.width * srcBytes];
+		uint8_t* pDestRow = pDest + y * mSurfaces.front().RowPitch;
+
+		for (uint32_t x = 0; x < header.width; ++x, pSrcRow += srcBytes, pDestRow += 4)
+		{
+			if (grey)
+			{
+				pDestRow[0] = pDestRow[1] = pDestRow[2] = pSrcRow[0];
+				pDestRow[3] = 255;
+			}
+			else
+			{
+				// BGR(A) order
+				pDestRow[0] = pSrcRow[2];
+				pDestRow[1] = pSrcRow[1];
+				pDestRow[2] = pSrcRow[0];
+				pDestRow[3] = (srcBytes == 4) ? pSrcRow[3] : 255;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Image::LoadImageFromPFM( const String& filename )
+{
+	Clear();
+
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	String magic;
+	int32_t width, height;
+	float scale;
+	file >> magic >> width >> height >> scale;
+
+	// Exactly one white space character before raster
+	file.get();
+
+	uint32_t numChannels;
+	if (magic == "PF")
+		numChannels = 3;
+	else if (magic == "Pf")
+		numChannels = 1;
+	else if (magic == "P4")
+		numChannels = 4;
+	else 
+		return false;
+
+	if (!file || width <= 0 || height <= 0)
+		return false;
+
+	vector<float> srcData(width * height * numChannels);
+	if (!file.read((char*)&srcData[0], srcData.size() * sizeof(float)))
+		return false;
+
+	// Positive scale means big endian
+	if (scale > 0.0f)
+	{
+		for (float& value : srcData)
+		{
+			uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+			std::swap(bytes[0], bytes[3]);
+			std::swap(bytes[1], bytes[2]);
+		}
+	}
+
+	CreateImage(TT_Texture2D, PF_RGBA32F, width, height, 1, 1, 1);
+
+	// Rows are stored bottom up
+	float* pDest = static_cast<float*>(mSurfaces.front().pData);
+	for (int32_t y = 0; y < height; ++y)
+	{
+		const float* pSrcRow = &srcData[(height - y - 1) * width * numChannels];
+		float* pDestRow = pDest + y * width * 4;
+
+		for (int32_t x = 0; x < width; ++x, pSrcRow += numChannels, pDestRow += 4)
+		{
+			if (numChannels == 1)
+			{
+				pDestRow[0] = pDestRow[1] = pDestRow[2] = pSrcRow[0];
+				pDestRow[3] = 1.0f;
+			}
+			else
+			{
+				pDestRow[0] = pSrcRow[0];
+				pDestRow[1] = pSrcRow[1];
+				pDestRow[2] = pSrcRow[2];
+				pDestRow[3] = (numChannels == 4) ? pSrcRow[3] : 1.0f;
+			}
+		}
+	}
+
+	return true;
+}
 
 }
\ No newline at end of file
@@ -7,13 +7,46 @@
 
 namespace RcEngine {
 
+enum MipFilter
+{
+	MF_Box = 0,		// 2x2 average, fast but blurry and aliased
+	MF_Kaiser		// Kaiser windowed sinc, sharper
+};
+
 class _ApiExport Image 
 {
 public:
 	Image();
 	~Image();
 
-	bool LoadImageFromDDS(const String& filename);
+	/**
+	 * Load DDS file, levels finer than firstLevel are skipped so only the mip tail is read.
+	 * At least the last level is loaded, GetFirstLevel returns the level actually used.
+	 */
+	bool LoadImageFromDDS(const String& filename, uint32_t firstLevel = 0);
+	bool LoadImageFromDDS(Stream& stream, uint32_t firstLevel = 0);
+	bool SaveImageToDDS(const String& filename);
+
+	/// Uncompressed 8 or 24/32 bit TGA, RLE included. Image is RGBA8 with first row on top.
+	bool LoadImageFromTGA(const String& filename);
+
+	/// PF, Pf or P4 float map. Image is RGBA32F with first row on top.
+	bool LoadImageFromPFM(const String& filename);
+
+	/**
+	 * Allocate uninitialized surfaces of all levels, layers and faces in one block. Surface order
+	 * is same as DDS files, all levels of one layer (or cube face) after another.
+	 */
+	void CreateImage(TextureType type, PixelFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t levels, uint32_t layers);
+
+	/**
+	 * Replace levels with full mip chain filtered from level 0, for RGBA8, sRGB8 and RGBA32F 2D,
+	 * array and cube images. sRGB images are filtered in linear space. If alphaCoverageRef > 0,
+	 * alpha of each level is scaled to keep the fraction of texels above it, so alpha tested
+	 * geometry doesn't fade out in distance. Faces and layers are filtered in parallel.
+	 */
+	void GenerateMipmaps(MipFilter filter = MF_Kaiser, float alphaCoverageRef = 0.0f);
+
 	void SaveImageToFile(const String& filename);
 	void SaveLinearDepthToFile(const String& filename, float projM33, float projM43);
 
@@ -23,12 +56,18 @@ public:
 	inline uint32_t GetLevels() const		{ assert(mValid); return mLevels; }
 	inline uint32_t GetLayers() const		{ assert(mValid); return mLayers; }
 
+	/// Level of source file stored as level 0, nonzero if finer levels were skipped on load.
+	inline uint32_t GetFirstLevel() const	{ assert(mValid); return mFirstLevel; }
+
 	inline PixelFormat GetFormat() const	{ assert(mValid); return mFormat; }
 	inline TextureType GetType() const		{ assert(mValid); return mType; }
 
 	uint32_t GetRowPitch(uint32_t level);
 	uint32_t GetSlicePitch(uint32_t level);
 	uint32_t GetSurfaceSize(uint32_t level);
+
+	/// Bytes of one 2D surface of format, compressed formats are padded to 4x4 blocks.
+	static uint32_t CalculateSurfaceSize(PixelFormat format, uint32_t width, uint32_t height, uint32_t* rowPitch = nullptr);
 	
 	const void* GetLevel(uint32_t level, uint32_t layer = 0, CubeMapFace face = CMF_PositiveX) const;
 	void* GetLevel(uint32_t level, uint32_t layer = 0, CubeMapFace face = CMF_PositiveX);
@@ -48,6 +87,7 @@ private:
 
 	uint32_t mLevels;
 	uint32_t mLayers;
+	uint32_t mFirstLevel;
 
 	struct SurfaceInfo
 	{
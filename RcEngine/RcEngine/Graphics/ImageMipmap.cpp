@@ -0,0 +1,332 @@
+#include <Graphics/Image.h>
+#include <Core/ThreadPool.h>
+#include <Core/Exception.h>
+
+#ifdef RC_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace RcEngine {
+
+namespace {
+
+// Kaiser window parameters, filter width in destination texels
+const float KaiserWidth = 3.0f;
+const float KaiserAlpha = 4.0f;
+
+/**
+ * Separable 2:1 downsample kernel. Tap i of destination texel x reads source texel 2x + Offset + i.
+ */
+struct MipKernel
+{
+	vector<float> Weights;
+	int32_t Offset;
+};
+
+// Zero order modified Bessel function of first kind
+float BesselI0(float x)
+{
+	float sum = 1.0f, term = 1.0f;
+	for (uint32_t k = 1; k < 32; ++k)
+	{
+		term *= (x * 0.5f / k) * (x * 0.5f / k);
+		sum += term;
+		if (term < sum * 1e-8f)
+			break;
+	}
+	return sum;
+}
+
+float Sinc(float x)
+{
+	if (fabsf(x) < 1e-5f)
+		return 1.0f;
+
+	x *= 3.14159265f;
+	return sinf(x) / x;
+}
+
+MipKernel CreateMipKernel(MipFilter filter)
+{
+	MipKernel kernel;
+
+	if (filter == MF_Box)
+	{
+		kernel.Weights.push_back(0.5f);
+		kernel.Weights.push_back(0.5f);
+		kernel.Offset = 0;
+		return kernel;
+	}
+
+	// Windowed sinc in destination texel space, source texel centers are at +-0.25, +-0.75 ...
+	const int32_t radius = static_cast<int32_t>(ceilf(KaiserWidth));
+	const float invBesselAlpha = 1.0f / BesselI0(KaiserAlpha);
+
+	float sum = 0.0f;
+	for (int32_t i = -radius; i < radius; ++i)
+	{
+		float t = (i + 0.5f) * 0.5f;
+		float window = 0.0f;
+
+		float r = t / (KaiserWidth * 0.5f);
+		if (r * r < 1.0f)
+			window = BesselI0(KaiserAlpha * sqrtf(1.0f - r * r)) * invBesselAlpha;
+
+		float weight = Sinc(t) * window;
+		kernel.Weights.push_back(weight);
+		sum += weight;
+	}
+
+	for (float& weight : kernel.Weights)
+		weight /= sum;
+
+	kernel.Offset = -radius + 1;
+	return kernel;
+}
+
+float SRGBToLinear(float value)
+{
+	return (value <= 0.04045f) ? (value / 12.92f) : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float value)
+{
+	return (value <= 0.0031308f) ? (value * 12.92f) : (1.055f * powf(value, 1.0f / 2.4f) - 0.055f);
+}
+
+uint8_t FloatToUNorm8(float value)
+{
+	value = (std::min)(1.0f, (std::max)(0.0f, value));
+	return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+/**
+ * Accumulate weighted RGBA texels, one SSE register per texel.
+ */
+inline void FilterTexels(const float* const* texels, const float* weights, uint32_t numTaps, float* result)
+{
+#ifdef RC_SSE2
+	__m128 sum = _mm_setzero_ps();
+	for (uint32_t i = 0; i < numTaps; ++i)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texels[i]), _mm_set1_ps(weights[i])));
+	_mm_storeu_ps(result, sum);
+#else
+	result[0] = result[1] = result[2] = result[3] = 0.0f;
+	for (uint32_t i = 0; i < numTaps; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			result[c] += texels[i][c] * weights[i];
+	}
+#endif
+}
+
+/**
+ * Half size linear RGBA32F level, separable filter with clamped texel addressing.
+ */
+void DownsampleLevel(const MipKernel& kernel, const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dest)
+{
+	const uint32_t destWidth = (std::max)(1U, srcWidth >> 1);
+	const uint32_t destHeight = (std::max)(1U, srcHeight >> 1);
+	const uint32_t numTaps = kernel.Weights.size();
+
+	// 1 texel wide dimension is not filtered
+	const bool filterX = srcWidth > 1;
+	const bool filterY = srcHeight > 1;
+
+	// Horizontal pass keeps source height
+	vector<float> temp(destWidth * srcHeight * 4);
+	ParallelFor(0, srcHeight, [&](uint32_t y) {
+		const float* texels[16];
+		const float* srcRow = src + y * srcWidth * 4;
+		float* tempRow = &temp[y * destWidth * 4];
+
+		for (uint32_t x = 0; x < destWidth; ++x)
+		{
+			if (!filterX)
+			{
+				memcpy(tempRow + x * 4, srcRow, sizeof(float) * 4);
+				continue;
+			}
+
+			for (uint32_t i = 0; i < numTaps; ++i)
+			{
+				int32_t srcX = (std::min)(static_cast<int32_t>(srcWidth) - 1, (std::max)(0, static_cast<int32_t>(x * 2) + kernel.Offset + static_cast<int32_t>(i)));
+				texels[i] = srcRow + srcX * 4;
+			}
+
+			FilterTexels(texels, &kernel.Weights[0], numTaps, tempRow + x * 4);
+		}
+	});
+
+	ParallelFor(0, destHeight, [&](uint32_t y) {
+		const float* texels[16];
+		float* destRow = dest + y * destWidth * 4;
+
+		if (!filterY)
+		{
+			memcpy(destRow, &temp[0], sizeof(float) * 4 * destWidth);
+			return;
+		}
+
+		int32_t rows[16];
+		for (uint32_t i = 0; i < numTaps; ++i)
+			rows[i] = (std::min)(static_cast<int32_t>(srcHeight) - 1, (std::max)(0, static_cast<int32_t>(y * 2) + kernel.Offset + static_cast<int32_t>(i)));
+
+		for (uint32_t x = 0; x < destWidth; ++x)
+		{
+			for (uint32_t i = 0; i < numTaps; ++i)
+				texels[i] = &temp[(rows[i] * destWidth + x) * 4];
+
+			FilterTexels(texels, &kernel.Weights[0], numTaps, destRow + x * 4);
+		}
+	});
+}
+
+float ComputeAlphaCoverage(const float* texels, uint32_t numTexels, float alphaRef, float alphaScale)
+{
+	uint32_t numPassed = 0;
+	for (uint32_t i = 0; i < numTexels; ++i)
+	{
+		if (texels[i * 4 + 3] * alphaScale > alphaRef)
+			numPassed++;
+	}
+
+	return static_cast<float>(numPassed) / numTexels;
+}
+
+/**
+ * Scale alpha of a level so the fraction of texels passing alpha test matches coverage.
+ */
+void PreserveAlphaCoverage(float* texels, uint32_t numTexels, float alphaRef, float coverage)
+{
+	float minScale = 0.0f, maxScale = 4.0f, scale = 1.0f;
+	for (uint32_t i = 0; i < 10; ++i)
+	{
+		float currentCoverage = ComputeAlphaCoverage(texels, numTexels, alphaRef, scale);
+		if (currentCoverage < coverage)
+			minScale = scale;
+		else if (currentCoverage > coverage)
+			maxScale = scale;
+		else
+			break;
+
+		scale = (minScale + maxScale) * 0.5f;
+	}
+
+	for (uint32_t i = 0; i < numTexels; ++i)
+		texels[i * 4 + 3] = (std::min)(1.0f, texels[i * 4 + 3] * scale);
+}
+
+}
+
+void Image::GenerateMipmaps( MipFilter filter /*= MF_Kaiser*/, float alphaCoverageRef /*= 0.0f*/ )
+{
+	if (mFormat != PF_RGBA8_UNORM && mFormat != PF_SRGB8_ALPHA8_UNORM && mFormat != PF_RGBA32F)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Only RGBA8, sRGB8 and RGBA32F images support mipmap generation", "Image::GenerateMipmaps");
+
+	if (mType == TT_Texture3D)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Volume texture mipmap generation unsupported", "Image::GenerateMipmaps");
+
+	const bool srgb = (mFormat == PF_SRGB8_ALPHA8_UNORM);
+	const bool floatFormat = (mFormat == PF_RGBA32F);
+	const uint32_t numSurfaces = mLayers * ((mType == TT_TextureCube) ? CMF_Count : 1);
+	const uint32_t width = mWidth, height = mHeight;
+
+	uint32_t numLevels = 1;
+	while ((std::max)(width, height) >> numLevels)
+		numLevels++;
+
+	// Level 0 of every surface as linear float, filtering from it avoids accumulating 8 bit rounding
+	float srgbToLinear[256];
+	for (uint32_t i = 0; i < 256; ++i)
+		srgbToLinear[i] = srgb ? SRGBToLinear(i / 255.0f) : (i / 255.0f);
+
+	vector<vector<float> > topLevels(numSurfaces);
+	ParallelFor(0, numSurfaces, [&](uint32_t surface) {
+		const SurfaceInfo& info = mSurfaces[surface * mLevels];
+		vector<float>& texels = topLevels[surface];
+		texels.resize(width * height * 4);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t* srcRow = static_cast<const uint8_t*>(info.pData) + y * info.RowPitch;
+			float* destRow = &texels[y * width * 4];
+
+			if (floatFormat)
+				memcpy(destRow, srcRow, sizeof(float) * 4 * width);
+			else
+			{
+				for (uint32_t x = 0; x < width * 4; x += 4)
+				{
+					destRow[x + 0] = srgbToLinear[srcRow[x + 0]];
+					destRow[x + 1] = srgbToLinear[srcRow[x + 1]];
+					destRow[x + 2] = srgbToLinear[srcRow[x + 2]];
+					destRow[x + 3] = srcRow[x + 3] / 255.0f;
+				}
+			}
+		}
+	});
+
+	// Keep top level bits exact
+	vector<vector<uint8_t> > topLevelData(numSurfaces);
+	const uint32_t texelBytes = floatFormat ? 16 : 4;
+	for (uint32_t surface = 0; surface < numSurfaces; ++surface)
+	{
+		const SurfaceInfo& info = mSurfaces[surface * mLevels];
+		topLevelData[surface].resize(width * height * texelBytes);
+		for (uint32_t y = 0; y < height; ++y)
+			memcpy(&topLevelData[surface][y * width * texelBytes], static_cast<const uint8_t*>(info.pData) + y * info.RowPitch, width * texelBytes);
+	}
+
+	CreateImage(mType, mFormat, width, height, 1, numLevels, mLayers);
+
+	const MipKernel kernel = CreateMipKernel(filter);
+
+	// Surfaces in parallel, rows of each level in nested tasks
+	ParallelFor(0, numSurfaces, [&](uint32_t surface) {
+		memcpy(mSurfaces[surface * numLevels].pData, &topLevelData[surface][0], topLevelData[surface].size());
+
+		vector<float> level, nextLevel;
+		level.swap(topLevels[surface]);
+
+		float coverage = 0.0f;
+		if (alphaCoverageRef > 0.0f)
+			coverage = ComputeAlphaCoverage(&level[0], width * height, alphaCoverageRef, 1.0f);
+
+		uint32_t levelWidth = width, levelHeight = height;
+		for (uint32_t i = 1; i < numLevels; ++i)
+		{
+			uint32_t nextWidth = (std::max)(1U, levelWidth >> 1);
+			uint32_t nextHeight = (std::max)(1U, levelHeight >> 1);
+			const uint32_t numTexels = nextWidth * nextHeight;
+
+			nextLevel.resize(numTexels * 4);
+			DownsampleLevel(kernel, &level[0], levelWidth, levelHeight, &nextLevel[0]);
+			level.swap(nextLevel);
+
+			levelWidth = nextWidth;
+			levelHeight = nextHeight;
+
+			// Filtered values stay in level for next level, only stored copy is adjusted
+			vector<float> stored(level);
+			if (alphaCoverageRef > 0.0f)
+				PreserveAlphaCoverage(&stored[0], numTexels, alphaCoverageRef, coverage);
+
+			void* pDest = mSurfaces[surface * numLevels + i].pData;
+			if (floatFormat)
+				memcpy(pDest, &stored[0], sizeof(float) * stored.size());
+			else
+			{
+				uint8_t* destTexels = static_cast<uint8_t*>(pDest);
+				for (uint32_t t = 0; t < numTexels * 4; t += 4)
+				{
+					for (uint32_t c = 0; c < 3; ++c)
+						destTexels[t + c] = FloatToUNorm8(srgb ? LinearToSRGB(stored[t + c]) : stored[t + c]);
+					destTexels[t + 3] = FloatToUNorm8(stored[t + 3]);
+				}
+			}
+		}
+	});
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,116 @@
+#include <Graphics/InstanceBatch.h>
+#include <Graphics/Material.h>
+#include <Graphics/Effect.h>
+#include <Graphics/RenderFactory.h>
+#include <Graphics/RenderOperation.h>
+#include <Graphics/GraphicsResource.h>
+#include <Graphics/VertexDeclaration.h>
+#include <Core/Environment.h>
+#include <Core/Exception.h>
+
+namespace RcEngine {
+
+InstanceBatch::InstanceBatch()
+	: mRenderOperation(new RenderOperation)
+{
+
+}
+
+InstanceBatch::~InstanceBatch()
+{
+
+}
+
+bool InstanceBatch::CanInstance( const Renderable& lhs, const Renderable& rhs )
+{
+	if (lhs.GetInstanceKey() == nullptr || lhs.GetInstanceKey() != rhs.GetInstanceKey())
+		return false;
+
+	if (lhs.GetMaterial() != rhs.GetMaterial() || lhs.GetWorldTransformsCount() != 1 || rhs.GetWorldTransformsCount() != 1)
+		return false;
+
+	const RenderOperation& lhsOp = *lhs.GetRenderOperation();
+	const RenderOperation& rhsOp = *rhs.GetRenderOperation();
+
+	return lhsOp.PrimitiveType == rhsOp.PrimitiveType &&
+		   lhsOp.VertexDecl == rhsOp.VertexDecl &&
+		   lhsOp.VertexStreams == rhsOp.VertexStreams &&
+		   lhsOp.IndexBuffer == rhsOp.IndexBuffer &&
+		   lhsOp.IndexType == rhsOp.IndexType &&
+		   lhsOp.IndexStart == rhsOp.IndexStart &&
+		   lhsOp.IndexCount == rhsOp.IndexCount &&
+		   lhsOp.VertexStart == rhsOp.VertexStart &&
+		   lhsOp.VertexCount == rhsOp.VertexCount &&
+		   lhsOp.BaseVertex == rhsOp.BaseVertex;
+}
+
+shared_ptr<VertexDeclaration> InstanceBatch::CreateInstancedVertexDeclaration( const VertexDeclaration& vertexDecl )
+{
+	vector<VertexElement> elements = vertexDecl.GetVertexElements();
+
+	uint32_t instanceSlot = 0;
+	for (const VertexElement& element : elements)
+		instanceSlot = (std::max)(instanceSlot, element.InputSlot + 1);
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		VertexElement element(sizeof(float4) * i, VEF_Float4, VEU_TextureCoordinate, i);
+		element.InputSlot = instanceSlot;
+		element.InstanceStepRate = 1;
+		elements.push_back(element);
+	}
+
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+	return factory->CreateVertexDeclaration(&elements[0], elements.size());
+}
+
+void InstanceBatch::Reset( Renderable* const* instances, uint32_t count, const shared_ptr<GraphicsBuffer>& instanceBuffer,
+	const shared_ptr<VertexDeclaration>& instancedDecl )
+{
+	assert(count > 0 && count <= MaxInstances);
+
+	mMaterial = instances[0]->GetMaterial();
+	mInstanceBuffer = instanceBuffer;
+
+	mInstances.assign(instances, instances + count);
+	mWorldTransforms.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+		instances[i]->GetWorldTransforms(&mWorldTransforms[i]);
+
+	*mRenderOperation = *instances[0]->GetRenderOperation();
+	mRenderOperation->VertexDecl = instancedDecl;
+	mRenderOperation->BindVertexStream(instancedDecl->GetVertexElements().back().InputSlot, instanceBuffer);
+	mRenderOperation->NumInstances = count;
+}
+
+EffectTechnique* InstanceBatch::GetTechnique() const
+{
+	return mMaterial->GetInstancedTechnique();
+}
+
+void InstanceBatch::GetWorldTransforms( float4x4* xform ) const
+{
+	std::copy(mWorldTransforms.begin(), mWorldTransforms.end(), xform);
+}
+
+uint32_t InstanceBatch::GetWorldTransformsCount() const
+{
+	return mWorldTransforms.size();
+}
+
+void InstanceBatch::OnRenderBegin()
+{
+	// Instance buffer is shared by all batches of render queue, so every draw discards it
+	uint32_t bufferSize = sizeof(float4x4) * mWorldTransforms.size();
+	float4x4* pInstances = static_cast<float4x4*>(mInstanceBuffer->Map(0, bufferSize, RMA_Write_Discard));
+
+	// Rows of transposed matrix are columns of world, shader builds world matrix from columns
+	for (size_t i = 0; i < mWorldTransforms.size(); ++i)
+		pInstances[i] = mWorldTransforms[i].Transpose();
+	mInstanceBuffer->UnMap();
+
+	mMaterial->ApplyInstancedMaterial();
+	mInstances[0]->ApplyGeometryParameters(*mMaterial->GetInstancedEffect());
+}
+
+} // Namespace RcEngine
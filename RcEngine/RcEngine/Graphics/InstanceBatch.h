@@ -0,0 +1,67 @@
+#ifndef InstanceBatch_h__
+#define InstanceBatch_h__
+
+#include <Core/Prerequisites.h>
+#include <Graphics/Renderable.h>
+
+namespace RcEngine {
+
+/**
+ * Run of queued renderables drawing the same geometry with the same material, merged into one
+ * instanced draw by render queue. World transforms are uploaded to instance stream before draw,
+ * four float4 rows of transposed world matrix per instance.
+ */
+class _ApiExport InstanceBatch : public Renderable
+{
+public:
+	// Instance stream size, longer runs are split
+	static const uint32_t MaxInstances = 256;
+
+public:
+	InstanceBatch();
+	~InstanceBatch();
+
+	/**
+	 * Return if two renderables can be drawn by one instanced draw, they must have the same
+	 * instance key, material and render operation.
+	 */
+	static bool CanInstance(const Renderable& lhs, const Renderable& rhs);
+
+	/**
+	 * Vertex declaration of geometry with four per instance float4 elements appended, in
+	 * the next input slot.
+	 */
+	static shared_ptr<VertexDeclaration> CreateInstancedVertexDeclaration(const VertexDeclaration& vertexDecl);
+
+	/**
+	 * Set up batch from instances, instance buffer is bound to instanced vertex declaration's
+	 * last input slot.
+	 */
+	void Reset(Renderable* const* instances, uint32_t count, const shared_ptr<GraphicsBuffer>& instanceBuffer,
+		const shared_ptr<VertexDeclaration>& instancedDecl);
+
+	inline uint32_t GetNumInstances() const						{ return mInstances.size(); }
+
+	const shared_ptr<Material>& GetMaterial() const				{ return mMaterial; }
+	const shared_ptr<RenderOperation>& GetRenderOperation() const	{ return mRenderOperation; }
+
+	EffectTechnique* GetTechnique() const;
+
+	/// World transform of each instance.
+	void GetWorldTransforms(float4x4* xform) const;
+	uint32_t GetWorldTransformsCount() const;
+
+	void OnRenderBegin();
+
+protected:
+	shared_ptr<Material> mMaterial;
+	shared_ptr<RenderOperation> mRenderOperation;
+	shared_ptr<GraphicsBuffer> mInstanceBuffer;
+
+	vector<Renderable*> mInstances;
+	vector<float4x4> mWorldTransforms;
+};
+
+} // Namespace RcEngine
+
+#endif // InstanceBatch_h__
@@ -0,0 +1,213 @@
+#include <Graphics/IrradianceVolume.h>
+#include <Graphics/VertexQuantization.h>
+#include <Graphics/RenderFactory.h>
+#include <Graphics/GraphicsResource.h>
+#include <Core/Environment.h>
+#include <IO/Stream.h>
+#include <Core/Exception.h>
+#include <Math/Math.h>
+
+namespace RcEngine {
+
+IrradianceVolume::IrradianceVolume()
+{
+	mDims[0] = mDims[1] = mDims[2] = 0;
+}
+
+IrradianceVolume::~IrradianceVolume()
+{
+
+}
+
+void IrradianceVolume::Create( const BoundingBoxf& bounds, uint32_t dimX, uint32_t dimY, uint32_t dimZ )
+{
+	if (dimX < 2 || dimY < 2 || dimZ < 2 || !bounds.IsValid())
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Volume needs valid bounds and two probes per axis", "IrradianceVolume::Create");
+
+	mBounds = bounds;
+	mDims[0] = dimX;
+	mDims[1] = dimY;
+	mDims[2] = dimZ;
+
+	SHRadiance black;
+	memset(&black, 0, sizeof(black));
+	mProbes.assign(dimX * dimY * dimZ, black);
+}
+
+bool IrradianceVolume::Load( Stream& stream )
+{
+	// Short reads leave values undefined, check sizes before reading
+	const uint32_t headerSize = 5 * sizeof(uint32_t) + 2 * sizeof(float3);
+	if (stream.GetSize() - stream.GetPosition() < headerSize)
+		return false;
+
+	if (stream.ReadUInt() != FileMagic || stream.ReadUInt() != FileVersion)
+		return false;
+
+	uint32_t dims[3];
+	for (uint32_t i = 0; i < 3; ++i)
+		dims[i] = stream.ReadUInt();
+
+	BoundingBoxf bounds;
+	stream.Read(&bounds.Min, sizeof(float3));
+	stream.Read(&bounds.Max, sizeof(float3));
+
+	// Same checks as Create, which throws
+	if (dims[0] < 2 || dims[1] < 2 || dims[2] < 2 || !bounds.IsValid())
+		return false;
+
+	uint64_t dataSize = uint64_t(dims[0]) * dims[1] * dims[2] * 27 * sizeof(uint16_t);
+	if (dataSize > stream.GetSize() - stream.GetPosition())
+		return false;
+
+	vector<uint16_t> halfs(size_t(dataSize / sizeof(uint16_t)));
+	if (stream.Read(&halfs[0], uint32_t(dataSize)) != dataSize)
+		return false;
+
+	Create(bounds, dims[0], dims[1], dims[2]);
+
+	const uint16_t* src = &halfs[0];
+	for (SHRadiance& sh : mProbes)
+	{
+		for (uint32_t i = 0; i < 9; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				sh.Coeffs[i][c] = VertexQuantization::HalfToFloat(*src++);
+		}
+	}
+
+	return true;
+}
+
+void IrradianceVolume::Save( Stream& stream ) const
+{
+	stream.WriteUInt(FileMagic);
+	stream.WriteUInt(FileVersion);
+	for (uint32_t i = 0; i < 3; ++i)
+		stream.WriteUInt(mDims[i]);
+
+	stream.Write(&mBounds.Min, sizeof(float3));
+	stream.Write(&mBounds.Max, sizeof(float3));
+
+	vector<uint16_t> halfs;
+	halfs.reserve(mProbes.size() * 27);
+	for (const SHRadiance& sh : mProbes)
+	{
+		for (uint32_t i = 0; i < 9; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				halfs.push_back(VertexQuantization::FloatToHalf(sh.Coeffs[i][c]));
+		}
+	}
+
+	if (halfs.size())
+		stream.Write(&halfs[0], halfs.size() * sizeof(uint16_t));
+}
+
+float3 IrradianceVolume::GetProbePosition( uint32_t x, uint32_t y, uint32_t z ) const
+{
+	float3 extent = mBounds.Max - mBounds.Min;
+	return float3(mBounds.Min.X() + extent.X() * x / (mDims[0] - 1),
+				  mBounds.Min.Y() + extent.Y() * y / (mDims[1] - 1),
+				  mBounds.Min.Z() + extent.Z() * z / (mDims[2] - 1));
+}
+
+void IrradianceVolume::Sample( const float3& position, SHRadiance& sh ) const
+{
+	uint32_t cell[3];
+	float weight[3];
+
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		float extent = mBounds.Max[axis] - mBounds.Min[axis];
+		float coord = extent > 0.0f ? (position[axis] - mBounds.Min[axis]) / extent * (mDims[axis] - 1) : 0.0f;
+		coord = Clamp(coord, 0.0f, float(mDims[axis] - 1));
+
+		cell[axis] = (std::min)(uint32_t(coord), mDims[axis] - 2);
+		weight[axis] = coord - cell[axis];
+	}
+
+	memset(&sh, 0, sizeof(sh));
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		uint32_t dx = corner & 1, dy = (corner >> 1) & 1, dz = corner >> 2;
+
+		float w = (dx ? weight[0] : 1.0f - weight[0]) * (dy ? weight[1] : 1.0f - weight[1]) * (dz ? weight[2] : 1.0f - weight[2]);
+		if (w == 0.0f)
+			continue;
+
+		const SHRadiance& probe = mProbes[GetProbeIndex(cell[0] + dx, cell[1] + dy, cell[2] + dz)];
+		for (uint32_t i = 0; i < 9; ++i)
+			sh.Coeffs[i] += probe.Coeffs[i] * w;
+	}
+}
+
+void IrradianceVolume::EvalBasis( const float3& dir, float basis[9] )
+{
+	const float x = dir.X(), y = dir.Y(), z = dir.Z();
+
+	basis[0] = 0.282095f;
+	basis[1] = 0.488603f * y;
+	basis[2] = 0.488603f * z;
+	basis[3] = 0.488603f * x;
+	basis[4] = 1.092548f * x * y;
+	basis[5] = 1.092548f * y * z;
+	basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+	basis[7] = 1.092548f * x * z;
+	basis[8] = 0.546274f * (x * x - y * y);
+}
+
+float3 IrradianceVolume::EvalIrradiance( const SHRadiance& sh, const float3& normal )
+{
+	// Clamped cosine lobe per band
+	static const float Band[9] = { 
+		Mathf::PI, 
+		Mathf::PI * 2.0f / 3.0f, Mathf::PI * 2.0f / 3.0f, Mathf::PI * 2.0f / 3.0f,
+		Mathf::PI / 4.0f, Mathf::PI / 4.0f, Mathf::PI / 4.0f, Mathf::PI / 4.0f, Mathf::PI / 4.0f };
+
+	float basis[9];
+	EvalBasis(normal, basis);
+
+	float3 irradiance(0.0f, 0.0f, 0.0f);
+	for (uint32_t i = 0; i < 9; ++i)
+		irradiance += sh.Coeffs[i] * (Band[i] * basis[i]);
+
+	for (uint32_t c = 0; c < 3; ++c)
+		irradiance[c] = (std::max)(irradiance[c], 0.0f);
+
+	return irradiance;
+}
+
+void IrradianceVolume::CreateTextures()
+{
+	if (mProbes.empty())
+		ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Volume has no probes", "IrradianceVolume::CreateTextures");
+
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+
+	const uint32_t numProbes = mProbes.size();
+	vector<uint16_t> texels(numProbes * 4);
+	
+	for (uint32_t i = 0; i < NumCoeffTextures; ++i)
+	{
+		for (uint32_t probe = 0; probe < numProbes; ++probe)
+		{
+			const SHRadiance& sh = mProbes[probe];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				// Last texel has one unused channel
+				uint32_t index = i * 4 + c;
+				texels[probe * 4 + c] = VertexQuantization::FloatToHalf(index < 27 ? sh.Coeffs[index / 3][index % 3] : 0.0f);
+			}
+		}
+
+		ElementInitData initData;
+		initData.pData = &texels[0];
+		initData.rowPitch = mDims[0] * 4 * sizeof(uint16_t);
+		initData.slicePitch = initData.rowPitch * mDims[1];
+
+		mCoeffTextures[i] = factory->CreateTexture3D(mDims[0], mDims[1], mDims[2], PF_RGBA16F, 1, EAH_GPU_Read, TexCreate_ShaderResource, &initData);
+	}
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,88 @@
+#ifndef IrradianceVolume_h__
+#define IrradianceVolume_h__
+
+#include <Core/Prerequisites.h>
+#include <Math/Vector.h>
+#include <Math/BoundingBox.h>
+
+namespace RcEngine {
+
+/**
+ * Order 2 spherical harmonics (9 coefficients) of incoming radiance per RGB channel.
+ */
+struct _ApiExport SHRadiance
+{
+	float3 Coeffs[9];
+};
+
+/**
+ * Regular grid of SH radiance probes spanning a box, baked offline by ProbeBaker. Probes sit
+ * on grid corners, so a 2x2x2 volume has one probe at each box corner. 
+
+   File layout:
+   
+   Magic, Version				uint32_t
+   Dims							uint32_t * 3
+   Bounds Min, Max				float3 * 2
+   Probes						half * 27 each, X fastest then Y then Z
+
+ * CPU code samples the probe around a point with Sample and shades with EvalIrradiance. For GPU
+ * shading CreateTextures uploads the probes, which DeferredPath applies in its lighting pass.
+ */
+class _ApiExport IrradianceVolume
+{
+public:
+	static const uint32_t FileMagic = ('I' << 24) | ('R' << 16) | ('R' << 8) | ('V');
+	static const uint32_t FileVersion = 1;
+
+	/// 27 floats of a probe, ordered by coefficient then channel, packed four per texel.
+	static const uint32_t NumCoeffTextures = 7;
+
+public:
+	IrradianceVolume();
+	~IrradianceVolume();
+
+	/// Allocate dimX x dimY x dimZ black probes, each dimension at least 2.
+	void Create(const BoundingBoxf& bounds, uint32_t dimX, uint32_t dimY, uint32_t dimZ);
+
+	/// Return false if stream doesn't hold a valid volume of current version, volume is unchanged then.
+	bool Load(Stream& stream);
+	void Save(Stream& stream) const;
+
+	const BoundingBoxf& GetBounds() const				{ return mBounds; }
+	uint32_t GetDimension(uint32_t axis) const			{ return mDims[axis]; }
+	uint32_t GetNumProbes() const						{ return mProbes.size(); }
+
+	uint32_t GetProbeIndex(uint32_t x, uint32_t y, uint32_t z) const { return (z * mDims[1] + y) * mDims[0] + x; }
+	float3 GetProbePosition(uint32_t x, uint32_t y, uint32_t z) const;
+
+	const SHRadiance& GetProbe(uint32_t index) const	{ return mProbes[index]; }
+	void SetProbe(uint32_t index, const SHRadiance& sh)	{ mProbes[index] = sh; }
+
+	/// Trilinear blend of the eight probes around position, clamped to volume bounds.
+	void Sample(const float3& position, SHRadiance& sh) const;
+
+	/// Real SH basis of order 2 in direction, which must be normalized.
+	static void EvalBasis(const float3& dir, float basis[9]);
+
+	/**
+	 * Irradiance arriving at surface with normal, radiance convolved with clamped cosine
+	 * (Ramamoorthi and Hanrahan). Divide by PI for outgoing radiance of white diffuse surface.
+	 */
+	static float3 EvalIrradiance(const SHRadiance& sh, const float3& normal);
+
+	/// (Re)create RGBA16F 3D textures of current probes, one texel per probe. Call again after SetProbe.
+	void CreateTextures();
+	const shared_ptr<Texture>& GetCoeffTexture(uint32_t index) const { return mCoeffTextures[index]; }
+
+private:
+	BoundingBoxf mBounds;
+	uint32_t mDims[3];
+	vector<SHRadiance> mProbes;
+
+	shared_ptr<Texture> mCoeffTextures[NumCoeffTextures];
+};
+
+} // Namespace RcEngine
+
+#endif // IrradianceVolume_h__
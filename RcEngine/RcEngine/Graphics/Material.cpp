@@ -6,6 +6,7 @@
 #include <Graphics/Effect.h>
 #include <Graphics/GraphicsResource.h>
 #include <Graphics/TextureResource.h>
+#include <Graphics/TextureStreamer.h>
 #include <Graphics/RenderState.h>
 #include <Graphics/RenderQueue.h>
 #include <Core/Environment.h>
@@ -22,22 +23,20 @@ namespace {
 
 using namespace RcEngine;
 
-uint32_t GetRenderQueueBucket(const String& str) 
+// Mesh appends effect flags its vertex layout needs to material name, e.g. "Box.material.xml _QuantizedVertex"
+String SplitMaterialFlags(const String& materialName, vector<String>* flags)
 {
-	if (str == "Overlay")
-		return RenderQueue::BucketOverlay;
-	else if (str == "Background")
-		return RenderQueue::BucketBackground;
-	else if (str == "Opaque")
-		return RenderQueue::BucketOpaque;
-	else if (str == "Transparent")
-		return RenderQueue::BucketTransparent;
-	else if (str == "Translucent")
-		return RenderQueue::BucketTranslucent;
-	else if (str == "Opaque")
-		return RenderQueue::BucketTransparent;
-	else 
-		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Undefined Queue Bucket", "GetQueueBucket");
+	size_t flagsPos = materialName.find(" _");
+	if (flags && flagsPos != String::npos)
+	{
+		StringStream iss(materialName.substr(flagsPos));
+
+		String flag;
+		while (iss >> flag)
+			flags->push_back(flag);
+	}
+
+	return materialName.substr(0, flagsPos);
 }
 
 }
@@ -101,27 +100,52 @@ void Material::SetTexture( const String& name, const shared_ptr<ShaderResourceVi
 	effectParam->SetValue(textureSRV);
 }
 
+void Material::PrepareImpl()
+{
+	FileSystem& fileSystem = FileSystem::GetSingleton();
+
+	vector<String> nameFlags;
+	String materialFile = SplitMaterialFlags(mResourceName, &nameFlags);
+
+	// Prefer cooked binary material if up to date, no XML parsing and semantic lookup
+	mScript = std::make_shared<Internal::MaterialScript>();
+
+	if (shared_ptr<Stream> matStream = Internal::OpenCookedScript(materialFile, mGroup, Internal::MaterialScriptId))
+	{
+		Internal::LoadMaterialScript(*matStream, *mScript);
+	}
+	else
+	{
+		shared_ptr<Stream> xmlStream = fileSystem.OpenStream(materialFile, mGroup);
+		Stream& source = *xmlStream;	
+
+		XMLDoc doc;
+		XMLNodePtr root = doc.Parse(source);
+		Internal::LoadMaterialScript(root, *mScript);
+	}
+
+	// Flags from material name select effect variant, material script may list them already
+	for (const String& flag : nameFlags)
+	{
+		if (std::find(mScript->EffectFlags.begin(), mScript->EffectFlags.end(), flag) == mScript->EffectFlags.end())
+			mScript->EffectFlags.push_back(flag);
+	}
+}
+
 void Material::LoadImpl()
 {
 	FileSystem& fileSystem = FileSystem::GetSingleton();
-	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
 	ResourceManager& resMan = ResourceManager::GetSingleton();
 
-	shared_ptr<Stream> matStream = fileSystem.OpenStream(mResourceName, mGroup);
-	Stream& source = *matStream;	
-
-	XMLDoc doc;
-	XMLNodePtr root = doc.Parse(source);
+	const Internal::MaterialScript& script = *mScript;
 
 	// material name 
-	mMaterialName = root->AttributeString("name", "");
 	mMaterialName = mResourceName;
 
 	// effect first
-	XMLNodePtr effectNode = root->FirstNode("Effect");
-	String effecFile =  effectNode->AttributeString("name", "");		// file name
+	String effecFile = script.EffectFile;		// file name
 	
-	String parentDir = PathUtil::GetPath(mResourceName);
+	String parentDir = PathUtil::GetPath(SplitMaterialFlags(mResourceName, nullptr));
 	String effectResGroup;
 
 	// Test if a effect exits in the same group as material
@@ -138,80 +162,83 @@ void Material::LoadImpl()
 	 * we can distinction effects.
 	 */
 	String effectName = effecFile;
-	for (XMLNodePtr effectFlagNode = effectNode->FirstNode("Flag"); effectFlagNode; effectFlagNode = effectFlagNode->NextSibling("Flag"))
+	bool instancing = false;
+	for (const String& flag : script.EffectFlags)
 	{
-		String flag = effectFlagNode->AttributeString("name", "");
-		effectName += " " + flag;
+		// _Instancing flag requests an instanced variant beside the effect, not the effect itself 
+		if (flag == "_Instancing")
+			instancing = true;
+		else
+			effectName += " " + flag;
 	}
 	
 	// load effect
 	mEffect = std::static_pointer_cast<Effect>( resMan.GetResourceByName(RT_Effect, effectName, effectResGroup) );
+	resMan.AddDependency(mResourceHandle, mEffect->GetResourceHandle());
 
-	for (XMLNodePtr paramNode = root->FirstNode("Parameter"); paramNode; paramNode = paramNode->NextSibling("Parameter"))
+	if (instancing)
 	{
-		if (XMLAttributePtr sematicAttrib = paramNode->FirstAttribute("semantic"))
-		{
-			String semantic = sematicAttrib->ValueString();
-			EffectParameter* effectParam = mEffect->GetParameterByUsage(Internal::EffectParamsUsageDefs::GetInstance().GetUsageType(semantic));
+		mInstancedEffect = std::static_pointer_cast<Effect>( resMan.GetResourceByName(RT_Effect, effectName + " _Instancing", effectResGroup) );
+		resMan.AddDependency(mResourceHandle, mInstancedEffect->GetResourceHandle());
+	}
+
+	for (const Internal::MaterialParamScript& param : script.Params)
+	{
+		EffectParameter* effectParam = mEffect->GetParameterByUsage(param.Usage);
 			
-			if (effectParam == nullptr)
-				continue;
-
-			// texture type
-			if (EPT_Texture1D <= effectParam->GetParameterType() && effectParam->GetParameterType() <= EPT_TextureCubeArray)
-			{	
-				String texFile = paramNode->AttributeString("value", "");
-				if (!texFile.empty())
-				{
-					String resGroup = mGroup;
-					String texturePath = parentDir + texFile;
+		if (effectParam == nullptr)
+			continue;
+
+		// texture type
+		if (EPT_Texture1D <= effectParam->GetParameterType() && effectParam->GetParameterType() <= EPT_TextureCubeArray)
+		{	
+			const String& texFile = param.Value;
+			if (!texFile.empty())
+			{
+				String resGroup = mGroup;
+				String texturePath = parentDir + texFile;
 					
-					if (fileSystem.Exits(texturePath, mGroup) == false)
-						resGroup = "General";
+				if (fileSystem.Exits(texturePath, mGroup) == false)
+					resGroup = "General";
 
-					shared_ptr<TextureResource> textureRes = resMan.GetResourceByName<TextureResource>(RT_Texture, texturePath, mGroup);
-					mMaterialTextureCopys.push_back(textureRes->GetTexture());
-					SetTexture(effectParam->GetName(), textureRes->GetTexture()->GetShaderResourceView());		
-				}
-			}
+				// Streamed texture loads only mip tail
+				TextureStreamer* streamer = TextureStreamer::GetSingletonPtr();
+				if (streamer)
+					streamer->MarkStreamed( resMan.AddResource(RT_Texture, texturePath, mGroup) );
 
-			// Material Color
-			switch (effectParam->GetParameterUsage())
-			{
-			case EPU_Material_Ambient_Color:
-				{
-					String value = paramNode->AttributeString("value", "");
-				    mAmbient = Internal::StringToFloat3(value);	
-				}
-				break;
-			case EPU_Material_Diffuse_Color:
-				{
-					String value = paramNode->AttributeString("value", "");
-					mDiffuse = Internal::StringToFloat3(value);		
-				}
-				break;
-			case EPU_Material_Specular_Color:
-				{
-					String value = paramNode->AttributeString("value", "");
-					mSpecular = Internal::StringToFloat3(value);	
-				}
-				break;
-			case EPU_Material_Emissive_Color:
-				{
-					String value = paramNode->AttributeString("value", "");
-					mEmissive = Internal::StringToFloat3(value);	
-				}
-				break;
-			case EPU_Material_Power:
-				{
-					String value = paramNode->AttributeString("value", "");
-					std::sscanf(value.c_str(), "%f", &mPower);		
-				}
-				break;
-			default:
-				break;
+				shared_ptr<TextureResource> textureRes = resMan.GetResourceByName<TextureResource>(RT_Texture, texturePath, mGroup);
+				resMan.AddDependency(mResourceHandle, textureRes->GetResourceHandle());
+
+				if (streamer)
+					streamer->Register(textureRes);
+
+				mTextureResources.push_back(textureRes);
+				mBoundTextures.push_back( std::make_pair(effectParam->GetName(), textureRes->GetTexture()) );
+				SetTexture(effectParam->GetName(), textureRes->GetTexture()->GetShaderResourceView());		
 			}
 		}
+
+		// Material Color
+		switch (effectParam->GetParameterUsage())
+		{
+		case EPU_Material_Ambient_Color:
+			mAmbient = param.NumericValue;
+			break;
+		case EPU_Material_Diffuse_Color:
+			mDiffuse = param.NumericValue;
+			break;
+		case EPU_Material_Specular_Color:
+			mSpecular = param.NumericValue;
+			break;
+		case EPU_Material_Emissive_Color:
+			mEmissive = param.NumericValue;
+			break;
+		case EPU_Material_Power:
+			mPower = param.NumericValue[0];
+			break;
+		default:
+			break;
+		}
 	}
 
 	// Capture all auto-binding shader parameter
@@ -222,12 +249,39 @@ void Material::LoadImpl()
 			mAutoBindings.push_back(effectParam);
 	}
 
-	// Parse render queue bucket
-	if (root->FirstNode("Queue"))
+	if (mInstancedEffect)
 	{
-		String bucket = root->FirstNode("Queue")->AttributeString("name", "");
-		mQueueBucket = GetRenderQueueBucket(bucket);
+		for (auto& kv : mInstancedEffect->GetParameters())
+		{
+			EffectParameter* effectParam = kv.second;
+			if (effectParam->GetParameterUsage() != EPU_Unknown)
+				mInstancedAutoBindings.push_back(effectParam);
+
+			// Parameters set on material effect by render path are copied before instanced draw
+			EffectParameter* sourceParam = mEffect->GetParameterByName(kv.first);
+			if (sourceParam && sourceParam->GetParameterType() == effectParam->GetParameterType() &&
+				sourceParam->GetElementSize() == effectParam->GetElementSize())
+			{
+				effectParam->CopyValue(*sourceParam);
+
+				InstancedParameter instancedParam = { sourceParam, effectParam, sourceParam->GetTimeStamp() };
+				mInstancedParams.push_back(instancedParam);
+			}
+		}
 	}
+
+	// Render queue bucket
+	if (script.HasQueueBucket)
+		mQueueBucket = script.QueueBucket;
+
+	mScript.reset();
+}
+
+void Material::OnDependencyCollected( Resource& dependency )
+{
+	TextureStreamer* streamer = TextureStreamer::GetSingletonPtr();
+	if (streamer && dependency.GetResourceType() == RT_Texture)
+		streamer->MarkStreamed(dependency.GetResourceHandle());
 }
 
 void Material::UnloadImpl()
@@ -245,6 +299,11 @@ EffectTechnique* Material::GetCurrentTechnique() const
 	return mEffect->GetCurrentTechnique();
 }
 
+EffectTechnique* Material::GetInstancedTechnique() const
+{
+	return mInstancedEffect->GetTechniqueByName(mEffect->GetCurrentTechnique()->GetTechniqueName());
+}
+
 void Material::SetCurrentTechnique( const String& techName )
 {
 	mEffect->SetCurrentTechnique(techName);
@@ -256,11 +315,47 @@ void Material::SetCurrentTechnique( uint32_t index )
 }
 
 void Material::ApplyMaterial( const float4x4& world )
+{
+	UpdateStreamedTextures();
+	ApplyAutoBindings(mAutoBindings, world);
+}
+
+void Material::ApplyInstancedMaterial()
+{
+	UpdateStreamedTextures();
+
+	for (InstancedParameter& param : mInstancedParams)
+	{
+		if (param.Source->GetTimeStamp() != param.LastModified)
+		{
+			param.Target->CopyValue(*param.Source);
+			param.LastModified = param.Source->GetTimeStamp();
+		}
+	}
+
+	// World transform comes from instance stream
+	ApplyAutoBindings(mInstancedAutoBindings, float4x4::Identity());
+}
+
+void Material::UpdateStreamedTextures()
+{
+	for (size_t i = 0; i < mTextureResources.size(); ++i)
+	{
+		const shared_ptr<Texture>& texture = mTextureResources[i]->GetTexture();
+		if (mBoundTextures[i].second != texture)
+		{
+			SetTexture(mBoundTextures[i].first, texture->GetShaderResourceView());
+			mBoundTextures[i].second = texture;
+		}
+	}
+}
+
+void Material::ApplyAutoBindings( const vector<EffectParameter*>& autoBindings, const float4x4& world )
 {
 	RenderDevice* renderDevice = Environment::GetSingleton().GetRenderDevice();
 	const shared_ptr<Camera> camera = renderDevice->GetCurrentFrameBuffer()->GetCamera();
 
-	for (auto effectParam : mAutoBindings)
+	for (auto effectParam : autoBindings)
 	{
 		switch (effectParam->GetParameterUsage())
 		{
@@ -11,6 +11,10 @@
 
 
 namespace RcEngine {
+
+namespace Internal { struct MaterialScript; }
+
+class TextureResource;
 	
 static const int32_t MaxMaterialTextures = 16;
 
@@ -33,8 +37,17 @@ public:
 	uint32_t GetQueueBucket() const						{ return mQueueBucket; }
 
 	shared_ptr<Effect> GetEffect() const				{ return mEffect; }
+
+	/**
+	 * Effect variant compiled with _Instancing macro, world transform read from instance stream.
+	 * Null if material does not list _Instancing effect flag.
+	 */
+	shared_ptr<Effect> GetInstancedEffect() const		{ return mInstancedEffect; }
 	
 	EffectTechnique* GetCurrentTechnique() const;
+
+	/// Technique of instanced effect with the same name as current technique.
+	EffectTechnique* GetInstancedTechnique() const;
 	void SetCurrentTechnique(const String& techName);
 	void SetCurrentTechnique(uint32_t index);
 
@@ -45,16 +58,34 @@ public:
 
 	void SetTexture(const String& name, const shared_ptr<ShaderResourceView>& textureSRV);
 
+	/// Textures loaded from material script, texture streamer requests their levels.
+	const vector<shared_ptr<TextureResource> >& GetTextureResources() const	{ return mTextureResources; }
+
 	// Apply shader parameter before rendering, called by renderable
 	void ApplyMaterial(const float4x4& world = float4x4::Identity());
 
+	/**
+	 * Apply shader parameter before instanced draw. Parameters set on material effect since last 
+	 * instanced draw are copied to instanced effect first.
+	 */
+	void ApplyInstancedMaterial();
+
 	//shared_ptr<Resource> Clone();
 
+	/// Texture dependencies are marked streamed, so they are prepared with mip tail only.
+	void OnDependencyCollected(Resource& dependency);
+
 protected:
 
+	void PrepareImpl();
 	void LoadImpl();
     void UnloadImpl();
 
+	void ApplyAutoBindings(const vector<EffectParameter*>& autoBindings, const float4x4& world);
+
+	/// Rebind textures replaced by texture streamer.
+	void UpdateStreamedTextures();
+
 public:
 	static shared_ptr<Resource> FactoryFunc(ResourceManager* creator, ResourceHandle handle, const String& name, const String& group);
 
@@ -71,10 +102,26 @@ protected:
 	float3 mEmissive;
 	float mPower;
 	
-	vector<shared_ptr<Texture> > mMaterialTextureCopys;
+	// Texture resources and the texture each one had when bound to effect parameter
+	vector<shared_ptr<TextureResource> > mTextureResources;
+	vector<std::pair<String, shared_ptr<Texture> > > mBoundTextures;
 	unordered_map<String, shared_ptr<ShaderResourceView> > mTextureSRVs;		
 
 	vector<EffectParameter*> mAutoBindings;
+
+	struct InstancedParameter
+	{
+		EffectParameter* Source;
+		EffectParameter* Target;
+		TimeStamp LastModified;
+	};
+
+	shared_ptr<Effect> mInstancedEffect;
+	vector<EffectParameter*> mInstancedAutoBindings;
+	vector<InstancedParameter> mInstancedParams;
+
+	// Material script parsed by PrepareImpl
+	shared_ptr<Internal::MaterialScript> mScript;
 };
 
 
@@ -6,11 +6,16 @@
 #include <Graphics/VertexDeclaration.h>
 #include <Graphics/GraphicsResource.h>
 #include <Graphics/Skeleton.h>
+#include <Graphics/VertexQuantization.h>
+#include <Graphics/MeshFormat.h>
 #include <Core/Environment.h>
 #include <Core/Exception.h>
 #include <Core/Loger.h>
 #include <Graphics/Animation.h>
 #include <IO/Stream.h>
+#include <IO/MemoryStream.h>
+#include <IO/MappedFile.h>
+#include <IO/FileStream.h>
 #include <IO/FileSystem.h>
 #include <IO/PathUtil.h>
 #include <Math/MathUtil.h>
@@ -21,7 +26,8 @@
 namespace RcEngine {
 
 Mesh::Mesh(ResourceManager* creator, ResourceHandle handle, const String& name, const String& group )
-	: Resource(RT_Mesh, creator, handle, name, group)
+	: Resource(RT_Mesh, creator, handle, name, group),
+	  mFileVersion(1)
 {
 	printf("Create Mesh: %s\n", mResourceName.c_str());
 }
@@ -32,7 +38,7 @@ Mesh::~Mesh()
 }
 
 /**
- * Mesh Layout:
+ * Version 1 Mesh Layout, new files are version 2 (see MeshFormat.h):
    
    Magic Number			uint32_t
    Mesh Name			String
@@ -45,23 +51,154 @@ Mesh::~Mesh()
    Bones 
    Vertex Buffer Data
    Index Buffer Data
+   Mesh Part Clusters	optional, cluster count and clusters of each mesh part
+   Mesh Part LODs		optional, LOD count and simplified index ranges of each mesh part
 */
 
+void Mesh::PrepareImpl()
+{
+	shared_ptr<Stream> fileStream = FileSystem::GetSingleton().OpenStream(mResourceName, mGroup);
+
+	// Uncompressed files are mapped, buffers are created straight from file pages without a copy
+	shared_ptr<MemoryStream> memStream;
+	if (dynamic_cast<FileStream*>(fileStream.get()))
+	{
+		String fileName = fileStream->GetName();
+		fileStream->Close();
+
+		shared_ptr<MappedFile> mappedFile = std::make_shared<MappedFile>();
+		if (mappedFile->Open(fileName))
+			memStream = std::make_shared<MemoryStream>(fileName, mappedFile->GetData(), mappedFile->GetSize(), mappedFile);
+		else
+			fileStream = FileSystem::GetSingleton().OpenStream(mResourceName, mGroup);
+	}
+
+	if (!memStream)
+	{
+		memStream = std::make_shared<MemoryStream>();
+		if (memStream->ReadFrom(*fileStream) == false)
+			ENGINE_EXCEPT(Exception::ERR_INTERNAL_ERROR, "Error while reading mesh " + mResourceName, "Mesh::PrepareImpl");
+	}
+
+	// Parse section directory here on loader thread, LoadImpl only creates resources
+	mFileVersion = 1;
+	if (ReadMeshFileDirectory(memStream->GetData(), memStream->GetSize(), mFileHeader, mFileSections))
+		mFileVersion = mFileHeader.Version;
+
+	mPreparedStream = memStream;
+}
+
 void Mesh::LoadImpl()
 {
-	ResourceManager& resMan = ResourceManager::GetSingleton();
-	FileSystem& fileSystem = FileSystem::GetSingleton();
-	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+	shared_ptr<MemoryStream> streamPtr = mPreparedStream;
+	mPreparedStream.reset();
 
-	String currMeshDirectory = PathUtil::GetParentPath(mResourceName);
+	// Parts without material are not added to mesh, but cluster and LOD data is in file order
+	vector<shared_ptr<MeshPart> > fileMeshParts;
+
+	if (mFileVersion == MeshFileVersion)
+		LoadVersion2(*streamPtr, fileMeshParts);
+	else
+		LoadVersion1(*streamPtr, fileMeshParts);
+
+	vector<MeshSectionEntry>().swap(mFileSections);
+
+	AddMeshParts(fileMeshParts);
+
+	// Skinned vertices move, cluster bounds are not valid
+	if (mSkeleton)
+	{
+		for (shared_ptr<MeshPart>& meshPart : fileMeshParts)
+			meshPart->mClusters.clear();
+	}
+
+	// Texture streaming needs texcoord density, computed while all vertex data is on CPU
+	for (shared_ptr<MeshPart>& meshPart : mMeshParts)
+		meshPart->UpdateUVDensity();
+
+	// Static batching reads vertex copies back on demand, see LoadShadowData
+	ReleaseShadowData();
+}
 
-	shared_ptr<Stream> streamPtr = fileSystem.OpenStream(mResourceName, mGroup);
-	Stream& source = *streamPtr;
+bool Mesh::LoadShadowData()
+{
+	if (mSkeleton)
+		return false;
+
+	// Already loaded
+	for (VertexBuffer& vertexBuffer : mVertexBuffers)
+	{
+		if (vertexBuffer.ShadowData.size())
+			return true;
+	}
+
+	MeshFileGeometry geometry;
+	if (!ReadMeshFileGeometry(FileSystem::GetSingleton().Locate(mResourceName, mGroup), geometry) ||
+		geometry.VertexBuffers.size() != mVertexBuffers.size() || geometry.IndexBuffers.size() != mIndexBuffers.size())
+		return false;
+
+	for (size_t i = 0; i < mVertexBuffers.size(); ++i)
+	{
+		VertexBuffer& vertexBuffer = mVertexBuffers[i];
+		vector<uint8_t>& data = geometry.VertexBuffers[i].Data;
+
+		uint32_t vertexSize = vertexBuffer.VertexDecl ? vertexBuffer.VertexDecl->GetVertexSize() : 0;
+		if (vertexSize && data.size() % vertexSize == 0 && data.size() / vertexSize <= MaxShadowVertexCount)
+			vertexBuffer.ShadowData.swap(data);
+	}
+
+	// Index copies of parts with vertex copy, in buffer index format
+	for (shared_ptr<MeshPart>& meshPart : mMeshParts)
+	{
+		if (meshPart->mIndexBufferIndex < 0 || !meshPart->GetVertexShadowData())
+			continue;
+
+		IndexBuffer& indexBuffer = mIndexBuffers[meshPart->mIndexBufferIndex];
+		if (indexBuffer.ShadowData.size())
+			continue;
+
+		const vector<uint32_t>& indices = geometry.IndexBuffers[meshPart->mIndexBufferIndex];
+		if (indexBuffer.IndexFormat == IBT_Bit16)
+		{
+			indexBuffer.ShadowData.resize(sizeof(uint16_t) * indices.size());
+			uint16_t* pIndices = reinterpret_cast<uint16_t*>(indexBuffer.ShadowData.data());
+			for (size_t j = 0; j < indices.size(); ++j)
+				pIndices[j] = static_cast<uint16_t>(indices[j]);
+		}
+		else
+		{
+			const uint8_t* pIndices = reinterpret_cast<const uint8_t*>(indices.data());
+			indexBuffer.ShadowData.assign(pIndices, pIndices + sizeof(uint32_t) * indices.size());
+		}
+	}
+
+	return true;
+}
+
+void Mesh::ReleaseShadowData()
+{
+	for (VertexBuffer& vertexBuffer : mVertexBuffers)
+		vector<uint8_t>().swap(vertexBuffer.ShadowData);
+
+	// Keep CPU index copy only for cluster culling
+	vector<bool> keepShadowData(mIndexBuffers.size(), false);
+	for (shared_ptr<MeshPart>& meshPart : mMeshParts)
+	{
+		if (meshPart->mIndexBufferIndex >= 0 && meshPart->mClusters.size())
+			keepShadowData[meshPart->mIndexBufferIndex] = true;
+	}
 
-	const uint32_t MeshId = ('M' << 24) | ('E' << 16) | ('S' << 8) | ('H');
+	for (size_t i = 0; i < mIndexBuffers.size(); ++i)
+	{
+		if (!keepShadowData[i])
+			vector<uint8_t>().swap(mIndexBuffers[i].ShadowData);
+	}
+}
 
+void Mesh::LoadVersion1( MemoryStream& source, vector<shared_ptr<MeshPart> >& fileMeshParts )
+{
 	uint32_t header = source.ReadUInt();
-	assert(header == MeshId);
+	assert(header == MeshFileMagic);
 
 	// read mesh name
 	String meshName = source.ReadString();
@@ -77,30 +214,7 @@ void Mesh::LoadImpl()
 	uint32_t numVertexBuffers = source.ReadUInt();
 	uint32_t numIndexBuffers = source.ReadUInt();
 
-	// Read mesh parts
-	for (uint32_t i = 0; i < numMeshParts; ++i)
-	{
-		shared_ptr<MeshPart> subMesh = std::make_shared<MeshPart>(*this);
-		subMesh->Load(source);
-
-		String matPath;
-
-		if (currMeshDirectory.empty())
-			matPath = subMesh->mMaterialName;
-		else 
-			matPath = currMeshDirectory + "/" + subMesh->mMaterialName;
-
-		// Hack: if material doesn't exit, not add it
-		if (fileSystem.Exits(matPath, mGroup) == false)
-		{
-			EngineLogger::LogWarning("Material %s Not Exits!", matPath.c_str());
-			continue;
-		}
-
-		// add mesh part material resource
-		ResourceManager::GetSingleton().AddResource(RT_Material, matPath, mGroup);
-		mMeshParts.push_back(subMesh);
-	}
+	LoadMeshParts(source, numMeshParts, fileMeshParts);
 
 	// Read bones
 	if (numBones > 0)
@@ -125,17 +239,12 @@ void Mesh::LoadImpl()
 			vertexElement.UsageIndex = source.ReadUShort();
 		}
 
-		mVertexBuffers[i].VertexDecl = factory->CreateVertexDeclaration(&elements[0], elements.size());
+		InitVertexLayout(i, elements);
 		
-		// Read vertex buffer
-		uint32_t vertexSize = mVertexBuffers[i].VertexDecl->GetVertexSize();
-		uint32_t vertexBufferSize = vertexSize * vertexCount;
-
-		mVertexBuffers[i].Buffer = factory->CreateVertexBuffer(vertexBufferSize, EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Vertex, nullptr);
-
-		void* pBuffer = mVertexBuffers[i].Buffer->Map(0, vertexBufferSize, RMA_Write_Discard);
-		source.Read(pBuffer, vertexBufferSize);
-		mVertexBuffers[i].Buffer->UnMap();
+		// Vertex buffer created from memory stream data
+		uint32_t vertexBufferSize = mVertexBuffers[i].VertexDecl->GetVertexSize() * vertexCount;
+		InitVertexData(i, source.GetData() + source.GetPosition(), vertexBufferSize);
+		source.Seek(source.GetPosition() + vertexBufferSize);
 	}
 
 	// Read index buffers
@@ -143,27 +252,245 @@ void Mesh::LoadImpl()
 	for (uint32_t i = 0; i < numIndexBuffers; ++i)
 	{
 		uint32_t indexCount = source.ReadUInt();
-		
-		uint32_t indexBufferSize;
-		if (source.ReadUInt() == IBT_Bit16)
+		IndexBufferType indexFormat = (source.ReadUInt() == IBT_Bit16) ? IBT_Bit16 : IBT_Bit32;
+
+		uint32_t indexBufferSize = indexCount * (indexFormat == IBT_Bit16 ? sizeof(uint16_t) : sizeof(uint32_t));
+		InitIndexData(i, indexFormat, source.GetData() + source.GetPosition(), indexBufferSize);
+		source.Seek(source.GetPosition() + indexBufferSize);
+	}
+
+	// Read clusters, older mesh files end here
+	if (!source.IsEof())
+	{
+		for (shared_ptr<MeshPart>& meshPart : fileMeshParts)
 		{
-			mIndexBuffers[i].IndexFormat = IBT_Bit16;
-			indexBufferSize = sizeof(uint16_t) * indexCount;
+			meshPart->mClusters.resize(source.ReadUInt());
+			for (MeshCluster& cluster : meshPart->mClusters)
+				cluster.Read(source);
 		}
-		else
+	}
+
+	// Read simplified LOD levels
+	if (!source.IsEof())
+	{
+		for (shared_ptr<MeshPart>& meshPart : fileMeshParts)
+		{
+			meshPart->mLods.resize(source.ReadUInt());
+			if (meshPart->mLods.size())
+				source.Read(&meshPart->mLods[0], sizeof(MeshLodLevel) * meshPart->mLods.size());
+		}
+	}
+}
+
+void Mesh::LoadVersion2( MemoryStream& source, vector<shared_ptr<MeshPart> >& fileMeshParts )
+{
+	mBoundingBox = BoundingBoxf(mFileHeader.BoundMin, mFileHeader.BoundMax);
+
+	mVertexBuffers.resize(mFileHeader.NumVertexBuffers);
+	mIndexBuffers.resize(mFileHeader.NumIndexBuffers);
+
+	// Mesh parts and skeleton first, other sections refer to them
+	for (const MeshSectionEntry& section : mFileSections)
+	{
+		source.Seek(section.Offset);
+
+		if (section.Type == MST_MeshParts)
+		{
+			String meshName = source.ReadString();
+			LoadMeshParts(source, mFileHeader.NumMeshParts, fileMeshParts);
+		}
+		else if (section.Type == MST_Skeleton && mFileHeader.NumBones > 0)
+		{
+			mSkeleton = Skeleton::LoadFrom(source, mFileHeader.NumBones);
+		}
+	}
+
+	auto CheckSection = [&](const MeshSectionEntry& section, uint32_t numItems, uint32_t expectedSize) {
+		if (section.Index >= numItems || section.Size != expectedSize)
+			ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid mesh section in " + mResourceName, "Mesh::LoadVersion2");
+	};
+
+	// Vertex layouts next, vertex data size is checked against them
+	for (const MeshSectionEntry& section : mFileSections)
+	{
+		if (section.Type != MST_VertexLayout)
+			continue;
+
+		CheckSection(section, mVertexBuffers.size(), sizeof(MeshVertexElementDesc) * section.Count);
+		if (section.Count == 0)
+			ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Empty vertex layout in " + mResourceName, "Mesh::LoadVersion2");
+
+		const MeshVertexElementDesc* descs = reinterpret_cast<const MeshVertexElementDesc*>(source.GetData() + section.Offset);
+		vector<VertexElement> elements(section.Count);
+		for (uint32_t i = 0; i < section.Count; ++i)
+		{
+			elements[i].Offset = descs[i].Offset;
+			elements[i].Type = static_cast<VertexElementFormat>(descs[i].Type);
+			elements[i].Usage = static_cast<VertexElementUsage>(descs[i].Usage);
+			elements[i].UsageIndex = descs[i].UsageIndex;
+		}
+
+		InitVertexLayout(section.Index, elements);
+	}
+
+	// Writer stores identical buffers once, sections at the same offset share one GPU buffer
+	std::map<uint32_t, shared_ptr<GraphicsBuffer> > vertexDataBuffers, indexDataBuffers;
+
+	// Buffers are created straight from file ranges, sections don't depend on each other
+	for (const MeshSectionEntry& section : mFileSections)
+	{
+		const uint8_t* data = source.GetData() + section.Offset;
+
+		switch (section.Type)
+		{
+		case MST_VertexData:
+			{
+				if (section.Index >= mVertexBuffers.size() || !mVertexBuffers[section.Index].VertexDecl)
+					ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Vertex data without layout in " + mResourceName, "Mesh::LoadVersion2");
+
+				uint32_t vertexSize = mVertexBuffers[section.Index].VertexDecl->GetVertexSize();
+				CheckSection(section, mVertexBuffers.size(), vertexSize * section.Count);
+				InitVertexData(section.Index, data, section.Size, vertexDataBuffers[section.Offset]);
+				vertexDataBuffers[section.Offset] = mVertexBuffers[section.Index].Buffer;
+			}
+			break;
+		case MST_IndexData:
+			{
+				IndexBufferType indexFormat = (section.Format == IBT_Bit16) ? IBT_Bit16 : IBT_Bit32;
+				uint32_t indexSize = (indexFormat == IBT_Bit16) ? sizeof(uint16_t) : sizeof(uint32_t);
+				CheckSection(section, mIndexBuffers.size(), indexSize * section.Count);
+				InitIndexData(section.Index, indexFormat, data, section.Size, indexDataBuffers[section.Offset]);
+				indexDataBuffers[section.Offset] = mIndexBuffers[section.Index].Buffer;
+			}
+			break;
+		case MST_Clusters:
+			{
+				CheckSection(section, fileMeshParts.size(), MeshCluster::FileSize * section.Count);
+				vector<MeshCluster>& clusters = fileMeshParts[section.Index]->mClusters;
+				clusters.resize(section.Count);
+
+				source.Seek(section.Offset);
+				for (MeshCluster& cluster : clusters)
+					cluster.Read(source);
+			}
+			break;
+		case MST_Lods:
+			{
+				CheckSection(section, fileMeshParts.size(), sizeof(MeshLodLevel) * section.Count);
+				const MeshLodLevel* lods = reinterpret_cast<const MeshLodLevel*>(data);
+				fileMeshParts[section.Index]->mLods.assign(lods, lods + section.Count);
+			}
+			break;
+		default:
+			// Mesh parts, skeleton and unknown sections
+			break;
+		}
+	}
+}
+
+void Mesh::LoadMeshParts( Stream& source, uint32_t numMeshParts, vector<shared_ptr<MeshPart> >& fileMeshParts )
+{
+	fileMeshParts.resize(numMeshParts);
+	for (uint32_t i = 0; i < numMeshParts; ++i)
+	{
+		fileMeshParts[i] = std::make_shared<MeshPart>(*this);
+		fileMeshParts[i]->Load(source);
+	}
+}
+
+void Mesh::AddMeshParts( const vector<shared_ptr<MeshPart> >& fileMeshParts )
+{
+	ResourceManager& resMan = ResourceManager::GetSingleton();
+	FileSystem& fileSystem = FileSystem::GetSingleton();
+
+	String currMeshDirectory = PathUtil::GetParentPath(mResourceName);
+
+	for (const shared_ptr<MeshPart>& subMesh : fileMeshParts)
+	{
+		String matPath;
+
+		if (currMeshDirectory.empty())
+			matPath = subMesh->mMaterialName;
+		else 
+			matPath = currMeshDirectory + "/" + subMesh->mMaterialName;
+
+		// Hack: if material doesn't exit, not add it. Cooked duplicates only exist as alias
+		if (fileSystem.Exits(resMan.ResolveAlias(matPath), mGroup) == false)
 		{
-			mIndexBuffers[i].IndexFormat = IBT_Bit32;
-			indexBufferSize = sizeof(uint32_t) * indexCount;
+			EngineLogger::LogWarning("Material %s Not Exits!", matPath.c_str());
+			continue;
 		}
 
-		// Read index buffer
-		mIndexBuffers[i].Buffer = factory->CreateIndexBuffer(indexBufferSize, EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Index, nullptr);
-		void* pBuffer = mIndexBuffers[i].Buffer->Map(0, indexBufferSize, RMA_Write_Discard);
-		source.Read(pBuffer, indexBufferSize);
-		mIndexBuffers[i].Buffer->UnMap();
+		// Shader must decode quantized vertices, flag selects the effect variant
+		if (subMesh->mVertexBufferIndex >= 0 && subMesh->mVertexBufferIndex < (int32_t)mVertexBuffers.size() && subMesh->HasQuantizedPosition())
+			matPath += " _QuantizedVertex";
+
+		// add mesh part material resource
+		subMesh->mMaterialResourceName = matPath;
+		ResourceHandle matHandle = resMan.AddResource(RT_Material, matPath, mGroup);
+		resMan.AddDependency(mResourceHandle, matHandle);
+		mMeshParts.push_back(subMesh);
+	}
+}
+
+void Mesh::InitVertexLayout( uint32_t index, vector<VertexElement>& elements )
+{
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+
+	VertexBuffer& vertexBuffer = mVertexBuffers[index];
+	vertexBuffer.VertexDecl = factory->CreateVertexDeclaration(&elements[0], elements.size());
+
+	vertexBuffer.QuantizedPosition = false;
+	for (const VertexElement& vertexElement : elements)
+	{
+		if (vertexElement.Usage == VEU_Position && vertexElement.Type == VEF_UShort4N)
+			vertexBuffer.QuantizedPosition = true;
+	}
+}
+
+void Mesh::InitVertexData( uint32_t index, const void* data, uint32_t size, const shared_ptr<GraphicsBuffer>& sharedBuffer )
+{
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+
+	ElementInitData initData;
+	initData.pData = data;
+	initData.rowPitch = size;
+	initData.slicePitch = 0;
+
+	if (sharedBuffer)
+		mVertexBuffers[index].Buffer = sharedBuffer;
+	else
+		mVertexBuffers[index].Buffer = factory->CreateVertexBuffer(size, EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Vertex, &initData);
+
+	// Texcoord density source, released after load
+	if (!mSkeleton)
+	{
+		const uint8_t* vertexData = static_cast<const uint8_t*>(data);
+		mVertexBuffers[index].ShadowData.assign(vertexData, vertexData + size);
 	}
 }
 
+void Mesh::InitIndexData( uint32_t index, IndexBufferType format, const void* data, uint32_t size, const shared_ptr<GraphicsBuffer>& sharedBuffer )
+{
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+
+	IndexBuffer& indexBuffer = mIndexBuffers[index];
+	indexBuffer.IndexFormat = format;
+
+	const uint8_t* indexData = static_cast<const uint8_t*>(data);
+	indexBuffer.ShadowData.assign(indexData, indexData + size);
+
+	ElementInitData initData;
+	initData.pData = data;
+	initData.rowPitch = size;
+	initData.slicePitch = 0;
+
+	if (sharedBuffer)
+		indexBuffer.Buffer = sharedBuffer;
+	else
+		indexBuffer.Buffer = factory->CreateIndexBuffer(size, EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Index, &initData);
+}
+
 void Mesh::UnloadImpl()
 {
 
@@ -195,7 +522,8 @@ MeshPart::MeshPart(Mesh& mesh)
 	  mIndexCount(0),
 	  mPrimitiveCount(0),
 	  mIndexStart(0), 
-	  mVertexStart(0)
+	  mVertexStart(0),
+	  mUVDensity(0)
 {
 
 }
@@ -236,6 +564,120 @@ void MeshPart::Save( Stream& source )
 
 }
 
+bool MeshPart::HasQuantizedPosition() const
+{
+	return mParentMesh.mVertexBuffers[mVertexBufferIndex].QuantizedPosition;
+}
+
+void MeshPart::GetPositionDequantize( float3& scale, float3& bias ) const
+{
+	// Exporter quantizes all vertex buffers within mesh bounds
+	const BoundingBoxf& bound = mParentMesh.mBoundingBox;
+	scale = bound.Max - bound.Min;
+	bias = bound.Min;
+}
+
+void MeshPart::UpdateUVDensity()
+{
+	// Fallback assumes texture is mapped once over bounds
+	float diagonal = Length(mBoundingBox.Max - mBoundingBox.Min);
+	mUVDensity = (diagonal > 0.0f) ? 1.0f / diagonal : 1.0f;
+
+	const uint8_t* vertices = GetVertexShadowData();
+	const uint8_t* indices = GetIndexShadowData();
+	if (!vertices || !indices)
+		return;
+
+	const VertexElement* positionElement = nullptr;
+	const VertexElement* texcoordElement = nullptr;
+	for (const VertexElement& element : GetVertexDeclaration()->GetVertexElements())
+	{
+		if (element.Usage == VEU_Position)
+			positionElement = &element;
+		else if (element.Usage == VEU_TextureCoordinate && element.UsageIndex == 0)
+			texcoordElement = &element;
+	}
+
+	if (!positionElement || !texcoordElement || (texcoordElement->Type != VEF_Float2 && texcoordElement->Type != VEF_Half2))
+		return;
+
+	const uint32_t vertexSize = GetVertexDeclaration()->GetVertexSize();
+	const bool index16 = (GetIndexFormat() == IBT_Bit16);
+
+	float3 dequantizeScale, dequantizeBias;
+	GetPositionDequantize(dequantizeScale, dequantizeBias);
+
+	double worldArea = 0.0, uvArea = 0.0;
+	for (uint32_t i = 0; i + 2 < mIndexCount; i += 3)
+	{
+		float3 position[3];
+		float2 texcoord[3];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t index = mIndexStart + i + k;
+			const uint8_t* vertex = vertices + vertexSize * ((index16 ? reinterpret_cast<const uint16_t*>(indices)[index] : 
+				reinterpret_cast<const uint32_t*>(indices)[index]) + mBaseVertex);
+
+			const uint8_t* attribute = vertex + positionElement->Offset;
+			if (positionElement->Type == VEF_UShort4N)
+			{
+				const uint16_t* q = reinterpret_cast<const uint16_t*>(attribute);
+				for (int c = 0; c < 3; ++c)
+					position[k][c] = q[c] / 65535.0f * dequantizeScale[c] + dequantizeBias[c];
+			}
+			else
+				memcpy(&position[k], attribute, sizeof(float3));
+
+			attribute = vertex + texcoordElement->Offset;
+			if (texcoordElement->Type == VEF_Half2)
+			{
+				const uint16_t* h = reinterpret_cast<const uint16_t*>(attribute);
+				texcoord[k] = float2(VertexQuantization::HalfToFloat(h[0]), VertexQuantization::HalfToFloat(h[1]));
+			}
+			else
+				memcpy(&texcoord[k], attribute, sizeof(float2));
+		}
+
+		worldArea += Length(Cross(position[1] - position[0], position[2] - position[0]));
+
+		float2 uv1 = texcoord[1] - texcoord[0];
+		float2 uv2 = texcoord[2] - texcoord[0];
+		uvArea += fabs(uv1.X() * uv2.Y() - uv1.Y() * uv2.X());
+	}
+
+	// Area ratio is squared density
+	if (worldArea > 0.0 && uvArea > 0.0)
+		mUVDensity = static_cast<float>(sqrt(uvArea / worldArea));
+}
+
+const uint8_t* MeshPart::GetIndexShadowData() const
+{
+	const Mesh::IndexBuffer& indexBuffer = mParentMesh.mIndexBuffers[mIndexBufferIndex];
+	return indexBuffer.ShadowData.size() ? &indexBuffer.ShadowData[0] : nullptr;
+}
+
+IndexBufferType MeshPart::GetIndexFormat() const
+{
+	return mParentMesh.mIndexBuffers[mIndexBufferIndex].IndexFormat;
+}
+
+const uint8_t* MeshPart::GetVertexShadowData() const
+{
+	const Mesh::VertexBuffer& vertexBuffer = mParentMesh.mVertexBuffers[mVertexBufferIndex];
+	return vertexBuffer.ShadowData.size() ? &vertexBuffer.ShadowData[0] : nullptr;
+}
+
+uint32_t MeshPart::GetVertexShadowCount() const
+{
+	const Mesh::VertexBuffer& vertexBuffer = mParentMesh.mVertexBuffers[mVertexBufferIndex];
+	return vertexBuffer.ShadowData.size() / vertexBuffer.VertexDecl->GetVertexSize();
+}
+
+const shared_ptr<VertexDeclaration>& MeshPart::GetVertexDeclaration() const
+{
+	return mParentMesh.mVertexBuffers[mVertexBufferIndex].VertexDecl;
+}
+
 void MeshPart::GetRenderOperation( RenderOperation& op, uint32_t lodIndex )
 {
 	const Mesh::VertexBuffer& vertexBuffer = mParentMesh.mVertexBuffers[mVertexBufferIndex];
@@ -250,7 +692,12 @@ void MeshPart::GetRenderOperation( RenderOperation& op, uint32_t lodIndex )
 
 		// use indices buffer
 		op.BindIndexStream(indexBuffer.Buffer, indexBuffer.IndexFormat);
-		op.SetIndexRange(mIndexStart, mIndexCount);
+
+		if (lodIndex > 0 && lodIndex <= mLods.size())
+			op.SetIndexRange(mLods[lodIndex-1].IndexStart, mLods[lodIndex-1].IndexCount);
+		else
+			op.SetIndexRange(mIndexStart, mIndexCount);
+
 		op.VertexStart = mVertexStart;
 		op.BaseVertex = mBaseVertex;
 	}
@@ -3,6 +3,9 @@
 
 #include <Core/Prerequisites.h>
 #include <Graphics/GraphicsCommon.h>
+#include <Graphics/MeshOptimizer.h>
+#include <Graphics/MeshSimplifier.h>
+#include <Graphics/MeshFormat.h>
 #include <Math/BoundingBox.h>
 #include <Math/Matrix.h>
 #include <Resource/Resource.h>
@@ -11,6 +14,7 @@ namespace RcEngine {
 
 class Skeleton;
 class MeshPart;
+struct VertexElement;
 
 /**
   MeshPart don't store a material reference, it only store a material name which is define 
@@ -41,10 +45,43 @@ public:
 
 	virtual shared_ptr<Resource> Clone();
 
+	/**
+	 * Read CPU copies of unskinned vertex buffers up to MaxShadowVertexCount vertices and their
+	 * index buffers back from file, source for static batching. Return false for skinned mesh or
+	 * if file can't be read. Copies are not kept after load, so only batched meshes pay for them.
+	 */
+	bool LoadShadowData();
+
+	/// Release copies of LoadShadowData, index copies of clustered parts are kept.
+	void ReleaseShadowData();
+
+public:
+	// Unskinned vertex buffers up to this many vertices can be read back, see LoadShadowData
+	static const uint32_t MaxShadowVertexCount = 8192;
+
 protected:
+	void PrepareImpl();
 	void LoadImpl();
 	void UnloadImpl();
 
+private:
+	void LoadVersion1(MemoryStream& source, vector<shared_ptr<MeshPart> >& fileMeshParts);
+	void LoadVersion2(MemoryStream& source, vector<shared_ptr<MeshPart> >& fileMeshParts);
+	void LoadMeshParts(Stream& source, uint32_t numMeshParts, vector<shared_ptr<MeshPart> >& fileMeshParts);
+
+	/**
+	 * Add mesh parts whose material exists, after vertex layouts are known. Parts with quantized
+	 * vertices use the material with _QuantizedVertex effect flag.
+	 */
+	void AddMeshParts(const vector<shared_ptr<MeshPart> >& fileMeshParts);
+
+	void InitVertexLayout(uint32_t index, vector<VertexElement>& elements);
+	/**
+	 * Create buffer from data, or use shared buffer if the same data is already created.
+	 */
+	void InitVertexData(uint32_t index, const void* data, uint32_t size, const shared_ptr<GraphicsBuffer>& sharedBuffer = nullptr);
+	void InitIndexData(uint32_t index, IndexBufferType format, const void* data, uint32_t size, const shared_ptr<GraphicsBuffer>& sharedBuffer = nullptr);
+
 public:
 	static shared_ptr<Resource> FactoryFunc(ResourceManager* creator, ResourceHandle handle, const String& name, const String& group);
 
@@ -61,6 +98,8 @@ private:
 	{
 		shared_ptr<VertexDeclaration> VertexDecl;
 		shared_ptr<GraphicsBuffer> Buffer;
+		bool QuantizedPosition;
+		vector<uint8_t> ShadowData;		// CPU copy, only kept while loading and after LoadShadowData
 	};
 	vector<VertexBuffer> mVertexBuffers;
 
@@ -69,11 +108,20 @@ private:
 	{
 		IndexBufferType			   IndexFormat;
 		shared_ptr<GraphicsBuffer> Buffer;
+		vector<uint8_t>			   ShadowData;	// CPU copy, only kept for clustered or shadowed vertex mesh parts
 	};
 	vector<IndexBuffer> mIndexBuffers;
 
 	// Skeleton for skinned mesh, empty for static mesh
 	shared_ptr<Skeleton> mSkeleton;
+
+	// Whole mesh file read in memory by PrepareImpl
+	shared_ptr<MemoryStream> mPreparedStream;
+
+	// Version 2 header and section directory, parsed by PrepareImpl
+	uint32_t mFileVersion;
+	MeshFileHeader mFileHeader;
+	vector<MeshSectionEntry> mFileSections;
 };
 
 class _ApiExport MeshPart
@@ -95,16 +143,64 @@ public:
 
 	inline const String& GetMaterialName() const				{ return mMaterialName; }
 
+	/**
+	 * Material resource added by mesh, material file in mesh directory followed by effect flags
+	 * its vertex layout needs, e.g. "Box.material.xml _QuantizedVertex".
+	 */
+	inline const String& GetMaterialResourceName() const		{ return mMaterialResourceName; }
+
+	/**
+	 * Average texcoord 0 units per object space unit, used to pick texture mip level on screen. 
+	 * Estimated from bounding box if vertex data is not kept on CPU (skinned mesh).
+	 */
+	inline float GetUVDensity() const							{ return mUVDensity; }
+
+	/**
+	 * LOD 0 is full mesh part, higher levels are simplified index ranges with increasing error.
+	 */
 	void GetRenderOperation( RenderOperation& op, uint32_t lodIndex );
 
+	inline uint32_t GetNumLods() const							{ return mLods.size() + 1; }
+	inline float GetLodError(uint32_t lodIndex) const			{ return lodIndex ? mLods[lodIndex-1].Error : 0.0f; }
+
+	/**
+	 * Position stored as VEF_UShort4N within mesh bounds, shader decodes with 
+	 * position = q * scale + bias, see _QuantizedVertex.
+	 */
+	bool HasQuantizedPosition() const;
+	void GetPositionDequantize(float3& scale, float3& bias) const;
+
+	/**
+	 * Clusters for CPU culling, IndexStart is in parent index buffer. Empty for skinned mesh 
+	 * and mesh exported without clusters.
+	 */
+	inline const vector<MeshCluster>& GetClusters() const		{ return mClusters; }
+
+	/// CPU copy of parent index buffer, only valid if mesh part has clusters or vertex shadow data.
+	const uint8_t* GetIndexShadowData() const;
+	IndexBufferType GetIndexFormat() const;
+
+	/**
+	 * CPU copy of parent vertex buffer, nullptr unless Mesh::LoadShadowData is called and buffer has
+	 * at most Mesh::MaxShadowVertexCount vertices. Indices of this part address it with GetBaseVertex added.
+	 */
+	const uint8_t* GetVertexShadowData() const;
+	uint32_t GetVertexShadowCount() const;
+	const shared_ptr<VertexDeclaration>& GetVertexDeclaration() const;
+	inline int32_t GetBaseVertex() const						{ return mBaseVertex; }
+
 	void Load(Stream& source);
 	void Save(Stream& source);
 
+private:
+	void UpdateUVDensity();
+
 private:
 	Mesh& mParentMesh;
 
 	String mName;
 	String mMaterialName;
+	String mMaterialResourceName;
 
 	BoundingBoxf mBoundingBox;
 
@@ -120,6 +216,11 @@ private:
 	int32_t mBaseVertex;
 	
 	uint32_t mPrimitiveCount; // Only support triangle
+
+	float mUVDensity;
+
+	vector<MeshCluster> mClusters;
+	vector<MeshLodLevel> mLods;
 };
 
 } // Namespace RcEngine
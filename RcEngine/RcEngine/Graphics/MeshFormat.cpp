@@ -0,0 +1,313 @@
+#include <Graphics/MeshFormat.h>
+#include <Graphics/VertexDeclaration.h>
+#include <IO/MemoryStream.h>
+#include <IO/FileStream.h>
+#include <IO/CompressedStream.h>
+#include <Core/Exception.h>
+
+namespace RcEngine {
+
+namespace {
+
+void ReadMeshPart(Stream& source, MeshFileGeometry::Part& part)
+{
+	part.Name = source.ReadString();
+	source.ReadString(); // material
+
+	float3 partMin, partMax;
+	source.Read(&partMin, sizeof(float3));
+	source.Read(&partMax, sizeof(float3));
+
+	part.VertexBufferIndex = source.ReadUInt();
+	part.IndexBufferIndex = source.ReadUInt();
+	part.StartIndex = source.ReadUInt();
+	part.IndexCount = source.ReadUInt();
+	part.BaseVertex = source.ReadInt();
+}
+
+void AddVertexElement(MeshFileGeometry::VertexBuffer& vertexBuffer, const VertexElement& element)
+{
+	if (element.Usage == VEU_Position)
+	{
+		vertexBuffer.PositionOffset = element.Offset;
+		vertexBuffer.PositionType = element.Type;
+	}
+
+	vertexBuffer.VertexSize += VertexElementUtil::GetElementSize(element);
+}
+
+void ReadIndices(const uint8_t* data, uint32_t indexCount, uint32_t indexFormat, vector<uint32_t>& indexBuffer)
+{
+	indexBuffer.resize(indexCount);
+
+	if (indexFormat == IBT_Bit16)
+	{
+		const uint16_t* indices16 = reinterpret_cast<const uint16_t*>(data);
+		for (uint32_t i = 0; i < indexCount; ++i)
+			indexBuffer[i] = indices16[i];
+	}
+	else if (indexCount)
+		memcpy(&indexBuffer[0], data, sizeof(uint32_t) * indexCount);
+}
+
+void ReadMeshVersion1(MemoryStream& source, MeshFileGeometry& mesh)
+{
+	source.ReadUInt(); // magic
+
+	mesh.Name = source.ReadString();
+	source.Read(&mesh.BoundMin, sizeof(float3));
+	source.Read(&mesh.BoundMax, sizeof(float3));
+
+	uint32_t numMeshParts = source.ReadUInt();
+	uint32_t numBones = source.ReadUInt();
+	uint32_t numVertexBuffers = source.ReadUInt();
+	uint32_t numIndexBuffers = source.ReadUInt();
+
+	mesh.MeshParts.resize(numMeshParts);
+	for (MeshFileGeometry::Part& part : mesh.MeshParts)
+		ReadMeshPart(source, part);
+
+	// Skip bones, name, parent, position, rotation, scale
+	for (uint32_t i = 0; i < numBones; ++i)
+	{
+		uint8_t transform[sizeof(float) * 10];
+
+		source.ReadString();
+		source.ReadInt();
+		source.Read(transform, sizeof(transform));
+	}
+
+	mesh.VertexBuffers.resize(numVertexBuffers);
+	for (MeshFileGeometry::VertexBuffer& vertexBuffer : mesh.VertexBuffers)
+	{
+		vertexBuffer.VertexCount = source.ReadUInt();
+
+		uint32_t veCount = source.ReadUInt();
+		for (uint32_t i = 0; i < veCount; ++i)
+		{
+			VertexElement element;
+			element.Offset = source.ReadUInt();
+			element.Type = static_cast<VertexElementFormat>(source.ReadUInt());
+			element.Usage = static_cast<VertexElementUsage>(source.ReadUInt());
+			element.UsageIndex = source.ReadUShort();
+			AddVertexElement(vertexBuffer, element);
+		}
+
+		vertexBuffer.Data.resize(vertexBuffer.VertexCount * vertexBuffer.VertexSize);
+		if (vertexBuffer.Data.size())
+			source.Read(&vertexBuffer.Data[0], vertexBuffer.Data.size());
+	}
+
+	mesh.IndexBuffers.resize(numIndexBuffers);
+	for (vector<uint32_t>& indexBuffer : mesh.IndexBuffers)
+	{
+		uint32_t indexCount = source.ReadUInt();
+		uint32_t indexFormat = source.ReadUInt();
+		uint32_t indexSize = (indexFormat == IBT_Bit16) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+		ReadIndices(source.GetData() + source.GetPosition(), indexCount, indexFormat, indexBuffer);
+		source.Seek(source.GetPosition() + indexSize * indexCount);
+	}
+}
+
+void ReadMeshVersion2(MemoryStream& source, const MeshFileHeader& header, const vector<MeshSectionEntry>& sections, MeshFileGeometry& mesh)
+{
+	mesh.BoundMin = header.BoundMin;
+	mesh.BoundMax = header.BoundMax;
+	mesh.MeshParts.resize(header.NumMeshParts);
+	mesh.VertexBuffers.resize(header.NumVertexBuffers);
+	mesh.IndexBuffers.resize(header.NumIndexBuffers);
+
+	for (const MeshSectionEntry& section : sections)
+	{
+		const uint8_t* data = source.GetData() + section.Offset;
+
+		if (section.Type == MST_MeshParts)
+		{
+			source.Seek(section.Offset);
+			mesh.Name = source.ReadString();
+			for (MeshFileGeometry::Part& part : mesh.MeshParts)
+				ReadMeshPart(source, part);
+		}
+		else if (section.Type == MST_VertexLayout && section.Index < mesh.VertexBuffers.size())
+		{
+			const MeshVertexElementDesc* descs = reinterpret_cast<const MeshVertexElementDesc*>(data);
+			for (uint32_t i = 0; i < section.Count; ++i)
+			{
+				VertexElement element;
+				element.Offset = descs[i].Offset;
+				element.Type = static_cast<VertexElementFormat>(descs[i].Type);
+				element.Usage = static_cast<VertexElementUsage>(descs[i].Usage);
+				element.UsageIndex = descs[i].UsageIndex;
+				AddVertexElement(mesh.VertexBuffers[section.Index], element);
+			}
+		}
+		else if (section.Type == MST_VertexData && section.Index < mesh.VertexBuffers.size())
+		{
+			mesh.VertexBuffers[section.Index].Data.assign(data, data + section.Size);
+		}
+		else if (section.Type == MST_IndexData && section.Index < mesh.IndexBuffers.size())
+		{
+			ReadIndices(data, section.Count, section.Format, mesh.IndexBuffers[section.Index]);
+		}
+	}
+
+	// Layout and data sections may come in any order
+	for (MeshFileGeometry::VertexBuffer& vertexBuffer : mesh.VertexBuffers)
+		vertexBuffer.VertexCount = vertexBuffer.VertexSize ? vertexBuffer.Data.size() / vertexBuffer.VertexSize : 0;
+}
+
+}
+
+MeshFileWriter::MeshFileWriter()
+{
+
+}
+
+MeshFileWriter::~MeshFileWriter()
+{
+
+}
+
+Stream& MeshFileWriter::BeginSection( MeshSectionType type, uint32_t index, uint32_t count, uint32_t format )
+{
+	MeshSectionEntry entry;
+	entry.Type = type;
+	entry.Index = index;
+	entry.Count = count;
+	entry.Format = format;
+	entry.Offset = 0;
+	entry.Size = 0;
+
+	mSections.push_back(entry);
+	mSectionData.push_back(std::make_shared<MemoryStream>());
+
+	return *mSectionData.back();
+}
+
+void MeshFileWriter::Save( Stream& stream, MeshFileHeader& header )
+{
+	auto Align = [](uint32_t offset) -> uint32_t {
+		return (offset + MeshFileAlignment - 1) & ~(MeshFileAlignment - 1);
+	};
+
+	// Layout sections after directory, identical sections (e.g. vertex data of LOD and variant
+	// buffers) are stored once and share offset
+	vector<bool> stored(mSections.size(), false);
+	uint32_t offset = Align(sizeof(MeshFileHeader) + sizeof(MeshSectionEntry) * mSections.size());
+	for (size_t i = 0; i < mSections.size(); ++i)
+	{
+		mSections[i].Size = mSectionData[i]->GetSize();
+
+		size_t same = 0;
+		while (same < i && (!stored[same] || mSections[same].Size != mSections[i].Size || mSections[i].Size == 0 ||
+			   memcmp(mSectionData[same]->GetData(), mSectionData[i]->GetData(), mSections[i].Size) != 0))
+			++same;
+
+		if (same < i)
+		{
+			mSections[i].Offset = mSections[same].Offset;
+			continue;
+		}
+
+		stored[i] = true;
+		mSections[i].Offset = offset;
+		offset = Align(offset + mSections[i].Size);
+	}
+
+	header.Magic = MeshFileMagic;
+	header.Version = MeshFileVersion;
+	header.NumSections = mSections.size();
+	header.FileSize = offset;
+
+	stream.Write(&header, sizeof(MeshFileHeader));
+	if (mSections.size())
+		stream.Write(&mSections[0], sizeof(MeshSectionEntry) * mSections.size());
+
+	uint32_t position = sizeof(MeshFileHeader) + sizeof(MeshSectionEntry) * mSections.size();
+
+	const uint8_t Padding[MeshFileAlignment] = { 0 };
+	for (size_t i = 0; i < mSections.size(); ++i)
+	{
+		if (!stored[i])
+			continue;
+
+		stream.Write(Padding, mSections[i].Offset - position);
+		stream.Write(mSectionData[i]->GetData(), mSections[i].Size);
+		position = mSections[i].Offset + mSections[i].Size;
+	}
+
+	stream.Write(Padding, offset - position);
+}
+
+bool ReadMeshFileDirectory( const uint8_t* data, uint32_t size, MeshFileHeader& header, vector<MeshSectionEntry>& sections )
+{
+	// Version 1 has null terminated mesh name after magic, never starts with version number
+	if (size < sizeof(MeshFileHeader))
+		return false;
+
+	memcpy(&header, data, sizeof(MeshFileHeader));
+	if (header.Magic != MeshFileMagic || header.Version != MeshFileVersion)
+		return false;
+
+	uint32_t directorySize = sizeof(MeshSectionEntry) * header.NumSections;
+	if (header.FileSize > size || sizeof(MeshFileHeader) + directorySize > size)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Mesh file truncated", "ReadMeshFileDirectory");
+
+	sections.resize(header.NumSections);
+	if (header.NumSections)
+		memcpy(&sections[0], data + sizeof(MeshFileHeader), directorySize);
+
+	for (const MeshSectionEntry& entry : sections)
+	{
+		if ((entry.Offset & (MeshFileAlignment - 1)) || entry.Offset > size || entry.Size > size - entry.Offset)
+			ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid mesh file section", "ReadMeshFileDirectory");
+	}
+
+	return true;
+}
+
+float3 MeshFileGeometry::GetPosition( const Part& part, uint32_t index ) const
+{
+	const VertexBuffer& vertexBuffer = VertexBuffers[part.VertexBufferIndex];
+	const uint8_t* vertex = &vertexBuffer.Data[(part.BaseVertex + index) * vertexBuffer.VertexSize + vertexBuffer.PositionOffset];
+
+	float3 position;
+	if (vertexBuffer.PositionType == VEF_UShort4N)
+	{
+		const uint16_t* q = reinterpret_cast<const uint16_t*>(vertex);
+		for (int k = 0; k < 3; ++k)
+			position[k] = BoundMin[k] + (BoundMax[k] - BoundMin[k]) * (q[k] / 65535.0f);
+	}
+	else
+		memcpy(&position, vertex, sizeof(float3));
+
+	return position;
+}
+
+bool ReadMeshFileGeometry( const String& fileName, MeshFileGeometry& mesh )
+{
+	shared_ptr<FileStream> fileStream = std::make_shared<FileStream>();
+	if (!fileStream->Open(fileName, FILE_READ))
+		return false;
+
+	shared_ptr<Stream> streamPtr = fileStream;
+	if (CompressedStream::IsCompressed(*fileStream))
+		streamPtr = std::make_shared<CompressedStream>(fileStream);
+
+	MemoryStream source;
+	if (!source.ReadFrom(*streamPtr) || source.GetSize() < sizeof(uint32_t) || source.ReadUInt() != MeshFileMagic)
+		return false;
+	source.Seek(0);
+
+	MeshFileHeader header;
+	vector<MeshSectionEntry> sections;
+	if (ReadMeshFileDirectory(source.GetData(), source.GetSize(), header, sections))
+		ReadMeshVersion2(source, header, sections, mesh);
+	else
+		ReadMeshVersion1(source, mesh);
+
+	return true;
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,149 @@
+#ifndef MeshFormat_h__
+#define MeshFormat_h__
+
+#include <Core/Prerequisites.h>
+#include <Graphics/GraphicsCommon.h>
+#include <Math/Vector.h>
+
+namespace RcEngine {
+
+class MemoryStream;
+
+/**
+ * Mesh file version 2 layout:
+   
+   Header				MeshFileHeader
+   Section Directory	MeshSectionEntry * NumSections
+   Sections				each at MeshFileAlignment aligned offset, in any order,
+						identical sections share one offset
+
+ * Buffer sections hold raw GPU data, so buffers are created straight from file ranges.
+ * Version 1 files have mesh name after magic, see Mesh::LoadVersion1.
+ */
+const uint32_t MeshFileMagic = ('M' << 24) | ('E' << 16) | ('S' << 8) | ('H');
+const uint32_t MeshFileVersion = 2;
+const uint32_t MeshFileAlignment = 64;
+
+enum MeshSectionType
+{
+	MST_MeshParts = 0,		// Mesh name and part info
+	MST_Skeleton,			// Bones
+	MST_VertexLayout,		// Index: vertex buffer, Count: element count, MeshVertexElementDesc array
+	MST_VertexData,			// Index: vertex buffer, Count: vertex count, raw vertices
+	MST_IndexData,			// Index: index buffer, Count: index count, Format: IndexBufferType, raw indices
+	MST_Clusters,			// Index: mesh part, Count: cluster count, MeshCluster::FileSize each, see MeshCluster::Write
+	MST_Lods				// Index: mesh part, Count: level count, MeshLodLevel array
+};
+
+struct MeshFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t NumSections;
+	uint32_t FileSize;
+
+	float3 BoundMin;
+	float3 BoundMax;
+
+	uint32_t NumMeshParts;
+	uint32_t NumBones;
+	uint32_t NumVertexBuffers;
+	uint32_t NumIndexBuffers;
+};
+
+struct MeshSectionEntry
+{
+	uint32_t Type;
+	uint32_t Index;
+	uint32_t Count;
+	uint32_t Format;
+	uint32_t Offset;		// From file start
+	uint32_t Size;			// In bytes
+};
+
+struct MeshVertexElementDesc
+{
+	uint32_t Offset;
+	uint32_t Type;
+	uint32_t Usage;
+	uint32_t UsageIndex;
+};
+
+/**
+ * Collect sections in memory, then write header, directory and aligned sections. Sections
+ * with identical data are written once.
+ */
+class _ApiExport MeshFileWriter
+{
+public:
+	MeshFileWriter();
+	~MeshFileWriter();
+
+	/**
+	 * Start a new section, returned stream receives its data until next BeginSection.
+	 */
+	Stream& BeginSection(MeshSectionType type, uint32_t index, uint32_t count = 0, uint32_t format = 0);
+
+	/**
+	 * Header Magic, Version, NumSections and FileSize are filled.
+	 */
+	void Save(Stream& stream, MeshFileHeader& header);
+
+private:
+	vector<MeshSectionEntry> mSections;
+	vector<shared_ptr<MemoryStream> > mSectionData;
+};
+
+/**
+ * Return if memory holds a version 2 mesh file, validate and read header and section directory.
+ * Throw if a section is out of file range or misaligned.
+ */
+_ApiExport bool ReadMeshFileDirectory(const uint8_t* data, uint32_t size, MeshFileHeader& header, vector<MeshSectionEntry>& sections);
+
+/**
+ * CPU copy of mesh file geometry for tools working without render device. Vertices stay in
+ * file layout, only position element is located; skeleton, clusters and LODs are skipped.
+ */
+struct _ApiExport MeshFileGeometry
+{
+	struct Part
+	{
+		String Name;
+		uint32_t VertexBufferIndex;
+		uint32_t IndexBufferIndex;
+		uint32_t StartIndex;
+		uint32_t IndexCount;
+		int32_t BaseVertex;
+	};
+
+	struct VertexBuffer
+	{
+		VertexBuffer() : VertexCount(0), VertexSize(0), PositionOffset(UINT32_MAX), PositionType(VEF_Float3) {}
+
+		uint32_t VertexCount;
+		uint32_t VertexSize;
+		uint32_t PositionOffset;
+		VertexElementFormat PositionType;
+		vector<uint8_t> Data;
+	};
+
+	/// Position of part vertex index, quantized positions are decoded within mesh bounds.
+	float3 GetPosition(const Part& part, uint32_t index) const;
+
+	String Name;
+	float3 BoundMin, BoundMax;
+
+	vector<Part> MeshParts;
+	vector<VertexBuffer> VertexBuffers;
+	vector<vector<uint32_t> > IndexBuffers;
+};
+
+/**
+ * Read version 1 or 2 mesh file, compressed or not. Return false if file can't be opened or
+ * is not a mesh.
+ */
+_ApiExport bool ReadMeshFileGeometry(const String& fileName, MeshFileGeometry& mesh);
+
+} // Namespace RcEngine
+
+#endif // MeshFormat_h__
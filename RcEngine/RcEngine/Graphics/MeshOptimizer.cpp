@@ -0,0 +1,555 @@
+#include <Graphics/MeshOptimizer.h>
+#include <Math/Vector.h>
+#include <IO/Stream.h>
+
+namespace RcEngine {
+
+namespace {
+
+// Forsyth's scoring, cache position and remaining triangles valence
+const uint32_t ForsythCacheSize = 32;
+const float CacheDecayPower = 1.5f;
+const float LastTriangleScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+float ForsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+{
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			// The vertices used by last triangle, fixed score to discourage using them again immediately
+			score = LastTriangleScore;
+		}
+		else
+		{
+			float scaler = 1.0f - float(cachePosition - 3) / float(ForsythCacheSize - 3);
+			score = powf(scaler, CacheDecayPower);
+		}
+	}
+
+	score += ValenceBoostScale * powf(float(remainingTriangles), -ValenceBoostPower);
+	return score;
+}
+
+/**
+ * FIFO cache emulation with timestamps, vertex is in cache if inserted within last cacheSize insertions.
+ */
+struct FIFOCache
+{
+	FIFOCache(uint32_t vertexCount, uint32_t cacheSize)
+		: Timestamps(vertexCount, 0),
+		  CacheSize(cacheSize),
+		  Time(cacheSize + 1)
+	{
+
+	}
+
+	uint32_t AddTriangle(const uint32_t* triangle)
+	{
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = triangle[k];
+			if (Time - Timestamps[vertex] > CacheSize)
+			{
+				Timestamps[vertex] = Time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+	void Flush()							{ Time += CacheSize + 1; }
+
+	vector<uint32_t> Timestamps;
+	uint32_t CacheSize;
+	uint32_t Time;
+};
+
+}
+
+void MeshOptimizer::OptimizeVertexCache( uint32_t* dest, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount )
+{
+	uint32_t faceCount = indexCount / 3;
+	if (faceCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency, live triangles of vertex v are the first Remaining[v] entries
+	vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t i = 0; i < faceCount * 3; ++i)
+		remaining[indices[i]]++;
+
+	vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		offsets[v+1] = offsets[v] + remaining[v];
+
+	vector<uint32_t> adjacency(faceCount * 3);
+	{
+		vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (uint32_t i = 0; i < faceCount * 3; ++i)
+			adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	vector<int32_t> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+	vector<float> triangleScore(faceCount);
+	vector<bool> emitted(faceCount, false);
+
+	int32_t bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (uint32_t t = 0; t < faceCount; ++t)
+	{
+		const uint32_t* tri = &indices[t*3];
+		triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+		if (triangleScore[t] > bestScore)
+		{
+			bestScore = triangleScore[t];
+			bestTriangle = t;
+		}
+	}
+
+	uint32_t cache[ForsythCacheSize + 3];
+	uint32_t cacheCount = 0;
+	uint32_t nextUnemitted = 0;
+
+	vector<uint32_t> result(faceCount * 3);
+
+	for (uint32_t output = 0; output < faceCount; ++output)
+	{
+		if (bestTriangle < 0)
+		{
+			// No triangle adjacent to cache left, continue with input order
+			while (emitted[nextUnemitted]) nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		const uint32_t* tri = &indices[bestTriangle*3];
+		emitted[bestTriangle] = true;
+
+		result[output*3+0] = tri[0];
+		result[output*3+1] = tri[1];
+		result[output*3+2] = tri[2];
+
+		// Remove emitted triangle from its vertices
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = tri[k];
+			uint32_t* triangles = &adjacency[offsets[vertex]];
+			for (uint32_t j = 0; j < remaining[vertex]; ++j)
+			{
+				if (triangles[j] == (uint32_t)bestTriangle)
+				{
+					triangles[j] = triangles[remaining[vertex] - 1];
+					remaining[vertex]--;
+					break;
+				}
+			}
+		}
+
+		// Move triangle vertices to cache front
+		uint32_t newCache[ForsythCacheSize + 3];
+		uint32_t newCacheCount = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			if (std::find(newCache, newCache + newCacheCount, tri[k]) == newCache + newCacheCount)
+				newCache[newCacheCount++] = tri[k];
+		}
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+				newCache[newCacheCount++] = cache[i];
+		}
+
+		for (uint32_t i = 0; i < newCacheCount; ++i)
+		{
+			uint32_t vertex = newCache[i];
+			cachePosition[vertex] = (i < ForsythCacheSize) ? int32_t(i) : -1;
+			vertexScore[vertex] = ForsythVertexScore(cachePosition[vertex], remaining[vertex]);
+		}
+
+		cacheCount = (std::min)(newCacheCount, ForsythCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// Rescore triangles touching changed vertices, next best is among them
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCacheCount; ++i)
+		{
+			uint32_t vertex = newCache[i];
+			const uint32_t* triangles = &adjacency[offsets[vertex]];
+			for (uint32_t j = 0; j < remaining[vertex]; ++j)
+			{
+				uint32_t t = triangles[j];
+				const uint32_t* adjTri = &indices[t*3];
+				triangleScore[t] = vertexScore[adjTri[0]] + vertexScore[adjTri[1]] + vertexScore[adjTri[2]];
+
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), dest);
+}
+
+void MeshOptimizer::OptimizeOverdraw( uint32_t* dest, const uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t positionStride, uint32_t vertexCount, float threshold )
+{
+	uint32_t faceCount = indexCount / 3;
+	if (faceCount == 0)
+		return;
+
+	// Hard boundaries, where cache optimized order had to restart with all vertices missed
+	vector<uint32_t> hardClusters;
+	{
+		FIFOCache fifo(vertexCount, DefaultCacheSize);
+		for (uint32_t t = 0; t < faceCount; ++t)
+		{
+			if (fifo.AddTriangle(&indices[t*3]) == 3 || t == 0)
+				hardClusters.push_back(t);
+		}
+	}
+
+	// Soft boundaries, split hard cluster wherever ACMR so far is within threshold of cluster ACMR
+	vector<uint32_t> clusters;
+	{
+		FIFOCache fifo(vertexCount, DefaultCacheSize);
+
+		for (size_t c = 0; c < hardClusters.size(); ++c)
+		{
+			uint32_t start = hardClusters[c];
+			uint32_t end = (c + 1 < hardClusters.size()) ? hardClusters[c+1] : faceCount;
+
+			fifo.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = start; t < end; ++t)
+				clusterMisses += fifo.AddTriangle(&indices[t*3]);
+
+			float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+			clusters.push_back(start);
+
+			fifo.Flush();
+			uint32_t runningMisses = 0, runningFaces = 0;
+			for (uint32_t t = start; t < end; ++t)
+			{
+				runningMisses += fifo.AddTriangle(&indices[t*3]);
+				runningFaces++;
+
+				if (t + 1 < end && float(runningMisses) <= clusterThreshold * float(runningFaces))
+				{
+					clusters.push_back(t + 1);
+
+					fifo.Flush();
+					runningMisses = runningFaces = 0;
+				}
+			}
+		}
+	}
+
+	const uint8_t* positionBytes = reinterpret_cast<const uint8_t*>(positions);
+	auto GetPosition = [&](uint32_t vertex) -> float3 {
+		return float3( reinterpret_cast<const float*>(positionBytes + vertex * positionStride) );
+	};
+
+	// Area weighted mesh centroid
+	float3 meshCentroid(0.0f, 0.0f, 0.0f);
+	float meshArea = 0.0f;
+	for (uint32_t t = 0; t < faceCount; ++t)
+	{
+		float3 p0 = GetPosition(indices[t*3+0]);
+		float3 p1 = GetPosition(indices[t*3+1]);
+		float3 p2 = GetPosition(indices[t*3+2]);
+
+		float area = Cross(p1 - p0, p2 - p0).Length();
+		meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Cluster sort key, clusters facing away from mesh center are more likely to occlude others
+	vector<float> clusterKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		uint32_t start = clusters[c];
+		uint32_t end = (c + 1 < clusters.size()) ? clusters[c+1] : faceCount;
+
+		float3 centroid(0.0f, 0.0f, 0.0f);
+		float3 normal(0.0f, 0.0f, 0.0f);
+		float clusterArea = 0.0f;
+
+		for (uint32_t t = start; t < end; ++t)
+		{
+			float3 p0 = GetPosition(indices[t*3+0]);
+			float3 p1 = GetPosition(indices[t*3+1]);
+			float3 p2 = GetPosition(indices[t*3+2]);
+
+			float3 faceNormal = Cross(p1 - p0, p2 - p0);
+			float area = faceNormal.Length();
+
+			centroid += (p0 + p1 + p2) * (area / 3.0f);
+			normal += faceNormal;
+			clusterArea += area;
+		}
+
+		if (clusterArea > 0.0f)
+			centroid /= clusterArea;
+
+		float normalLength = normal.Length();
+		if (normalLength > 0.0f)
+			normal /= normalLength;
+
+		clusterKeys[c] = Dot(centroid - meshCentroid, normal);
+	}
+
+	vector<uint32_t> clusterOrder(clusters.size());
+	for (uint32_t c = 0; c < clusterOrder.size(); ++c)
+		clusterOrder[c] = c;
+
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+		return clusterKeys[a] > clusterKeys[b];
+	});
+
+	vector<uint32_t> result;
+	result.reserve(faceCount * 3);
+	for (uint32_t c : clusterOrder)
+	{
+		uint32_t start = clusters[c];
+		uint32_t end = (c + 1 < clusters.size()) ? clusters[c+1] : faceCount;
+		result.insert(result.end(), indices + start * 3, indices + end * 3);
+	}
+
+	std::copy(result.begin(), result.end(), dest);
+}
+
+uint32_t MeshOptimizer::OptimizeVertexFetchRemap( uint32_t* remap, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount )
+{
+	std::fill(remap, remap + vertexCount, UINT32_MAX);
+
+	uint32_t nextVertex = 0;
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t vertex = indices[i];
+		if (remap[vertex] == UINT32_MAX)
+			remap[vertex] = nextVertex++;
+	}
+
+	uint32_t usedVertices = nextVertex;
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] == UINT32_MAX)
+			remap[v] = nextVertex++;
+	}
+
+	return usedVertices;
+}
+
+void MeshOptimizer::RemapIndices( uint32_t* dest, const uint32_t* indices, uint32_t indexCount, const uint32_t* remap )
+{
+	for (uint32_t i = 0; i < indexCount; ++i)
+		dest[i] = remap[indices[i]];
+}
+
+void MeshOptimizer::RemapVertices( void* dest, const void* vertices, uint32_t vertexCount, uint32_t vertexSize, const uint32_t* remap )
+{
+	uint8_t* destBytes = static_cast<uint8_t*>(dest);
+	const uint8_t* srcBytes = static_cast<const uint8_t*>(vertices);
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		memcpy(destBytes + remap[v] * vertexSize, srcBytes + v * vertexSize, vertexSize);
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache( const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize )
+{
+	VertexCacheStatistics stats;
+	stats.VerticesTransformed = 0;
+	stats.ACMR = stats.ATVR = 0.0f;
+
+	uint32_t faceCount = indexCount / 3;
+	if (faceCount == 0)
+		return stats;
+
+	FIFOCache fifo(vertexCount, cacheSize);
+	for (uint32_t t = 0; t < faceCount; ++t)
+		stats.VerticesTransformed += fifo.AddTriangle(&indices[t*3]);
+
+	vector<bool> used(vertexCount, false);
+	uint32_t usedVertices = 0;
+	for (uint32_t i = 0; i < faceCount * 3; ++i)
+	{
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = true;
+			usedVertices++;
+		}
+	}
+
+	stats.ACMR = float(stats.VerticesTransformed) / float(faceCount);
+	stats.ATVR = float(stats.VerticesTransformed) / float(usedVertices);
+	return stats;
+}
+
+void MeshOptimizer::BuildClusters( vector<MeshCluster>& clusters, const uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t positionStride, uint32_t maxTriangles )
+{
+	const uint32_t faceCount = indexCount / 3;
+	if (faceCount == 0 || maxTriangles == 0)
+		return;
+
+	const uint8_t* positionBytes = reinterpret_cast<const uint8_t*>(positions);
+	auto GetPosition = [&](uint32_t vertex) -> float3 {
+		return float3( reinterpret_cast<const float*>(positionBytes + vertex * positionStride) );
+	};
+
+	// Unit face normals, zero for degenerate triangles
+	vector<float3> faceNormals(faceCount);
+	for (uint32_t t = 0; t < faceCount; ++t)
+	{
+		float3 p0 = GetPosition(indices[t*3+0]);
+		float3 n = Cross(GetPosition(indices[t*3+1]) - p0, GetPosition(indices[t*3+2]) - p0);
+		float length = n.Length();
+		faceNormals[t] = (length > 0.0f) ? n / length : float3(0.0f, 0.0f, 0.0f);
+	}
+
+	auto AddCluster = [&](uint32_t first, uint32_t last) {
+		MeshCluster cluster;
+		cluster.IndexStart = first * 3;
+		cluster.IndexCount = (last - first) * 3;
+
+		// Ritter's bounding sphere of triangle corners
+		const uint32_t* clusterIndices = indices + cluster.IndexStart;
+		float3 a = GetPosition(clusterIndices[0]);
+		float3 b = a;
+		float maxDist = 0.0f;
+		for (uint32_t i = 0; i < cluster.IndexCount; ++i)
+		{
+			float3 p = GetPosition(clusterIndices[i]);
+			float dist = (p - a).LengthSquared();
+			if (dist > maxDist) { maxDist = dist; b = p; }
+		}
+		a = b; maxDist = 0.0f;
+		for (uint32_t i = 0; i < cluster.IndexCount; ++i)
+		{
+			float3 p = GetPosition(clusterIndices[i]);
+			float dist = (p - a).LengthSquared();
+			if (dist > maxDist) { maxDist = dist; b = p; }
+		}
+
+		cluster.Center = (a + b) * 0.5f;
+		cluster.Radius = (b - a).Length() * 0.5f;
+		for (uint32_t i = 0; i < cluster.IndexCount; ++i)
+		{
+			float3 p = GetPosition(clusterIndices[i]);
+			float dist = (p - cluster.Center).Length();
+			if (dist > cluster.Radius)
+			{
+				float newRadius = (cluster.Radius + dist) * 0.5f;
+				cluster.Center += (p - cluster.Center) * ((newRadius - cluster.Radius) / dist);
+				cluster.Radius = newRadius;
+			}
+		}
+
+		// Normal cone, axis is average face normal, cutoff from the widest face
+		float3 axis(0.0f, 0.0f, 0.0f);
+		for (uint32_t t = first; t < last; ++t)
+			axis += faceNormals[t];
+
+		float axisLength = axis.Length();
+		float minDot = 1.0f;
+		if (axisLength > 0.0f)
+		{
+			axis /= axisLength;
+			for (uint32_t t = first; t < last; ++t)
+			{
+				if (faceNormals[t].LengthSquared() > 0.0f)
+					minDot = (std::min)(minDot, Dot(axis, faceNormals[t]));
+			}
+		}
+
+		cluster.ConeAxis = axis;
+		cluster.ConeApex = cluster.Center;
+		cluster.ConeCutoff = 1.0f;
+
+		// Cone wider than about 84 degrees half angle can't cull anything useful
+		if (axisLength > 0.0f && minDot > 0.1f)
+		{
+			// Move apex back along axis until every face plane is in front of it
+			float maxT = 0.0f;
+			for (uint32_t t = first; t < last; ++t)
+			{
+				const float3& n = faceNormals[t];
+				if (n.LengthSquared() == 0.0f)
+					continue;
+
+				float3 p0 = GetPosition(indices[t*3]);
+				float dc = Dot(cluster.Center - p0, n);
+				float dn = Dot(axis, n);
+				maxT = (std::max)(maxT, dc / dn);
+			}
+
+			cluster.ConeApex = cluster.Center - axis * maxT;
+			cluster.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+		}
+
+		clusters.push_back(cluster);
+	};
+
+	const uint32_t minTriangles = (std::max)(1u, maxTriangles / 4);
+
+	uint32_t first = 0;
+	float3 normalSum(0.0f, 0.0f, 0.0f);
+	for (uint32_t t = 0; t < faceCount; ++t)
+	{
+		uint32_t count = t - first;
+		if (count >= maxTriangles || (count >= minTriangles && Dot(faceNormals[t], normalSum) < 0.0f))
+		{
+			AddCluster(first, t);
+			first = t;
+			normalSum = float3(0.0f, 0.0f, 0.0f);
+		}
+
+		normalSum += faceNormals[t];
+	}
+
+	AddCluster(first, faceCount);
+}
+
+void MeshCluster::Read( Stream& source )
+{
+	IndexStart = source.ReadUInt();
+	IndexCount = source.ReadUInt();
+
+	for (int i = 0; i < 3; ++i) Center[i] = source.ReadFloat();
+	Radius = source.ReadFloat();
+
+	for (int i = 0; i < 3; ++i) ConeApex[i] = source.ReadFloat();
+	for (int i = 0; i < 3; ++i) ConeAxis[i] = source.ReadFloat();
+	ConeCutoff = source.ReadFloat();
+}
+
+void MeshCluster::Write( Stream& dest ) const
+{
+	dest.WriteUInt(IndexStart);
+	dest.WriteUInt(IndexCount);
+
+	for (int i = 0; i < 3; ++i) dest.WriteFloat(Center[i]);
+	dest.WriteFloat(Radius);
+
+	for (int i = 0; i < 3; ++i) dest.WriteFloat(ConeApex[i]);
+	for (int i = 0; i < 3; ++i) dest.WriteFloat(ConeAxis[i]);
+	dest.WriteFloat(ConeCutoff);
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,93 @@
+#ifndef MeshOptimizer_h__
+#define MeshOptimizer_h__
+
+#include <Core/Prerequisites.h>
+#include <Math/Vector.h>
+
+namespace RcEngine {
+
+/**
+ * Post-transform vertex cache statistics of a triangle list, FIFO cache simulated.
+ */
+struct _ApiExport VertexCacheStatistics
+{
+	uint32_t VerticesTransformed;
+	float ACMR;		// Average transformed vertices per triangle, 0.5 - 3.0
+	float ATVR;		// Average times a vertex is transformed, 1.0 is optimal
+};
+
+/**
+ * Contiguous index range of a mesh part with bounds for CPU cluster culling.
+ * Cluster is back facing if Dot(Normalize(ConeApex - eye), ConeAxis) >= ConeCutoff,
+ * ConeCutoff of 1 means cone test never passes.
+ */
+struct _ApiExport MeshCluster
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+
+	float3 Center;
+	float Radius;
+
+	float3 ConeApex;
+	float3 ConeAxis;
+	float ConeCutoff;
+
+	/// Serialized size, fields are written one by one so file layout doesn't depend on struct padding.
+	static const uint32_t FileSize = 2 * sizeof(uint32_t) + 11 * sizeof(float);
+
+	void Read(Stream& source);
+	void Write(Stream& dest) const;
+};
+
+/**
+ * Index buffer and vertex order optimization for mesh exporters. Run OptimizeVertexCache,
+ * then OptimizeOverdraw, then OptimizeVertexFetchRemap. All index functions allow dest == indices.
+ */
+class _ApiExport MeshOptimizer
+{
+public:
+	static const uint32_t DefaultCacheSize = 16;
+	static const uint32_t DefaultClusterSize = 128;
+
+public:
+	/**
+	 * Reorder triangles for post-transform vertex cache, Forsyth's linear-speed algorithm.
+	 */
+	static void OptimizeVertexCache(uint32_t* dest, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+	/**
+	 * Reorder clusters of cache optimized triangles to draw outward facing clusters first, reduce overdraw.
+	 * Clusters are split as long as ACMR stays within threshold times of the input ACMR.
+	 * positionStride is in bytes, position is 3 floats.
+	 */
+	static void OptimizeOverdraw(uint32_t* dest, const uint32_t* indices, uint32_t indexCount,
+		const float* positions, uint32_t positionStride, uint32_t vertexCount, float threshold = 1.05f);
+
+	/**
+	 * Build vertex remap table for fetch locality, vertices in order of first use by indices.
+	 * Unused vertices are moved to the end, so remap is a permutation. Return used vertex count.
+	 */
+	static uint32_t OptimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+	/// dest[i] = remap[indices[i]]
+	static void RemapIndices(uint32_t* dest, const uint32_t* indices, uint32_t indexCount, const uint32_t* remap);
+
+	/// Reorder vertices of vertexSize bytes, dest[remap[i]] = vertices[i]. dest must not overlap vertices.
+	static void RemapVertices(void* dest, const void* vertices, uint32_t vertexCount, uint32_t vertexSize, const uint32_t* remap);
+
+	static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount,
+		uint32_t cacheSize = DefaultCacheSize);
+
+	/**
+	 * Split optimized triangle list into clusters of at most maxTriangles consecutive triangles, indices are
+	 * not reordered. A cluster is also closed early when triangle normal turns away from the cluster, to keep 
+	 * normal cones narrow. Clusters are appended, IndexStart is relative to indices.
+	 */
+	static void BuildClusters(vector<MeshCluster>& clusters, const uint32_t* indices, uint32_t indexCount,
+		const float* positions, uint32_t positionStride, uint32_t maxTriangles = DefaultClusterSize);
+};
+
+} // Namespace RcEngine
+
+#endif // MeshOptimizer_h__
@@ -0,0 +1,380 @@
+#include <Graphics/MeshSimplifier.h>
+#include <Math/Vector.h>
+
+namespace RcEngine {
+
+namespace {
+
+enum VertexKind
+{
+	VK_Manifold,	// Interior vertex, collapse to any neighbor
+	VK_Border,		// Open border vertex, collapse only along border
+	VK_Locked		// Seam, complex or user locked vertex, never moves
+};
+
+// Border constraint planes are weighted stronger than faces
+const float BorderWeight = 10.0f;
+
+/**
+ * Symmetric 4x4 quadric, sum of squared distances to weighted planes.
+ */
+struct Quadric
+{
+	float A00, A11, A22;
+	float A01, A02, A12;
+	float B0, B1, B2;
+	float C;
+	float Weight;
+
+	Quadric() { memset(this, 0, sizeof(Quadric)); }
+
+	Quadric(const float3& n, float d, float weight)
+	{
+		A00 = n[0] * n[0] * weight;
+		A11 = n[1] * n[1] * weight;
+		A22 = n[2] * n[2] * weight;
+		A01 = n[0] * n[1] * weight;
+		A02 = n[0] * n[2] * weight;
+		A12 = n[1] * n[2] * weight;
+		B0 = n[0] * d * weight;
+		B1 = n[1] * d * weight;
+		B2 = n[2] * d * weight;
+		C = d * d * weight;
+		Weight = weight;
+	}
+
+	void Add(const Quadric& q)
+	{
+		A00 += q.A00; A11 += q.A11; A22 += q.A22;
+		A01 += q.A01; A02 += q.A02; A12 += q.A12;
+		B0 += q.B0; B1 += q.B1; B2 += q.B2;
+		C += q.C;
+		Weight += q.Weight;
+	}
+
+	/// Weighted average squared distance of p to planes.
+	float Error(const float3& p) const
+	{
+		float rx = A00 * p[0] + A01 * p[1] + A02 * p[2];
+		float ry = A01 * p[0] + A11 * p[1] + A12 * p[2];
+		float rz = A02 * p[0] + A12 * p[1] + A22 * p[2];
+
+		float error = rx * p[0] + ry * p[1] + rz * p[2];
+		error += (B0 * p[0] + B1 * p[1] + B2 * p[2]) * 2.0f;
+		error += C;
+
+		return (Weight > 0.0f) ? fabsf(error) / Weight : 0.0f;
+	}
+};
+
+struct Collapse
+{
+	uint32_t V0;		// Removed vertex
+	uint32_t V1;		// Target vertex
+	float Error;
+
+	bool operator< (const Collapse& rhs) const { return Error < rhs.Error; }
+};
+
+inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+	return (uint64_t(a) << 32) | b;
+}
+
+}
+
+uint32_t MeshSimplifier::Simplify( uint32_t* dest, const uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t positionStride, uint32_t vertexCount,
+								   uint32_t targetIndexCount, float targetError, const uint8_t* vertexLock, float* resultError )
+{
+	assert(indexCount % 3 == 0);
+
+	const uint8_t* positionBytes = reinterpret_cast<const uint8_t*>(positions);
+	auto GetPosition = [&](uint32_t vertex) -> float3 {
+		return float3( reinterpret_cast<const float*>(positionBytes + vertex * positionStride) );
+	};
+
+	vector<uint32_t> result(indices, indices + indexCount);
+
+	// Vertices with same position are wedges of one position vertex
+	vector<uint32_t> wedge(vertexCount);
+	vector<uint32_t> wedgeCount(vertexCount, 0);
+	{
+		std::unordered_map<uint64_t, uint32_t> positionMap;
+		std::unordered_map<uint64_t, vector<uint32_t> > buckets;
+
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			float3 p = GetPosition(v);
+			
+			uint32_t bits[3];
+			memcpy(bits, p(), sizeof(bits));
+			uint64_t hash = (uint64_t(bits[0]) * 73856093u) ^ (uint64_t(bits[1]) * 19349663u) ^ (uint64_t(bits[2]) * 83492791u);
+
+			vector<uint32_t>& bucket = buckets[hash];
+			wedge[v] = v;
+			for (uint32_t other : bucket)
+			{
+				if (memcmp(GetPosition(other)(), p(), sizeof(float3)) == 0)
+				{
+					wedge[v] = other;
+					break;
+				}
+			}
+
+			if (wedge[v] == v)
+				bucket.push_back(v);
+
+			wedgeCount[wedge[v]]++;
+		}
+	}
+
+	// Face and border quadrics accumulated on position vertex
+	vector<Quadric> quadrics(vertexCount);
+	vector<uint8_t> vertexKind(vertexCount);
+	std::unordered_map<uint64_t, uint32_t> halfEdges;
+
+	auto BuildTopology = [&]() {
+		halfEdges.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = wedge[result[i + e]], b = wedge[result[i + (e+1)%3]];
+				halfEdges[EdgeKey(a, b)]++;
+			}
+		}
+
+		// Non-manifold flag is kept apart from border count, so later border edges can't clear it
+		vector<uint32_t> borderEdges(vertexCount, 0);
+		vector<bool> nonManifold(vertexCount, false);
+		for (const auto& kv : halfEdges)
+		{
+			uint32_t a = uint32_t(kv.first >> 32), b = uint32_t(kv.first);
+			if (kv.second > 1)
+			{
+				nonManifold[a] = nonManifold[b] = true;
+			}
+			else if (halfEdges.find(EdgeKey(b, a)) == halfEdges.end())
+			{
+				borderEdges[a]++;
+				borderEdges[b]++;
+			}
+		}
+
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			uint32_t w = wedge[v];
+			if (wedgeCount[w] > 1 || (vertexLock && vertexLock[v]) || nonManifold[w] || borderEdges[w] > 2)
+				vertexKind[v] = VK_Locked;
+			else if (borderEdges[w] == 2)
+				vertexKind[v] = VK_Border;
+			else
+				vertexKind[v] = VK_Manifold;
+		}
+	};
+
+	auto IsBorderEdge = [&](uint32_t a, uint32_t b) -> bool {
+		a = wedge[a]; b = wedge[b];
+		return (halfEdges.find(EdgeKey(a, b)) == halfEdges.end()) != (halfEdges.find(EdgeKey(b, a)) == halfEdges.end());
+	};
+
+	BuildTopology();
+
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		float3 p0 = GetPosition(result[i+0]);
+		float3 p1 = GetPosition(result[i+1]);
+		float3 p2 = GetPosition(result[i+2]);
+
+		float3 normal = Cross(p1 - p0, p2 - p0);
+		float area = normal.Length();
+		if (area == 0.0f)
+			continue;
+
+		normal /= area;
+		Quadric faceQuadric(normal, -Dot(normal, p0), area);
+		for (int k = 0; k < 3; ++k)
+			quadrics[wedge[result[i+k]]].Add(faceQuadric);
+
+		// Plane through border edge perpendicular to face keeps border in place
+		for (int e = 0; e < 3; ++e)
+		{
+			uint32_t a = result[i + e], b = result[i + (e+1)%3];
+			if (!IsBorderEdge(a, b))
+				continue;
+
+			float3 pa = GetPosition(a), pb = GetPosition(b);
+			float3 edge = pb - pa;
+			float length = edge.Length();
+			if (length == 0.0f)
+				continue;
+
+			float3 edgeNormal = Cross(edge, normal) / length;
+			Quadric borderQuadric(edgeNormal, -Dot(edgeNormal, pa), length * length * BorderWeight);
+			quadrics[wedge[a]].Add(borderQuadric);
+			quadrics[wedge[b]].Add(borderQuadric);
+		}
+	}
+
+	const float maxError = targetError * targetError;
+	float currentError = 0.0f;
+
+	vector<Collapse> collapses;
+	vector<uint32_t> collapseRemap(vertexCount);
+	vector<uint8_t> collapseLocked(vertexCount);
+	vector<uint32_t> triangleOffsets(vertexCount + 1);
+	vector<uint32_t> vertexTriangles;
+
+	while (result.size() > targetIndexCount)
+	{
+		// Vertex to triangle adjacency of current triangles
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : result)
+			triangleOffsets[index + 1]++;
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			triangleOffsets[v + 1] += triangleOffsets[v];
+
+		vertexTriangles.resize(result.size());
+		{
+			vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i)
+				vertexTriangles[fill[result[i]]++] = uint32_t(i / 3);
+		}
+
+		// Gather candidates, one direction per edge
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = result[i + e], b = result[i + (e+1)%3];
+
+				// Visit interior edge once from its smaller vertex, border edges have one half edge only
+				bool border = IsBorderEdge(a, b);
+				if (!border && a > b)
+					continue;
+
+				Collapse best;
+				best.Error = FLT_MAX;
+
+				for (int dir = 0; dir < 2; ++dir)
+				{
+					uint32_t v0 = dir ? b : a;
+					uint32_t v1 = dir ? a : b;
+
+					if (vertexKind[v0] == VK_Locked || (vertexKind[v0] == VK_Border && !border))
+						continue;
+
+					float error = quadrics[wedge[v0]].Error(GetPosition(v1));
+					if (error < best.Error)
+					{
+						best.V0 = v0;
+						best.V1 = v1;
+						best.Error = error;
+					}
+				}
+
+				if (best.Error < FLT_MAX && best.Error <= maxError)
+					collapses.push_back(best);
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end());
+
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			collapseRemap[v] = v;
+		std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+		size_t triangleCount = result.size() / 3;
+		size_t targetTriangles = targetIndexCount / 3;
+		size_t collapsedTriangles = 0;
+		size_t appliedCollapses = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (triangleCount - collapsedTriangles <= targetTriangles)
+				break;
+
+			uint32_t v0 = collapse.V0, v1 = collapse.V1;
+			if (collapseLocked[v0] || collapseLocked[v1])
+				continue;
+
+			// Reject collapse which flips a triangle around v0
+			float3 target = GetPosition(v1);
+			bool flipped = false;
+			uint32_t removedTriangles = 0;
+			for (uint32_t k = triangleOffsets[v0]; k < triangleOffsets[v0 + 1] && !flipped; ++k)
+			{
+				const uint32_t* tri = &result[vertexTriangles[k] * 3];
+				if (tri[0] == v1 || tri[1] == v1 || tri[2] == v1)
+				{
+					removedTriangles++;
+					continue;
+				}
+
+				float3 p[3], q[3];
+				for (int j = 0; j < 3; ++j)
+				{
+					p[j] = GetPosition(tri[j]);
+					q[j] = (tri[j] == v0) ? target : p[j];
+				}
+
+				float3 before = Cross(p[1] - p[0], p[2] - p[0]);
+				float3 after = Cross(q[1] - q[0], q[2] - q[0]);
+				flipped = (Dot(before, after) <= 0.0f);
+			}
+
+			if (flipped)
+				continue;
+
+			collapseRemap[v0] = v1;
+			currentError = (std::max)(currentError, collapse.Error);
+			quadrics[wedge[v1]].Add(quadrics[wedge[v0]]);
+
+			// Lock one ring of v0, their triangles changed
+			for (uint32_t k = triangleOffsets[v0]; k < triangleOffsets[v0 + 1]; ++k)
+			{
+				const uint32_t* tri = &result[vertexTriangles[k] * 3];
+				collapseLocked[tri[0]] = collapseLocked[tri[1]] = collapseLocked[tri[2]] = 1;
+			}
+
+			collapsedTriangles += removedTriangles;
+			appliedCollapses++;
+		}
+
+		if (appliedCollapses == 0)
+			break;
+
+		// Apply collapses and drop degenerate triangles
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t a = collapseRemap[result[i+0]];
+			uint32_t b = collapseRemap[result[i+1]];
+			uint32_t c = collapseRemap[result[i+2]];
+
+			if (a != b && b != c && a != c)
+			{
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+		}
+		result.resize(writeIndex);
+
+		BuildTopology();
+	}
+
+	if (result.size())
+		memcpy(dest, &result[0], result.size() * sizeof(uint32_t));
+
+	if (resultError)
+		*resultError = sqrtf(currentError);
+
+	return uint32_t(result.size());
+}
+
+} // Namespace RcEngine
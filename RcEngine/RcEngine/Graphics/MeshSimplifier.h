@@ -0,0 +1,44 @@
+#ifndef MeshSimplifier_h__
+#define MeshSimplifier_h__
+
+#include <Core/Prerequisites.h>
+
+namespace RcEngine {
+
+/**
+ * Simplified index range of a mesh part in parent index buffer. Error is geometric error of 
+ * the level in model units.
+ */
+struct _ApiExport MeshLodLevel
+{
+	uint32_t IndexStart;
+	uint32_t IndexCount;
+	float Error;
+};
+
+/**
+ * Quadric error metric edge collapse simplifier for automatic LOD generation. Vertices are collapsed onto
+ * existing vertices, so simplified index lists reference the original vertex buffer.
+ *
+ * Vertices which share position with other vertices (UV seams, normal discontinuities) are locked.
+ * Open border vertices, which include material boundaries when parts are simplified separately, only 
+ * collapse along the border. Callers lock other attribute borders like bone weights with vertexLock.
+ */
+class _ApiExport MeshSimplifier
+{
+public:
+	/**
+	 * Simplify triangle list until index count reaches targetIndexCount or next collapse exceeds targetError,
+	 * which is in model units. dest may be indices. Return index count written to dest, resultError 
+	 * receives geometric error of the result.
+	 *
+	 * positionStride is in bytes, position is 3 floats. vertexLock is optional, non zero locks vertex.
+	 */
+	static uint32_t Simplify(uint32_t* dest, const uint32_t* indices, uint32_t indexCount, 
+		const float* positions, uint32_t positionStride, uint32_t vertexCount,
+		uint32_t targetIndexCount, float targetError, const uint8_t* vertexLock = nullptr, float* resultError = nullptr);
+};
+
+} // Namespace RcEngine
+
+#endif // MeshSimplifier_h__
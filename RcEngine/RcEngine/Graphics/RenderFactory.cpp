@@ -187,6 +187,11 @@ shared_ptr<Texture> RenderFactory::LoadTextureFromFile( const String& filename )
 	if (image.LoadImageFromDDS(filename.c_str()) == false)
 		ENGINE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, filename + " not found!", "RenderFactory::LoadTextureFromFile");
 
+	return CreateTextureFromImage(image);
+}
+
+shared_ptr<Texture> RenderFactory::CreateTextureFromImage( Image& image )
+{
 	uint32_t numLayers = image.GetLayers();
 	uint32_t numLevels = image.GetLevels();
 
@@ -246,7 +251,7 @@ shared_ptr<Texture> RenderFactory::LoadTextureFromFile( const String& filename )
 		break;
 	}
 
-	ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Internal Error", "RenderFactory::LoadTextureFromFile");
+	ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Internal Error", "RenderFactory::CreateTextureFromImage");
 }
 
 void RenderFactory::SaveTextureToFile( const String& filename, const shared_ptr<Texture>& texture )
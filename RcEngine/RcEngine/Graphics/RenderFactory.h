@@ -8,6 +8,7 @@
 
 namespace RcEngine {
 
+class Image;
 class ShaderResourceView;
 class UnorderedAccessView;
 
@@ -90,6 +91,7 @@ public:
 	
 	// Utility function
 	shared_ptr<Texture> LoadTextureFromFile(const String& filename);
+	shared_ptr<Texture> CreateTextureFromImage(Image& image);
 
 	void SaveTextureToFile(const String& filename, const shared_ptr<Texture>& texture);
 	void SaveLinearDepthTextureToFile(const String& filename, const shared_ptr<Texture>& texture, float projM33, float projM43);
@@ -32,14 +32,14 @@ void RenderOperation::SetIndexRange( uint32_t indexStart, uint32_t indexCount, u
 {
 	IndexStart = indexStart;
 	IndexCount = indexCount;
-	numInstance = numInstance;
+	NumInstances = numInstance;
 }
 
 void RenderOperation::SetVertexRange( uint32_t vertexStart, uint32_t vertexCount, uint32_t numInstance /*= 0*/ )
 {
 	VertexStart = vertexStart;
 	VertexCount = vertexCount;
-	numInstance = numInstance;
+	NumInstances = numInstance;
 }
 
 }
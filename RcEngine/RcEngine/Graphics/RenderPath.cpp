@@ -12,6 +12,7 @@
 #include <Graphics/RenderOperation.h>
 #include <Graphics/CascadedShadowMap.h>
 #include <Graphics/DebugDrawManager.h>
+#include <Graphics/IrradianceVolume.h>
 #include <MainApp/Application.h>
 #include <MainApp/Window.h>
 #include <Scene/SceneManager.h>
@@ -296,6 +297,7 @@ void DeferredPath::OnGraphicsInit( const shared_ptr<Camera>& camera )
 	mPointLightTech = mDeferredEffect->GetTechniqueByName("PointLighting");
 	mSpotLightTech = mDeferredEffect->GetTechniqueByName("SpotLighting");
 	mShadingTech = mDeferredEffect->GetTechniqueByName("Shading");
+	mIrradianceVolumeTech = mDeferredEffect->GetTechniqueByName("IrradianceVolume");
 
 	// Init GBuffer
 	mGBufferFB = factory->CreateFrameBuffer(windowWidth, windowHeight);
@@ -554,6 +556,9 @@ void DeferredPath::DeferredLighting()
 		}
 	}
 
+	if (mIrradianceVolume)
+		DrawIrradianceVolume();
+
 	//mDevice->GetRenderFactory()->SaveLinearDepthTextureToFile("E:/depth.pfm", mDepthStencilBufferLight, proj.M33, proj.M43);
 }
 
@@ -620,6 +625,33 @@ void DeferredPath::DrawDirectionalLightShape( Light* light )
 	mDevice->Draw(mDirLightTech, mFullscreenTrangle);
 }
 
+void DeferredPath::SetIrradianceVolume( const shared_ptr<IrradianceVolume>& volume )
+{
+	if (volume && !volume->GetCoeffTexture(0))
+		volume->CreateTextures();
+
+	mIrradianceVolume = volume;
+}
+
+void DeferredPath::DrawIrradianceVolume()
+{
+	static const char* CoeffNames[IrradianceVolume::NumCoeffTextures] = {
+		"IrradianceCoeffs0", "IrradianceCoeffs1", "IrradianceCoeffs2", "IrradianceCoeffs3",
+		"IrradianceCoeffs4", "IrradianceCoeffs5", "IrradianceCoeffs6" };
+
+	const BoundingBoxf& bounds = mIrradianceVolume->GetBounds();
+	float3 dims((float)mIrradianceVolume->GetDimension(0), (float)mIrradianceVolume->GetDimension(1), (float)mIrradianceVolume->GetDimension(2));
+
+	mDeferredEffect->GetParameterByName("IrradianceVolumeMin")->SetValue(bounds.Min);
+	mDeferredEffect->GetParameterByName("IrradianceVolumeMax")->SetValue(bounds.Max);
+	mDeferredEffect->GetParameterByName("IrradianceVolumeDims")->SetValue(dims);
+
+	for (uint32_t i = 0; i < IrradianceVolume::NumCoeffTextures; ++i)
+		mDeferredEffect->GetParameterByName(CoeffNames[i])->SetValue(mIrradianceVolume->GetCoeffTexture(i)->GetShaderResourceView());
+
+	mDevice->Draw(mIrradianceVolumeTech, mFullscreenTrangle);
+}
+
 void DeferredPath::DrawSpotLightShape( Light* light )
 {
 	bool bCastShadow = light->GetCastShadow();
@@ -13,6 +13,7 @@ namespace RcEngine {
 
 class CascadedShadowMap;
 class RenderDevice;
+class IrradianceVolume;
 
 class _ApiExport RenderPath
 {
@@ -77,6 +78,9 @@ public:
 	shared_ptr<Effect> GetDeferredEffect() const { return mDeferredEffect; } 
 	CascadedShadowMap* GetShadowManager() const  { return mShadowMan; }
 
+	/// Add probe irradiance of volume to diffuse light of every pixel, null to disable.
+	void SetIrradianceVolume(const shared_ptr<IrradianceVolume>& volume);
+
 protected:
 	void GenereateGBuffer();
 	void ComputeSSAO();
@@ -88,6 +92,7 @@ protected:
 	void DrawDirectionalLightShape(Light* light);
 	void DrawSpotLightShape(Light* light);
 	void DrawPointLightShape(Light* light);
+	void DrawIrradianceVolume();
 
 protected:
 
@@ -123,7 +128,9 @@ protected:
 	EffectTechnique* mPointLightTech;
 	EffectTechnique* mSpotLightTech;
 	EffectTechnique* mShadingTech;
+	EffectTechnique* mIrradianceVolumeTech;
 
+	shared_ptr<IrradianceVolume> mIrradianceVolume;
 
 	RenderOperation mSpotLightShape;
 	RenderOperation mPointLightShape;
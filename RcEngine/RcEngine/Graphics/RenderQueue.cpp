@@ -1,4 +1,10 @@
 #include <Graphics/RenderQueue.h>
+#include <Graphics/Renderable.h>
+#include <Graphics/InstanceBatch.h>
+#include <Graphics/RenderFactory.h>
+#include <Graphics/RenderOperation.h>
+#include <Graphics/GraphicsResource.h>
+#include <Core/Environment.h>
 #include <Core/Exception.h>
 
 namespace RcEngine {
@@ -17,6 +23,15 @@ RenderQueue::~RenderQueue()
 {
 	for (auto& kv : mRenderBuckets)
 		delete kv.second;
+
+	for (auto& kv : mInstanceBatches)
+	{
+		for (InstanceBatch* batch : kv.second)
+			delete batch;
+	}
+
+	for (InstanceBatch* batch : mFreeInstanceBatches)
+		delete batch;
 }
 
 RenderBucket& RenderQueue::GetRenderBucket( Bucket bucket, bool sortBucket /*= true*/ )
@@ -29,10 +44,7 @@ RenderBucket& RenderQueue::GetRenderBucket( Bucket bucket, bool sortBucket /*= t
 	RenderBucket& renderBucker = (*mRenderBuckets[bucket]);
 
 	if (sortBucket)
-	{
-		std::sort(renderBucker.begin(), renderBucker.end(), [](const RenderQueueItem& lhs, const RenderQueueItem& rhs) {
-			return lhs.SortKey < rhs.SortKey; });
-	}
+		SortBucket(bucket, renderBucker);
 
 	return renderBucker;
 }
@@ -42,13 +54,89 @@ std::map<RenderQueue::Bucket, RenderBucket*>& RenderQueue::GetAllRenderBuckets(
 	if (sortBucket)
 	{
 		for (auto& kv : mRenderBuckets)
+			SortBucket(kv.first, *kv.second);
+	}
+
+	return mRenderBuckets;
+}
+
+void RenderQueue::SortBucket( Bucket bucket, RenderBucket& renderBucket )
+{
+	// Items with equal sort key are grouped by instance key, so instancing candidates are adjacent
+	std::sort(renderBucket.begin(), renderBucket.end(), [](const RenderQueueItem& lhs, const RenderQueueItem& rhs) {
+		if (lhs.SortKey != rhs.SortKey)
+			return lhs.SortKey < rhs.SortKey;
+		return std::less<const void*>()(lhs.InstanceKey, rhs.InstanceKey); });
+
+	MergeInstances(bucket, renderBucket);
+}
+
+void RenderQueue::MergeInstances( Bucket bucket, RenderBucket& renderBucket )
+{
+	vector<Renderable*> instances;
+
+	size_t numMerged = 0;
+	for (size_t i = 0; i < renderBucket.size(); )
+	{
+		RenderQueueItem item = renderBucket[i];
+
+		// Gather run of items which can be drawn with the first one
+		instances.assign(1, item.Renderable);
+		size_t next = i + 1;
+		if (item.InstanceKey)
+		{
+			while (next < renderBucket.size() && instances.size() < InstanceBatch::MaxInstances && 
+				   renderBucket[next].SortKey == item.SortKey && 
+				   InstanceBatch::CanInstance(*item.Renderable, *renderBucket[next].Renderable))
+			{
+				instances.push_back(renderBucket[next++].Renderable);
+			}
+		}
+
+		if (instances.size() > 1)
 		{
-			std::sort(kv.second->begin(), kv.second->end(), [](const RenderQueueItem& lhs, const RenderQueueItem& rhs) {
-				return lhs.SortKey < rhs.SortKey; });
+			if (!mInstanceBuffer)
+			{
+				RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+				mInstanceBuffer = factory->CreateVertexBuffer(sizeof(float4x4) * InstanceBatch::MaxInstances, 
+					EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Vertex, nullptr);
+			}
+
+			InstanceBatch* batch;
+			if (mFreeInstanceBatches.size())
+			{
+				batch = mFreeInstanceBatches.back();
+				mFreeInstanceBatches.pop_back();
+			}
+			else
+				batch = new InstanceBatch;
+
+			shared_ptr<VertexDeclaration> instancedDecl = GetInstancedVertexDeclaration(item.Renderable->GetRenderOperation()->VertexDecl);
+			batch->Reset(&instances[0], instances.size(), mInstanceBuffer, instancedDecl);
+			mInstanceBatches[bucket].push_back(batch);
+
+			item.Renderable = batch;
+			item.InstanceKey = nullptr;
 		}
+
+		renderBucket[numMerged++] = item;
+		i = next;
 	}
 
-	return mRenderBuckets;
+	renderBucket.resize(numMerged);
+}
+
+shared_ptr<VertexDeclaration> RenderQueue::GetInstancedVertexDeclaration( const shared_ptr<VertexDeclaration>& vertexDecl )
+{
+	// Source declaration may be released and its address reused, check weak pointer
+	auto& cached = mInstancedVertexDecls[vertexDecl.get()];
+	if (cached.first.lock() != vertexDecl)
+	{
+		cached.first = vertexDecl;
+		cached.second = InstanceBatch::CreateInstancedVertexDeclaration(*vertexDecl);
+	}
+
+	return cached.second;
 }
 
 
@@ -59,6 +147,7 @@ void RenderQueue::AddToQueue( RenderQueueItem item, Bucket bucket )
 		ENGINE_EXCEPT(Exception::ERR_ITEM_NOT_FOUND, "Render bucket not exits!",  "RenderQueue::AddToQueue");
 	}
 
+	item.InstanceKey = item.Renderable->GetInstanceKey();
 	mRenderBuckets[bucket]->push_back(item);
 }
 
@@ -78,11 +167,21 @@ void RenderQueue::ClearAllQueue()
 	{
 		iter->second->clear();
 	}
+
+	for (auto& kv : mInstanceBatches)
+	{
+		mFreeInstanceBatches.insert(mFreeInstanceBatches.end(), kv.second.begin(), kv.second.end());
+		kv.second.clear();
+	}
 }
 
 void RenderQueue::ClearQueue( Bucket bucket )
 {
 	mRenderBuckets[bucket]->clear();
+
+	vector<InstanceBatch*>& batches = mInstanceBatches[bucket];
+	mFreeInstanceBatches.insert(mFreeInstanceBatches.end(), batches.begin(), batches.end());
+	batches.clear();
 }
 
 
@@ -5,13 +5,16 @@
 
 namespace RcEngine {
 
+class InstanceBatch;
+
 struct _ApiExport RenderQueueItem
 {
 	Renderable* Renderable;
 	float SortKey;
+	const void* InstanceKey;   // Set by render queue, breaks sort key ties 
 
 	RenderQueueItem() {}
-	RenderQueueItem(class Renderable* rd, float key) : Renderable(rd), SortKey(key) { }
+	RenderQueueItem(class Renderable* rd, float key) : Renderable(rd), SortKey(key), InstanceKey(nullptr) { }
 };
 
 typedef std::vector<RenderQueueItem> RenderBucket;
@@ -75,6 +78,10 @@ public:
 
 	void AddRenderBucket(Bucket bucket);
 
+	/**
+	 * Sorted bucket has runs of items with the same geometry and material merged into 
+	 * instanced draws, if material has instanced effect.
+	 */
 	RenderBucket& GetRenderBucket(Bucket bucket, bool sort = true);
 	std::map<Bucket, RenderBucket*>& GetAllRenderBuckets(bool sort = true);
 
@@ -82,8 +89,24 @@ public:
 	void ClearAllQueue();
 	void ClearQueue(Bucket bucket);
 
+protected:
+	void SortBucket(Bucket bucket, RenderBucket& renderBucket);
+	void MergeInstances(Bucket bucket, RenderBucket& renderBucket);
+
+	shared_ptr<VertexDeclaration> GetInstancedVertexDeclaration(const shared_ptr<VertexDeclaration>& vertexDecl);
+
 public:
 	std::map<Bucket, RenderBucket*> mRenderBuckets;
+
+protected:
+	// Instance batches in use by each bucket, returned to free list when bucket cleared
+	std::map<Bucket, vector<InstanceBatch*> > mInstanceBatches;
+	vector<InstanceBatch*> mFreeInstanceBatches;
+
+	shared_ptr<GraphicsBuffer> mInstanceBuffer;
+
+	// Instanced vertex declaration of each geometry vertex declaration, keeps its own VAO
+	std::map<VertexDeclaration*, std::pair<weak_ptr<VertexDeclaration>, shared_ptr<VertexDeclaration> > > mInstancedVertexDecls;
 };
 
 
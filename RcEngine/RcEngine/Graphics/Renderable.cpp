@@ -25,6 +25,16 @@ EffectTechnique* Renderable::GetTechnique() const
 	return GetMaterial()->GetCurrentTechnique();
 }
 
+const void* Renderable::GetInstanceKey() const
+{
+	return nullptr;
+}
+
+void Renderable::ApplyGeometryParameters( Effect& effect ) const
+{
+
+}
+
 void Renderable::Render()
 {
 	EffectTechnique* technique = GetTechnique();
@@ -45,6 +45,19 @@ public:
 	 */
 	virtual uint32_t GetWorldTransformsCount() const = 0;
 
+	/**
+	 * Renderables with the same non-null instance key, material and render operation are merged 
+	 * into one instanced draw by render queue. Only for single world matrix renderables whose 
+	 * material has instanced effect. 
+	 */
+	virtual const void* GetInstanceKey() const;
+
+	/**
+	 * Set effect parameters of the geometry, not the instance. Also called on instanced effect
+	 * by instanced draw.
+	 */
+	virtual void ApplyGeometryParameters(Effect& effect) const;
+
 	virtual void Render();
 
 	virtual void OnRenderBegin();
@@ -229,6 +229,37 @@ void SpriteBatch::Draw( const shared_ptr<Texture>& texture, const float2& positi
 	Draw(texture, destination, sourceRectangle, color, rotation, float2::Zero(), layerDepth);
 }
 
+void SpriteBatch::Draw( const TextureRegion& region, const Rectanglef& destinationRectangle, const IntRect* sourceRectangle, const ColorRGBA& color, float rotation, const float2& origin, float layerDepth /*= 0.0f*/ )
+{
+	// Remap source rectangle to page texels
+	IntRect pageRect = region.Rect;
+	if (sourceRectangle)
+	{
+		pageRect.X += sourceRectangle->X;
+		pageRect.Y += sourceRectangle->Y;
+		pageRect.Width = sourceRectangle->Width;
+		pageRect.Height = sourceRectangle->Height;
+	}
+
+	Draw(region.GetTexture(), destinationRectangle, &pageRect, color, rotation, origin, layerDepth);
+}
+
+void SpriteBatch::Draw( const TextureRegion& region, const Rectanglef& destinationRectangle, const IntRect* sourceRectangle, const ColorRGBA& color, float layerDepth /*= 0.0f*/ )
+{
+	Draw(region, destinationRectangle, sourceRectangle, color, 0.0f, float2::Zero(), layerDepth);
+}
+
+void SpriteBatch::Draw( const TextureRegion& region, const Rectanglef& destinationRectangle, const ColorRGBA& color, float layerDepth /*= 0.0f*/ )
+{
+	Draw(region, destinationRectangle, nullptr, color, 0.0f, float2::Zero(), layerDepth);
+}
+
+void SpriteBatch::Draw( const TextureRegion& region, const float2& position, const ColorRGBA& color, float layerDepth /*= 0.0f*/ )
+{
+	Rectanglef destination = Rectanglef(position.X(), position.Y(), (float)region.Rect.Width, (float)region.Rect.Height);
+	Draw(region, destination, nullptr, color, 0.0f, float2::Zero(), layerDepth);
+}
+
 void SpriteBatch::Flush()
 {
 	std::map<shared_ptr<Texture>, Sprite*>::iterator it;
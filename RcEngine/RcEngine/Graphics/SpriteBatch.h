@@ -7,6 +7,7 @@
 #include <Math/ColorRGBA.h>
 #include <Graphics/Renderable.h>
 #include <Scene/SceneObject.h>
+#include <Graphics/TextureAtlas.h>
 
 namespace RcEngine {
 
@@ -74,6 +75,19 @@ public:
 	void Draw(const shared_ptr<Texture>& texture, const float2& position, const ColorRGBA& color, float layerDepth = 0.0f);
 	void Draw(const shared_ptr<Texture>& texture, const float2& position, const IntRect* sourceRectangle, const ColorRGBA& color, float layerDepth = 0.0f);
 
+	/**
+	 * Draw region of a texture atlas page. Source rectangle is relative to region, use null to draw
+	 * the entire region. Regions of the same page share one batch.
+	 */
+	void Draw(const TextureRegion& region, const Rectanglef& destinationRectangle, const IntRect* sourceRectangle, 
+		      const ColorRGBA& color, float rotation, const float2& origin, float layerDepth = 0.0f);
+
+	void Draw(const TextureRegion& region, const Rectanglef& destinationRectangle, const IntRect* sourceRectangle, 
+		      const ColorRGBA& color, float layerDepth = 0.0f);
+
+	void Draw(const TextureRegion& region, const Rectanglef& destinationRectangle, const ColorRGBA& color, float layerDepth = 0.0f);
+	void Draw(const TextureRegion& region, const float2& position, const ColorRGBA& color, float layerDepth = 0.0f);
+
 private:
 	uint32_t mSortMode;
 	shared_ptr<Material> mSpriteMaterial;
@@ -0,0 +1,270 @@
+#include <Graphics/TextureAtlas.h>
+#include <Graphics/Image.h>
+#include <Graphics/RenderFactory.h>
+#include <Core/Environment.h>
+#include <Core/Exception.h>
+
+namespace RcEngine {
+
+SkylinePacker::SkylinePacker( uint32_t width, uint32_t height )
+	: mWidth(width),
+	  mHeight(height)
+{
+	Reset();
+}
+
+void SkylinePacker::Reset()
+{
+	SkylineNode node = { 0, 0, mWidth };
+
+	mSkyline.clear();
+	mSkyline.push_back(node);
+	mUsedArea = 0;
+}
+
+bool SkylinePacker::Fit( size_t index, uint32_t width, uint32_t height, uint32_t& y, uint32_t& waste ) const
+{
+	uint32_t x = mSkyline[index].X;
+	if (x + width > mWidth)
+		return false;
+
+	// Rectangle rests on highest node it spans
+	y = 0;
+	uint32_t widthLeft = width;
+	for (size_t i = index; widthLeft > 0; ++i)
+	{
+		y = (std::max)(y, mSkyline[i].Y);
+		widthLeft -= (std::min)(widthLeft, mSkyline[i].Width);
+	}
+
+	if (y + height > mHeight)
+		return false;
+
+	// Area between skyline and rectangle bottom is lost
+	waste = 0;
+	widthLeft = width;
+	for (size_t i = index; widthLeft > 0; ++i)
+	{
+		uint32_t spanWidth = (std::min)(widthLeft, mSkyline[i].Width);
+		waste += (y - mSkyline[i].Y) * spanWidth;
+		widthLeft -= spanWidth;
+	}
+
+	return true;
+}
+
+bool SkylinePacker::Insert( uint32_t width, uint32_t height, uint32_t& x, uint32_t& y )
+{
+	size_t bestIndex = mSkyline.size();
+	uint32_t bestTop = UINT32_MAX, bestWaste = UINT32_MAX;
+
+	for (size_t i = 0; i < mSkyline.size(); ++i)
+	{
+		uint32_t nodeY, waste;
+		if (Fit(i, width, height, nodeY, waste))
+		{
+			if (nodeY + height < bestTop || (nodeY + height == bestTop && waste < bestWaste))
+			{
+				bestIndex = i;
+				bestTop = nodeY + height;
+				bestWaste = waste;
+				y = nodeY;
+			}
+		}
+	}
+
+	if (bestIndex == mSkyline.size())
+		return false;
+
+	x = mSkyline[bestIndex].X;
+
+	SkylineNode newNode = { x, bestTop, width };
+	mSkyline.insert(mSkyline.begin() + bestIndex, newNode);
+
+	// Shrink or remove nodes covered by new one
+	for (size_t i = bestIndex + 1; i < mSkyline.size(); )
+	{
+		SkylineNode& node = mSkyline[i];
+		uint32_t newRight = x + width;
+		if (node.X >= newRight)
+			break;
+
+		uint32_t shrink = newRight - node.X;
+		if (shrink >= node.Width)
+		{
+			mSkyline.erase(mSkyline.begin() + i);
+			continue;
+		}
+
+		node.X += shrink;
+		node.Width -= shrink;
+		break;
+	}
+
+	// Merge neighbours of same height
+	for (size_t i = 0; i + 1 < mSkyline.size(); )
+	{
+		if (mSkyline[i].Y == mSkyline[i+1].Y)
+		{
+			mSkyline[i].Width += mSkyline[i+1].Width;
+			mSkyline.erase(mSkyline.begin() + i + 1);
+		}
+		else
+			++i;
+	}
+
+	mUsedArea += uint64_t(width) * height;
+	return true;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+	return float(double(mUsedArea) / (double(mWidth) * mHeight));
+}
+
+//////////////////////////////////////////////////////////////////////////
+TextureAtlas::Page::Page( uint32_t size )
+	: Packer(size, size),
+	  PageImage(std::make_shared<Image>()),
+	  Shared(std::make_shared<TextureAtlasPage>()),
+	  Dirty(true)
+{
+	PageImage->CreateImage(TT_Texture2D, PF_RGBA8_UNORM, size, size, 1, 1, 1);
+	memset(PageImage->GetLevel(0), 0, size * size * 4);
+}
+
+TextureAtlas::TextureAtlas( uint32_t pageSize /*= 1024*/, uint32_t padding /*= 1*/ )
+	: mPageSize(pageSize),
+	  mPadding(padding)
+{
+
+}
+
+TextureAtlas::~TextureAtlas()
+{
+
+}
+
+bool TextureAtlas::AddImage( const String& name, const void* pixels, uint32_t width, uint32_t height, uint32_t rowPitch )
+{
+	if (width == 0 || height == 0 || width + 2 * mPadding > mPageSize || height + 2 * mPadding > mPageSize)
+		return false;
+
+	if (mRegions.find(name) != mRegions.end())
+		return false;
+
+	// Placeholder until packed, keeps names unique
+	Region& region = mRegions[name];
+	region.Page = UINT32_MAX;
+
+	PendingImage image;
+	image.Name = name;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(width * height * 4);
+
+	const uint8_t* src = static_cast<const uint8_t*>(pixels);
+	for (uint32_t row = 0; row < height; ++row)
+		memcpy(&image.Pixels[row * width * 4], src + row * rowPitch, width * 4);
+
+	mPending.push_back(image);
+	return true;
+}
+
+bool TextureAtlas::AddImage( const String& name, const Image& image )
+{
+	if (image.GetType() != TT_Texture2D || (image.GetFormat() != PF_RGBA8_UNORM && image.GetFormat() != PF_SRGB8_ALPHA8_UNORM))
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Only RGBA8 2D image can be packed", "TextureAtlas::AddImage");
+
+	return AddImage(name, image.GetLevel(0), image.GetWidth(), image.GetHeight(), image.GetWidth() * 4);
+}
+
+void TextureAtlas::CopyToPage( Page& page, const PendingImage& image, uint32_t x, uint32_t y )
+{
+	uint8_t* pageData = static_cast<uint8_t*>(page.PageImage->GetLevel(0));
+
+	const uint32_t paddedWidth = image.Width + 2 * mPadding;
+	const uint32_t paddedHeight = image.Height + 2 * mPadding;
+
+	for (uint32_t row = 0; row < paddedHeight; ++row)
+	{
+		// Padding repeats nearest border texel
+		uint32_t srcRow = (std::min)(image.Height - 1, row > mPadding ? row - mPadding : 0);
+		const uint8_t* src = &image.Pixels[srcRow * image.Width * 4];
+		uint8_t* dest = pageData + ((y + row) * mPageSize + x) * 4;
+
+		for (uint32_t i = 0; i < mPadding; ++i)
+			memcpy(dest + i * 4, src, 4);
+
+		memcpy(dest + mPadding * 4, src, image.Width * 4);
+
+		for (uint32_t i = mPadding + image.Width; i < paddedWidth; ++i)
+			memcpy(dest + i * 4, src + (image.Width - 1) * 4, 4);
+	}
+
+	page.Dirty = true;
+}
+
+void TextureAtlas::Build( bool createTextures /*= true*/ )
+{
+	// Tall images first keep skyline flat
+	std::sort(mPending.begin(), mPending.end(), [](const PendingImage& a, const PendingImage& b) {
+		return (a.Height != b.Height) ? a.Height > b.Height : a.Width > b.Width;
+	});
+
+	for (const PendingImage& image : mPending)
+	{
+		const uint32_t paddedWidth = image.Width + 2 * mPadding;
+		const uint32_t paddedHeight = image.Height + 2 * mPadding;
+
+		uint32_t x, y;
+		uint32_t pageIndex;
+		for (pageIndex = 0; pageIndex < mPages.size(); ++pageIndex)
+		{
+			if (mPages[pageIndex].Packer.Insert(paddedWidth, paddedHeight, x, y))
+				break;
+		}
+
+		if (pageIndex == mPages.size())
+		{
+			// AddImage checked it fits an empty page
+			mPages.push_back(Page(mPageSize));
+			mPages.back().Packer.Insert(paddedWidth, paddedHeight, x, y);
+		}
+
+		CopyToPage(mPages[pageIndex], image, x, y);
+
+		Region& region = mRegions[image.Name];
+		region.Page = pageIndex;
+		region.Rect = IntRect(x + mPadding, y + mPadding, image.Width, image.Height);
+	}
+
+	vector<PendingImage>().swap(mPending);
+
+	if (createTextures)
+	{
+		RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+		for (Page& page : mPages)
+		{
+			if (page.Dirty)
+			{
+				// Regions handed out before see new texture through shared page
+				page.Shared->PageTexture = factory->CreateTextureFromImage(*page.PageImage);
+				page.Dirty = false;
+			}
+		}
+	}
+}
+
+bool TextureAtlas::GetRegion( const String& name, TextureRegion& region ) const
+{
+	auto it = mRegions.find(name);
+	if (it == mRegions.end() || it->second.Page == UINT32_MAX)
+		return false;
+
+	region.Page = mPages[it->second.Page].Shared;
+	region.Rect = it->second.Rect;
+	return true;
+}
+
+} // Namespace RcEngine
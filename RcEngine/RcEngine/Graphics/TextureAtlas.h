@@ -0,0 +1,135 @@
+#ifndef TextureAtlas_h__
+#define TextureAtlas_h__
+
+#include <Core/Prerequisites.h>
+#include <Math/Rectangle.h>
+
+namespace RcEngine {
+
+class Image;
+
+/**
+ * Texture of an atlas page, replaced when Build uploads the page again. Shared with regions,
+ * so they draw with the current texture.
+ */
+struct _ApiExport TextureAtlasPage
+{
+	shared_ptr<Texture> PageTexture;
+};
+
+/**
+ * Sub rectangle of an atlas page in texels. SpriteBatch source rectangles drawn with a region
+ * are relative to its top left corner.
+ */
+struct _ApiExport TextureRegion
+{
+	shared_ptr<TextureAtlasPage> Page;
+	IntRect Rect;
+
+	/// Fetch at draw time, texture changes when page is rebuilt.
+	const shared_ptr<Texture>& GetTexture() const	{ return Page->PageTexture; }
+};
+
+/**
+ * Skyline bottom-left rectangle packer. Each rectangle is placed where its top edge ends lowest,
+ * ties go to the position wasting least area below it.
+ */
+class _ApiExport SkylinePacker
+{
+public:
+	SkylinePacker(uint32_t width, uint32_t height);
+
+	void Reset();
+
+	/// Find position for width x height rectangle, return false if it doesn't fit.
+	bool Insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+
+	/// Fraction of area used by inserted rectangles.
+	float GetOccupancy() const;
+
+private:
+	bool Fit(size_t index, uint32_t width, uint32_t height, uint32_t& y, uint32_t& waste) const;
+
+private:
+	struct SkylineNode
+	{
+		uint32_t X, Y;
+		uint32_t Width;
+	};
+
+	uint32_t mWidth, mHeight;
+	uint64_t mUsedArea;
+
+	vector<SkylineNode> mSkyline;
+};
+
+/**
+ * Packs small RGBA8 images into shared texture pages, so sprites and GUI images of different
+ * sources are drawn in one SpriteBatch batch per page. Images added are packed on Build, largest
+ * first, changed pages are uploaded again. Works without render device (cook time) until
+ * Build is called with createTextures.
+ */
+class _ApiExport TextureAtlas
+{
+public:
+	TextureAtlas(uint32_t pageSize = 1024, uint32_t padding = 1);
+	~TextureAtlas();
+
+	/**
+	 * Queue RGBA8 pixels for packing, return false if name exists or image with padding is larger
+	 * than a page. Border texels are repeated into padding, so filtering doesn't bleed neighbours.
+	 */
+	bool AddImage(const String& name, const void* pixels, uint32_t width, uint32_t height, uint32_t rowPitch);
+
+	/// Queue top level of RGBA8 or sRGB8 2D image.
+	bool AddImage(const String& name, const Image& image);
+
+	/// Pack queued images into pages, new pages are opened when needed.
+	void Build(bool createTextures = true);
+
+	bool GetRegion(const String& name, TextureRegion& region) const;
+
+	uint32_t GetNumPages() const							{ return mPages.size(); }
+	const shared_ptr<Texture>& GetPageTexture(uint32_t page) const	{ return mPages[page].Shared->PageTexture; }
+	const Image& GetPageImage(uint32_t page) const			{ return *mPages[page].PageImage; }
+
+	float GetOccupancy(uint32_t page) const					{ return mPages[page].Packer.GetOccupancy(); }
+
+private:
+	struct PendingImage
+	{
+		String Name;
+		uint32_t Width, Height;
+		vector<uint8_t> Pixels;
+	};
+
+	struct Page
+	{
+		Page(uint32_t size);
+
+		SkylinePacker Packer;
+		shared_ptr<Image> PageImage;
+		shared_ptr<TextureAtlasPage> Shared;	// Texture, referenced by regions
+		bool Dirty;
+	};
+
+	struct Region
+	{
+		uint32_t Page;
+		IntRect Rect;
+	};
+
+	void CopyToPage(Page& page, const PendingImage& image, uint32_t x, uint32_t y);
+
+private:
+	uint32_t mPageSize;
+	uint32_t mPadding;
+
+	vector<Page> mPages;
+	vector<PendingImage> mPending;
+	unordered_map<String, Region> mRegions;
+};
+
+} // Namespace RcEngine
+
+#endif // TextureAtlas_h__
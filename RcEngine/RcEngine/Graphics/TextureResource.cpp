@@ -1,23 +1,91 @@
 #include <Graphics/TextureResource.h>
 #include <Graphics/GraphicsResource.h>
 #include <Graphics/RenderFactory.h>
+#include <Graphics/Image.h>
+#include <Graphics/TextureStreamer.h>
 #include <Core/Environment.h>
+#include <Core/Exception.h>
 #include <IO/FileSystem.h>
 
 namespace RcEngine {
 
 TextureResource::TextureResource( ResourceManager* creator, ResourceHandle handle, const String& name, const String& group )
-	: Resource(RT_Texture, creator, handle, name, group)
+	: Resource(RT_Texture, creator, handle, name, group),
+	  mFullWidth(0),
+	  mFullHeight(0),
+	  mNumMipLevels(0),
+	  mResidentMip(0)
 {
 
 }
 
+void TextureResource::PrepareImpl()
+{
+	mFilePath = FileSystem::GetSingleton().Locate(mResourceName, mGroup);
+
+	// Streamed textures start with mip tail only, streamer loads finer levels on demand
+	TextureStreamer* streamer = TextureStreamer::GetSingletonPtr();
+	bool streamed = streamer && streamer->IsStreamed(mResourceHandle);
+
+	mImage = std::make_shared<Image>();
+	if (mImage->LoadImageFromDDS(mFilePath, streamed ? UINT32_MAX : 0) == false)
+		ENGINE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, mFilePath + " not found!", "TextureResource::PrepareImpl");
+
+	UpdateMipSizes(*mImage);
+
+	if (streamed)
+	{
+		// Last level told full size, read again from first level fitting in tail size
+		uint32_t tailMip = streamer->GetTailMip(*this);
+		if (tailMip < mImage->GetFirstLevel())
+			mImage->LoadImageFromDDS(mFilePath, tailMip);
+	}
+}
+
 void TextureResource::LoadImpl()
 {
-	String fullPath = FileSystem::GetSingleton().Locate(mResourceName, mGroup);
+	SetResidentImage(*mImage);
+	mImage.reset();
+}
+
+void TextureResource::UpdateMipSizes( const Image& image )
+{
+	const uint32_t firstLevel = image.GetFirstLevel();
 
+	// Exact for power of two sizes, may be a few texels off for others
+	mFullWidth = image.GetWidth() << firstLevel;
+	mFullHeight = image.GetHeight() << firstLevel;
+	mNumMipLevels = image.GetLevels() + firstLevel;
+
+	uint32_t numSurfaces = image.GetLayers() * ((image.GetType() == TT_TextureCube) ? CMF_Count : 1);
+	uint32_t fullDepth = image.GetDepth() << firstLevel;
+
+	mMipSizes.resize(mNumMipLevels);
+	for (uint32_t level = 0; level < mNumMipLevels; ++level)
+	{
+		uint32_t levelWidth = (std::max)(1U, mFullWidth >> level);
+		uint32_t levelHeight = (std::max)(1U, mFullHeight >> level);
+		uint32_t levelDepth = (std::max)(1U, fullDepth >> level);
+
+		mMipSizes[level] = Image::CalculateSurfaceSize(image.GetFormat(), levelWidth, levelHeight) * levelDepth * numSurfaces;
+	}
+}
+
+void TextureResource::SetResidentImage( Image& image )
+{
 	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
-	mTexture = factory->LoadTextureFromFile(fullPath);
+	mTexture = factory->CreateTextureFromImage(image);
+
+	mResidentMip = image.GetFirstLevel();
+	mSize = GetMipTailSize(mResidentMip);
+}
+
+uint32_t TextureResource::GetMipTailSize( uint32_t firstMip ) const
+{
+	uint32_t size = 0;
+	for (uint32_t level = firstMip; level < mNumMipLevels; ++level)
+		size += mMipSizes[level];
+	return size;
 }
 
 void TextureResource::UnloadImpl()
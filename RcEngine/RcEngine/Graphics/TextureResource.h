@@ -5,6 +5,8 @@
 
 namespace RcEngine {
 
+class Image;
+
 class _ApiExport TextureResource : public Resource
 {
 public:
@@ -12,15 +14,48 @@ public:
 
 	inline const shared_ptr<Texture>& GetTexture() const { return mTexture; }
 
+	/**
+	 * Level of full mip chain used as level 0 of GetTexture. Nonzero when texture is streamed
+	 * and finer levels are not resident, texture object is replaced when it changes.
+	 */
+	inline uint32_t GetResidentMip() const			{ return mResidentMip; }
+	inline uint32_t GetNumMipLevels() const			{ return mNumMipLevels; }
+	inline uint32_t GetFullWidth() const			{ return mFullWidth; }
+	inline uint32_t GetFullHeight() const			{ return mFullHeight; }
+	inline const String& GetFilePath() const		{ return mFilePath; }
+
+	/// Bytes of levels from firstMip to last, all layers and faces included.
+	uint32_t GetMipTailSize(uint32_t firstMip) const;
+
 public:
 	static shared_ptr<Resource> FactoryFunc(ResourceManager* creator, ResourceHandle handle, const String& name, const String& group);
 
 protected:
+	void PrepareImpl();
 	void LoadImpl();
 	void UnloadImpl();
 
+private:
+	/// Create texture from levels loaded by streamer, call from render thread.
+	void SetResidentImage(Image& image);
+	void UpdateMipSizes(const Image& image);
+
+	friend class TextureStreamer;
+
 private:
 	shared_ptr<Texture> mTexture; 
+
+	String mFilePath;
+
+	uint32_t mFullWidth, mFullHeight;
+	uint32_t mNumMipLevels;
+	uint32_t mResidentMip;
+
+	// Bytes of each level of full chain, all layers and faces
+	vector<uint32_t> mMipSizes;
+
+	// Decoded image, released after texture created
+	shared_ptr<Image> mImage;
 };
 
 
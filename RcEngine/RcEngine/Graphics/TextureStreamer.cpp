@@ -0,0 +1,278 @@
+#include <Graphics/TextureStreamer.h>
+#include <Graphics/TextureResource.h>
+#include <Graphics/Material.h>
+#include <Graphics/Camera.h>
+#include <Graphics/Image.h>
+#include <Core/ThreadPool.h>
+#include <IO/FileSystem.h>
+#include <IO/Stream.h>
+#include <Math/MathUtil.h>
+
+namespace RcEngine {
+
+namespace {
+
+const uint32_t NoRequest = UINT32_MAX;
+
+}
+
+TextureStreamer::TextureStreamer( uint64_t budgetBytes, uint32_t viewportHeight )
+	: mBudgetBytes(budgetBytes),
+	  mViewportHeight(viewportHeight),
+	  mFrame(0),
+	  mNumPending(0)
+{
+	memset(&mStats, 0, sizeof(mStats));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Loader tasks reference streamer
+	if (ThreadPool* threadPool = ThreadPool::GetSingletonPtr())
+		threadPool->WaitAll();
+}
+
+void TextureStreamer::MarkStreamed( ResourceHandle handle )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStreamedHandles.insert(handle);
+}
+
+bool TextureStreamer::IsStreamed( ResourceHandle handle )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStreamedHandles.count(handle) > 0;
+}
+
+void TextureStreamer::Register( const shared_ptr<TextureResource>& texture )
+{
+	// Address of released texture may be reused
+	auto it = mTextures.find(texture.get());
+	if (it != mTextures.end() && !it->second.Texture.expired())
+		return;
+
+	StreamedTexture entry;
+	entry.Texture = texture;
+	entry.FrameMip = NoRequest;
+	entry.RequestedMip = GetTailMip(*texture);
+	entry.WantedMip = entry.RequestedMip;
+	entry.LastRequestFrame = mFrame;
+	entry.Pending = false;
+	entry.Failed = false;
+
+	mTextures[texture.get()] = entry;
+}
+
+uint32_t TextureStreamer::GetTailMip( const TextureResource& texture ) const
+{
+	uint32_t size = (std::max)(texture.GetFullWidth(), texture.GetFullHeight());
+
+	uint32_t mip = 0;
+	while (mip + 1 < texture.GetNumMipLevels() && (size >> mip) > MipTailSize)
+		++mip;
+
+	return mip;
+}
+
+void TextureStreamer::RequestMaterial( const Material& material, float uvDensity, const float4x4& world, float distance, const Camera& camera )
+{
+	const float4x4& proj = camera.GetProjMatrix();
+	if (proj.M34 == 0.0f)
+		return;
+
+	// Largest axis scale, stretched texcoords need finer level
+	float scale = (std::max)( Length(float3(world.M11, world.M12, world.M13)), 
+		(std::max)(Length(float3(world.M21, world.M22, world.M23)), Length(float3(world.M31, world.M32, world.M33))) );
+	if (scale > 0.0f)
+		uvDensity /= scale;
+
+	// Screen pixels per world unit at distance
+	float pixelsPerUnit = 0.5f * mViewportHeight * proj.M22 / (std::max)(distance, camera.GetNearPlane());
+
+	for (const shared_ptr<TextureResource>& texture : material.GetTextureResources())
+	{
+		auto it = mTextures.find(texture.get());
+		if (it == mTextures.end())
+			continue;
+
+		// Level where one texel covers about one pixel
+		float texelsPerUnit = uvDensity * (std::max)(texture->GetFullWidth(), texture->GetFullHeight());
+		float texelsPerPixel = texelsPerUnit / pixelsPerUnit;
+
+		uint32_t mip = 0;
+		if (texelsPerPixel > 1.0f)
+			mip = (std::min)(static_cast<uint32_t>(log(texelsPerPixel) / log(2.0f)), texture->GetNumMipLevels() - 1);
+
+		StreamedTexture& entry = it->second;
+		entry.FrameMip = (std::min)(entry.FrameMip, mip);
+	}
+}
+
+void TextureStreamer::Update()
+{
+	++mFrame;
+
+	// Loaded levels become texture on render thread
+	vector<FinishedLoad> finished;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		finished.swap(mFinishedLoads);
+	}
+
+	for (FinishedLoad& load : finished)
+	{
+		auto it = mTextures.find(load.Texture.get());
+		if (it != mTextures.end())
+		{
+			it->second.Pending = false;
+			it->second.Failed = !load.LoadedImage;
+		}
+
+		if (load.LoadedImage)
+		{
+			uint32_t oldMip = load.Texture->GetResidentMip();
+			load.Texture->SetResidentImage(*load.LoadedImage);
+
+			if (load.Texture->GetResidentMip() < oldMip)
+				mStats.NumLoaded++;
+			else
+				mStats.NumEvicted++;
+		}
+	}
+	mNumPending -= finished.size();
+
+	struct ActiveTexture
+	{
+		shared_ptr<TextureResource> Texture;
+		StreamedTexture* Entry;
+		uint32_t TailMip;
+	};
+
+	vector<ActiveTexture> active;
+	active.reserve(mTextures.size());
+
+	uint64_t wantedBytes = 0;
+	mStats.RequestedBytes = 0;
+	for (auto it = mTextures.begin(); it != mTextures.end(); )
+	{
+		ActiveTexture texture;
+		texture.Texture = it->second.Texture.lock();
+		if (!texture.Texture)
+		{
+			it = mTextures.erase(it);
+			continue;
+		}
+
+		StreamedTexture& entry = it->second;
+		texture.Entry = &entry;
+		texture.TailMip = GetTailMip(*texture.Texture);
+
+		// Recently visible textures keep last request
+		if (entry.FrameMip != NoRequest)
+		{
+			entry.RequestedMip = entry.FrameMip;
+			entry.LastRequestFrame = mFrame;
+		}
+		else if (mFrame - entry.LastRequestFrame > EvictFrames)
+			entry.RequestedMip = texture.TailMip;
+
+		entry.FrameMip = NoRequest;
+		entry.RequestedMip = (std::min)(entry.RequestedMip, texture.TailMip);
+
+		// Levels of failed texture won't change, budget isn't reserved for them
+		if (entry.Failed)
+			entry.RequestedMip = texture.Texture->GetResidentMip();
+
+		entry.WantedMip = entry.RequestedMip;
+
+		uint64_t requestedSize = texture.Texture->GetMipTailSize(entry.RequestedMip);
+		mStats.RequestedBytes += requestedSize;
+		wantedBytes += requestedSize;
+
+		active.push_back(texture);
+		++it;
+	}
+
+	// Over budget, drop finest level of the largest texture until requests fit
+	std::priority_queue< std::pair<uint32_t, uint32_t> > largest;
+	for (uint32_t i = 0; i < active.size(); ++i)
+	{
+		const ActiveTexture& texture = active[i];
+		if (texture.Entry->WantedMip < texture.TailMip)
+			largest.push(std::make_pair(texture.Texture->mMipSizes[texture.Entry->WantedMip], i));
+	}
+
+	while (wantedBytes > mBudgetBytes && !largest.empty())
+	{
+		uint32_t index = largest.top().second;
+		wantedBytes -= largest.top().first;
+		largest.pop();
+
+		ActiveTexture& texture = active[index];
+		if (++texture.Entry->WantedMip < texture.TailMip)
+			largest.push(std::make_pair(texture.Texture->mMipSizes[texture.Entry->WantedMip], index));
+	}
+
+	// Dropping levels first if resident levels exceed budget, otherwise most missing levels first
+	mStats.ResidentBytes = 0;
+	for (const ActiveTexture& texture : active)
+		mStats.ResidentBytes += texture.Texture->GetMipTailSize(texture.Texture->GetResidentMip());
+
+	const bool evictFirst = mStats.ResidentBytes > mBudgetBytes;
+	std::sort(active.begin(), active.end(), [evictFirst](const ActiveTexture& a, const ActiveTexture& b) {
+		int32_t priorityA = int32_t(a.Texture->GetResidentMip()) - int32_t(a.Entry->WantedMip);
+		int32_t priorityB = int32_t(b.Texture->GetResidentMip()) - int32_t(b.Entry->WantedMip);
+		return evictFirst ? priorityA < priorityB : priorityA > priorityB;
+	});
+
+	memset(mStats.MissingMips, 0, sizeof(mStats.MissingMips));
+	mStats.NumBudgetLimited = 0;
+	mStats.NumFailed = 0;
+
+	for (ActiveTexture& texture : active)
+	{
+		StreamedTexture& entry = *texture.Entry;
+		uint32_t residentMip = texture.Texture->GetResidentMip();
+
+		if (entry.Failed)
+			mStats.NumFailed++;
+		else if (entry.WantedMip != residentMip && !entry.Pending && mNumPending < MaxPendingLoads)
+			StartLoad(texture.Texture, entry);
+
+		if (entry.WantedMip != entry.RequestedMip)
+			mStats.NumBudgetLimited++;
+
+		if (residentMip > entry.RequestedMip)
+			mStats.MissingMips[(std::min)(residentMip - entry.RequestedMip, 4U) - 1]++;
+	}
+
+	mStats.NumStreamedTextures = active.size();
+	mStats.NumPendingLoads = mNumPending;
+	mStats.BudgetBytes = mBudgetBytes;
+}
+
+void TextureStreamer::StartLoad( const shared_ptr<TextureResource>& texture, StreamedTexture& entry )
+{
+	entry.Pending = true;
+	mNumPending++;
+
+	// Dropping levels reloads the smaller tail from file, so GPU memory is freed on swap
+	uint32_t firstMip = entry.WantedMip;
+
+	// File is read by async backend, levels are decoded on IO thread when read finishes
+	AsyncReadRequestPtr request = std::make_shared<AsyncReadRequest>(texture->GetFilePath());
+	request->SetCallback([this, texture, firstMip](AsyncReadRequest& request) {
+		FinishedLoad load;
+		load.Texture = texture;
+		load.LoadedImage = std::make_shared<Image>();
+		if (!request.IsSucceeded() || !load.LoadedImage->LoadImageFromDDS(*request.GetStream(), firstMip))
+			load.LoadedImage.reset();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFinishedLoads.push_back(load);
+	});
+
+	FileSystem::GetSingleton().SubmitAsync(vector<AsyncReadRequestPtr>(1, request));
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,122 @@
+#ifndef TextureStreamer_h__
+#define TextureStreamer_h__
+
+#include <Core/Prerequisites.h>
+#include <Core/Singleton.h>
+#include <Resource/Resource.h>
+#include <Math/Matrix.h>
+#include <mutex>
+
+namespace RcEngine {
+
+class TextureResource;
+class Material;
+class Camera;
+class Image;
+
+struct _ApiExport TextureStreamingStats
+{
+	uint32_t NumStreamedTextures;
+	uint32_t NumPendingLoads;
+	uint32_t NumBudgetLimited;		// Textures kept coarser than requested to fit budget
+	uint32_t NumFailed;				// Textures whose levels failed to load, kept as resident
+
+	uint64_t ResidentBytes;
+	uint64_t RequestedBytes;		// Bytes if every texture had requested levels resident
+	uint64_t BudgetBytes;
+
+	uint32_t NumLoaded;				// Finer levels uploaded since start
+	uint32_t NumEvicted;			// Levels dropped since start
+
+	// Textures missing 1, 2, 3 or more requested levels
+	uint32_t MissingMips[4];
+};
+
+/**
+ * Stream texture mip levels by screen space demand. While render queue is built, the finest
+ * level each material texture needs is recorded from projected texcoord density. Update loads
+ * finer levels or drops them on worker threads, so resident textures fit in memory budget.
+ * Textures of materials loaded while the streamer exists start with mip tail resident only.
+ */
+class _ApiExport TextureStreamer : public Singleton<TextureStreamer>
+{
+public:
+	// Finest level always resident is the first not larger than this
+	static const uint32_t MipTailSize = 64;
+
+	// Frames without request before texture falls back to mip tail
+	static const uint32_t EvictFrames = 120;
+
+	static const uint32_t MaxPendingLoads = 4;
+
+public:
+	TextureStreamer(uint64_t budgetBytes, uint32_t viewportHeight);
+	~TextureStreamer();
+
+	void SetBudget(uint64_t budgetBytes)				{ mBudgetBytes = budgetBytes; }
+	void SetViewportHeight(uint32_t height)				{ mViewportHeight = height; }
+
+	/// Texture of handle loads mip tail only, call before resource is loaded. Thread safe.
+	void MarkStreamed(ResourceHandle handle);
+	bool IsStreamed(ResourceHandle handle);
+
+	void Register(const shared_ptr<TextureResource>& texture);
+
+	/// Level kept resident without any request.
+	uint32_t GetTailMip(const TextureResource& texture) const;
+
+	/**
+	 * Request levels of material textures for geometry with uvDensity texcoord units per object
+	 * space unit, placed by world transform at distance from camera. Called for every visible 
+	 * renderable during queue build, orthographic (shadow) cameras are ignored.
+	 */
+	void RequestMaterial(const Material& material, float uvDensity, const float4x4& world, float distance, const Camera& camera);
+
+	/**
+	 * Apply finished loads, fit requests into budget and start new loads. Call once per frame
+	 * on render thread, after render queue is built.
+	 */
+	void Update();
+
+	const TextureStreamingStats& GetStatistics() const	{ return mStats; }
+
+private:
+	struct StreamedTexture
+	{
+		weak_ptr<TextureResource> Texture;
+
+		uint32_t FrameMip;			// Finest level requested since last update
+		uint32_t RequestedMip;
+		uint32_t WantedMip;			// Requested level limited by budget
+		uint32_t LastRequestFrame;
+		bool Pending;
+		bool Failed;				// Load failed, file is not read again
+	};
+
+	struct FinishedLoad
+	{
+		shared_ptr<TextureResource> Texture;
+		shared_ptr<Image> LoadedImage;		// Null if load failed
+	};
+
+	void StartLoad(const shared_ptr<TextureResource>& texture, StreamedTexture& entry);
+
+private:
+	uint64_t mBudgetBytes;
+	uint32_t mViewportHeight;
+	uint32_t mFrame;
+	uint32_t mNumPending;
+
+	unordered_map<TextureResource*, StreamedTexture> mTextures;
+
+	// Guards streamed handles and finished loads
+	std::mutex mMutex;
+	unordered_set<ResourceHandle> mStreamedHandles;
+	vector<FinishedLoad> mFinishedLoads;
+
+	TextureStreamingStats mStats;
+};
+
+} // Namespace RcEngine
+
+#endif // TextureStreamer_h__
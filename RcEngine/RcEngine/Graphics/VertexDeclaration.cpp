@@ -56,6 +56,8 @@ uint32_t VertexElementUtil::GetElementComponentCount( const VertexElement& eleme
 	case VEF_Int2:
 	case VEF_UInt2:
 	case VEF_Bool2:
+	case VEF_Half2:
+	case VEF_Short2N:
 		return 2;
 
 	case VEF_UInt3:
@@ -68,6 +70,10 @@ uint32_t VertexElementUtil::GetElementComponentCount( const VertexElement& eleme
 	case VEF_Int4:
 	case VEF_Bool4:
 	case VEF_UInt4:
+	case VEF_Half4:
+	case VEF_UShort4N:
+	case VEF_UByte4N:
+	case VEF_UByte4:
 		return 4;
 	}
 	ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid type",  "VertexElement::GetTypeCount");
@@ -93,10 +99,21 @@ uint32_t VertexElementUtil::GetElementSize( const VertexElement& element )
 	case VEF_Bool2:		return sizeof(bool)*2;
 	case VEF_Bool3:		return sizeof(bool)*3;
 	case VEF_Bool4:		return sizeof(bool)*4;
+	case VEF_Half2:		return sizeof(uint16_t)*2;
+	case VEF_Half4:		return sizeof(uint16_t)*4;
+	case VEF_UShort4N:	return sizeof(uint16_t)*4;
+	case VEF_Short2N:	return sizeof(int16_t)*2;
+	case VEF_UByte4N:	return sizeof(uint8_t)*4;
+	case VEF_UByte4:	return sizeof(uint8_t)*4;
 	default:			break;
 	}
 
 	ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid type", "VertexElement::GetElementSize");
 }
 
+bool VertexElementUtil::IsNormalized( const VertexElement& element )
+{
+	return element.Type == VEF_UShort4N || element.Type == VEF_Short2N || element.Type == VEF_UByte4N;
+}
+
 }
\ No newline at end of file
@@ -46,6 +46,9 @@ struct _ApiExport VertexElementUtil
 {
 	static uint32_t GetElementComponentCount(const VertexElement& element);
 	static uint32_t GetElementSize(const VertexElement& element);
+
+	/// Integer format read as float in [0, 1] or [-1, 1] by shader
+	static bool IsNormalized(const VertexElement& element);
 };
 
 class _ApiExport VertexDeclaration 
@@ -0,0 +1,181 @@
+#include <Graphics/VertexQuantization.h>
+#include <Math/Math.h>
+
+namespace RcEngine {
+
+namespace {
+
+inline float SignNotZero(float value)
+{
+	return (value >= 0.0f) ? 1.0f : -1.0f;
+}
+
+inline int16_t QuantizeSNorm16(float value)
+{
+	value = (std::max)(-1.0f, (std::min)(1.0f, value));
+	return (int16_t)floorf(value * 32767.0f + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+}
+
+uint16_t VertexQuantization::FloatToHalf( float value )
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	// NaN and infinity
+	if (exponent == 0xff)
+		return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+	int32_t halfExponent = (int32_t)exponent - 127 + 15;
+
+	// Overflow
+	if (halfExponent >= 0x1f)
+		return (uint16_t)(sign | 0x7c00);
+
+	// Denormal or zero
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+			return (uint16_t)sign;
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t halfMantissa = mantissa >> shift;
+
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+			halfMantissa++;
+
+		return (uint16_t)(sign | halfMantissa);
+	}
+
+	uint32_t half = sign | ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+
+	// Round to nearest even, carry may overflow into exponent which is correct
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+
+	return (uint16_t)half;
+}
+
+float VertexQuantization::HalfToFloat( uint16_t value )
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	uint32_t bits;
+	if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// Normalize denormal
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(float));
+	return result;
+}
+
+uint16_t VertexQuantization::QuantizeUNorm16( float value )
+{
+	value = (std::max)(0.0f, (std::min)(1.0f, value));
+	return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+void VertexQuantization::QuantizePosition( uint16_t dest[4], const float3& position, const float3& boundMin, const float3& boundMax )
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		float extent = boundMax[i] - boundMin[i];
+		dest[i] = (extent > 0.0f) ? QuantizeUNorm16((position[i] - boundMin[i]) / extent) : 0;
+	}
+	dest[3] = 0;
+}
+
+void VertexQuantization::EncodeOctahedral( int16_t dest[2], const float3& normal )
+{
+	float invL1 = 1.0f / (fabsf(normal.X()) + fabsf(normal.Y()) + fabsf(normal.Z()));
+
+	float x = normal.X() * invL1;
+	float y = normal.Y() * invL1;
+
+	// Fold lower hemisphere over diagonals
+	if (normal.Z() < 0.0f)
+	{
+		float foldX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldX;
+		y = foldY;
+	}
+
+	dest[0] = QuantizeSNorm16(x);
+	dest[1] = QuantizeSNorm16(y);
+}
+
+float3 VertexQuantization::DecodeOctahedral( const int16_t src[2] )
+{
+	float x = (std::max)(src[0] / 32767.0f, -1.0f);
+	float y = (std::max)(src[1] / 32767.0f, -1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	if (z < 0.0f)
+	{
+		float foldX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldX;
+		y = foldY;
+	}
+
+	float3 normal(x, y, z);
+	return normal / normal.Length();
+}
+
+void VertexQuantization::QuantizeBlendWeights( uint8_t dest[4], const float weights[4] )
+{
+	float sum = weights[0] + weights[1] + weights[2] + weights[3];
+	float scale = (sum > 0.0f) ? 255.0f / sum : 0.0f;
+
+	int total = 0, largest = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		dest[i] = (uint8_t)(std::min)(255.0f, weights[i] * scale + 0.5f);
+		total += dest[i];
+
+		if (weights[i] > weights[largest])
+			largest = i;
+	}
+
+	// Put rounding error on the largest weight
+	if (sum > 0.0f)
+		dest[largest] = (uint8_t)(dest[largest] + (255 - total));
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,43 @@
+#ifndef VertexQuantization_h__
+#define VertexQuantization_h__
+
+#include <Core/Prerequisites.h>
+#include <Math/Vector.h>
+
+namespace RcEngine {
+
+/**
+ * Encoders for compact vertex formats, used by mesh exporters. Decoding happens in
+ * vertex shader, see ModelVertexFactory with _QuantizedVertex.
+ */
+class _ApiExport VertexQuantization
+{
+public:
+	/// IEEE half float, round to nearest even, overflow to infinity.
+	static uint16_t FloatToHalf(float value);
+	static float HalfToFloat(uint16_t value);
+
+	/// Map value in [0, 1] to 16 bit unsigned normalized.
+	static uint16_t QuantizeUNorm16(float value);
+
+	/**
+	 * Quantize position to VEF_UShort4N within bounds, w is 0.
+	 * Decode with position = q * (max - min) + min.
+	 */
+	static void QuantizePosition(uint16_t dest[4], const float3& position, const float3& boundMin, const float3& boundMax);
+
+	/**
+	 * Octahedral encode unit vector to VEF_Short2N, max error under 0.05 degree.
+	 */
+	static void EncodeOctahedral(int16_t dest[2], const float3& normal);
+	static float3 DecodeOctahedral(const int16_t src[2]);
+
+	/**
+	 * Quantize 4 blend weights to VEF_UByte4N, quantized weights always sum to 255.
+	 */
+	static void QuantizeBlendWeights(uint8_t dest[4], const float weights[4]);
+};
+
+} // Namespace RcEngine
+
+#endif // VertexQuantization_h__
@@ -0,0 +1,129 @@
+#include <IO/AsyncFileIO.h>
+#include <IO/MemoryStream.h>
+#include <IO/CompressedStream.h>
+#include <Core/ThreadPool.h>
+#include <Core/Exception.h>
+
+namespace RcEngine {
+
+AsyncReadRequest::AsyncReadRequest( const String& fileName, uint32_t offset, uint32_t size )
+	: mFileName(fileName),
+	  mOffset(offset),
+	  mSize(size),
+	  mBytesRead(0),
+	  mCompleted(false),
+	  mSucceeded(false)
+{
+
+}
+
+bool AsyncReadRequest::IsCompleted()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCompleted;
+}
+
+bool AsyncReadRequest::IsSucceeded()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mSucceeded;
+}
+
+bool AsyncReadRequest::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (!mCompleted)
+		mCondition.wait(lock);
+
+	return mSucceeded;
+}
+
+void AsyncReadRequest::Complete( bool succeeded )
+{
+	if (!succeeded)
+		mData.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCompleted = true;
+		mSucceeded = succeeded;
+	}
+	mCondition.notify_all();
+
+	if (mCallback)
+		mCallback(*this);
+}
+
+shared_ptr<Stream> AsyncReadRequest::GetStream()
+{
+	if (!Wait())
+		ENGINE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "Error while reading from file " + mFileName, "AsyncReadRequest::GetStream");
+
+	shared_ptr<Stream> stream = std::make_shared<MemoryStream>(mFileName, mData);
+
+	if (CompressedStream::IsCompressed(*stream))
+		return std::make_shared<CompressedStream>(stream);
+
+	return stream;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/**
+ * Fallback backend, every request is a blocking read on a pool thread.
+ */
+class ThreadPoolFileBackend : public AsyncFileBackend
+{
+public:
+	virtual const char* GetName() const		{ return "ThreadPool"; }
+
+	virtual void Submit(const vector<AsyncReadRequestPtr>& requests)
+	{
+		ThreadPool* threadPool = ThreadPool::GetSingletonPtr();
+
+		for (const AsyncReadRequestPtr& request : requests)
+		{
+			if (threadPool)
+				threadPool->Submit( [request]() { Read(*request); } );
+			else
+				Read(*request);
+		}
+	}
+
+private:
+	static void Read(AsyncReadRequest& request)
+	{
+		FILE* file = fopen(request.mFileName.c_str(), "rb");
+		if (!file)
+		{
+			request.Complete(false);
+			return;
+		}
+
+		fseek(file, 0, SEEK_END);
+		uint32_t fileSize = (uint32_t)ftell(file);
+
+		uint32_t size = fileSize > request.mOffset ? fileSize - request.mOffset : 0;
+		if (request.mSize)
+			size = (std::min)(size, request.mSize);
+
+		request.mData.resize(size);
+
+		bool succeeded = true;
+		if (size)
+		{
+			fseek(file, request.mOffset, SEEK_SET);
+			succeeded = (fread(&request.mData[0], size, 1, file) == 1);
+		}
+
+		fclose(file);
+		request.mBytesRead = succeeded ? size : 0;
+		request.Complete(succeeded);
+	}
+};
+
+shared_ptr<AsyncFileBackend> AsyncFileBackend::Create()
+{
+	return std::make_shared<ThreadPoolFileBackend>();
+}
+
+} //Namespace RcEngine
@@ -0,0 +1,83 @@
+#ifndef AsyncFileIO_h__
+#define AsyncFileIO_h__
+
+#include <Core/Prerequisites.h>
+#include <mutex>
+#include <condition_variable>
+
+namespace RcEngine {
+
+/**
+ * One asynchronous file read. Size 0 reads from offset to end of file.
+ */
+class _ApiExport AsyncReadRequest
+{
+public:
+	typedef std::function<void(AsyncReadRequest&)> Callback;
+
+public:
+	AsyncReadRequest(const String& fileName, uint32_t offset = 0, uint32_t size = 0);
+
+	const String& GetFileName() const			{ return mFileName; }
+	uint32_t GetOffset() const					{ return mOffset; }
+
+	/**
+	 * Called on IO thread when request is finished, set before submitting.
+	 */
+	void SetCallback(const Callback& callback)	{ mCallback = callback; }
+
+	bool IsCompleted();
+	bool IsSucceeded();
+
+	/// Block until request is finished, return if succeeded.
+	bool Wait();
+
+	/// Valid after completed.
+	vector<uint8_t>& GetData()					{ return mData; }
+
+	/**
+	 * Wrap data in a stream after completed, data is moved into stream.
+	 * Block compressed files are decompressed transparently.
+	 */
+	shared_ptr<Stream> GetStream();
+
+	/// Called by backend.
+	void Complete(bool succeeded);
+
+private:
+	friend class ThreadPoolFileBackend;
+
+	String mFileName;
+	uint32_t mOffset;
+	uint32_t mSize;
+	uint32_t mBytesRead;
+	vector<uint8_t> mData;
+
+	Callback mCallback;
+
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mCompleted;
+	bool mSucceeded;
+};
+
+typedef shared_ptr<AsyncReadRequest> AsyncReadRequestPtr;
+
+/**
+ * Asynchronous read backend. Submit returns immediately, many requests can be in flight.
+ */
+class _ApiExport AsyncFileBackend
+{
+public:
+	virtual ~AsyncFileBackend() {}
+
+	virtual const char* GetName() const = 0;
+	virtual void Submit(const vector<AsyncReadRequestPtr>& requests) = 0;
+
+	/// Create backend of the platform, reads are blocking calls on ThreadPool threads.
+	static shared_ptr<AsyncFileBackend> Create();
+};
+
+} //Namespace RcEngine
+
+#endif // AsyncFileIO_h__
@@ -0,0 +1,579 @@
+#include <IO/CompressedStream.h>
+#include <Core/Exception.h>
+#include <Core/ThreadPool.h>
+#include <atomic>
+
+namespace RcEngine {
+
+namespace {
+
+const uint32_t LZ4MinMatch = 4;
+const uint32_t LZ4LastLiterals = 5;
+const uint32_t LZ4MFLimit = 12;
+const uint32_t LZ4HashLog = 16;
+const uint32_t LZ4MaxDistance = 65535;
+
+const uint32_t BlockStoredFlag = 0x80000000;
+
+inline uint32_t Read32(const uint8_t* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint32_t HashSequence(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - LZ4HashLog);
+}
+
+inline uint8_t* WriteLength(uint8_t* op, uint32_t length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+uint8_t* WriteSequence(uint8_t* op, uint8_t* oend, const uint8_t* literals, uint32_t literalLength, uint32_t offset, uint32_t matchLength)
+{
+	// token + literal length + literals + offset + match length
+	uint32_t required = 1 + (literalLength / 255 + 1) + literalLength + 2 + ((matchLength - LZ4MinMatch) / 255 + 1);
+	if (required > uint32_t(oend - op))
+		return nullptr;
+
+	uint8_t* token = op++;
+
+	*token = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15)
+		op = WriteLength(op, literalLength - 15);
+
+	memcpy(op, literals, literalLength);
+	op += literalLength;
+
+	*op++ = (uint8_t)(offset & 0xFF);
+	*op++ = (uint8_t)(offset >> 8);
+
+	uint32_t matchCode = matchLength - LZ4MinMatch;
+	*token |= (uint8_t)(matchCode < 15 ? matchCode : 15);
+	if (matchCode >= 15)
+		op = WriteLength(op, matchCode - 15);
+
+	return op;
+}
+
+uint8_t* WriteLastLiterals(uint8_t* op, uint8_t* oend, const uint8_t* literals, uint32_t literalLength)
+{
+	uint32_t required = 1 + (literalLength / 255 + 1) + literalLength;
+	if (required > uint32_t(oend - op))
+		return nullptr;
+
+	*op++ = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15)
+		op = WriteLength(op, literalLength - 15);
+
+	memcpy(op, literals, literalLength);
+	return op + literalLength;
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////////
+uint32_t LZ4Codec::CompressBound( uint32_t srcSize )
+{
+	return srcSize + srcSize / 255 + 16;
+}
+
+uint32_t LZ4Codec::Compress( const void* src, uint32_t srcSize, void* dest, uint32_t destCapacity )
+{
+	const uint8_t* const base = static_cast<const uint8_t*>(src);
+	const uint8_t* const iend = base + srcSize;
+	const uint8_t* ip = base;
+	const uint8_t* anchor = base;
+
+	uint8_t* const obase = static_cast<uint8_t*>(dest);
+	uint8_t* const oend = obase + destCapacity;
+	uint8_t* op = obase;
+
+	if (srcSize > LZ4MFLimit)
+	{
+		const uint8_t* const mflimit = iend - LZ4MFLimit;
+		const uint8_t* const matchlimit = iend - LZ4LastLiterals;
+
+		vector<uint32_t> hashTable(1 << LZ4HashLog, 0);
+
+		while (ip < mflimit)
+		{
+			uint32_t sequence = Read32(ip);
+			uint32_t hash = HashSequence(sequence);
+			const uint8_t* ref = base + hashTable[hash];
+			hashTable[hash] = uint32_t(ip - base);
+
+			if (ref >= ip || uint32_t(ip - ref) > LZ4MaxDistance || Read32(ref) != sequence)
+			{
+				++ip;
+				continue;
+			}
+
+			// Extend match backward
+			while (ip > anchor && ref > base && ip[-1] == ref[-1])
+			{
+				--ip;
+				--ref;
+			}
+
+			// Extend match forward
+			uint32_t matchLength = LZ4MinMatch;
+			while (ip + matchLength < matchlimit && ip[matchLength] == ref[matchLength])
+				++matchLength;
+
+			op = WriteSequence(op, oend, anchor, uint32_t(ip - anchor), uint32_t(ip - ref), matchLength);
+			if (!op)
+				return 0;
+
+			ip += matchLength;
+			anchor = ip;
+
+			if (ip < mflimit)
+				hashTable[HashSequence(Read32(ip - 2))] = uint32_t(ip - 2 - base);
+		}
+	}
+
+	op = WriteLastLiterals(op, oend, anchor, uint32_t(iend - anchor));
+	if (!op)
+		return 0;
+
+	return uint32_t(op - obase);
+}
+
+uint32_t LZ4Codec::Decompress( const void* src, uint32_t srcSize, void* dest, uint32_t destSize )
+{
+	const uint8_t* ip = static_cast<const uint8_t*>(src);
+	const uint8_t* const iend = ip + srcSize;
+
+	uint8_t* const obase = static_cast<uint8_t*>(dest);
+	uint8_t* const oend = obase + destSize;
+	uint8_t* op = obase;
+
+	for (;;)
+	{
+		if (ip >= iend)
+			return 0;
+
+		uint32_t token = *ip++;
+
+		// Literals
+		uint32_t literalLength = token >> 4;
+		if (literalLength == 15)
+		{
+			uint32_t s;
+			do
+			{
+				if (ip >= iend) return 0;
+				s = *ip++;
+				literalLength += s;
+			} while (s == 255);
+		}
+
+		if (literalLength > uint32_t(iend - ip) || literalLength > uint32_t(oend - op))
+			return 0;
+
+		memcpy(op, ip, literalLength);
+		op += literalLength;
+		ip += literalLength;
+
+		// Last sequence has no match
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return 0;
+
+		uint32_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > uint32_t(op - obase))
+			return 0;
+
+		uint32_t matchLength = token & 15;
+		if (matchLength == 15)
+		{
+			uint32_t s;
+			do
+			{
+				if (ip >= iend) return 0;
+				s = *ip++;
+				matchLength += s;
+			} while (s == 255);
+		}
+		matchLength += LZ4MinMatch;
+
+		if (matchLength > uint32_t(oend - op))
+			return 0;
+
+		// Match may overlap output, copy byte by byte
+		const uint8_t* match = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			for (uint32_t i = 0; i < matchLength; ++i)
+				*op++ = *match++;
+		}
+	}
+
+	return uint32_t(op - obase);
+}
+
+//////////////////////////////////////////////////////////////////////////
+CompressedStream::CompressedStream()
+	: mBlockSize(0),
+	  mCachedBlock(UINT32_MAX)
+{
+
+}
+
+CompressedStream::CompressedStream( const shared_ptr<Stream>& source )
+	: mBlockSize(0),
+	  mCachedBlock(UINT32_MAX)
+{
+	Open(source);
+}
+
+CompressedStream::~CompressedStream()
+{
+	Close();
+}
+
+const String& CompressedStream::GetName() const
+{
+	return mSource ? mSource->GetName() : Stream::GetName();
+}
+
+bool CompressedStream::IsCompressed( Stream& source )
+{
+	if (source.GetSize() < HeaderSize)
+		return false;
+
+	uint32_t position = source.GetPosition();
+	uint32_t magic = source.ReadUInt();
+	source.Seek(position);
+
+	return magic == CompressedStreamId;
+}
+
+bool CompressedStream::Open( const shared_ptr<Stream>& source )
+{
+	Close();
+
+	if (!source || !IsCompressed(*source))
+		return false;
+
+	mSource = source;
+	mSource->Seek(0);
+
+	mSource->ReadUInt();  // Magic
+	mBlockSize = mSource->ReadUInt();
+	mSize = mSource->ReadUInt();
+	uint32_t numBlocks = mSource->ReadUInt();
+	uint32_t tableOffset = mSource->ReadUInt();
+
+	if (mBlockSize == 0 || (uint64_t(numBlocks) * mBlockSize < mSize))
+	{
+		ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Corrupted compressed stream " + GetName(), "CompressedStream::Open");
+		return false;
+	}
+
+	vector<uint32_t> blockTable(numBlocks);
+	mSource->Seek(tableOffset);
+	if (numBlocks)
+		mSource->Read(&blockTable[0], sizeof(uint32_t) * numBlocks);
+
+	mBlockOffsets.resize(numBlocks + 1);
+	mBlockStored.resize(numBlocks);
+
+	mBlockOffsets[0] = HeaderSize;
+	for (uint32_t i = 0; i < numBlocks; ++i)
+	{
+		mBlockStored[i] = (blockTable[i] & BlockStoredFlag) != 0;
+		mBlockOffsets[i+1] = mBlockOffsets[i] + (blockTable[i] & ~BlockStoredFlag);
+	}
+
+	mBlockCache.resize(mBlockSize);
+	mCachedBlock = UINT32_MAX;
+	mPosition = 0;
+
+	return true;
+}
+
+uint32_t CompressedStream::GetBlockUncompressedSize( uint32_t block ) const
+{
+	uint32_t blockStart = block * mBlockSize;
+	return (std::min)(mBlockSize, mSize - blockStart);
+}
+
+bool CompressedStream::DecodeBlock( uint32_t block, const uint8_t* src, uint8_t* dest ) const
+{
+	uint32_t compressedSize = mBlockOffsets[block+1] - mBlockOffsets[block];
+	uint32_t uncompressedSize = GetBlockUncompressedSize(block);
+
+	if (mBlockStored[block])
+	{
+		if (compressedSize != uncompressedSize)
+			return false;
+
+		memcpy(dest, src, uncompressedSize);
+		return true;
+	}
+
+	return LZ4Codec::Decompress(src, compressedSize, dest, uncompressedSize) == uncompressedSize;
+}
+
+void CompressedStream::CacheBlock( uint32_t block )
+{
+	if (mCachedBlock == block)
+		return;
+
+	uint32_t compressedSize = mBlockOffsets[block+1] - mBlockOffsets[block];
+	mReadBuffer.resize(compressedSize);
+
+	mSource->Seek(mBlockOffsets[block]);
+	mSource->Read(&mReadBuffer[0], compressedSize);
+
+	mCachedBlock = UINT32_MAX;
+	if (!DecodeBlock(block, &mReadBuffer[0], &mBlockCache[0]))
+		ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Corrupted compressed block in " + GetName(), "CompressedStream::CacheBlock");
+
+	mCachedBlock = block;
+}
+
+void CompressedStream::DecodeBlocks( uint32_t firstBlock, uint32_t numBlocks, uint8_t* dest )
+{
+	// One sequential read for all compressed blocks
+	uint32_t compressedStart = mBlockOffsets[firstBlock];
+	uint32_t compressedSize = mBlockOffsets[firstBlock+numBlocks] - compressedStart;
+	mReadBuffer.resize(compressedSize);
+
+	mSource->Seek(compressedStart);
+	mSource->Read(&mReadBuffer[0], compressedSize);
+
+	// Exceptions can't cross worker threads, collect error and throw here
+	std::atomic<bool> corrupted(false);
+
+	const uint8_t* src = &mReadBuffer[0];
+	ParallelFor(firstBlock, firstBlock + numBlocks, [&](uint32_t block) {
+		if (!DecodeBlock(block, src + (mBlockOffsets[block] - compressedStart), dest + (block - firstBlock) * mBlockSize))
+			corrupted = true;
+	});
+
+	if (corrupted)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Corrupted compressed block in " + GetName(), "CompressedStream::DecodeBlocks");
+}
+
+uint32_t CompressedStream::Read( void* dest, uint32_t size )
+{
+	if (!mSource)
+	{
+		ENGINE_EXCEPT(Exception::ERR_RT_ASSERTION_FAILED,
+			"Compressed stream not open", "CompressedStream::Read( void*, uint32_t)");
+		return 0;
+	}
+
+	if (size + mPosition > mSize)
+		size = mSize - mPosition;
+
+	uint8_t* pDest = static_cast<uint8_t*>(dest);
+	uint32_t bytesRemain = size;
+
+	while (bytesRemain > 0)
+	{
+		uint32_t block = mPosition / mBlockSize;
+		uint32_t blockOffset = mPosition % mBlockSize;
+
+		uint32_t numFullBlocks = 0;
+		if (blockOffset == 0)
+			numFullBlocks = (std::min)(bytesRemain / mBlockSize, GetNumBlocks() - block);
+
+		uint32_t copySize;
+		if (numFullBlocks > 1)
+		{
+			// Large read, decode blocks straight into dest
+			DecodeBlocks(block, numFullBlocks, pDest);
+			copySize = numFullBlocks * mBlockSize;
+		}
+		else
+		{
+			CacheBlock(block);
+			copySize = (std::min)(GetBlockUncompressedSize(block) - blockOffset, bytesRemain);
+			memcpy(pDest, &mBlockCache[blockOffset], copySize);
+		}
+
+		pDest += copySize;
+		mPosition += copySize;
+		bytesRemain -= copySize;
+	}
+
+	return size;
+}
+
+uint32_t CompressedStream::Write( const void* data, uint32_t size )
+{
+	ENGINE_EXCEPT(Exception::ERR_CANNOT_WRITE_TO_FILE,
+		"Compressed stream is read only, use CompressedStreamWriter", "CompressedStream::Write( void*, uint32_t)");
+	return 0;
+}
+
+uint32_t CompressedStream::Seek( uint32_t position )
+{
+	mPosition = (std::min)(position, mSize);
+	return mPosition;
+}
+
+void CompressedStream::Close()
+{
+	if (mSource)
+	{
+		mSource->Close();
+		mSource.reset();
+	}
+
+	mBlockOffsets.clear();
+	mBlockStored.clear();
+	mBlockCache.clear();
+	mReadBuffer.clear();
+	mCachedBlock = UINT32_MAX;
+	mPosition = 0;
+	mSize = 0;
+}
+
+void CompressedStream::Flush()
+{
+
+}
+
+//////////////////////////////////////////////////////////////////////////
+CompressedStreamWriter::CompressedStreamWriter( const shared_ptr<Stream>& dest, uint32_t blockSize )
+	: mDest(dest),
+	  mBlockSize(blockSize)
+{
+	assert(mDest && mBlockSize > 0);
+
+	// Header, patched when closed
+	mDest->WriteUInt(CompressedStream::CompressedStreamId);
+	mDest->WriteUInt(mBlockSize);
+	mDest->WriteUInt(0);
+	mDest->WriteUInt(0);
+	mDest->WriteUInt(0);
+}
+
+CompressedStreamWriter::~CompressedStreamWriter()
+{
+	Close();
+}
+
+const String& CompressedStreamWriter::GetName() const
+{
+	return mDest ? mDest->GetName() : Stream::GetName();
+}
+
+uint32_t CompressedStreamWriter::Read( void* dest, uint32_t size )
+{
+	ENGINE_EXCEPT(Exception::ERR_RT_ASSERTION_FAILED,
+		"Compressed stream writer not opened for reading", "CompressedStreamWriter::Read( void*, uint32_t)");
+	return 0;
+}
+
+uint32_t CompressedStreamWriter::Write( const void* data, uint32_t size )
+{
+	if (!mDest)
+	{
+		ENGINE_EXCEPT(Exception::ERR_RT_ASSERTION_FAILED,
+			"Compressed stream writer closed", "CompressedStreamWriter::Write( void*, uint32_t)");
+		return 0;
+	}
+
+	// Overwrites data after a seek back
+	if (mPosition + size > mBuffer.size())
+		mBuffer.resize(mPosition + size);
+
+	if (size)
+		memcpy(&mBuffer[mPosition], data, size);
+
+	mPosition += size;
+	mSize = mBuffer.size();
+
+	return size;
+}
+
+uint32_t CompressedStreamWriter::Seek( uint32_t position )
+{
+	if (position > mSize)
+	{
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS,
+			"Seek past end of compressed stream writer", "CompressedStreamWriter::Seek( uint32_t)");
+	}
+
+	mPosition = position;
+	return mPosition;
+}
+
+void CompressedStreamWriter::Close()
+{
+	if (!mDest)
+		return;
+
+	const uint32_t numBlocks = (mSize + mBlockSize - 1) / mBlockSize;
+
+	vector<vector<uint8_t> > compressedBlocks(numBlocks);
+	vector<uint32_t> blockTable(numBlocks);
+	ParallelFor(0, numBlocks, [&](uint32_t i) {
+		const uint32_t blockSize = (std::min)(mBlockSize, mSize - i * mBlockSize);
+		const uint8_t* block = &mBuffer[i * mBlockSize];
+
+		vector<uint8_t>& compressed = compressedBlocks[i];
+		compressed.resize(LZ4Codec::CompressBound(blockSize));
+		uint32_t compressedSize = LZ4Codec::Compress(block, blockSize, &compressed[0], compressed.size());
+
+		// Store incompressible block as it is
+		if (compressedSize == 0 || compressedSize >= blockSize)
+		{
+			compressed.assign(block, block + blockSize);
+			blockTable[i] = blockSize | BlockStoredFlag;
+		}
+		else
+		{
+			compressed.resize(compressedSize);
+			blockTable[i] = compressedSize;
+		}
+	});
+
+	for (const vector<uint8_t>& compressed : compressedBlocks)
+		mDest->Write(&compressed[0], compressed.size());
+
+	uint32_t tableOffset = mDest->GetPosition();
+	if (numBlocks)
+		mDest->Write(&blockTable[0], sizeof(uint32_t) * numBlocks);
+
+	mDest->Seek(8);
+	mDest->WriteUInt(mSize);
+	mDest->WriteUInt(numBlocks);
+	mDest->WriteUInt(tableOffset);
+
+	vector<uint8_t>().swap(mBuffer);
+
+	mDest->Close();
+	mDest.reset();
+}
+
+void CompressedStreamWriter::Flush()
+{
+
+}
+
+} //Namespace RcEngine
@@ -0,0 +1,115 @@
+#ifndef CompressedStream_h__
+#define CompressedStream_h__
+
+#include <Core/Prerequisites.h>
+#include <IO/Stream.h>
+
+namespace RcEngine {
+
+/**
+ * LZ4 block format codec. Fast to decode, used for asset streams.
+ */
+class _ApiExport LZ4Codec
+{
+public:
+	/// Return worst case compressed size.
+	static uint32_t CompressBound(uint32_t srcSize);
+	/// Return compressed size, 0 if dest is too small.
+	static uint32_t Compress(const void* src, uint32_t srcSize, void* dest, uint32_t destCapacity);
+	/// Return decompressed size, 0 if source is corrupted.
+	static uint32_t Decompress(const void* src, uint32_t srcSize, void* dest, uint32_t destSize);
+};
+
+/**
+ * Compressed Stream Layout:
+
+   Magic Number			uint32_t
+   Block Size			uint32_t
+   Uncompressed Size	uint32_t
+   Block Count			uint32_t
+   Block Table Offset	uint32_t
+   Block Data
+   Block Table			uint32_t[Block Count], compressed size, high bit set if stored
+*/
+class _ApiExport CompressedStream : public Stream
+{
+public:
+	static const uint32_t CompressedStreamId = ('R' << 24) | ('C' << 16) | ('Z' << 8) | ('B');
+	static const uint32_t HeaderSize = 20;
+	static const uint32_t DefaultBlockSize = 64 * 1024;
+
+public:
+	CompressedStream();
+	CompressedStream(const shared_ptr<Stream>& source);
+	virtual ~CompressedStream();
+
+	virtual const String& GetName() const;
+	virtual uint32_t Read(void* dest, uint32_t size);
+	virtual uint32_t Write(const void* data, uint32_t size);
+	virtual uint32_t Seek(uint32_t position);
+
+	virtual void Close();
+	virtual void Flush();
+
+	bool Open(const shared_ptr<Stream>& source);
+
+	uint32_t GetBlockSize() const				{ return mBlockSize; }
+	uint32_t GetNumBlocks() const				{ return mBlockOffsets.size() - 1; }
+
+	/**
+	 * Check if stream starts with compressed stream header, stream position is unchanged.
+	 */
+	static bool IsCompressed(Stream& source);
+
+private:
+	uint32_t GetBlockUncompressedSize(uint32_t block) const;
+
+	bool DecodeBlock(uint32_t block, const uint8_t* src, uint8_t* dest) const;
+	void CacheBlock(uint32_t block);
+
+	/**
+	 * Decode contiguous full blocks straight into dest, blocks are decoded in parallel.
+	 */
+	void DecodeBlocks(uint32_t firstBlock, uint32_t numBlocks, uint8_t* dest);
+
+private:
+	shared_ptr<Stream> mSource;
+
+	uint32_t mBlockSize;
+
+	vector<uint32_t> mBlockOffsets;  // Block offsets in source, with an end offset
+	vector<bool> mBlockStored;
+
+	uint32_t mCachedBlock;
+	vector<uint8_t> mBlockCache;
+	vector<uint8_t> mReadBuffer;
+};
+
+/**
+ * Write compressed stream, see CompressedStream for layout. Data is kept uncompressed until
+ * Close, so writers may seek back and patch headers. Blocks are compressed in parallel on Close.
+ */
+class _ApiExport CompressedStreamWriter : public Stream
+{
+public:
+	CompressedStreamWriter(const shared_ptr<Stream>& dest, uint32_t blockSize = CompressedStream::DefaultBlockSize);
+	virtual ~CompressedStreamWriter();
+
+	virtual const String& GetName() const;
+	virtual uint32_t Read(void* dest, uint32_t size);
+	virtual uint32_t Write(const void* data, uint32_t size);
+	virtual uint32_t Seek(uint32_t position);
+
+	virtual void Close();
+	virtual void Flush();
+
+private:
+	shared_ptr<Stream> mDest;
+
+	uint32_t mBlockSize;
+	vector<uint8_t> mBuffer;
+};
+
+} //Namespace RcEngine
+
+#endif // CompressedStream_h__
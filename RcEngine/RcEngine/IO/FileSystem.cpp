@@ -1,5 +1,6 @@
 #include <IO/FileSystem.h>
 #include <IO/FileStream.h>
+#include <IO/CompressedStream.h>
 #include <IO/PathUtil.h>
 #include <Core/Exception.h>
 #include <sys/stat.h>
@@ -13,7 +14,7 @@ namespace RcEngine {
 
 FileSystem::FileSystem()
 {
-
+	mAsyncBackend = AsyncFileBackend::Create();
 }
 
 FileSystem::~FileSystem()
@@ -159,6 +160,11 @@ shared_ptr<Stream> FileSystem::OpenStream( const String& file, const String& gro
 		{
 			shared_ptr<FileStream> stream ( new FileStream );
 			stream->Open(fullPath);
+
+			// Cooked assets may be block compressed, decompress transparently
+			if (CompressedStream::IsCompressed(*stream))
+				return std::make_shared<CompressedStream>(stream);
+
 			return stream;
 		}
 	}
@@ -167,6 +173,47 @@ shared_ptr<Stream> FileSystem::OpenStream( const String& file, const String& gro
 	ENGINE_EXCEPT(Exception::ERR_FILE_NOT_FOUND, "File: " + file + "in " + group + " doesn't exits", "FileSystem::OpenStream");
 }
 
+String FileSystem::FindInGroup( const String& file, const String& group )
+{
+	auto groupIter = mResouceGroups.find(group);
+	if (groupIter != mResouceGroups.end())
+	{
+		for (const String& path : groupIter->second)
+		{
+			String fullPath = path + "/" + file;
+			if (FileExits(fullPath))
+				return fullPath;
+		}
+	}
+
+	// Let the request fail on open
+	return file;
+}
+
+AsyncReadRequestPtr FileSystem::ReadFileAsync( const String& file, const String& group/*="General"*/ )
+{
+	vector<AsyncReadRequestPtr> requests(1, std::make_shared<AsyncReadRequest>(FindInGroup(file, group)));
+	mAsyncBackend->Submit(requests);
+	return requests.front();
+}
+
+void FileSystem::ReadFilesAsync( const vector<String>& files, const String& group, vector<AsyncReadRequestPtr>& requests )
+{
+	vector<AsyncReadRequestPtr> batch;
+	batch.reserve(files.size());
+
+	for (const String& file : files)
+		batch.push_back( std::make_shared<AsyncReadRequest>(FindInGroup(file, group)) );
+
+	mAsyncBackend->Submit(batch);
+	requests.insert(requests.end(), batch.begin(), batch.end());
+}
+
+void FileSystem::SubmitAsync( const vector<AsyncReadRequestPtr>& requests )
+{
+	mAsyncBackend->Submit(requests);
+}
+
 bool FileSystem::Exits( const String& name, const String& group/*="General"*/ )
 {
 	if (mResouceGroups.find(group) == mResouceGroups.end())
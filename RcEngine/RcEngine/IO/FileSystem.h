@@ -3,6 +3,7 @@
 
 #include <Core/Prerequisites.h>
 #include <Core/Singleton.h>
+#include <IO/AsyncFileIO.h>
 
 namespace RcEngine {
 
@@ -31,13 +32,32 @@ public:
 	String Locate(const String& file, const String& group="General");
 	shared_ptr<Stream> OpenStream(const String& file, const String& group="General");
 
+	/**
+	 * Read whole file asynchronously, return immediately. A file not found fails the request.
+	 */
+	AsyncReadRequestPtr ReadFileAsync(const String& file, const String& group="General");
+
+	/**
+	 * Submit reads of many files in one batch, keep read queue deep for streaming loaders.
+	 */
+	void ReadFilesAsync(const vector<String>& files, const String& group, vector<AsyncReadRequestPtr>& requests);
+
+	/// Submit prepared requests (e.g. partial reads) to async backend.
+	void SubmitAsync(const vector<AsyncReadRequestPtr>& requests);
+
+	const char* GetAsyncBackendName() const		{ return mAsyncBackend->GetName(); }
+
 private:
 	void ScanDirInternal(vector<String>& result, String path, const String& startPath,
 		const String& filter, unsigned flags, bool recursive);
 
+	String FindInGroup(const String& file, const String& group);
+
 private:
 	unordered_set<String> mAllowedPaths;
 	unordered_map<String, vector<String> > mResouceGroups;
+
+	shared_ptr<AsyncFileBackend> mAsyncBackend;
 	
 };
 
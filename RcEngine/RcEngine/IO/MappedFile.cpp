@@ -0,0 +1,105 @@
+#include <IO/MappedFile.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+namespace RcEngine {
+
+MappedFile::MappedFile()
+	: mFileHandle(nullptr),
+	  mMappingHandle(nullptr),
+	  mData(nullptr),
+	  mSize(0)
+{
+
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open( const String& fileName )
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	mFileHandle = hFile;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0 || fileSize.HighPart != 0)
+	{
+		Close();
+		return false;
+	}
+
+	mMappingHandle = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mMappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	mData = static_cast<const uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+	mSize = fileSize.LowPart;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0 || uint64_t(fileStat.st_size) > UINT32_MAX)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	mData = (data != MAP_FAILED) ? static_cast<const uint8_t*>(data) : nullptr;
+	mSize = uint32_t(fileStat.st_size);
+#endif
+
+	if (!mData)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (mData)
+		UnmapViewOfFile(mData);
+
+	if (mMappingHandle)
+		CloseHandle(mMappingHandle);
+
+	if (mFileHandle)
+		CloseHandle(mFileHandle);
+#else
+	if (mData)
+		munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+
+	mFileHandle = nullptr;
+	mMappingHandle = nullptr;
+	mData = nullptr;
+	mSize = 0;
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,37 @@
+#ifndef MappedFile_h__
+#define MappedFile_h__
+
+#include <Core/Prerequisites.h>
+
+namespace RcEngine {
+
+/**
+ * Read-only memory mapping of a whole file, pages are loaded on demand by the OS.
+ */
+class _ApiExport MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/// Return false if file can't be opened or is empty.
+	bool Open(const String& fileName);
+	void Close();
+
+	const uint8_t* GetData() const		{ return mData; }
+	uint32_t GetSize() const			{ return mSize; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator= (const MappedFile&);
+
+private:
+	void* mFileHandle;
+	void* mMappingHandle;
+	const uint8_t* mData;
+	uint32_t mSize;
+};
+
+} // Namespace RcEngine
+
+#endif // MappedFile_h__
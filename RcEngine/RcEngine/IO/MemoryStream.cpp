@@ -0,0 +1,115 @@
+#include <IO/MemoryStream.h>
+#include <Core/Exception.h>
+
+namespace RcEngine {
+
+MemoryStream::MemoryStream()
+	: mViewData(nullptr)
+{
+
+}
+
+MemoryStream::MemoryStream( const String& name, vector<uint8_t>& buffer )
+	: mName(name),
+	  mViewData(nullptr)
+{
+	mBuffer.swap(buffer);
+	mSize = mBuffer.size();
+}
+
+MemoryStream::MemoryStream( const String& name, const uint8_t* data, uint32_t size, const shared_ptr<void>& owner )
+	: mName(name),
+	  mViewData(data),
+	  mViewOwner(owner)
+{
+	mSize = size;
+}
+
+MemoryStream::~MemoryStream()
+{
+
+}
+
+uint32_t MemoryStream::Read( void* dest, uint32_t size )
+{
+	if (size + mPosition > mSize)
+		size = mSize - mPosition;
+
+	if (!size)
+		return 0;
+
+	memcpy(dest, GetData() + mPosition, size);
+	mPosition += size;
+
+	return size;
+}
+
+uint32_t MemoryStream::Write( const void* data, uint32_t size )
+{
+	if (!size)
+		return 0;
+
+	if (mViewOwner)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Memory view " + mName + " is read-only", "MemoryStream::Write");
+
+	if (mPosition + size > mBuffer.size())
+		mBuffer.resize(mPosition + size);
+
+	memcpy(&mBuffer[mPosition], data, size);
+
+	mPosition += size;
+	if (mPosition > mSize)
+		mSize = mPosition;
+
+	return size;
+}
+
+uint32_t MemoryStream::Seek( uint32_t position )
+{
+	if (position > mSize)
+		position = mSize;
+
+	mPosition = position;
+	return mPosition;
+}
+
+void MemoryStream::Close()
+{
+	vector<uint8_t>().swap(mBuffer);
+	mViewData = nullptr;
+	mViewOwner.reset();
+	mPosition = 0;
+	mSize = 0;
+}
+
+void MemoryStream::Flush()
+{
+
+}
+
+bool MemoryStream::ReadFrom( Stream& source )
+{
+	if (mName.empty())
+		mName = source.GetName();
+
+	uint32_t size = source.GetSize() - source.GetPosition();
+	if (!size)
+		return true;
+
+	if (mViewOwner)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Memory view " + mName + " is read-only", "MemoryStream::ReadFrom");
+
+	uint32_t offset = mBuffer.size();
+	mBuffer.resize(offset + size);
+
+	if (source.Read(&mBuffer[offset], size) != size)
+	{
+		mBuffer.resize(offset);
+		return false;
+	}
+
+	mSize = mBuffer.size();
+	return true;
+}
+
+} //Namespace RcEngine
@@ -0,0 +1,46 @@
+#ifndef MemoryStream_h__
+#define MemoryStream_h__
+
+#include <Core/Prerequisites.h>
+#include <IO/Stream.h>
+
+namespace RcEngine {
+
+/**
+ * Stream on a growable memory buffer, or read-only view of memory kept alive by an owner,
+ * e.g. a MappedFile.
+ */
+class _ApiExport MemoryStream : public Stream
+{
+public:
+	MemoryStream();
+	MemoryStream(const String& name, vector<uint8_t>& buffer);  // Swap buffer in, no copy
+	MemoryStream(const String& name, const uint8_t* data, uint32_t size, const shared_ptr<void>& owner);  // Read-only view
+	virtual ~MemoryStream();
+
+	virtual const String& GetName() const	{ return mName; }
+	virtual uint32_t Read(void* dest, uint32_t size);
+	virtual uint32_t Write(const void* data, uint32_t size);
+	virtual uint32_t Seek(uint32_t position);
+
+	virtual void Close();
+	virtual void Flush();
+
+	/**
+	 * Read remaining data of source stream into memory.
+	 */
+	bool ReadFrom(Stream& source);
+
+	const uint8_t* GetData() const			{ return mViewOwner ? mViewData : (mBuffer.empty() ? nullptr : &mBuffer[0]); }
+
+protected:
+	String mName;
+	vector<uint8_t> mBuffer;
+
+	const uint8_t* mViewData;
+	shared_ptr<void> mViewOwner;
+};
+
+} //Namespace RcEngine
+
+#endif // MemoryStream_h__
@@ -3,6 +3,7 @@
 #include <Graphics/Effect.h>
 #include <Graphics/Material.h>
 #include <Graphics/TextureResource.h>
+#include <Graphics/TextureStreamer.h>
 #include <Graphics/AnimationClip.h>
 #include <Graphics/Mesh.h>
 #include <Resource/ResourceManager.h>
@@ -11,6 +12,7 @@
 #include <Core/Exception.h>
 #include <Core/Profiler.h>
 #include <Core/XMLDom.h>
+#include <Core/ThreadPool.h>
 #include <IO/FileSystem.h>
 #include <IO/FileStream.h>
 #include <Input/InputSystem.h>
@@ -36,6 +38,7 @@ Application::Application( const String& config )
 	FileSystem::Initialize();
 	ResourceManager::Initialize();
 	ProfilerManager::Initialize();
+	ThreadPool::Initialize();
 	
 	// Init System Clock
 	SystemClock::InitClock();
@@ -78,6 +81,9 @@ void Application::RunGame()
 	} while ( !mEndGame );
 
 	UnloadContent();
+
+	// Waits for loader tasks, they hold textures which must go before resources
+	TextureStreamer::Finalize();
 }
 
 void Application::Tick()
@@ -118,6 +124,13 @@ void Application::Tick()
 
 	// render
 	Render();
+
+	// Mip requests were recorded while building render queues
+	if (TextureStreamer* streamer = TextureStreamer::GetSingletonPtr())
+		streamer->Update();
+
+	// Released resources are safe to destroy once frame is done
+	ResourceManager::GetSingleton().CollectReleased();
 }
 
 void Application::ProcessEventQueue()
@@ -202,6 +215,9 @@ void Application::Window_UserResized()
 		//Environment::GetSingleton().GetRHDevice()->Resize(width, height);	
 		//UIManager::GetSingleton().OnWindowResize(width, height);
 
+		if (TextureStreamer* streamer = TextureStreamer::GetSingletonPtr())
+			streamer->SetViewportHeight(height);
+
 		WindowResize(width, height);
 	}	
 }
@@ -290,6 +306,14 @@ void Application::LoadConfiguration()
 		mAppSettings.SyncInterval = node->AttributeUInt("Interval", 0);  
 	}
 
+	// Texture mips are streamed by demand if budget (MB) is set, all levels are loaded otherwise
+	node = graphicNode->FirstNode("TextureStreaming");
+	if (node)
+	{
+		uint64_t budget = uint64_t(node->AttributeUInt("Budget", 256)) * 1024 * 1024;
+		new TextureStreamer(budget, mAppSettings.Height);
+	}
+
 	node = appNode->FirstNode("RenderSystem");
 	if (node)
 	{
@@ -317,6 +341,22 @@ void Application::LoadConfiguration()
 			FileSystem::GetSingleton().RegisterPath(pathName, groupName);
 		}
 	}
+
+	// Alias table of cooked files stored once, must be loaded before any resource is added
+	String aliases = resNode->AttributeString("Aliases", "");
+	if (!aliases.empty() && FileSystem::GetSingleton().Exits(aliases, "General"))
+	{
+		shared_ptr<Stream> aliasStream = FileSystem::GetSingleton().OpenStream(aliases, "General");
+		ResourceManager::GetSingleton().LoadAliasTable(*aliasStream);
+	}
+
+	// Resource dependency manifest written by asset cooker, lets mesh loading prefetch materials, effects and textures
+	String manifest = resNode->AttributeString("Manifest", "Dependencies.bin");
+	if (!manifest.empty() && FileSystem::GetSingleton().Exits(manifest, "General"))
+	{
+		shared_ptr<Stream> manifestStream = FileSystem::GetSingleton().OpenStream(manifest, "General");
+		ResourceManager::GetSingleton().LoadDependencyManifest(*manifestStream);
+	}
 }
 
 
@@ -0,0 +1,103 @@
+#include <Resource/DependencyManifest.h>
+#include <IO/Stream.h>
+
+namespace RcEngine {
+
+namespace {
+
+String MakeEntryKey(uint32_t type, const String& name, const String& group)
+{
+	std::ostringstream oss;
+	oss << type << ':' << group << ':' << name;
+	return oss.str();
+}
+
+}
+
+uint32_t DependencyManifest::AddEntry( uint32_t type, const String& name, const String& group )
+{
+	auto inserted = mEntryIndices.insert(std::make_pair(MakeEntryKey(type, name, group), (uint32_t)mEntries.size()));
+	if (inserted.second)
+	{
+		Entry entry;
+		entry.Type = type;
+		entry.Name = name;
+		entry.Group = group;
+		mEntries.push_back(entry);
+	}
+
+	return inserted.first->second;
+}
+
+int32_t DependencyManifest::FindEntry( uint32_t type, const String& name, const String& group ) const
+{
+	auto found = mEntryIndices.find(MakeEntryKey(type, name, group));
+	return (found != mEntryIndices.end()) ? (int32_t)found->second : -1;
+}
+
+void DependencyManifest::AddDependency( uint32_t entry, uint32_t dependency )
+{
+	vector<uint32_t>& dependencies = mEntries[entry].Dependencies;
+	if (entry != dependency && std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+		dependencies.push_back(dependency);
+}
+
+void DependencyManifest::Clear()
+{
+	mEntries.clear();
+	mEntryIndices.clear();
+}
+
+bool DependencyManifest::Read( Stream& source )
+{
+	Clear();
+
+	if (source.ReadUInt() != FileId)
+		return false;
+
+	uint32_t numEntries = source.ReadUInt();
+
+	vector<vector<uint32_t> > dependencyIndices;
+	for (uint32_t i = 0; i < numEntries && !source.IsEof(); ++i)
+	{
+		uint32_t type = source.ReadUInt();
+		String name = source.ReadString();
+		String group = source.ReadString();
+
+		// Same entry twice keeps one index, dependencies are remapped below
+		dependencyIndices.push_back(vector<uint32_t>(1, AddEntry(type, name, group)));
+
+		uint32_t numDependencies = source.ReadUInt();
+		for (uint32_t j = 0; j < numDependencies && !source.IsEof(); ++j)
+			dependencyIndices.back().push_back(source.ReadUInt());
+	}
+
+	for (const vector<uint32_t>& indices : dependencyIndices)
+	{
+		for (size_t j = 1; j < indices.size(); ++j)
+		{
+			if (indices[j] < dependencyIndices.size())
+				AddDependency(indices[0], dependencyIndices[indices[j]][0]);
+		}
+	}
+
+	return true;
+}
+
+void DependencyManifest::Write( Stream& dest ) const
+{
+	dest.WriteUInt(FileId);
+	dest.WriteUInt(mEntries.size());
+	for (const Entry& entry : mEntries)
+	{
+		dest.WriteUInt(entry.Type);
+		dest.WriteString(entry.Name);
+		dest.WriteString(entry.Group);
+
+		dest.WriteUInt(entry.Dependencies.size());
+		for (uint32_t index : entry.Dependencies)
+			dest.WriteUInt(index);
+	}
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,55 @@
+#ifndef DependencyManifest_h__
+#define DependencyManifest_h__
+
+#include <Core/Prerequisites.h>
+
+namespace RcEngine {
+
+/**
+ * Resource dependency graph file, e.g. mesh -> material -> effect/texture. Written by importers
+ * at export time, merged by asset cooker and loaded by ResourceManager on startup, so the first
+ * load of a resource already knows its dependency closure.
+ *
+ * Entries of type RT_Undefined are source files, cooker uses them to detect changes of files
+ * referenced by a source asset. They are skipped by ResourceManager.
+ */
+class _ApiExport DependencyManifest
+{
+public:
+	static const uint32_t FileId = ('R' << 24) | ('D' << 16) | ('E' << 8) | ('P');
+
+	struct Entry
+	{
+		uint32_t Type;
+		String Name;
+		String Group;
+		vector<uint32_t> Dependencies;
+	};
+
+public:
+	/// Return index of existing entry if already added.
+	uint32_t AddEntry(uint32_t type, const String& name, const String& group);
+
+	/// Return -1 if not found.
+	int32_t FindEntry(uint32_t type, const String& name, const String& group) const;
+
+	void AddDependency(uint32_t entry, uint32_t dependency);
+
+	const vector<Entry>& GetEntries() const		{ return mEntries; }
+
+	void Clear();
+
+	/**
+	 * Return false if stream is not a dependency manifest, invalid dependency indices are dropped.
+	 */
+	bool Read(Stream& source);
+	void Write(Stream& dest) const;
+
+private:
+	vector<Entry> mEntries;
+	std::map<String, uint32_t> mEntryIndices;
+};
+
+} // Namespace RcEngine
+
+#endif // DependencyManifest_h__
@@ -36,14 +36,66 @@ void Resource::Touch()
 
 }
 
+void Resource::Prepare()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mLoadState != Unloaded)
+			return;
+		mLoadState = Preparing;
+	}
+
+	try 
+	{
+		PrepareImpl();
+	}
+	catch (...)
+	{
+		// Let a later Load retry and report
+		SetLoadState(Unloaded);
+		throw;
+	}
+
+	SetLoadState(Prepared);
+}
+
 void Resource::LoadSync()
 {
-	if (mLoadState == Unloaded)
 	{
-		SetLoadState(Loading);
+		std::unique_lock<std::mutex> lock(mMutex);
+		for (;;)
+		{
+			// Other thread prepares or loads, wait for its result
+			while (mLoadState == Preparing || mLoadState == Loading)
+				mStateCondition.wait(lock);
+
+			if (mLoadState == Prepared)
+				break;
+
+			if (mLoadState != Unloaded)
+				return;
+
+			// Prepare may find other thread started preparing, wait for it then
+			lock.unlock();
+			Prepare();
+			lock.lock();
+		}
+
+		mLoadState = Loading;
+	}
+
+	try 
+	{
 		LoadImpl();
-		SetLoadState(Loaded);
 	}
+	catch (...)
+	{
+		// Let a later Load prepare again and report
+		SetLoadState(Unloaded);
+		throw;
+	}
+
+	SetLoadState(Loaded);
 }
 
 void Resource::LoadAsync()
@@ -51,7 +103,7 @@ void Resource::LoadAsync()
 
 }
 
-Resource::LoadState Resource::GetLoadState()
+Resource::LoadState Resource::GetLoadState() const
 {
 	LoadState state;
 	
@@ -67,6 +119,8 @@ void Resource::SetLoadState( LoadState state )
 	mMutex.lock();
 	mLoadState = state;
 	mMutex.unlock();
+
+	mStateCondition.notify_all();
 }
 
 shared_ptr<Resource> Resource::Clone()
@@ -3,6 +3,7 @@
 
 #include <Core/Prerequisites.h>
 #include <mutex>
+#include <condition_variable>
 
 namespace RcEngine {
 
@@ -29,6 +30,8 @@ public:
 	enum LoadState
 	{
 		Unloaded,
+		Preparing,
+		Prepared,
 		Loading,
 		Loaded,
 		Unloading,
@@ -46,16 +49,28 @@ public:
 	uint32_t		GetSize() const						{ return mSize; }
 	uint32_t		GetResourceType() const				{ return mResourceType; }
 
+	/**
+	 * Do CPU side loading work (file IO, decompress, parsing), thread safe. Load() will
+	 * prepare first if not prepared, or wait while other thread prepares or loads.
+	 */
+	void Prepare();
 	void Load(bool background = false);
 	void Unload();
 	void Reload();
 	void Touch();
 
+	/**
+	 * Called by ResourceManager::LoadWithDependencies for each recorded dependency, before the
+	 * closure is prepared in parallel. Lets resource configure how a dependency loads.
+	 */
+	virtual void OnDependencyCollected(Resource& dependency)	{ }
+
 	void SetLoadState(LoadState state);
-	LoadState GetLoadState();
+	LoadState GetLoadState() const;
 
-	bool IsLoaded() const								{ return mLoadState == Loaded; }
-	bool IsLoading() const								{ return mLoadState == Loading; }
+	bool IsLoaded() const								{ return GetLoadState() == Loaded; }
+	bool IsPrepared() const								{ return GetLoadState() == Prepared; }
+	bool IsLoading() const								{ return GetLoadState() == Loading; }
 
 private:
 	void LoadSync();
@@ -63,6 +78,7 @@ private:
 
 protected:
 	
+	virtual void PrepareImpl()							{ }
 	virtual void LoadImpl() = 0;
 	virtual void UnloadImpl() = 0;
 
@@ -78,7 +94,9 @@ protected:
 	ResourceHandle mResourceHandle;
 	ResourceTypes mResourceType;
 
-	std::mutex mMutex; 
+	// Guards load state, waiters are notified on every state change
+	mutable std::mutex mMutex; 
+	std::condition_variable mStateCondition;
 };
 
 }
@@ -1,24 +1,22 @@
 #include <Resource/ResourceManager.h>
+#include <Resource/DependencyManifest.h>
 #include <IO/FileSystem.h>
+#include <IO/Stream.h>
 #include <Core/Exception.h>
+#include <Core/ThreadPool.h>
+#include <exception>
 
 namespace RcEngine {
 
 ResourceManager::ResourceManager()
-: mNextHandle(1)
 {
 
 }
 
 ResourceManager::~ResourceManager()
 {
-	mResourcesByHandle.clear();
-}
-
-
-ResourceHandle ResourceManager::GetNextHandle()
-{
-	return mNextHandle ++;
+	UnLoadAll();
+	CollectReleased();
 }
 
 void ResourceManager::RegisterType( uint32_t type, const String& typeString, ResTypeFactoryFunc factoryFunc )
@@ -38,36 +36,34 @@ void ResourceManager::RegisterType( uint32_t type, const String& typeString, Res
 
 void ResourceManager::AddResourceGroup( const String& groupName )
 {
-	if (mResourcesWithGroup.find(groupName) == mResourcesWithGroup.end())
+	std::lock_guard<std::mutex> lock(mWriterMutex);
+
+	if (mResourceGroups.find(groupName) == mResourceGroups.end())
 	{
-		mResourcesWithGroup.insert(std::make_pair(groupName, ResourceGroup()));
+		mResourceGroups.insert(std::make_pair(groupName, ResourceGroup()));
 	}
 }
 
-ResourceHandle ResourceManager::AddResource( uint32_t type, const String& name, const String& group )
+ResourceHandle ResourceManager::AddResource( uint32_t type, const String& aliasName, const String& group )
 {
-	ResourceHandle retVal = 0;
-
-	unordered_map<String, ResourceGroup>::iterator groupIter;
-	groupIter = mResourcesWithGroup.find(group);
+	String name = ResolveAlias(aliasName);
 
-	if (groupIter != mResourcesWithGroup.end())
-	{
-		ResourceGroup& resourceGroup = groupIter->second;
+	ResourceHandle retVal = mResourceNames.Find(name, group);
+	if (retVal)
+		return retVal;
 
-		auto resIter = resourceGroup.Resources.find(name);
+	std::lock_guard<std::mutex> lock(mWriterMutex);
 
-		if (resIter != resourceGroup.Resources.end())
-			retVal = resIter->second->GetResourceHandle();
-		else
-			retVal = AddNonExitingResource(type, name, group);
-	}
-	else
+	// Another thread may have added it
+	retVal = mResourceNames.Find(name, group);
+	if (!retVal)
 	{
+		if (mResourceGroups.find(group) == mResourceGroups.end())
+			mResourceGroups.insert(std::make_pair(group, ResourceGroup()));
+
 		retVal = AddNonExitingResource(type, name, group);
 	}
 
-
 	return retVal;
 }
 
@@ -82,47 +78,46 @@ ResourceHandle ResourceManager::AddNonExitingResource( uint32_t type, const Stri
 		ENGINE_EXCEPT(Exception::ERR_ITEM_NOT_FOUND, "Resource type factory not found", "ResourceManager::AddNonExitingResouce");
 	}
 
-	retVal = GetNextHandle();
+	retVal = mResources.Allocate();
 
 	shared_ptr<Resource> resource = (factoryIter->second.FactoryFunc)(this, retVal, name, group);
 
-	mResourcesWithGroup[group].Resources.insert( std::make_pair(name, resource) );
-	mResourcesByHandle.insert( std::make_pair(retVal, resource) );
+	// Publish handle before name, a reader finding the name always finds the resource
+	mResources.Publish(retVal, resource);
+	mResourceNames.Insert(name, group, retVal);
 
 	return retVal;
 }
 
 	
-shared_ptr<Resource> ResourceManager::GetResourceByName( uint32_t type, const String& name, const String& group )
+shared_ptr<Resource> ResourceManager::GetResourceByName( uint32_t type, const String& aliasName, const String& group )
 {
-	shared_ptr<Resource> retVal = nullptr;
+	String name = ResolveAlias(aliasName);
 
-	auto groupIter = mResourcesWithGroup.find(group);
+	shared_ptr<Resource> retVal = mResources.FindShared( mResourceNames.Find(name, group) );
 
-	if (groupIter == mResourcesWithGroup.end())
+	if (!retVal)
 	{
-		String err = "Resource Group: " + group + " doesn't exit";
-		ENGINE_EXCEPT(Exception::ERR_ITEM_NOT_FOUND, err , "ResourceManager::GetResourceByName");
-	}
-
-
-	ResourceGroup& resourceGroup = groupIter->second;
-
-	auto resIter = resourceGroup.Resources.find(name);
+		std::lock_guard<std::mutex> lock(mWriterMutex);
 
-	if (resIter != resourceGroup.Resources.end())
-	{
-		if (resIter->second->GetResourceType() == type)
+		if (mResourceGroups.find(group) == mResourceGroups.end())
 		{
-			retVal = resIter->second;
+			String err = "Resource Group: " + group + " doesn't exit";
+			ENGINE_EXCEPT(Exception::ERR_ITEM_NOT_FOUND, err , "ResourceManager::GetResourceByName");
 		}
+
+		// Another thread may have added it
+		ResourceHandle handle = mResourceNames.Find(name, group);
+		if (!handle)
+			handle = AddNonExitingResource(type, name, group);
+
+		retVal = mResources.FindShared(handle);
 	}
-	else
-	{
-		ResourceHandle newResHandle = AddNonExitingResource(type, name, group);
-		retVal = GetResourceByHandle(newResHandle);
-	}
 
+	if (retVal && retVal->GetResourceType() != type)
+		return nullptr;
+
+	// Loading may look up other resources, never hold the writer lock here
 	if (retVal && retVal->IsLoaded() == false)
 		retVal->Load();
 
@@ -132,13 +127,7 @@ shared_ptr<Resource> ResourceManager::GetResourceByName( uint32_t type, const St
 
 shared_ptr<Resource> ResourceManager::GetResourceByHandle( ResourceHandle handle )
 {
-	shared_ptr<Resource> retVal = nullptr;
-
-	auto found = mResourcesByHandle.find(handle);
-	if (found != mResourcesByHandle.end())
-	{
-		retVal =  found->second;
-	}
+	shared_ptr<Resource> retVal = mResources.FindShared(handle);
 
 	if (retVal && retVal->IsLoaded() == false)
 		retVal->Load();
@@ -149,25 +138,233 @@ shared_ptr<Resource> ResourceManager::GetResourceByHandle( ResourceHandle handle
 
 void ResourceManager::LoadAllFromDisk()
 {
-	for (auto iter = mResourcesByHandle.begin(); iter != mResourcesByHandle.end(); ++iter)
+	vector<shared_ptr<Resource> > resources;
+	{
+		std::lock_guard<std::mutex> lock(mWriterMutex);
+		mResources.GetResources(resources);
+	}
+
+	for (const shared_ptr<Resource>& resource : resources)
+	{
+		resource->Load();
+	}
+}
+
+void ResourceManager::AddDependency( ResourceHandle resource, ResourceHandle dependency )
+{
+	std::lock_guard<std::mutex> lock(mWriterMutex);
+
+	vector<ResourceHandle>& dependencies = mDependencies[resource];
+	if (std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+		dependencies.push_back(dependency);
+}
+
+vector<ResourceHandle> ResourceManager::GetDependencies( ResourceHandle resource ) const
+{
+	std::lock_guard<std::mutex> lock(mWriterMutex);
+
+	auto found = mDependencies.find(resource);
+	if (found != mDependencies.end())
+		return found->second;
+
+	return vector<ResourceHandle>();
+}
+
+void ResourceManager::CollectDependencies( ResourceHandle handle, std::unordered_set<ResourceHandle>& visited, vector<shared_ptr<Resource> >& closure )
+{
+	if (visited.insert(handle).second == false)
+		return;
+
+	auto found = mDependencies.find(handle);
+	if (found != mDependencies.end())
+	{
+		for (ResourceHandle dependency : found->second)
+			CollectDependencies(dependency, visited, closure);
+	}
+
+	shared_ptr<Resource> resource = mResources.FindShared(handle);
+	if (resource)
+		closure.push_back(resource);
+}
+
+shared_ptr<Resource> ResourceManager::LoadWithDependencies( uint32_t type, const String& name, const String& group )
+{
+	ResourceHandle handle = AddResource(type, name, group);
+
+	// Dependencies come before the resource depends on them
+	std::unordered_set<ResourceHandle> visited;
+	vector<shared_ptr<Resource> > closure;
+	{
+		std::lock_guard<std::mutex> lock(mWriterMutex);
+		CollectDependencies(handle, visited, closure);
+
+		// Dependents decide how dependencies load before any is prepared, e.g. streamed textures
+		for (const shared_ptr<Resource>& resource : closure)
+		{
+			auto found = mDependencies.find(resource->GetResourceHandle());
+			if (found == mDependencies.end())
+				continue;
+
+			for (ResourceHandle dependency : found->second)
+			{
+				if (Resource* dependencyResource = mResources.Find(dependency))
+					resource->OnDependencyCollected(*dependencyResource);
+			}
+		}
+	}
+
+	// File IO and decoding of the whole closure in parallel, errors are reported on calling thread
+	vector<std::exception_ptr> prepareErrors(closure.size());
+	ParallelFor(0, closure.size(), [&](uint32_t i) {
+		try 
+		{
+			closure[i]->Prepare();
+		}
+		catch (...)
+		{
+			prepareErrors[i] = std::current_exception();
+		}
+	});
+
+	// Graphics resource creation must be on the calling thread
+	for (size_t i = 0; i < closure.size(); ++i)
+	{
+		if (prepareErrors[i])
+			std::rethrow_exception(prepareErrors[i]);
+
+		if (closure[i]->IsLoaded() == false)
+			closure[i]->Load();
+	}
+
+	return closure.back();
+}
+
+void ResourceManager::SaveDependencyManifest( Stream& dest )
+{
+	DependencyManifest manifest;
 	{
-		iter->second->Load();
+		std::lock_guard<std::mutex> lock(mWriterMutex);
+
+		// Only resources in dependency graph
+		auto AddEntry = [&](ResourceHandle handle) -> int32_t {
+			Resource* resource = mResources.Find(handle);
+			if (!resource)
+				return -1;
+			return (int32_t)manifest.AddEntry(resource->GetResourceType(), resource->GetResourceName(), resource->GetResourceGroup());
+		};
+
+		for (auto& kv : mDependencies)
+		{
+			int32_t entry = AddEntry(kv.first);
+			if (entry < 0)
+				continue;
+
+			for (ResourceHandle dependency : kv.second)
+			{
+				int32_t dependencyEntry = AddEntry(dependency);
+				if (dependencyEntry >= 0)
+					manifest.AddDependency(entry, dependencyEntry);
+			}
+		}
 	}
+
+	manifest.Write(dest);
+}
+
+void ResourceManager::LoadDependencyManifest( Stream& source )
+{
+	DependencyManifest manifest;
+	if (!manifest.Read(source))
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid dependency manifest", "ResourceManager::LoadDependencyManifest");
+
+	const vector<DependencyManifest::Entry>& entries = manifest.GetEntries();
+
+	// Source file entries are for asset cooker only
+	vector<ResourceHandle> handles(entries.size(), 0);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].Type != RT_Undefined && mRegistry.count(entries[i].Type))
+			handles[i] = AddResource(entries[i].Type, entries[i].Name, entries[i].Group);
+	}
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (!handles[i])
+			continue;
+
+		for (uint32_t index : entries[i].Dependencies)
+		{
+			if (handles[index])
+				AddDependency(handles[i], handles[index]);
+		}
+	}
+}
+
+void ResourceManager::LoadAliasTable( Stream& source )
+{
+	const uint32_t AliasTableId = ('R' << 24) | ('A' << 16) | ('L' << 8) | ('S');
+
+	if (source.ReadUInt() != AliasTableId)
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Invalid alias table", "ResourceManager::LoadAliasTable");
+
+	uint32_t numAliases = source.ReadUInt();
+	for (uint32_t i = 0; i < numAliases; ++i)
+	{
+		String alias = source.ReadString();
+		String name = source.ReadString();
+		AddAlias(alias, name);
+	}
+}
+
+void ResourceManager::AddAlias( const String& alias, const String& name )
+{
+	if (alias != name)
+		mAliases[alias] = name;
+}
+
+String ResourceManager::ResolveAlias( const String& name ) const
+{
+	if (mAliases.empty())
+		return name;
+
+	// Effect and material names may have flags after file name, e.g. "Box.material.xml _QuantizedVertex"
+	size_t flagsPos = name.find(" _");
+
+	auto found = mAliases.find(name.substr(0, flagsPos));
+	if (found == mAliases.end())
+		return name;
+
+	return (flagsPos == String::npos) ? found->second : found->second + name.substr(flagsPos);
 }
 
 void ResourceManager::ReleaseResource( ResourceHandle handle )
 {
-	auto it = mResourcesByHandle.find(handle);
-	if (it != mResourcesByHandle.end())
+	std::lock_guard<std::mutex> lock(mWriterMutex);
+
+	Resource* resource = mResources.Find(handle);
+	if (resource)
 	{
-		//mResourcesByHandle[handle] = NULL;
-		mResourcesByHandle.erase(it);
+		mResourceNames.Remove(resource->GetResourceName(), resource->GetResourceGroup());
+		mResources.Release(handle);
+		mDependencies.erase(handle);
 	}
 }
 
 void ResourceManager::UnLoadAll()
 {
-	mResourcesByHandle.clear();
+	std::lock_guard<std::mutex> lock(mWriterMutex);
+
+	mResourceNames.Clear();
+	mResources.Clear();
+	mDependencies.clear();
+}
+
+void ResourceManager::CollectReleased()
+{
+	std::lock_guard<std::mutex> lock(mWriterMutex);
+
+	mResourceNames.CollectReleased();
+	mResources.CollectReleased();
 }
 
 }
\ No newline at end of file
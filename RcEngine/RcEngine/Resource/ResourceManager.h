@@ -4,6 +4,8 @@
 #include <Core/Prerequisites.h>
 #include <Core/Singleton.h>
 #include <Resource/Resource.h>
+#include <Resource/ResourceTable.h>
+#include <mutex>
 
 namespace RcEngine {
 
@@ -30,7 +32,6 @@ public:
 		unsigned MemoryBudget;
 
 		unsigned MemoryUse;
-		unordered_map<String, shared_ptr<Resource> > Resources;
 	};
 
 
@@ -51,18 +52,63 @@ public:
 
 	void LoadAllFromDisk();
 
+	/**
+	 * Record resource depends on dependency, e.g. mesh -> material -> effect/texture.
+	 */
+	void AddDependency(ResourceHandle resource, ResourceHandle dependency);
+	vector<ResourceHandle> GetDependencies(ResourceHandle resource) const;
+
+	/**
+	 * Load resource with all its recorded dependencies. Each resource of the closure is told of
+	 * its dependencies first (see Resource::OnDependencyCollected), then CPU side loading of the
+	 * whole closure is done in parallel and resources are created dependencies first.
+	 */
+	shared_ptr<Resource> LoadWithDependencies(uint32_t type, const String& name, const String& group);
+
+	/**
+	 * Dependency manifest (see DependencyManifest), written by asset cooker from importer
+	 * exports or saved from recorded dependencies after a run. Loaded on startup, so the first
+	 * load of a resource already knows its dependency closure.
+	 */
+	void SaveDependencyManifest(Stream& dest);
+	void LoadDependencyManifest(Stream& source);
+
+	/**
+	 * Alias table written by asset cooker, identical cooked files are stored once and other
+	 * names are aliases of it. Aliased names resolve to the stored name, so they share one loaded
+	 * instance. Load before resources are added, aliases are not locked. Flags after the file
+	 * name of effect and material names are kept.
+	 */
+	void LoadAliasTable(Stream& source);
+	void AddAlias(const String& alias, const String& name);
+	String ResolveAlias(const String& name) const;
+
 	void ReleaseResource(ResourceHandle handle);
 	void UnLoadAll();
 
+	/**
+	 * Destroy released resources, e.g. once per frame on main thread. Lookups are lock free,
+	 * this waits until lookups in progress on other threads are done.
+	 */
+	void CollectReleased();
+
 protected:
+	/// Must hold mWriterMutex.
 	ResourceHandle AddNonExitingResource(uint32_t type, const String& name, const String& group);
-	ResourceHandle GetNextHandle();  
+
+	void CollectDependencies(ResourceHandle handle, std::unordered_set<ResourceHandle>& visited, vector<shared_ptr<Resource> >& closure);
 
 protected:	
-	uint32_t mNextHandle;
 	std::map<int, ResourceRegEntry>  mRegistry;  // Registry of resource type
-	std::map<ResourceHandle, shared_ptr<Resource> > mResourcesByHandle;
-	unordered_map<String, ResourceGroup> mResourcesWithGroup;
+
+	// Lookups are lock free, insert and release are serialized by writer mutex
+	ResourceSlotArray mResources;
+	ResourceNameIndex mResourceNames;
+	mutable std::mutex mWriterMutex;
+
+	unordered_map<String, ResourceGroup> mResourceGroups;
+	unordered_map<ResourceHandle, vector<ResourceHandle> > mDependencies;
+	unordered_map<String, String> mAliases;
 	
 };
 
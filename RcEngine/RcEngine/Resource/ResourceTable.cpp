@@ -0,0 +1,335 @@
+#include <Resource/ResourceTable.h>
+#include <Core/Exception.h>
+#include <thread>
+
+namespace RcEngine {
+
+namespace {
+
+/**
+ * Count a lookup in progress. The fence pairs with the one in WaitForReaders: a writer which
+ * doesn't see the count sees no lookup that could still reach what it unlinked before.
+ */
+struct ReaderScope
+{
+	ReaderScope(std::atomic<uint32_t>& readers) : Readers(readers)
+	{
+		Readers.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	~ReaderScope()
+	{
+		Readers.fetch_sub(1, std::memory_order_release);
+	}
+
+	std::atomic<uint32_t>& Readers;
+
+private:
+	ReaderScope& operator=(const ReaderScope&);
+};
+
+// Lookups are short, spin until those started before retiring are done
+void WaitForReaders(const std::atomic<uint32_t>& readers)
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while (readers.load(std::memory_order_acquire) != 0)
+		std::this_thread::yield();
+}
+
+}
+
+ResourceSlotArray::ResourceSlotArray()
+	: mNumSlots(0)
+{
+	mActiveReaders.store(0, std::memory_order_relaxed);
+	for (uint32_t i = 0; i < MaxChunks; ++i)
+		mChunks[i].store(nullptr, std::memory_order_relaxed);
+}
+
+ResourceSlotArray::~ResourceSlotArray()
+{
+	Clear();
+	CollectReleased();
+
+	for (uint32_t i = 0; i < MaxChunks; ++i)
+		delete[] mChunks[i].load(std::memory_order_relaxed);
+}
+
+ResourceSlotArray::Slot* ResourceSlotArray::GetSlot( uint32_t index ) const
+{
+	Slot* chunk = mChunks[index >> ChunkBits].load(std::memory_order_acquire);
+	return chunk ? &chunk[index & (ChunkSize - 1)] : nullptr;
+}
+
+Resource* ResourceSlotArray::Find( ResourceHandle handle ) const
+{
+	Slot* slot = GetSlot(handle & IndexMask);
+	if (slot && handle && slot->Handle.load(std::memory_order_acquire) == handle)
+		return slot->Resource.get();
+
+	return nullptr;
+}
+
+shared_ptr<Resource> ResourceSlotArray::FindShared( ResourceHandle handle ) const
+{
+	// Slot resource isn't reset or reused while counted
+	ReaderScope reader(mActiveReaders);
+
+	Slot* slot = GetSlot(handle & IndexMask);
+	if (slot && handle && slot->Handle.load(std::memory_order_acquire) == handle)
+		return slot->Resource;
+
+	return shared_ptr<Resource>();
+}
+
+ResourceHandle ResourceSlotArray::Allocate()
+{
+	uint32_t index;
+	if (!mFreeSlots.empty())
+	{
+		index = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		if (mNumSlots > IndexMask)
+			ENGINE_EXCEPT(Exception::ERR_INVALID_STATE, "Resource handle exhausted", "ResourceSlotArray::Allocate");
+
+		index = mNumSlots++;
+		uint32_t chunk = index >> ChunkBits;
+		if (mChunks[chunk].load(std::memory_order_relaxed) == nullptr)
+			mChunks[chunk].store(new Slot[ChunkSize], std::memory_order_release);
+	}
+
+	Slot* slot = GetSlot(index);
+
+	// Generation 0 is never used, so a valid handle is never 0
+	slot->Generation = (slot->Generation % GenerationMask) + 1;
+	return (slot->Generation << IndexBits) | index;
+}
+
+void ResourceSlotArray::Publish( ResourceHandle handle, const shared_ptr<Resource>& resource )
+{
+	Slot* slot = GetSlot(handle & IndexMask);
+	assert(slot && slot->Handle.load(std::memory_order_relaxed) == 0);
+
+	slot->Resource = resource;
+	slot->Handle.store(handle, std::memory_order_release);
+}
+
+bool ResourceSlotArray::Release( ResourceHandle handle )
+{
+	Slot* slot = GetSlot(handle & IndexMask);
+	if (!slot || !handle || slot->Handle.load(std::memory_order_relaxed) != handle)
+		return false;
+
+	slot->Handle.store(0, std::memory_order_release);
+
+	// Reader may still hold the raw pointer, keep it alive until collected
+	mReleasedResources.push_back(slot->Resource);
+	mReleasedSlots.push_back(handle & IndexMask);
+	return true;
+}
+
+void ResourceSlotArray::CollectReleased()
+{
+	if (mReleasedSlots.empty())
+		return;
+
+	// Lookups started before release may still copy slot resource
+	WaitForReaders(mActiveReaders);
+
+	for (uint32_t index : mReleasedSlots)
+	{
+		GetSlot(index)->Resource.reset();
+		mFreeSlots.push_back(index);
+	}
+
+	mReleasedSlots.clear();
+	mReleasedResources.clear();
+}
+
+void ResourceSlotArray::Clear()
+{
+	for (uint32_t i = 0; i < mNumSlots; ++i)
+	{
+		Slot* slot = GetSlot(i);
+		ResourceHandle handle = slot->Handle.load(std::memory_order_relaxed);
+		if (handle)
+			Release(handle);
+	}
+}
+
+void ResourceSlotArray::GetResources( vector<shared_ptr<Resource> >& resources ) const
+{
+	for (uint32_t i = 0; i < mNumSlots; ++i)
+	{
+		Slot* slot = GetSlot(i);
+		if (slot->Handle.load(std::memory_order_relaxed))
+			resources.push_back(slot->Resource);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+ResourceNameIndex::ResourceNameIndex()
+	: mNumNodes(0)
+{
+	mActiveReaders.store(0, std::memory_order_relaxed);
+	mTable.store(CreateTable(256), std::memory_order_relaxed);
+}
+
+ResourceNameIndex::~ResourceNameIndex()
+{
+	Clear();
+	CollectReleased();
+
+	Table* table = mTable.load(std::memory_order_relaxed);
+	delete[] table->Buckets;
+	delete table;
+}
+
+size_t ResourceNameIndex::Hash( const String& name, const String& group )
+{
+	std::hash<String> hasher;
+	return hasher(name) * 31 ^ hasher(group);
+}
+
+ResourceNameIndex::Table* ResourceNameIndex::CreateTable( uint32_t numBuckets )
+{
+	Table* table = new Table;
+	table->NumBuckets = numBuckets;
+	table->Buckets = new std::atomic<Node*>[numBuckets];
+	for (uint32_t i = 0; i < numBuckets; ++i)
+		table->Buckets[i].store(nullptr, std::memory_order_relaxed);
+
+	return table;
+}
+
+ResourceHandle ResourceNameIndex::Find( const String& name, const String& group ) const
+{
+	size_t hash = Hash(name, group);
+
+	// Retired nodes and tables aren't deleted while counted
+	ReaderScope reader(mActiveReaders);
+
+	Table* table = mTable.load(std::memory_order_acquire);
+	Node* node = table->Buckets[hash & (table->NumBuckets - 1)].load(std::memory_order_acquire);
+	while (node)
+	{
+		if (node->Hash == hash && node->Name == name && node->Group == group)
+			return node->Handle;
+
+		node = node->Next.load(std::memory_order_acquire);
+	}
+
+	return 0;
+}
+
+void ResourceNameIndex::Insert( const String& name, const String& group, ResourceHandle handle )
+{
+	if (mNumNodes >= mTable.load(std::memory_order_relaxed)->NumBuckets)
+		Grow();
+
+	Node* node = new Node;
+	node->Name = name;
+	node->Group = group;
+	node->Hash = Hash(name, group);
+	node->Handle = handle;
+
+	Table* table = mTable.load(std::memory_order_relaxed);
+	std::atomic<Node*>& bucket = table->Buckets[node->Hash & (table->NumBuckets - 1)];
+
+	// Node is complete before it becomes reachable
+	node->Next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	bucket.store(node, std::memory_order_release);
+
+	mNumNodes++;
+}
+
+void ResourceNameIndex::Remove( const String& name, const String& group )
+{
+	size_t hash = Hash(name, group);
+
+	Table* table = mTable.load(std::memory_order_relaxed);
+	std::atomic<Node*>* link = &table->Buckets[hash & (table->NumBuckets - 1)];
+
+	for (Node* node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed))
+	{
+		if (node->Hash == hash && node->Name == name && node->Group == group)
+		{
+			// Unlink, a reader standing on node still walks a valid chain
+			link->store(node->Next.load(std::memory_order_relaxed), std::memory_order_release);
+			mRetiredNodes.push_back(node);
+			mNumNodes--;
+			return;
+		}
+
+		link = &node->Next;
+	}
+}
+
+void ResourceNameIndex::Grow()
+{
+	Table* oldTable = mTable.load(std::memory_order_relaxed);
+	Table* newTable = CreateTable(oldTable->NumBuckets * 2);
+
+	// Readers may still walk old nodes, so copy instead of relinking
+	for (uint32_t i = 0; i < oldTable->NumBuckets; ++i)
+	{
+		for (Node* node = oldTable->Buckets[i].load(std::memory_order_relaxed); node; node = node->Next.load(std::memory_order_relaxed))
+		{
+			Node* copy = new Node;
+			copy->Name = node->Name;
+			copy->Group = node->Group;
+			copy->Hash = node->Hash;
+			copy->Handle = node->Handle;
+
+			std::atomic<Node*>& bucket = newTable->Buckets[copy->Hash & (newTable->NumBuckets - 1)];
+			copy->Next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			bucket.store(copy, std::memory_order_relaxed);
+
+			mRetiredNodes.push_back(node);
+		}
+	}
+
+	mTable.store(newTable, std::memory_order_release);
+	mRetiredTables.push_back(oldTable);
+}
+
+void ResourceNameIndex::CollectReleased()
+{
+	if (mRetiredNodes.empty() && mRetiredTables.empty())
+		return;
+
+	// Lookups started before retiring may still walk retired nodes
+	WaitForReaders(mActiveReaders);
+
+	for (Node* node : mRetiredNodes)
+		delete node;
+	mRetiredNodes.clear();
+
+	for (Table* table : mRetiredTables)
+	{
+		delete[] table->Buckets;
+		delete table;
+	}
+	mRetiredTables.clear();
+}
+
+void ResourceNameIndex::Clear()
+{
+	Table* table = mTable.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < table->NumBuckets; ++i)
+	{
+		Node* node = table->Buckets[i].load(std::memory_order_relaxed);
+		table->Buckets[i].store(nullptr, std::memory_order_release);
+
+		for (; node; node = node->Next.load(std::memory_order_relaxed))
+			mRetiredNodes.push_back(node);
+	}
+
+	mNumNodes = 0;
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,134 @@
+#ifndef ResourceTable_h__
+#define ResourceTable_h__
+
+#include <Core/Prerequisites.h>
+#include <Resource/Resource.h>
+#include <atomic>
+
+namespace RcEngine {
+
+/**
+ * Generational slot array of resources indexed by handle.
+ *
+ * Handle = Generation << IndexBits | Index, a released handle never matches the slot again.
+ * Lookup is lock free and can run on any thread while one writer (serialized by the owner)
+ * inserts or releases. Slots are allocated in chunks which never move, released resources
+ * are retired and only destroyed and reused in CollectReleased, which waits until lookups
+ * in progress are done.
+ */
+class _ApiExport ResourceSlotArray
+{
+public:
+	static const uint32_t IndexBits = 20;
+	static const uint32_t IndexMask = (1U << IndexBits) - 1;
+	static const uint32_t GenerationMask = (1U << (32 - IndexBits)) - 1;
+
+	static const uint32_t ChunkBits = 10;
+	static const uint32_t ChunkSize = 1U << ChunkBits;
+	static const uint32_t MaxChunks = 1U << (IndexBits - ChunkBits);
+
+public:
+	ResourceSlotArray();
+	~ResourceSlotArray();
+
+	/// Writer only, return nullptr if handle is not valid.
+	Resource* Find(ResourceHandle handle) const;
+
+	/// Lock free, any thread.
+	shared_ptr<Resource> FindShared(ResourceHandle handle) const;
+
+	/**
+	 * Writer only. Reserve a new handle, the resource is visible after Publish.
+	 */
+	ResourceHandle Allocate();
+	void Publish(ResourceHandle handle, const shared_ptr<Resource>& resource);
+	bool Release(ResourceHandle handle);
+
+	/// Writer only. Wait for lookups in progress, destroy released resources and recycle their slots.
+	void CollectReleased();
+	/// Writer only. Release all resources.
+	void Clear();
+
+	/// Writer only. Get all live resources.
+	void GetResources(vector<shared_ptr<Resource> >& resources) const;
+
+private:
+	struct Slot
+	{
+		Slot() : Handle(0), Generation(0) {}
+
+		std::atomic<ResourceHandle> Handle;	  // Handle currently live in slot, 0 if empty
+		uint32_t Generation;
+		shared_ptr<Resource> Resource;
+	};
+
+	Slot* GetSlot(uint32_t index) const;
+
+private:
+	std::atomic<Slot*> mChunks[MaxChunks];
+
+	// FindShared calls in progress
+	mutable std::atomic<uint32_t> mActiveReaders;
+
+	uint32_t mNumSlots;
+	vector<uint32_t> mFreeSlots;
+	vector<uint32_t> mReleasedSlots;
+	vector<shared_ptr<Resource> > mReleasedResources;
+};
+
+/**
+ * Hashed (group, name) -> handle index. Find is lock free while one writer inserts or removes.
+ * Nodes are immutable once linked, removed nodes and old tables after growing are retired
+ * until CollectReleased, which waits until lookups in progress are done.
+ */
+class _ApiExport ResourceNameIndex
+{
+public:
+	ResourceNameIndex();
+	~ResourceNameIndex();
+
+	/// Lock free, return 0 if not found.
+	ResourceHandle Find(const String& name, const String& group) const;
+
+	/// Writer only.
+	void Insert(const String& name, const String& group, ResourceHandle handle);
+	void Remove(const String& name, const String& group);
+
+	void CollectReleased();
+	void Clear();
+
+private:
+	struct Node
+	{
+		String Name;
+		String Group;
+		size_t Hash;
+		ResourceHandle Handle;
+		std::atomic<Node*> Next;
+	};
+
+	struct Table
+	{
+		uint32_t NumBuckets;
+		std::atomic<Node*>* Buckets;
+	};
+
+	static size_t Hash(const String& name, const String& group);
+	static Table* CreateTable(uint32_t numBuckets);
+
+	void Grow();
+
+private:
+	std::atomic<Table*> mTable;
+	uint32_t mNumNodes;
+
+	// Find calls in progress
+	mutable std::atomic<uint32_t> mActiveReaders;
+
+	vector<Table*> mRetiredTables;
+	vector<Node*> mRetiredNodes;
+};
+
+} // Namespace RcEngine
+
+#endif // ResourceTable_h__
@@ -12,6 +12,7 @@
 #include <Graphics/Animation.h>
 #include <Graphics/AnimationState.h>
 #include <Graphics/RenderQueue.h>
+#include <Graphics/TextureStreamer.h>
 #include <Core/Environment.h>
 #include <Core/Exception.h>
 #include <IO/PathUtil.h>
@@ -25,6 +26,7 @@ Entity::Entity( const String& name, const shared_ptr<Mesh>& mesh )
 	mNumSkinMatrices(0), 
 	mMesh(mesh), 
 	mAnimationPlayer(nullptr),
+	mStatic(false),
 	mSkeleton( mesh->GetSkeleton() ? mesh->GetSkeleton()->Clone() : 0 )
 {
 	Initialize();
@@ -53,7 +55,6 @@ Entity::~Entity()
 void Entity::Initialize()
 {
 	const String& meshGroup = mMesh->GetResourceGroup();
-	String meshDirectory = PathUtil::GetPath(mMesh->GetResourceName()); 
 
 	for (uint32_t i = 0; i < mMesh->GetNumMeshPart(); ++i)
 	{
@@ -61,7 +62,8 @@ void Entity::Initialize()
 		
 		SubEntity* subEnt = new SubEntity(this, meshPart);
 
-		String matResName = meshDirectory + meshPart->GetMaterialName();
+		// Same material resource mesh depends on, with effect flags of part vertex layout
+		const String& matResName = meshPart->GetMaterialResourceName();
 		subEnt->SetMaterial( ResourceManager::GetSingleton().GetResourceByName<Material>(RT_Material, matResName, meshGroup) );
 
 		mSubEntityList.push_back( subEnt );
@@ -136,14 +138,28 @@ AnimationPlayer* Entity::GetAnimationPlayer()
 
 void Entity::OnUpdateRenderQueue(RenderQueue* renderQueue, const Camera& camera, RenderOrder order)
 {
-	// Add each visible SubEntity to the queue
+	// Add each visible SubEntity to the queue, batched ones are queued by their static batch
 	for (SubEntity* subEntity : mSubEntityList)
 	{
+		if (subEntity->GetStaticBatch())
+			continue;
+
 		BoundingBoxf subWorldBoud = Transform(subEntity->GetBoundingBox(), mParentNode->GetWorldTransform());
 
 		// Todo  mesh part world bounding has some bugs.
-		if(camera.Visible(subWorldBoud))
+		if (!camera.Visible(subWorldBoud))
+			continue;
+
+		subEntity->UpdateLod(camera, mParentNode->GetWorldTransform(), subWorldBoud);
+
+		if (subEntity->UpdateClusterCulling(camera, mParentNode->GetWorldTransform()))
 		{
+			if (TextureStreamer* streamer = TextureStreamer::GetSingletonPtr())
+			{
+				streamer->RequestMaterial(*subEntity->GetMaterial(), subEntity->GetMeshPart()->GetUVDensity(), mParentNode->GetWorldTransform(),
+					NearestDistToAABB(camera.GetPosition(), subWorldBoud.Min, subWorldBoud.Max), camera);
+			}
+
 			float sortKey = 0;
 			RenderQueue::Bucket bucket = (RenderQueue::Bucket)subEntity->GetMaterial()->GetQueueBucket();
 
@@ -243,9 +259,9 @@ SceneObject* Entity::FactoryFunc( const String& name, const NameValuePairList* p
 		found = params->find("Mesh");
 		if (found != params->end())
 		{
-			// Get mesh (load if required)
+			// Get mesh (load if required), with materials, effects and textures if dependency known
 			pMesh = std::static_pointer_cast<Mesh>(
-				ResourceManager::GetSingleton().GetResourceByName(RT_Mesh, found->second, groupName));	
+				ResourceManager::GetSingleton().LoadWithDependencies(RT_Mesh, found->second, groupName));	
 		}
 	}
 	else
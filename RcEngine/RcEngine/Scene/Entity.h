@@ -37,6 +37,13 @@ public:
 	shared_ptr<Skeleton> GetSkeleton();
 
 	bool HasSkeletonAnimation() const;
+
+	/**
+	 * Static entity never moves after SceneManager::BuildStaticBatches, its mesh parts may be
+	 * merged into static batches. Skinned entities are never batched.
+	 */
+	inline bool IsStatic() const									{ return mStatic; }
+	inline void SetStatic(bool isStatic)							{ mStatic = isStatic; }
 	AnimationPlayer* GetAnimationPlayer();
 
 	void OnUpdateRenderQueue(RenderQueue* renderQueue, const Camera& cam, RenderOrder order);
@@ -68,6 +75,8 @@ protected:
 	uint32_t mNumSkinMatrices;
 
 	SkinnedAnimationPlayer* mAnimationPlayer;
+
+	bool mStatic;
 };
 
 
@@ -18,6 +18,7 @@
 #include <IO/FileSystem.h>
 #include <Resource/ResourceManager.h>
 #include <Scene/SubEntity.h>
+#include <Scene/StaticBatch.h>
 #include <Scene/Light.h>
 #include <Graphics/Effect.h>
 
@@ -43,6 +44,8 @@ SceneManager::~SceneManager()
 
 void SceneManager::ClearScene()
 {
+	ClearStaticBatches();
+
 	// clear all scene node
 	for (SceneNode* node : mAllSceneNodes) 
 		delete node;
@@ -226,6 +229,87 @@ void SceneManager::UpdateRenderQueue(const Camera& cam, RenderOrder order)
 	mRenderQueue.ClearQueue(RenderQueue::BucketTranslucent);	// Particles
 
 	GetRootSceneNode()->OnUpdateRenderQueues(cam, order);
+
+	for (StaticBatch* batch : mStaticBatches)
+		batch->OnUpdateRenderQueue(&mRenderQueue, cam, order);
+}
+
+void SceneManager::BuildStaticBatches()
+{
+	ClearStaticBatches();
+
+	auto entityIter = mSceneObjectCollections.find(SOT_Entity);
+	if (entityIter == mSceneObjectCollections.end())
+		return;
+
+	// Vertex copies are read back from file only for batched meshes, released once copied into batches
+	vector<Mesh*> shadowMeshes;
+
+	for (SceneObject* sceneObject : entityIter->second)
+	{
+		Entity* entity = static_cast<Entity*>(sceneObject);
+		if (!entity->IsStatic() || !entity->IsAttached() || entity->HasSkeleton())
+			continue;
+
+		Mesh* mesh = entity->GetMesh().get();
+		if (std::find(shadowMeshes.begin(), shadowMeshes.end(), mesh) == shadowMeshes.end())
+		{
+			shadowMeshes.push_back(mesh);
+			mesh->LoadShadowData();
+		}
+
+		for (uint32_t i = 0; i < entity->GetNumSubEntities(); ++i)
+		{
+			SubEntity* subEntity = entity->GetSubEntity(i);
+			const shared_ptr<MeshPart>& meshPart = subEntity->GetMeshPart();
+
+			// Transparent parts are sorted per object, large parts gain nothing from batching
+			if (!meshPart->GetVertexShadowData() || !meshPart->GetIndexCount() ||
+				subEntity->GetMaterial()->GetQueueBucket() == RenderQueue::BucketTransparent)
+				continue;
+
+			// Later batches are more likely to have room
+			StaticBatch* batch = nullptr;
+			for (auto it = mStaticBatches.rbegin(); it != mStaticBatches.rend() && !batch; ++it)
+			{
+				if ((*it)->CanAdd(subEntity))
+					batch = *it;
+			}
+
+			if (!batch)
+			{
+				batch = new StaticBatch(subEntity->GetMaterial(), meshPart->GetVertexDeclaration());
+				mStaticBatches.push_back(batch);
+			}
+
+			batch->AddMember(subEntity);
+		}
+	}
+
+	for (Mesh* mesh : shadowMeshes)
+		mesh->ReleaseShadowData();
+
+	// A batch of one member only adds work
+	uint32_t numBatches = 0;
+	for (StaticBatch* batch : mStaticBatches)
+	{
+		if (batch->GetNumMembers() > 1)
+		{
+			batch->Build();
+			mStaticBatches[numBatches++] = batch;
+		}
+		else
+			delete batch;
+	}
+	mStaticBatches.resize(numBatches);
+}
+
+void SceneManager::ClearStaticBatches()
+{
+	for (StaticBatch* batch : mStaticBatches)
+		delete batch;
+
+	mStaticBatches.clear();
 }
 
 void SceneManager::UpdateBackgroundQueue( const Camera& cam )
@@ -13,6 +13,7 @@ namespace RcEngine {
 class SkyBox;
 class SceneObject;
 class Sprite;
+class StaticBatch;
 
 typedef std::vector<Light*> LightQueue;
 
@@ -65,6 +66,16 @@ public:
 
 	void CreateSkyBox( const shared_ptr<Texture>& texture );
 
+	/**
+	 * Merge mesh parts of static entities attached to scene into static batches, grouped by
+	 * material and vertex layout. Call after level is loaded, rebuild when static entities change.
+	 * Only small unskinned opaque mesh parts are batched, see Mesh::LoadShadowData.
+	 */
+	void BuildStaticBatches();
+	void ClearStaticBatches();
+
+	uint32_t GetNumStaticBatches() const				{ return mStaticBatches.size(); }
+
 	/**
 	 * Update all scene graph node and transform.
 	 */
@@ -112,6 +123,8 @@ protected:
 	// Todo: Add GUI Manager
 	std::list<Sprite*> mSprites;
 
+	std::vector<StaticBatch*> mStaticBatches;
+
 	AnimationController* mAnimationController;
 
 	RenderQueue mRenderQueue;
@@ -0,0 +1,395 @@
+#include <Scene/StaticBatch.h>
+#include <Scene/SubEntity.h>
+#include <Scene/Entity.h>
+#include <Graphics/Mesh.h>
+#include <Graphics/Material.h>
+#include <Graphics/Effect.h>
+#include <Graphics/EffectParameter.h>
+#include <Graphics/Camera.h>
+#include <Graphics/RenderQueue.h>
+#include <Graphics/RenderDevice.h>
+#include <Graphics/RenderFactory.h>
+#include <Graphics/FrameBuffer.h>
+#include <Graphics/RenderOperation.h>
+#include <Graphics/GraphicsResource.h>
+#include <Graphics/VertexDeclaration.h>
+#include <Graphics/VertexQuantization.h>
+#include <Graphics/TextureStreamer.h>
+#include <Core/Environment.h>
+#include <Core/Exception.h>
+#include <Math/MathUtil.h>
+
+namespace RcEngine {
+
+namespace {
+
+// Row vector convention, translation is ignored
+float3 TransformDirection(const float3& dir, const float4x4& mat)
+{
+	return float3(dir.X() * mat.M11 + dir.Y() * mat.M21 + dir.Z() * mat.M31,
+				  dir.X() * mat.M12 + dir.Y() * mat.M22 + dir.Z() * mat.M32,
+				  dir.X() * mat.M13 + dir.Y() * mat.M23 + dir.Z() * mat.M33);
+}
+
+bool IsDirection(const VertexElement& element)
+{
+	return (element.Usage == VEU_Normal || element.Usage == VEU_Tangent || element.Usage == VEU_Binormal) &&
+		   (element.Type == VEF_Float3 || element.Type == VEF_Short2N);
+}
+
+}
+
+StaticBatch::StaticBatch( const shared_ptr<Material>& material, const shared_ptr<VertexDeclaration>& vertexDecl )
+	: mMaterial(material),
+	  mVertexDecl(vertexDecl),
+	  mRenderOperation(new RenderOperation),
+	  mVertexCount(0),
+	  mPositionScaleParam(nullptr),
+	  mPositionBiasParam(nullptr),
+	  mLastViewDraw(0)
+{
+	// Positions are requantized within batch bounds
+	shared_ptr<Effect> effect = mMaterial->GetEffect();
+	if (effect)
+	{
+		mPositionScaleParam = effect->GetParameterByName("PositionScale");
+		mPositionBiasParam = effect->GetParameterByName("PositionBias");
+	}
+}
+
+StaticBatch::~StaticBatch()
+{
+	for (Member& member : mMembers)
+		member.SubEntity->SetStaticBatch(nullptr);
+}
+
+bool StaticBatch::IsSameLayout( const VertexDeclaration& lhs, const VertexDeclaration& rhs )
+{
+	const vector<VertexElement>& lhsElements = lhs.GetVertexElements();
+	const vector<VertexElement>& rhsElements = rhs.GetVertexElements();
+
+	if (lhsElements.size() != rhsElements.size())
+		return false;
+
+	for (size_t i = 0; i < lhsElements.size(); ++i)
+	{
+		if (lhsElements[i].Offset != rhsElements[i].Offset || lhsElements[i].Type != rhsElements[i].Type ||
+			lhsElements[i].Usage != rhsElements[i].Usage || lhsElements[i].UsageIndex != rhsElements[i].UsageIndex)
+			return false;
+	}
+
+	return true;
+}
+
+bool StaticBatch::CanAdd( SubEntity* subEntity ) const
+{
+	const shared_ptr<MeshPart>& meshPart = subEntity->GetMeshPart();
+
+	if (mIndexBuffer || subEntity->GetMaterial() != mMaterial || !meshPart->GetVertexShadowData() || !meshPart->GetIndexShadowData())
+		return false;
+
+	if (!IsSameLayout(*meshPart->GetVertexDeclaration(), *mVertexDecl))
+		return false;
+
+	// Shadow vertex count is upper bound of vertices referenced by the part
+	return mVertexCount + meshPart->GetVertexShadowCount() <= MaxVertices;
+}
+
+void StaticBatch::AddMember( SubEntity* subEntity )
+{
+	if (!CanAdd(subEntity))
+		ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Sub entity " + subEntity->GetName() + " can't join batch", "StaticBatch::AddMember");
+
+	const shared_ptr<MeshPart>& meshPart = subEntity->GetMeshPart();
+	const float4x4& world = subEntity->GetParent()->GetWorldTransform();
+
+	// Normals by inverse transpose, mirrored transform flips triangle winding
+	float4x4 normalMatrix = world.Inverse().Transpose();
+	bool mirrored = world.Determinant() < 0.0f;
+
+	float3 dequantizeScale, dequantizeBias;
+	meshPart->GetPositionDequantize(dequantizeScale, dequantizeBias);
+
+	const vector<VertexElement>& elements = mVertexDecl->GetVertexElements();
+	uint32_t vertexSize = mVertexDecl->GetVertexSize();
+
+	const uint8_t* sourceVertices = meshPart->GetVertexShadowData();
+	const uint8_t* sourceIndices = meshPart->GetIndexShadowData();
+	bool sourceIndex16 = (meshPart->GetIndexFormat() == IBT_Bit16);
+
+	Member member;
+	member.SubEntity = subEntity;
+	member.IndexStart = mIndices.size();
+	member.IndexCount = meshPart->GetIndexCount();
+
+	// Copy referenced vertices only, in order of first use
+	vector<uint32_t> remap(meshPart->GetVertexShadowCount(), UINT32_MAX);
+	for (uint32_t i = 0; i < member.IndexCount; ++i)
+	{
+		uint32_t index = meshPart->GetStartIndex() + i;
+		uint32_t sourceIndex = (sourceIndex16 ? reinterpret_cast<const uint16_t*>(sourceIndices)[index] :
+			reinterpret_cast<const uint32_t*>(sourceIndices)[index]) + meshPart->GetBaseVertex();
+
+		if (remap[sourceIndex] == UINT32_MAX)
+		{
+			remap[sourceIndex] = mVertexCount++;
+
+			size_t offset = mVertexData.size();
+			mVertexData.insert(mVertexData.end(), sourceVertices + sourceIndex * vertexSize, sourceVertices + (sourceIndex + 1) * vertexSize);
+			uint8_t* vertex = &mVertexData[offset];
+
+			for (const VertexElement& element : elements)
+			{
+				uint8_t* attribute = vertex + element.Offset;
+
+				if (element.Usage == VEU_Position)
+				{
+					float3 position;
+					if (element.Type == VEF_UShort4N)
+					{
+						const uint16_t* q = reinterpret_cast<const uint16_t*>(attribute);
+						for (int k = 0; k < 3; ++k)
+							position[k] = q[k] / 65535.0f * dequantizeScale[k] + dequantizeBias[k];
+					}
+					else
+						memcpy(&position, attribute, sizeof(float3));
+
+					position = Transform(position, world);
+
+					// Quantized position is encoded in Build when batch bounds are known
+					if (element.Type == VEF_Float3 || element.Type == VEF_Float4)
+						memcpy(attribute, &position, sizeof(float3));
+
+					mWorldPositions.push_back(position);
+					member.WorldBound.Merge(position);
+				}
+				else if (IsDirection(element))
+				{
+					const float4x4& matrix = (element.Usage == VEU_Normal) ? normalMatrix : world;
+
+					if (element.Type == VEF_Short2N)
+					{
+						float3 dir = Normalize(TransformDirection(VertexQuantization::DecodeOctahedral(reinterpret_cast<const int16_t*>(attribute)), matrix));
+						VertexQuantization::EncodeOctahedral(reinterpret_cast<int16_t*>(attribute), dir);
+					}
+					else
+					{
+						float3 dir;
+						memcpy(&dir, attribute, sizeof(float3));
+						dir = Normalize(TransformDirection(dir, matrix));
+						memcpy(attribute, &dir, sizeof(float3));
+					}
+				}
+			}
+		}
+
+		mIndices.push_back( static_cast<uint16_t>(remap[sourceIndex]) );
+	}
+
+	if (mirrored)
+	{
+		for (uint32_t i = member.IndexStart; i + 2 < mIndices.size(); i += 3)
+			std::swap(mIndices[i+1], mIndices[i+2]);
+	}
+
+	mWorldBoundingBox.Merge(member.WorldBound);
+	mMembers.push_back(member);
+
+	subEntity->SetStaticBatch(this);
+}
+
+void StaticBatch::Build()
+{
+	if (mIndices.empty())
+		return;
+
+	const vector<VertexElement>& elements = mVertexDecl->GetVertexElements();
+	uint32_t vertexSize = mVertexDecl->GetVertexSize();
+
+	for (const VertexElement& element : elements)
+	{
+		if (element.Usage == VEU_Position && element.Type == VEF_UShort4N)
+		{
+			for (uint32_t i = 0; i < mVertexCount; ++i)
+			{
+				uint16_t* q = reinterpret_cast<uint16_t*>(&mVertexData[i * vertexSize + element.Offset]);
+				VertexQuantization::QuantizePosition(q, mWorldPositions[i], mWorldBoundingBox.Min, mWorldBoundingBox.Max);
+			}
+		}
+	}
+
+	RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+
+	ElementInitData initData;
+	initData.pData = &mVertexData[0];
+	initData.rowPitch = mVertexData.size();
+	initData.slicePitch = 0;
+	mVertexBuffer = factory->CreateVertexBuffer(mVertexData.size(), EAH_GPU_Read, BufferCreate_Vertex, &initData);
+
+	initData.pData = &mIndices[0];
+	initData.rowPitch = sizeof(uint16_t) * mIndices.size();
+	mIndexBuffer = factory->CreateIndexBuffer(sizeof(uint16_t) * mIndices.size(), EAH_GPU_Read, BufferCreate_Index, &initData);
+
+	// Index copy kept for compacting visible members
+	vector<uint8_t>().swap(mVertexData);
+	vector<float3>().swap(mWorldPositions);
+
+	// Own declaration, GL vertex array object caches the vertex buffer it is created with
+	vector<VertexElement> batchElements = elements;
+	mVertexDecl = factory->CreateVertexDeclaration(&batchElements[0], batchElements.size());
+
+	mRenderOperation->PrimitiveType = PT_Triangle_List;
+	mRenderOperation->BindVertexStream(0, mVertexBuffer);
+	mRenderOperation->VertexDecl = mVertexDecl;
+	mRenderOperation->BaseVertex = 0;
+	mRenderOperation->VertexStart = 0;
+}
+
+const shared_ptr<RenderOperation>& StaticBatch::GetRenderOperation() const
+{
+	const ViewDraw* viewDraw = GetCurrentViewDraw();
+	if (viewDraw)
+	{
+		mRenderOperation->BindIndexStream(viewDraw->CulledIndexBuffer ? viewDraw->CulledIndexBuffer : mIndexBuffer, IBT_Bit16);
+		mRenderOperation->SetIndexRange(viewDraw->IndexStart, viewDraw->IndexCount);
+	}
+
+	return mRenderOperation;
+}
+
+StaticBatch::ViewDraw& StaticBatch::GetViewDraw( const Camera& camera )
+{
+	for (mLastViewDraw = 0; mLastViewDraw < mViewDraws.size(); ++mLastViewDraw)
+	{
+		if (mViewDraws[mLastViewDraw].ViewCamera == &camera)
+			return mViewDraws[mLastViewDraw];
+	}
+
+	ViewDraw viewDraw;
+	viewDraw.ViewCamera = &camera;
+	viewDraw.IndexStart = 0;
+	viewDraw.IndexCount = 0;
+	mViewDraws.push_back(viewDraw);
+
+	return mViewDraws.back();
+}
+
+const StaticBatch::ViewDraw* StaticBatch::GetCurrentViewDraw() const
+{
+	if (mViewDraws.empty())
+		return nullptr;
+
+	const shared_ptr<FrameBuffer>& frameBuffer = Environment::GetSingleton().GetRenderDevice()->GetCurrentFrameBuffer();
+	if (frameBuffer && frameBuffer->GetCamera())
+	{
+		const Camera* camera = frameBuffer->GetCamera().get();
+		for (const ViewDraw& viewDraw : mViewDraws)
+		{
+			if (viewDraw.ViewCamera == camera)
+				return &viewDraw;
+		}
+	}
+
+	return &mViewDraws[mLastViewDraw];
+}
+
+void StaticBatch::GetWorldTransforms( float4x4* xform ) const
+{
+	// Vertices are in world space
+	*xform = float4x4::Identity();
+}
+
+uint32_t StaticBatch::GetWorldTransformsCount() const
+{
+	return 1;
+}
+
+void StaticBatch::OnRenderBegin()
+{
+	Renderable::OnRenderBegin();
+
+	if (mPositionScaleParam)
+		mPositionScaleParam->SetValue(mWorldBoundingBox.Max - mWorldBoundingBox.Min);
+
+	if (mPositionBiasParam)
+		mPositionBiasParam->SetValue(mWorldBoundingBox.Min);
+}
+
+void StaticBatch::OnUpdateRenderQueue( RenderQueue* renderQueue, const Camera& camera, RenderOrder order )
+{
+	if (!mIndexBuffer || !camera.Visible(mWorldBoundingBox))
+		return;
+
+	TextureStreamer* streamer = TextureStreamer::GetSingletonPtr();
+
+	mVisibleRanges.clear();
+	for (const Member& member : mMembers)
+	{
+		if (!member.SubEntity->GetParent()->IsVisible() || !camera.Visible(member.WorldBound))
+			continue;
+
+		if (streamer)
+		{
+			streamer->RequestMaterial(*mMaterial, member.SubEntity->GetMeshPart()->GetUVDensity(), member.SubEntity->GetParent()->GetWorldTransform(),
+				NearestDistToAABB(camera.GetPosition(), member.WorldBound.Min, member.WorldBound.Max), camera);
+		}
+
+		// Merge with previous range if adjacent
+		if (mVisibleRanges.size() && mVisibleRanges.back().first + mVisibleRanges.back().second == member.IndexStart)
+			mVisibleRanges.back().second += member.IndexCount;
+		else
+			mVisibleRanges.push_back( std::make_pair(member.IndexStart, member.IndexCount) );
+	}
+
+	if (mVisibleRanges.empty())
+		return;
+
+	ViewDraw& viewDraw = GetViewDraw(camera);
+	if (mVisibleRanges.size() == 1)
+	{
+		// Single range draws from batch index buffer directly
+		viewDraw.CulledIndexBuffer.reset();
+		viewDraw.IndexStart = mVisibleRanges[0].first;
+		viewDraw.IndexCount = mVisibleRanges[0].second;
+	}
+	else
+	{
+		// Compact visible ranges into a dynamic index buffer of this view
+		uint32_t bufferSize = sizeof(uint16_t) * mIndices.size();
+		if (!viewDraw.CulledIndexBuffer)
+		{
+			RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+			viewDraw.CulledIndexBuffer = factory->CreateIndexBuffer(bufferSize, EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Index, nullptr);
+		}
+
+		uint16_t* pIndices = static_cast<uint16_t*>(viewDraw.CulledIndexBuffer->Map(0, bufferSize, RMA_Write_Discard));
+
+		viewDraw.IndexCount = 0;
+		for (const auto& range : mVisibleRanges)
+		{
+			memcpy(pIndices + viewDraw.IndexCount, &mIndices[range.first], sizeof(uint16_t) * range.second);
+			viewDraw.IndexCount += range.second;
+		}
+		viewDraw.CulledIndexBuffer->UnMap();
+
+		viewDraw.IndexStart = 0;
+	}
+
+	float sortKey = 0;
+	switch( order )
+	{
+	case RO_StateChange:
+		sortKey = (float)mMaterial->GetEffect()->GetResourceHandle();
+		break;
+	case RO_FrontToBack:
+		sortKey = NearestDistToAABB( camera.GetPosition(), mWorldBoundingBox.Min, mWorldBoundingBox.Max);
+		break;
+	case RO_BackToFront:
+		sortKey = -NearestDistToAABB( camera.GetPosition(), mWorldBoundingBox.Min, mWorldBoundingBox.Max);
+		break;
+	}
+
+	renderQueue->AddToQueue(RenderQueueItem(this, sortKey), (RenderQueue::Bucket)mMaterial->GetQueueBucket());
+}
+
+} // Namespace RcEngine
@@ -0,0 +1,118 @@
+#ifndef StaticBatch_h__
+#define StaticBatch_h__
+
+#include <Core/Prerequisites.h>
+#include <Graphics/Renderable.h>
+#include <Graphics/GraphicsCommon.h>
+#include <Math/BoundingBox.h>
+
+namespace RcEngine {
+
+class SubEntity;
+
+/**
+ * Mesh parts of static entities sharing material and vertex layout, pre-transformed to world
+ * space and merged in one vertex and index buffer. Each member keeps its index range, so
+ * invisible members are culled and visible ranges compacted into one draw.
+ */
+class _ApiExport StaticBatch : public Renderable
+{
+public:
+	// Batch indices are 16 bit
+	static const uint32_t MaxVertices = 65536;
+
+public:
+	StaticBatch(const shared_ptr<Material>& material, const shared_ptr<VertexDeclaration>& vertexDecl);
+	~StaticBatch();
+
+	/**
+	 * Return if mesh part of sub entity can join this batch, material and vertex layout
+	 * must match and merged vertices stay within MaxVertices.
+	 */
+	bool CanAdd(SubEntity* subEntity) const;
+
+	/**
+	 * Transform mesh part vertices with entity world transform and append them. Sub entity
+	 * is not rendered by its entity any more.
+	 */
+	void AddMember(SubEntity* subEntity);
+
+	/**
+	 * Create GPU buffers after all members added.
+	 */
+	void Build();
+
+	inline uint32_t GetNumMembers() const						{ return mMembers.size(); }
+	inline const BoundingBoxf& GetWorldBoundingBox() const		{ return mWorldBoundingBox; }
+
+	const shared_ptr<Material>& GetMaterial() const				{ return mMaterial; }
+	const shared_ptr<RenderOperation>& GetRenderOperation() const;
+
+	void GetWorldTransforms(float4x4* xform) const;
+	uint32_t GetWorldTransformsCount() const;
+
+	void OnRenderBegin();
+
+	/**
+	 * Cull members against camera frustum, add to queue if any member is visible.
+	 */
+	void OnUpdateRenderQueue(RenderQueue* renderQueue, const Camera& camera, RenderOrder order);
+
+	/// Vertex layouts are compatible if elements match, regardless of declaration object.
+	static bool IsSameLayout(const VertexDeclaration& lhs, const VertexDeclaration& rhs);
+
+protected:
+	struct Member
+	{
+		SubEntity* SubEntity;
+		BoundingBoxf WorldBound;
+		uint32_t IndexStart;
+		uint32_t IndexCount;
+	};
+
+	/**
+	 * Culling result of one camera. Shadow and main views are all queued before drawing, so each
+	 * keeps its own visible range and compacted index buffer.
+	 */
+	struct ViewDraw
+	{
+		const Camera* ViewCamera;
+		uint32_t IndexStart;
+		uint32_t IndexCount;
+		shared_ptr<GraphicsBuffer> CulledIndexBuffer;
+	};
+
+	ViewDraw& GetViewDraw(const Camera& camera);
+
+	/// Draw of current frame buffer camera, or of the last updated camera if not found.
+	const ViewDraw* GetCurrentViewDraw() const;
+
+	shared_ptr<Material> mMaterial;
+	shared_ptr<VertexDeclaration> mVertexDecl;
+	shared_ptr<RenderOperation> mRenderOperation;
+
+	vector<Member> mMembers;
+	BoundingBoxf mWorldBoundingBox;
+
+	// World space vertices, quantized positions are requantized within batch bounds when built
+	uint32_t mVertexCount;
+	vector<uint8_t> mVertexData;
+	vector<float3> mWorldPositions;
+	vector<uint16_t> mIndices;
+
+	shared_ptr<GraphicsBuffer> mVertexBuffer;
+	shared_ptr<GraphicsBuffer> mIndexBuffer;
+
+	// Dequantize parameters of material effect, cached when material is bound
+	EffectParameter* mPositionScaleParam;
+	EffectParameter* mPositionBiasParam;
+
+	// Culling results, used by GetRenderOperation
+	vector<ViewDraw> mViewDraws;
+	uint32_t mLastViewDraw;
+	vector<std::pair<uint32_t, uint32_t> > mVisibleRanges;
+};
+
+} // Namespace RcEngine
+
+#endif // StaticBatch_h__
@@ -5,16 +5,30 @@
 #include <Graphics/Mesh.h>
 #include <Graphics/RenderOperation.h>
 #include <Graphics/Material.h>
+#include <Graphics/Effect.h>
+#include <Graphics/EffectParameter.h>
+#include <Graphics/Camera.h>
+#include <Graphics/RenderFactory.h>
+#include <Graphics/RenderDevice.h>
+#include <Graphics/FrameBuffer.h>
+#include <Graphics/GraphicsResource.h>
+#include <Core/Environment.h>
 #include <Core/Exception.h>
 #include <Math/MathUtil.h>
 #include <Resource/ResourceManager.h>
 
 namespace RcEngine {
 
+// About one pixel at 1080p
+const float SubEntity::LodScreenError = 1.0f / 540.0f;
+
 SubEntity::SubEntity( Entity* parent, const shared_ptr<MeshPart>& meshPart )
-	: mMeshPart(meshPart), mParent(parent), mRenderOperation(new RenderOperation)
+	: mMeshPart(meshPart), mParent(parent), mRenderOperation(new RenderOperation),
+	  mStaticBatch(nullptr),
+	  mLastViewDraw(0)
 {
-
+	mPositionScaleParams[0] = mPositionScaleParams[1] = nullptr;
+	mPositionBiasParams[0] = mPositionBiasParams[1] = nullptr;
 }
 
 SubEntity::~SubEntity()
@@ -31,6 +45,8 @@ void SubEntity::SetMaterial( const shared_ptr<Material>& mat )
 {
 	mMaterial = mat;
 	mMaterial->Load();
+
+	CacheGeometryParameters();
 }
 
 void SubEntity::SetMaterial( const String& matName, const String& group )
@@ -40,6 +56,8 @@ void SubEntity::SetMaterial( const String& matName, const String& group )
 
 	mMaterial->Load();
 
+	CacheGeometryParameters();
+
 	// if use material animation, we must use material clone
 	//mMaterial = std::static_pointer_cast<Material>(mMaterial->Clone());
 }
@@ -89,10 +107,225 @@ uint32_t SubEntity::GetWorldTransformsCount() const
 
 const shared_ptr<RenderOperation>& SubEntity::GetRenderOperation() const
 {
-	mMeshPart->GetRenderOperation(*mRenderOperation, 0);
+	const ViewDraw* viewDraw = GetCurrentViewDraw();
+
+	mMeshPart->GetRenderOperation(*mRenderOperation, viewDraw ? viewDraw->LodIndex : 0);
+
+	if (viewDraw && viewDraw->ClusterCulled)
+	{
+		if (viewDraw->IndexBuffer)
+			mRenderOperation->BindIndexStream(viewDraw->IndexBuffer, mMeshPart->GetIndexFormat());
+
+		mRenderOperation->SetIndexRange(viewDraw->IndexStart, viewDraw->IndexCount);
+	}
+
 	return mRenderOperation;
 }
 
+SubEntity::ViewDraw& SubEntity::GetViewDraw( const Camera& camera )
+{
+	for (mLastViewDraw = 0; mLastViewDraw < mViewDraws.size(); ++mLastViewDraw)
+	{
+		if (mViewDraws[mLastViewDraw].ViewCamera == &camera)
+			return mViewDraws[mLastViewDraw];
+	}
+
+	ViewDraw viewDraw;
+	viewDraw.ViewCamera = &camera;
+	viewDraw.LodIndex = 0;
+	viewDraw.ClusterCulled = false;
+	viewDraw.IndexStart = 0;
+	viewDraw.IndexCount = 0;
+	mViewDraws.push_back(viewDraw);
+
+	return mViewDraws.back();
+}
+
+const SubEntity::ViewDraw* SubEntity::GetCurrentViewDraw() const
+{
+	if (mViewDraws.empty())
+		return nullptr;
+
+	const shared_ptr<FrameBuffer>& frameBuffer = Environment::GetSingleton().GetRenderDevice()->GetCurrentFrameBuffer();
+	if (frameBuffer && frameBuffer->GetCamera())
+	{
+		const Camera* camera = frameBuffer->GetCamera().get();
+		for (const ViewDraw& viewDraw : mViewDraws)
+		{
+			if (viewDraw.ViewCamera == camera)
+				return &viewDraw;
+		}
+	}
+
+	return &mViewDraws[mLastViewDraw];
+}
+
+uint32_t SubEntity::GetLodIndex() const
+{
+	const ViewDraw* viewDraw = GetCurrentViewDraw();
+	return viewDraw ? viewDraw->LodIndex : 0;
+}
+
+bool SubEntity::UpdateClusterCulling( const Camera& camera, const float4x4& world )
+{
+	const vector<MeshCluster>& clusters = mMeshPart->GetClusters();
+	
+	ViewDraw& viewDraw = GetViewDraw(camera);
+	viewDraw.ClusterCulled = false;
+
+	// Clusters only cover full detail level
+	if (clusters.empty() || viewDraw.LodIndex > 0)
+		return true;
+
+	// Cone test is only valid if back faces are not drawn
+	bool coneCulling = mMaterial->GetEffect()->IsBackFaceCulled();
+
+	// Cone test in model space
+	bool orthographic = (camera.GetProjMatrix().M44 == 1.0f);
+	float4x4 worldInverse = world.Inverse();
+	float3 eyeModel = Transform(camera.GetPosition(), worldInverse);
+	float3 viewModel = Normalize(Transform(camera.GetPosition() + camera.GetView(), worldInverse) - eyeModel);
+
+	mVisibleRanges.clear();
+	for (const MeshCluster& cluster : clusters)
+	{
+		if (coneCulling && cluster.ConeCutoff < 1.0f)
+		{
+			float3 dir = orthographic ? viewModel : Normalize(cluster.ConeApex - eyeModel);
+			if (Dot(dir, cluster.ConeAxis) >= cluster.ConeCutoff)
+				continue;
+		}
+
+		if (!camera.Visible(Transform(BoundingSpheref(cluster.Center, cluster.Radius), world)))
+			continue;
+
+		// Merge with previous range if adjacent
+		if (mVisibleRanges.size() && mVisibleRanges.back().first + mVisibleRanges.back().second == cluster.IndexStart)
+			mVisibleRanges.back().second += cluster.IndexCount;
+		else
+			mVisibleRanges.push_back( std::make_pair(cluster.IndexStart, cluster.IndexCount) );
+	}
+
+	if (mVisibleRanges.empty())
+		return false;
+
+	viewDraw.ClusterCulled = true;
+
+	// Single range draws from mesh index buffer directly
+	if (mVisibleRanges.size() == 1)
+	{
+		viewDraw.IndexBuffer.reset();
+		viewDraw.IndexStart = mVisibleRanges[0].first;
+		viewDraw.IndexCount = mVisibleRanges[0].second;
+		return true;
+	}
+
+	// Compact visible ranges into a dynamic index buffer of this view
+	uint32_t indexSize = (mMeshPart->GetIndexFormat() == IBT_Bit16) ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint32_t bufferSize = mMeshPart->GetIndexCount() * indexSize;
+	if (!viewDraw.IndexBuffer || viewDraw.IndexBuffer->GetBufferSize() < bufferSize)
+	{
+		RenderFactory* factory = Environment::GetSingleton().GetRenderFactory();
+		viewDraw.IndexBuffer = factory->CreateIndexBuffer(bufferSize, EAH_GPU_Read | EAH_CPU_Write, BufferCreate_Index, nullptr);
+	}
+
+	const uint8_t* shadowIndices = mMeshPart->GetIndexShadowData();
+	uint8_t* pIndices = static_cast<uint8_t*>(viewDraw.IndexBuffer->Map(0, bufferSize, RMA_Write_Discard));
+	
+	viewDraw.IndexCount = 0;
+	for (const auto& range : mVisibleRanges)
+	{
+		memcpy(pIndices + viewDraw.IndexCount * indexSize, shadowIndices + range.first * indexSize, range.second * indexSize);
+		viewDraw.IndexCount += range.second;
+	}
+	viewDraw.IndexBuffer->UnMap();
+
+	viewDraw.IndexStart = 0;
+	return true;
+}
+
+void SubEntity::UpdateLod( const Camera& camera, const float4x4& world, const BoundingBoxf& worldBound )
+{
+	ViewDraw& viewDraw = GetViewDraw(camera);
+	viewDraw.LodIndex = 0;
+
+	uint32_t numLods = mMeshPart->GetNumLods();
+	if (numLods == 1)
+		return;
+
+	// Model error to world error with largest axis scale
+	float scale = (std::max)( (std::max)(float3(world.M11, world.M12, world.M13).Length(), 
+		float3(world.M21, world.M22, world.M23).Length()), float3(world.M31, world.M32, world.M33).Length() );
+
+	// Projected error is error * M22 / distance for perspective, error * M22 for orthographic
+	const float4x4& proj = camera.GetProjMatrix();
+	float errorScale = scale * proj.M22;
+	if (proj.M44 != 1.0f)
+	{
+		float distance = NearestDistToAABB(camera.GetPosition(), worldBound.Min, worldBound.Max);
+		if (distance <= 0.0f)
+			return;
+
+		errorScale /= distance;
+	}
+
+	while (viewDraw.LodIndex + 1 < numLods && mMeshPart->GetLodError(viewDraw.LodIndex + 1) * errorScale <= LodScreenError)
+		viewDraw.LodIndex++;
+}
+
+const void* SubEntity::GetInstanceKey() const
+{
+	// Skinned and cluster culled sub entities have their own geometry, queued right after update
+	bool clusterCulled = mViewDraws.size() && mViewDraws[mLastViewDraw].ClusterCulled;
+	if (mParent->mNumSkinMatrices || clusterCulled || !mMaterial->GetInstancedEffect())
+		return nullptr;
+
+	return mMeshPart.get();
+}
+
+void SubEntity::CacheGeometryParameters()
+{
+	mPositionScaleParams[0] = mPositionScaleParams[1] = nullptr;
+	mPositionBiasParams[0] = mPositionBiasParams[1] = nullptr;
+
+	if (!mMeshPart->HasQuantizedPosition())
+		return;
+
+	Effect* effects[2] = { mMaterial->GetEffect().get(), mMaterial->GetInstancedEffect().get() };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (effects[i])
+		{
+			mPositionScaleParams[i] = effects[i]->GetParameterByName("PositionScale");
+			mPositionBiasParams[i] = effects[i]->GetParameterByName("PositionBias");
+		}
+	}
+}
+
+void SubEntity::ApplyGeometryParameters( Effect& effect ) const
+{
+	if (mMeshPart->HasQuantizedPosition())
+	{
+		float3 scale, bias;
+		mMeshPart->GetPositionDequantize(scale, bias);
+
+		int i = (&effect == mMaterial->GetEffect().get()) ? 0 : 1;
+		if (i == 1 && &effect != mMaterial->GetInstancedEffect().get())
+			return;
+
+		if (mPositionScaleParams[i])
+			mPositionScaleParams[i]->SetValue(scale);
+		if (mPositionBiasParams[i])
+			mPositionBiasParams[i]->SetValue(bias);
+	}
+}
+
+void SubEntity::OnRenderBegin()
+{
+	Renderable::OnRenderBegin();
+	ApplyGeometryParameters(*mMaterial->GetEffect());
+}
+
 const BoundingBoxf& SubEntity::GetBoundingBox() const
 {
 	return mMeshPart->GetBoundingBox();
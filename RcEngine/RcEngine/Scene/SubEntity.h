@@ -7,6 +7,8 @@
 
 namespace RcEngine {
 
+class StaticBatch;
+
 class _ApiExport SubEntity : public Renderable
 {
 public:
@@ -17,6 +19,9 @@ public:
 
 	const String& GetName() const ;
 
+	inline Entity* GetParent() const								{ return mParent; }
+	inline const shared_ptr<MeshPart>& GetMeshPart() const		{ return mMeshPart; }
+
 	const shared_ptr<Material>& GetMaterial() const;
 
 	void SetMaterial( const shared_ptr<Material>& mat );
@@ -29,11 +34,75 @@ public:
 	void GetWorldTransforms(float4x4* xform) const;
 	uint32_t GetWorldTransformsCount() const;
 
+	const void* GetInstanceKey() const;
+	void ApplyGeometryParameters(Effect& effect) const;
+
+	void OnRenderBegin();
+
+	/**
+	 * Cull mesh part clusters against camera frustum and normal cones, visible index ranges
+	 * are compacted into one draw. Return false if no cluster is visible. Result is kept for
+	 * this camera, call after UpdateLod with the same camera.
+	 */
+	bool UpdateClusterCulling(const Camera& camera, const float4x4& world);
+
+	/**
+	 * Select coarsest mesh part LOD whose geometric error projects below LodScreenError,
+	 * in fraction of half viewport height. Result is kept for this camera.
+	 */
+	void UpdateLod(const Camera& camera, const float4x4& world, const BoundingBoxf& worldBound);
+	
+	/// LOD of the view being drawn, see GetRenderOperation.
+	uint32_t GetLodIndex() const;
+
+	/**
+	 * Static batch this sub entity is merged into, it is rendered by the batch instead of its entity.
+	 */
+	inline StaticBatch* GetStaticBatch() const					{ return mStaticBatch; }
+	inline void SetStaticBatch(StaticBatch* batch)				{ mStaticBatch = batch; }
+
+public:
+	static const float LodScreenError;
+
+protected:
+	/// Look up dequantize parameters of material effect and its instanced variant once.
+	void CacheGeometryParameters();
+
+	/**
+	 * LOD and cluster culling result of one camera. Main view, shadow cascades and other passes
+	 * update and draw the same sub entity in one frame, each keeps its own draw.
+	 */
+	struct ViewDraw
+	{
+		const Camera* ViewCamera;
+		uint32_t LodIndex;
+		bool ClusterCulled;
+		uint32_t IndexStart;
+		uint32_t IndexCount;
+		shared_ptr<GraphicsBuffer> IndexBuffer;
+	};
+
+	ViewDraw& GetViewDraw(const Camera& camera);
+
+	/// Draw of current frame buffer camera, or of the last updated camera if not found.
+	const ViewDraw* GetCurrentViewDraw() const;
+
 protected:
 	Entity* mParent;
 	shared_ptr<MeshPart> mMeshPart;
 	shared_ptr<RenderOperation> mRenderOperation;
 	shared_ptr<Material> mMaterial;
+
+	StaticBatch* mStaticBatch;
+
+	// Position dequantize parameters, [0] for material effect and [1] for instanced effect
+	EffectParameter* mPositionScaleParams[2];
+	EffectParameter* mPositionBiasParams[2];
+
+	// LOD and cluster culling result of each camera, used by GetRenderOperation
+	vector<ViewDraw> mViewDraws;
+	uint32_t mLastViewDraw;
+	vector<std::pair<uint32_t, uint32_t> > mVisibleRanges;
 };
 
 
@@ -65,6 +65,10 @@ void SponzaApp::LoadContent()
 	sponzaNode->SetScale(0.45f);
 	sponzaNode->AttachObject(sponzaEntity);
 
+	// Sponza never moves, merge its small parts sharing a material into static batches
+	sponzaEntity->SetStatic(true);
+	sceneMan.BuildStaticBatches();
+
 	mCameraControler->SetMoveSpeed(50.0f);
 	mCameraControler->SetMoveInertia(true);
 
@@ -134,7 +138,8 @@ void SponzaApp::Update( float deltaTime )
 	mCameraControler->Update(deltaTime);
 
 	CalculateFrameRate();
-	mMainWindow->SetTitle("Graphics Demo FPS:" + std::to_string(mFramePerSecond));
+	SceneManager& sceneMan = Context::GetSingleton().GetSceneManager();
+	mMainWindow->SetTitle("Graphics Demo FPS:" + std::to_string(mFramePerSecond) + " Static Batches:" + std::to_string(sceneMan.GetNumStaticBatches()));
 }
 
 void SponzaApp::InitGUI()
@@ -0,0 +1,128 @@
+#include <MainApp/Application.h>
+#include <Graphics/TextureResource.h>
+#include <Graphics/TextureStreamer.h>
+#include <Graphics/Material.h>
+#include <Resource/ResourceManager.h>
+#include <Resource/DependencyManifest.h>
+#include <Scene/SceneManager.h>
+#include <Scene/Entity.h>
+#include <Scene/SubEntity.h>
+#include <IO/FileSystem.h>
+#include <IO/MemoryStream.h>
+#include <Core/Environment.h>
+#include <iostream>
+
+using namespace RcEngine;
+
+/**
+ * Load an entity whose dependency closure is known from a dependency manifest, so its textures
+ * are prepared in parallel with the materials, and check only mip tails of them are resident.
+ */
+class TextureStreamingTestApp : public Application
+{
+public:
+	TextureStreamingTestApp(const String& config)
+		: Application(config),
+		  mPassed(false)
+	{
+
+	}
+
+	virtual ~TextureStreamingTestApp(void)
+	{
+
+	}
+
+	bool IsPassed() const	{ return mPassed; }
+
+protected:
+	void Initialize()
+	{
+
+	}
+
+	void LoadContent()
+	{
+		ResourceManager& resMan = ResourceManager::GetSingleton();
+		SceneManager* sceneMan = Environment::GetSingleton().GetSceneManager();
+
+		// Without streamer, records mesh -> material -> texture dependencies
+		TextureStreamer::Finalize();
+		sceneMan->CreateEntity("Recorded", "Sponza.mesh", "Custom");
+
+		MemoryStream recorded;
+		resMan.SaveDependencyManifest(recorded);
+		recorded.Seek(0);
+
+		// Same files in a new group, as if manifest was loaded on startup before anything
+		const String testGroup = "TextureStreamingTest";
+		FileSystem::GetSingleton().RegisterPath("../Media/Mesh", testGroup);
+		FileSystem::GetSingleton().RegisterPath("../Media/Mesh/Sponza", testGroup);
+
+		DependencyManifest source, manifest;
+		source.Read(recorded);
+		for (const DependencyManifest::Entry& entry : source.GetEntries())
+			manifest.AddEntry(entry.Type, entry.Name, entry.Group == "Custom" ? testGroup : entry.Group);
+		for (uint32_t i = 0; i < source.GetEntries().size(); ++i)
+		{
+			for (uint32_t dependency : source.GetEntries()[i].Dependencies)
+				manifest.AddDependency(i, dependency);
+		}
+
+		MemoryStream manifestStream;
+		manifest.Write(manifestStream);
+		manifestStream.Seek(0);
+		resMan.LoadDependencyManifest(manifestStream);
+
+		TextureStreamer* streamer = new TextureStreamer(256 * 1024 * 1024, mAppSettings.Height);
+		Entity* entity = sceneMan->CreateEntity("Streamed", "Sponza.mesh", testGroup);
+
+		uint32_t numTextures = 0, numFullyLoaded = 0;
+		for (uint32_t i = 0; i < entity->GetNumSubEntities(); ++i)
+		{
+			const shared_ptr<Material>& material = entity->GetSubEntity(i)->GetMaterial();
+			for (const shared_ptr<TextureResource>& texture : material->GetTextureResources())
+			{
+				numTextures++;
+				if (texture->GetResidentMip() != streamer->GetTailMip(*texture))
+				{
+					std::cout << "Self test: " << texture->GetResourceName() << " has level " << texture->GetResidentMip() 
+							  << " resident, expected mip tail " << streamer->GetTailMip(*texture) << std::endl;
+					numFullyLoaded++;
+				}
+			}
+		}
+
+		mPassed = (numTextures > 0 && numFullyLoaded == 0);
+		std::cout << numTextures << " textures, self test " << (mPassed ? "passed" : "failed") << std::endl;
+	}
+
+	void UnloadContent()
+	{
+
+	}
+
+	void Update(float deltaTime)
+	{
+		mEndGame = true;
+	}
+
+	void Render()
+	{
+
+	}
+
+protected:
+	bool mPassed;
+};
+
+
+int main(int argc, char* argv[])
+{
+	TextureStreamingTestApp app("Config.xml");
+	app.Create();
+	app.RunGame();
+	app.Release();
+
+	return app.IsPassed() ? 0 : 1;
+}
@@ -0,0 +1,1189 @@
+#include "AssetCooker.h"
+#include <Core/XMLDom.h>
+#include <Core/ThreadPool.h>
+#include <Core/Exception.h>
+#include <IO/FileStream.h>
+#include <IO/PathUtil.h>
+#include <Resource/Resource.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <set>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <direct.h>
+#else
+	#include <dirent.h>
+	#include <unistd.h>
+#endif
+
+namespace {
+
+const uint64_t FNVOffsetBasis = 14695981039346656037ULL;
+const uint64_t FNVPrime = 1099511628211ULL;
+
+bool GetFileInfo(const String& file, uint32_t& size, uint64_t& modifiedTime)
+{
+	struct stat st;
+	if (stat(file.c_str(), &st) != 0)
+		return false;
+
+	size = (uint32_t)st.st_size;
+	modifiedTime = (uint64_t)st.st_mtime;
+	return true;
+}
+
+bool FileExists(const String& file)
+{
+	struct stat st;
+	return stat(file.c_str(), &st) == 0;
+}
+
+// PathUtil splits extensions, cooker paths may have dots in directories and no extension
+String GetDirectory(const String& file)
+{
+	size_t pos = file.find_last_of('/');
+	return pos == String::npos ? String() : file.substr(0, pos + 1);
+}
+
+String GetFileNameAndExtension(const String& file)
+{
+	size_t pos = file.find_last_of('/');
+	return pos == String::npos ? file : file.substr(pos + 1);
+}
+
+bool IsAbsolutePath(const String& path)
+{
+	return (path.size() && path[0] == '/') || (path.size() > 1 && path[1] == ':');
+}
+
+String ToLower(String str)
+{
+	std::transform(str.begin(), str.end(), str.begin(), (int(*)(int))tolower);
+	return str;
+}
+
+String ReplaceAll(String str, const String& token, const String& value)
+{
+	for (size_t pos = str.find(token); pos != String::npos; pos = str.find(token, pos + value.length()))
+		str.replace(pos, token.length(), value);
+	return str;
+}
+
+String QuotePath(const String& path)
+{
+	return "\"" + path + "\"";
+}
+
+String HashToString(uint64_t hash)
+{
+	std::ostringstream oss;
+	oss << std::hex;
+	oss.width(16);
+	oss.fill('0');
+	oss << hash;
+	return oss.str();
+}
+
+uint64_t StringToHash(const String& str)
+{
+	uint64_t hash = 0;
+	std::istringstream iss(str);
+	iss >> std::hex >> hash;
+	return hash;
+}
+
+/**
+ * Recursively list files under root + relDir, paths are relative to root. Hidden entries and
+ * skipDir are not listed.
+ */
+void ListFiles(const String& root, const String& relDir, const String& skipDir, vector<String>& files)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA findData;
+	HANDLE hFind = FindFirstFileA((root + relDir + "*").c_str(), &findData);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		String name = findData.cFileName;
+		if (name[0] == '.')
+			continue;
+
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (root + relDir + name + "/" != skipDir)
+				ListFiles(root, relDir + name + "/", skipDir, files);
+		}
+		else
+			files.push_back(relDir + name);
+
+	} while (FindNextFileA(hFind, &findData));
+
+	FindClose(hFind);
+#else
+	DIR* dir = opendir((root + relDir).c_str());
+	if (!dir)
+		return;
+
+	while (dirent* entry = readdir(dir))
+	{
+		String name = entry->d_name;
+		if (name[0] == '.')
+			continue;
+
+		struct stat st;
+		if (stat((root + relDir + name).c_str(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (root + relDir + name + "/" != skipDir)
+				ListFiles(root, relDir + name + "/", skipDir, files);
+		}
+		else
+			files.push_back(relDir + name);
+	}
+
+	closedir(dir);
+#endif
+}
+
+void CreateDirectories(const String& dir)
+{
+	for (size_t pos = dir.find('/', 1); pos != String::npos; pos = dir.find('/', pos + 1))
+	{
+		String parent = dir.substr(0, pos);
+		if (FileExists(parent))
+			continue;
+
+#ifdef _WIN32
+		_mkdir(parent.c_str());
+#else
+		mkdir(parent.c_str(), 0755);
+#endif
+	}
+}
+
+// Copy entry with its direct dependencies
+void CopyDependencyEntry(const DependencyManifest& from, uint32_t index, DependencyManifest& to)
+{
+	const DependencyManifest::Entry& entry = from.GetEntries()[index];
+
+	uint32_t toIndex = to.AddEntry(entry.Type, entry.Name, entry.Group);
+	for (uint32_t dependency : entry.Dependencies)
+	{
+		const DependencyManifest::Entry& dependencyEntry = from.GetEntries()[dependency];
+		to.AddDependency(toIndex, to.AddEntry(dependencyEntry.Type, dependencyEntry.Name, dependencyEntry.Group));
+	}
+}
+
+int RunCommand(const String& command)
+{
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes if command starts with a quote
+	return std::system(("\"" + command + "\"").c_str());
+#else
+	return std::system(command.c_str());
+#endif
+}
+
+}
+
+AssetCooker::AssetCooker()
+	: mDeduplicate(false)
+{
+
+}
+
+uint64_t AssetCooker::HashBytes( const void* data, size_t size, uint64_t hash )
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= FNVPrime;
+	}
+	return hash;
+}
+
+bool AssetCooker::HashFile( const String& file, uint64_t& hash )
+{
+	FILE* fp = fopen(file.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	hash = FNVOffsetBasis;
+
+	vector<uint8_t> buffer(1 << 16);
+	size_t bytesRead;
+	while ((bytesRead = fread(&buffer[0], 1, buffer.size(), fp)) > 0)
+		hash = HashBytes(&buffer[0], bytesRead, hash);
+
+	fclose(fp);
+	return true;
+}
+
+bool AssetCooker::LoadConfig( const String& configFile )
+{
+	FileStream source;
+	if (!source.Open(configFile, FILE_READ))
+	{
+		std::cout << "Can't open " << configFile << std::endl;
+		return false;
+	}
+
+	XMLDoc doc;
+	XMLNodePtr root = doc.Parse(source);
+	source.Close();
+
+	String configDir = GetDirectory(PathUtil::GetInternalPath(configFile));
+
+	String sourceRoot = PathUtil::AddTrailingSlash(root->AttributeString("source", "."));
+	String outputRoot = PathUtil::AddTrailingSlash(root->AttributeString("output", "Cooked"));
+	String manifestFile = PathUtil::GetInternalPath(root->AttributeString("manifest", outputRoot + "Manifest.xml"));
+	String aliasFile = PathUtil::GetInternalPath(root->AttributeString("aliases", outputRoot + "Aliases.bin"));
+	String dependencyFile = PathUtil::GetInternalPath(root->AttributeString("dependencies", outputRoot + "Dependencies.bin"));
+
+	mSourceRoot = IsAbsolutePath(sourceRoot) ? sourceRoot : configDir + sourceRoot;
+	mOutputRoot = IsAbsolutePath(outputRoot) ? outputRoot : configDir + outputRoot;
+	mManifestFile = IsAbsolutePath(manifestFile) ? manifestFile : configDir + manifestFile;
+	mAliasFile = IsAbsolutePath(aliasFile) ? aliasFile : configDir + aliasFile;
+	mDependencyFile = IsAbsolutePath(dependencyFile) ? dependencyFile : configDir + dependencyFile;
+	mResourceGroup = root->AttributeString("group", "General");
+	mDeduplicate = root->AttributeString("dedup", "false") == "true";
+
+	mRules.clear();
+	for (XMLNodePtr ruleNode = root->FirstNode("Rule"); ruleNode; ruleNode = ruleNode->NextSibling("Rule"))
+	{
+		CookRule rule;
+		rule.Name = ruleNode->AttributeString("name", "");
+		rule.Match = ToLower(ruleNode->AttributeString("match", ""));
+		rule.Tool = ruleNode->AttributeString("tool", "");
+		rule.Args = ruleNode->AttributeString("args", "");
+		rule.Relocatable = ruleNode->AttributeString("relocatable", "false") == "true";
+
+		for (XMLNodePtr outputNode = ruleNode->FirstNode("Output"); outputNode; outputNode = outputNode->NextSibling("Output"))
+			rule.Outputs.push_back(outputNode->AttributeString("file", ""));
+
+		if (rule.Match.empty() || rule.Tool.empty())
+		{
+			std::cout << "Skip rule " << rule.Name << ", match and tool required" << std::endl;
+			continue;
+		}
+
+		// Tool may be found in PATH only, then only its name is hashed
+		if (!HashFile(rule.Tool, rule.ToolHash))
+			rule.ToolHash = HashBytes(rule.Tool.c_str(), rule.Tool.length(), FNVOffsetBasis);
+
+		mRules.push_back(rule);
+	}
+
+	return true;
+}
+
+void AssetCooker::LoadManifest()
+{
+	mManifest.clear();
+	mDependencies.Clear();
+
+	FileStream dependencySource;
+	if (dependencySource.Open(mDependencyFile, FILE_READ))
+	{
+		if (!mDependencies.Read(dependencySource))
+			mDependencies.Clear();
+		dependencySource.Close();
+	}
+
+	FileStream source;
+	if (!source.Open(mManifestFile, FILE_READ))
+		return;
+
+	XMLDoc doc;
+	XMLNodePtr root = doc.Parse(source);
+	source.Close();
+
+	for (XMLNodePtr assetNode = root->FirstNode("Asset"); assetNode; assetNode = assetNode->NextSibling("Asset"))
+	{
+		CookRecord record;
+		record.Source = assetNode->AttributeString("source", "");
+		record.Rule = assetNode->AttributeString("rule", "");
+		record.Size = assetNode->AttributeUInt("size", 0);
+		record.ModifiedTime = StringToHash(assetNode->AttributeString("time", "0"));
+		record.SourceHash = StringToHash(assetNode->AttributeString("hash", "0"));
+		record.Key = StringToHash(assetNode->AttributeString("key", "0"));
+
+		for (XMLNodePtr outputNode = assetNode->FirstNode("Output"); outputNode; outputNode = outputNode->NextSibling("Output"))
+		{
+			CookOutput output;
+			output.File = outputNode->AttributeString("file", "");
+			output.Size = outputNode->AttributeUInt("size", 0);
+			output.Hash = StringToHash(outputNode->AttributeString("hash", "0"));
+			output.SharedWith = outputNode->AttributeString("shared", "");
+			record.Outputs.push_back(output);
+		}
+
+		for (XMLNodePtr referenceNode = assetNode->FirstNode("Reference"); referenceNode; referenceNode = referenceNode->NextSibling("Reference"))
+		{
+			CookReference reference;
+			reference.File = referenceNode->AttributeString("file", "");
+			reference.Size = referenceNode->AttributeUInt("size", 0);
+			reference.ModifiedTime = StringToHash(referenceNode->AttributeString("time", "0"));
+			reference.Hash = StringToHash(referenceNode->AttributeString("hash", "0"));
+			record.References.push_back(reference);
+		}
+
+		mManifest[record.Source] = record;
+	}
+}
+
+void AssetCooker::SaveManifest() const
+{
+	XMLDoc doc;
+	XMLNodePtr root = doc.AllocateNode(XML_Node_Element, "Manifest");
+	doc.RootNode(root);
+
+	for (const auto& kv : mManifest)
+	{
+		const CookRecord& record = kv.second;
+
+		XMLNodePtr assetNode = doc.AllocateNode(XML_Node_Element, "Asset");
+		assetNode->AppendAttribute(doc.AllocateAttributeString("source", record.Source));
+		assetNode->AppendAttribute(doc.AllocateAttributeString("rule", record.Rule));
+		assetNode->AppendAttribute(doc.AllocateAttributeUInt("size", record.Size));
+		assetNode->AppendAttribute(doc.AllocateAttributeString("time", HashToString(record.ModifiedTime)));
+		assetNode->AppendAttribute(doc.AllocateAttributeString("hash", HashToString(record.SourceHash)));
+		assetNode->AppendAttribute(doc.AllocateAttributeString("key", HashToString(record.Key)));
+
+		for (const CookOutput& output : record.Outputs)
+		{
+			XMLNodePtr outputNode = doc.AllocateNode(XML_Node_Element, "Output");
+			outputNode->AppendAttribute(doc.AllocateAttributeString("file", output.File));
+			outputNode->AppendAttribute(doc.AllocateAttributeUInt("size", output.Size));
+			outputNode->AppendAttribute(doc.AllocateAttributeString("hash", HashToString(output.Hash)));
+			if (output.SharedWith.size())
+				outputNode->AppendAttribute(doc.AllocateAttributeString("shared", output.SharedWith));
+			assetNode->AppendNode(outputNode);
+		}
+
+		for (const CookReference& reference : record.References)
+		{
+			XMLNodePtr referenceNode = doc.AllocateNode(XML_Node_Element, "Reference");
+			referenceNode->AppendAttribute(doc.AllocateAttributeString("file", reference.File));
+			referenceNode->AppendAttribute(doc.AllocateAttributeUInt("size", reference.Size));
+			referenceNode->AppendAttribute(doc.AllocateAttributeString("time", HashToString(reference.ModifiedTime)));
+			referenceNode->AppendAttribute(doc.AllocateAttributeString("hash", HashToString(reference.Hash)));
+			assetNode->AppendNode(referenceNode);
+		}
+
+		root->AppendNode(assetNode);
+	}
+
+	CreateDirectories(mManifestFile);
+
+	std::ofstream xmlFile(mManifestFile);
+	doc.Print(xmlFile);
+	xmlFile.close();
+
+	if (mDeduplicate)
+		SaveAliasTable();
+
+	SaveDependencies();
+}
+
+void AssetCooker::SaveAliasTable() const
+{
+	const uint32_t AliasTableId = ('R' << 24) | ('A' << 16) | ('L' << 8) | ('S');
+
+	// Resource names are relative to output root
+	vector<std::pair<String, String> > aliases;
+	for (const auto& kv : mManifest)
+	{
+		for (const CookOutput& output : kv.second.Outputs)
+		{
+			if (output.SharedWith.size())
+				aliases.push_back(std::make_pair(output.File.substr(mOutputRoot.length()), output.SharedWith.substr(mOutputRoot.length())));
+		}
+	}
+
+	CreateDirectories(mAliasFile);
+
+	FileStream stream;
+	if (!stream.Open(mAliasFile, FILE_WRITE))
+	{
+		std::cout << "Can't write " << mAliasFile << std::endl;
+		return;
+	}
+
+	stream.WriteUInt(AliasTableId);
+	stream.WriteUInt(aliases.size());
+	for (const auto& alias : aliases)
+	{
+		stream.WriteString(alias.first);
+		stream.WriteString(alias.second);
+	}
+
+	stream.Close();
+}
+
+void AssetCooker::SaveDependencies() const
+{
+	CreateDirectories(mDependencyFile);
+
+	FileStream stream;
+	if (!stream.Open(mDependencyFile, FILE_WRITE))
+	{
+		std::cout << "Can't write " << mDependencyFile << std::endl;
+		return;
+	}
+
+	mDependencies.Write(stream);
+	stream.Close();
+}
+
+const CookRule* AssetCooker::FindRule( const String& file ) const
+{
+	String lowerFile = ToLower(file);
+	for (const CookRule& rule : mRules)
+	{
+		if (lowerFile.length() >= rule.Match.length() &&
+			lowerFile.compare(lowerFile.length() - rule.Match.length(), rule.Match.length(), rule.Match) == 0)
+			return &rule;
+	}
+
+	return nullptr;
+}
+
+String AssetCooker::ExpandTokens( const String& str, const CookJob& job ) const
+{
+	String fileName = GetFileNameAndExtension(job.Record.Source);
+	String inputFile = mSourceRoot + job.Record.Source;
+
+	String result = str;
+	result = ReplaceAll(result, "{Input}", QuotePath(inputFile));
+	result = ReplaceAll(result, "{InputDir}", GetDirectory(inputFile));
+	result = ReplaceAll(result, "{Name}", fileName.substr(0, fileName.length() - job.Rule->Match.length()));
+	result = ReplaceAll(result, "{OutputDir}", job.OutputDir);
+	result = ReplaceAll(result, "{OutputList}", QuotePath(job.OutputList));
+	result = ReplaceAll(result, "{DependencyList}", QuotePath(job.DependencyList));
+	return result;
+}
+
+void AssetCooker::PrepareJob( CookJob& job )
+{
+	CookRecord& record = job.Record;
+	String sourceFile = mSourceRoot + record.Source;
+
+	record.Size = 0;
+	record.ModifiedTime = 0;
+	GetFileInfo(sourceFile, record.Size, record.ModifiedTime);
+
+	auto iter = mManifest.find(record.Source);
+	const CookRecord* cached = (iter != mManifest.end()) ? &iter->second : nullptr;
+
+	// Only read sources whose size or time changed
+	if (cached && cached->Size == record.Size && cached->ModifiedTime == record.ModifiedTime)
+		record.SourceHash = cached->SourceHash;
+	else if (!HashFile(sourceFile, record.SourceHash))
+		record.SourceHash = 0;
+
+	job.OutputDir = mOutputRoot + GetDirectory(record.Source);
+	if (job.Rule->Args.find("{OutputList}") != String::npos)
+		job.OutputList = job.OutputDir + GetFileNameAndExtension(record.Source) + ".outputs";
+	if (job.Rule->Args.find("{DependencyList}") != String::npos)
+		job.DependencyList = job.OutputDir + GetFileNameAndExtension(record.Source) + ".deps";
+
+	job.Command = QuotePath(job.Rule->Tool) + " " + ExpandTokens(job.Rule->Args, job);
+
+	// Files referenced last time, a changed texture makes its FBX stale
+	if (cached)
+	{
+		record.References = cached->References;
+		HashReferences(record, cached->References);
+	}
+
+	record.Key = ComputeKey(job);
+
+	job.Stale = !cached || cached->Key != record.Key;
+	if (!job.Stale)
+	{
+		record.Outputs = cached->Outputs;
+		for (const CookOutput& output : record.Outputs)
+		{
+			if (!FileExists(output.SharedWith.empty() ? output.File : output.SharedWith))
+			{
+				job.Stale = true;
+				break;
+			}
+		}
+	}
+}
+
+void AssetCooker::RunJob( CookJob& job )
+{
+	CookRecord& record = job.Record;
+
+	CreateDirectories(job.OutputDir);
+	if (job.OutputList.size())
+		remove(job.OutputList.c_str());
+	if (job.DependencyList.size())
+		remove(job.DependencyList.c_str());
+
+	Log("Cook " + record.Source);
+
+	int result = RunCommand(job.Command);
+	if (result != 0)
+	{
+		std::ostringstream oss;
+		oss << "Failed " << record.Source << ", " << job.Rule->Tool << " returned " << result;
+		Log(oss.str());
+		return;
+	}
+
+	vector<String> outputFiles = GetDeclaredOutputs(job);
+
+	if (job.OutputList.size())
+	{
+		std::ifstream listFile(job.OutputList);
+
+		String line;
+		while (std::getline(listFile, line))
+		{
+			if (line.size() && line.back() == '\r')
+				line.resize(line.size() - 1);
+			if (line.size())
+				outputFiles.push_back(PathUtil::GetInternalPath(line));
+		}
+
+		listFile.close();
+		remove(job.OutputList.c_str());
+	}
+
+	record.Outputs.clear();
+	for (const String& file : outputFiles)
+	{
+		CookOutput output;
+		output.File = file;
+
+		uint64_t modifiedTime;
+		if (!GetFileInfo(file, output.Size, modifiedTime) || !HashFile(file, output.Hash))
+		{
+			Log("Failed " + record.Source + ", missing output " + file);
+			return;
+		}
+
+		record.Outputs.push_back(output);
+	}
+
+	ReadJobDependencies(job);
+
+	// Referenced files are source file dependencies of the source entry
+	vector<CookReference> cachedReferences;
+	cachedReferences.swap(record.References);
+
+	int32_t sourceEntry = job.Dependencies.FindEntry(RT_Undefined, record.Source, "");
+	if (sourceEntry >= 0)
+	{
+		const vector<DependencyManifest::Entry>& entries = job.Dependencies.GetEntries();
+		for (uint32_t index : entries[sourceEntry].Dependencies)
+		{
+			if (entries[index].Type != RT_Undefined)
+				continue;
+
+			CookReference reference;
+			reference.File = entries[index].Name;
+			record.References.push_back(reference);
+		}
+	}
+
+	HashReferences(record, cachedReferences);
+	record.Key = ComputeKey(job);
+
+	job.Succeeded = true;
+}
+
+vector<String> AssetCooker::GetDeclaredOutputs( const CookJob& job ) const
+{
+	vector<String> outputFiles;
+	for (const String& output : job.Rule->Outputs)
+	{
+		String outputFile = ExpandTokens(output, job);
+		outputFiles.push_back(ReplaceAll(outputFile, "\"", ""));
+	}
+
+	return outputFiles;
+}
+
+vector<vector<uint32_t> > AssetCooker::GroupStaleJobs( const vector<CookJob>& jobs, const vector<uint32_t>& staleJobs ) const
+{
+	// Union jobs sharing an expected output, file names are case insensitive on Windows
+	vector<uint32_t> parents(staleJobs.size());
+	for (uint32_t i = 0; i < staleJobs.size(); ++i)
+		parents[i] = i;
+
+	auto findRoot = [&](uint32_t i) -> uint32_t {
+		while (parents[i] != i)
+			i = parents[i] = parents[parents[i]];
+		return i;
+	};
+
+	std::map<String, uint32_t> writers;
+	for (uint32_t i = 0; i < staleJobs.size(); ++i)
+	{
+		const CookJob& job = jobs[staleJobs[i]];
+
+		vector<String> outputFiles = GetDeclaredOutputs(job);
+		auto cached = mManifest.find(job.Record.Source);
+		if (cached != mManifest.end())
+		{
+			for (const CookOutput& output : cached->second.Outputs)
+				outputFiles.push_back(output.File);
+		}
+
+		for (const String& file : outputFiles)
+		{
+			auto found = writers.insert(std::make_pair(ToLower(file), i));
+			if (!found.second)
+				parents[findRoot(i)] = findRoot(found.first->second);
+		}
+	}
+
+	vector<vector<uint32_t> > groups;
+	std::map<uint32_t, uint32_t> groupIndices;
+	for (uint32_t i = 0; i < staleJobs.size(); ++i)
+	{
+		auto found = groupIndices.insert(std::make_pair(findRoot(i), groups.size()));
+		if (found.second)
+			groups.push_back(vector<uint32_t>());
+		groups[found.first->second].push_back(staleJobs[i]);
+	}
+
+	return groups;
+}
+
+vector<uint32_t> AssetCooker::FailCollidingOutputs( vector<CookJob>& jobs )
+{
+	std::map<String, vector<uint32_t> > writers;
+	std::map<String, String> fileNames;
+	for (uint32_t i = 0; i < jobs.size(); ++i)
+	{
+		if (jobs[i].Stale && !jobs[i].Succeeded)
+			continue;
+
+		for (const CookOutput& output : jobs[i].Record.Outputs)
+		{
+			String key = ToLower(output.File);
+			fileNames.insert(std::make_pair(key, output.File));
+
+			vector<uint32_t>& fileWriters = writers[key];
+			if (fileWriters.empty() || fileWriters.back() != i)
+				fileWriters.push_back(i);
+		}
+	}
+
+	std::set<uint32_t> failedJobs;
+	for (const auto& kv : writers)
+	{
+		if (kv.second.size() < 2)
+			continue;
+
+		std::ostringstream oss;
+		oss << "Failed, " << fileNames[kv.first] << " is written by";
+		for (uint32_t i : kv.second)
+		{
+			oss << " " << jobs[i].Record.Source;
+			failedJobs.insert(i);
+		}
+		Log(oss.str());
+	}
+
+	// Up to date job whose file was overwritten is cooked again next time too
+	for (uint32_t i : failedJobs)
+	{
+		jobs[i].Stale = true;
+		jobs[i].Succeeded = false;
+	}
+
+	return vector<uint32_t>(failedJobs.begin(), failedJobs.end());
+}
+
+void AssetCooker::HashReferences( CookRecord& record, const vector<CookReference>& cached ) const
+{
+	for (CookReference& reference : record.References)
+	{
+		String file = IsAbsolutePath(reference.File) ? reference.File : mSourceRoot + reference.File;
+
+		if (!GetFileInfo(file, reference.Size, reference.ModifiedTime))
+		{
+			reference.Size = 0;
+			reference.ModifiedTime = 0;
+			reference.Hash = 0;
+			continue;
+		}
+
+		const CookReference* found = nullptr;
+		for (const CookReference& cachedReference : cached)
+		{
+			if (cachedReference.File == reference.File)
+				found = &cachedReference;
+		}
+
+		if (found && found->Size == reference.Size && found->ModifiedTime == reference.ModifiedTime)
+			reference.Hash = found->Hash;
+		else if (!HashFile(file, reference.Hash))
+			reference.Hash = 0;
+	}
+}
+
+uint64_t AssetCooker::ComputeKey( const CookJob& job ) const
+{
+	const CookRecord& record = job.Record;
+
+	uint64_t key = HashBytes(&record.SourceHash, sizeof(record.SourceHash), FNVOffsetBasis);
+	key = HashBytes(&job.Rule->ToolHash, sizeof(job.Rule->ToolHash), key);
+	key = HashBytes(job.Command.c_str(), job.Command.length(), key);
+
+	for (const CookReference& reference : record.References)
+	{
+		key = HashBytes(reference.File.c_str(), reference.File.length(), key);
+		key = HashBytes(&reference.Hash, sizeof(reference.Hash), key);
+	}
+
+	return key;
+}
+
+String AssetCooker::GetResourceName( const String& file ) const
+{
+	String name = PathUtil::GetInternalPath(file);
+	if (name.compare(0, mOutputRoot.length(), mOutputRoot) == 0)
+		name = name.substr(mOutputRoot.length());
+	return name;
+}
+
+String AssetCooker::GetSourceName( const String& file ) const
+{
+	String name = PathUtil::GetInternalPath(file);
+	if (name.compare(0, mSourceRoot.length(), mSourceRoot) == 0)
+		name = name.substr(mSourceRoot.length());
+	return name;
+}
+
+void AssetCooker::ReadJobDependencies( CookJob& job )
+{
+	job.Dependencies.Clear();
+	if (job.DependencyList.empty())
+		return;
+
+	FileStream source;
+	if (!source.Open(job.DependencyList, FILE_READ))
+		return;
+
+	DependencyManifest toolDependencies;
+	if (!toolDependencies.Read(source))
+		Log("Invalid dependency list " + job.DependencyList);
+
+	source.Close();
+	remove(job.DependencyList.c_str());
+
+	// Rename into cooker names, written files have no group
+	const vector<DependencyManifest::Entry>& entries = toolDependencies.GetEntries();
+
+	vector<uint32_t> indices(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const DependencyManifest::Entry& entry = entries[i];
+		if (entry.Type == RT_Undefined)
+			indices[i] = job.Dependencies.AddEntry(entry.Type, GetSourceName(entry.Name), entry.Group);
+		else
+			indices[i] = job.Dependencies.AddEntry(entry.Type, GetResourceName(entry.Name), entry.Group.empty() ? mResourceGroup : entry.Group);
+	}
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		for (uint32_t dependency : entries[i].Dependencies)
+			job.Dependencies.AddDependency(indices[i], indices[dependency]);
+	}
+}
+
+bool AssetCooker::IsRelocatable( const CookJob& job, const CookOutput& output ) const
+{
+	if (job.Rule->Relocatable)
+		return true;
+
+	String name = GetResourceName(output.File);
+	for (const DependencyManifest::Entry& entry : job.Dependencies.GetEntries())
+	{
+		if (entry.Type != RT_Undefined && entry.Name == name)
+			return entry.Dependencies.empty();
+	}
+
+	// Not reported, may hold references
+	return false;
+}
+
+vector<uint32_t> AssetCooker::FindInvalidSharedOutputs( const vector<CookJob>& jobs ) const
+{
+	std::map<String, const CookOutput*> storedOutputs;
+	for (const CookJob& job : jobs)
+	{
+		if (job.Stale && !job.Succeeded)
+			continue;
+
+		for (const CookOutput& output : job.Record.Outputs)
+		{
+			if (output.SharedWith.empty())
+				storedOutputs[output.File] = &output;
+		}
+	}
+
+	vector<uint32_t> invalidJobs;
+	for (uint32_t i = 0; i < jobs.size(); ++i)
+	{
+		if (jobs[i].Stale && !jobs[i].Succeeded)
+			continue;
+
+		for (const CookOutput& output : jobs[i].Record.Outputs)
+		{
+			if (output.SharedWith.empty())
+				continue;
+
+			// Shared by older cooker or rule became non relocatable
+			bool sameDirectory = GetDirectory(output.SharedWith) == GetDirectory(output.File);
+
+			auto found = storedOutputs.find(output.SharedWith);
+			if (found == storedOutputs.end() || found->second->Hash != output.Hash || found->second->Size != output.Size ||
+				(!sameDirectory && !IsRelocatable(jobs[i], output)))
+			{
+				invalidJobs.push_back(i);
+				break;
+			}
+		}
+	}
+
+	return invalidJobs;
+}
+
+void AssetCooker::DeduplicateOutputs( vector<CookJob>& jobs )
+{
+	// Only outputs under output root, aliases are resource names relative to it. Outputs with
+	// relative references are grouped per directory, relocatable ones across directories
+	typedef std::pair<std::pair<uint64_t, uint32_t>, String> ContentKey;
+	std::map<ContentKey, vector<CookOutput*> > contentGroups;
+	for (CookJob& job : jobs)
+	{
+		if (job.Stale && !job.Succeeded)
+			continue;
+
+		for (CookOutput& output : job.Record.Outputs)
+		{
+			if (output.File.compare(0, mOutputRoot.length(), mOutputRoot) != 0)
+				continue;
+
+			String directory = IsRelocatable(job, output) ? String() : GetDirectory(output.File);
+			contentGroups[std::make_pair(std::make_pair(output.Hash, output.Size), directory)].push_back(&output);
+		}
+	}
+
+	uint32_t numShared = 0;
+	uint64_t sharedSize = 0;
+	for (auto& kv : contentGroups)
+	{
+		vector<CookOutput*>& outputs = kv.second;
+		if (outputs.size() < 2)
+			continue;
+
+		// Shared outputs are validated, so group has at least one stored file
+		String storedFile;
+		for (const CookOutput* output : outputs)
+		{
+			if (output->SharedWith.empty() && (storedFile.empty() || output->File < storedFile))
+				storedFile = output->File;
+		}
+
+		for (CookOutput* output : outputs)
+		{
+			if (output->File == storedFile)
+			{
+				output->SharedWith.clear();
+				continue;
+			}
+
+			if (output->SharedWith.empty())
+			{
+				remove(output->File.c_str());
+				numShared++;
+				sharedSize += output->Size;
+			}
+
+			output->SharedWith = storedFile;
+		}
+	}
+
+	if (numShared)
+		std::cout << "Deduplicated " << numShared << " outputs, " << sharedSize << " bytes" << std::endl;
+}
+
+bool AssetCooker::SelfTest()
+{
+	// Output root which doesn't exist, DeduplicateOutputs removes shared files
+	AssetCooker cooker;
+	cooker.mOutputRoot = "AssetCookerSelfTest.missing/";
+
+	CookRule materialRule;
+	materialRule.Name = "Material";
+	materialRule.Relocatable = false;
+	materialRule.ToolHash = 0;
+
+	CookRule textureRule = materialRule;
+	textureRule.Name = "Texture";
+	textureRule.Relocatable = true;
+
+	vector<CookJob> jobs;
+	auto addJob = [&](const CookRule& rule, const String& file, uint64_t hash, const String& reference) {
+		CookJob job;
+		job.Rule = &rule;
+		job.Stale = false;
+		job.Succeeded = true;
+
+		CookOutput output;
+		output.File = cooker.mOutputRoot + file;
+		output.Size = 64;
+		output.Hash = hash;
+		job.Record.Outputs.push_back(output);
+
+		uint32_t entry = job.Dependencies.AddEntry(RT_Material, file, "General");
+		if (!reference.empty())
+			job.Dependencies.AddDependency(entry, job.Dependencies.AddEntry(RT_Texture, reference, "General"));
+
+		jobs.push_back(job);
+	};
+
+	// Identical materials whose textures of same name differ, must each keep own file
+	addJob(materialRule, "A/Wood.material.bin", 1, "A/Wood.dds");
+	addJob(materialRule, "B/Wood.material.bin", 1, "B/Wood.dds");
+	addJob(materialRule, "A/Wood2.material.bin", 1, "A/Wood.dds");
+	addJob(textureRule, "A/Wood.dds", 2, "");
+	addJob(textureRule, "B/Wood.dds", 3, "");
+	addJob(textureRule, "A/Stone.dds", 4, "");
+	addJob(textureRule, "B/Stone.dds", 4, "");
+
+	cooker.DeduplicateOutputs(jobs);
+
+	struct Expected
+	{
+		uint32_t Job;
+		const char* SharedWith;
+	};
+
+	const Expected expected[] = {
+		{ 0, "" },
+		{ 1, "" },
+		{ 2, "A/Wood.material.bin" },
+		{ 3, "" },
+		{ 4, "" },
+		{ 5, "" },
+		{ 6, "A/Stone.dds" }
+	};
+
+	bool passed = true;
+	for (const Expected& e : expected)
+	{
+		const CookOutput& output = jobs[e.Job].Record.Outputs[0];
+		String sharedWith = e.SharedWith[0] ? cooker.mOutputRoot + e.SharedWith : String();
+		if (output.SharedWith != sharedWith)
+		{
+			std::cout << "Self test: " << output.File << " shared with \"" << output.SharedWith << "\", expected \"" << sharedWith << "\"" << std::endl;
+			passed = false;
+		}
+	}
+
+	// Manifest of older cooker shared materials across directories, must be cooked again
+	jobs[1].Record.Outputs[0].SharedWith = cooker.mOutputRoot + "A/Wood.material.bin";
+
+	vector<uint32_t> invalidJobs = cooker.FindInvalidSharedOutputs(jobs);
+	if (invalidJobs.size() != 1 || invalidJobs[0] != 1)
+	{
+		std::cout << "Self test: " << invalidJobs.size() << " invalid shared outputs, expected B/Wood.material.bin" << std::endl;
+		passed = false;
+	}
+
+	// Two FBX files of one directory with materials of same name write same file
+	const char* fbxSources[] = { "A/House.fbx", "A/Tree.fbx", "B/House.fbx" };
+
+	vector<CookJob> fbxJobs;
+	vector<uint32_t> staleJobs;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		CookJob job;
+		job.Rule = &materialRule;
+		job.Record.Source = fbxSources[i];
+		job.Stale = true;
+		job.Succeeded = true;
+
+		CookOutput output;
+		output.File = cooker.mOutputRoot + GetDirectory(job.Record.Source) + "Wood.material.xml";
+		output.Size = 64;
+		output.Hash = i;
+		job.Record.Outputs.push_back(output);
+
+		cooker.mManifest[job.Record.Source] = job.Record;
+		fbxJobs.push_back(job);
+		staleJobs.push_back(i);
+	}
+
+	vector<vector<uint32_t> > jobGroups = cooker.GroupStaleJobs(fbxJobs, staleJobs);
+	if (jobGroups.size() != 2 || jobGroups[0].size() != 2 || jobGroups[1].size() != 1)
+	{
+		std::cout << "Self test: " << jobGroups.size() << " job groups, expected A/House.fbx and A/Tree.fbx run serially" << std::endl;
+		passed = false;
+	}
+
+	vector<uint32_t> failedJobs = cooker.FailCollidingOutputs(fbxJobs);
+	if (failedJobs.size() != 2 || fbxJobs[0].Succeeded || fbxJobs[1].Succeeded || !fbxJobs[2].Succeeded)
+	{
+		std::cout << "Self test: " << failedJobs.size() << " failed jobs, expected A/House.fbx and A/Tree.fbx" << std::endl;
+		passed = false;
+	}
+
+	std::cout << "Self test " << (passed ? "passed" : "failed") << std::endl;
+	return passed;
+}
+
+uint32_t AssetCooker::Cook( bool force, bool prune )
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	vector<String> files;
+	ListFiles(mSourceRoot, "", mOutputRoot, files);
+
+	vector<CookJob> jobs;
+	for (const String& file : files)
+	{
+		const CookRule* rule = FindRule(file);
+		if (!rule)
+			continue;
+
+		CookJob job;
+		job.Rule = rule;
+		job.Record.Source = file;
+		job.Record.Rule = rule->Name;
+		job.Stale = false;
+		job.Succeeded = false;
+		jobs.push_back(job);
+	}
+
+	// Hash sources and check manifest
+	ParallelFor(0, jobs.size(), [&](uint32_t i) {
+		PrepareJob(jobs[i]);
+		jobs[i].Stale |= force;
+	});
+
+	// Dependencies of up to date sources are kept from last run
+	std::map<String, vector<uint32_t> > dependencyEntries;
+	for (uint32_t i = 0; i < mDependencies.GetEntries().size(); ++i)
+		dependencyEntries[mDependencies.GetEntries()[i].Name].push_back(i);
+
+	vector<uint32_t> staleJobs;
+	for (uint32_t i = 0; i < jobs.size(); ++i)
+	{
+		if (jobs[i].Stale)
+		{
+			staleJobs.push_back(i);
+			continue;
+		}
+
+		const CookRecord& record = jobs[i].Record;
+		for (uint32_t index : dependencyEntries[record.Source])
+		{
+			if (mDependencies.GetEntries()[index].Type == RT_Undefined)
+				CopyDependencyEntry(mDependencies, index, jobs[i].Dependencies);
+		}
+
+		for (const CookOutput& output : record.Outputs)
+		{
+			for (uint32_t index : dependencyEntries[GetResourceName(output.File)])
+			{
+				if (mDependencies.GetEntries()[index].Type != RT_Undefined)
+					CopyDependencyEntry(mDependencies, index, jobs[i].Dependencies);
+			}
+		}
+	}
+
+	// One importer process per pool thread, jobs expected to write same file run one after another
+	vector<vector<uint32_t> > jobGroups = GroupStaleJobs(jobs, staleJobs);
+	ParallelFor(0, jobGroups.size(), [&](uint32_t i) {
+		for (uint32_t job : jobGroups[i])
+			RunJob(jobs[job]);
+	});
+
+	// Stored copy of a shared output changed, write own copy again
+	vector<uint32_t> invalidJobs = FindInvalidSharedOutputs(jobs);
+	ParallelFor(0, invalidJobs.size(), [&](uint32_t i) {
+		CookJob& job = jobs[invalidJobs[i]];
+		job.Stale = true;
+		job.Succeeded = false;
+		RunJob(job);
+	});
+	staleJobs.insert(staleJobs.end(), invalidJobs.begin(), invalidJobs.end());
+
+	// Outputs listed by tools are only known now, colliding jobs fail until sources are renamed
+	for (uint32_t i : FailCollidingOutputs(jobs))
+	{
+		if (std::find(staleJobs.begin(), staleJobs.end(), i) == staleJobs.end())
+			staleJobs.push_back(i);
+	}
+
+	if (mDeduplicate)
+		DeduplicateOutputs(jobs);
+
+	uint32_t numFailed = 0;
+	std::set<String> sources;
+	std::map<String, CookRecord> manifest;
+	DependencyManifest dependencies;
+	for (const CookJob& job : jobs)
+	{
+		sources.insert(job.Record.Source);
+
+		// Failed sources get no record, they are cooked again next time
+		if (job.Stale && !job.Succeeded)
+			numFailed++;
+		else
+		{
+			manifest[job.Record.Source] = job.Record;
+			for (uint32_t i = 0; i < job.Dependencies.GetEntries().size(); ++i)
+				CopyDependencyEntry(job.Dependencies, i, dependencies);
+		}
+	}
+
+	for (const auto& kv : mManifest)
+	{
+		if (sources.count(kv.first))
+			continue;
+
+		std::cout << "Removed " << kv.first << std::endl;
+		if (prune)
+		{
+			for (const CookOutput& output : kv.second.Outputs)
+				remove(output.File.c_str());
+		}
+	}
+
+	mManifest.swap(manifest);
+	mDependencies = dependencies;
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << jobs.size() << " sources, " << staleJobs.size() - numFailed << " cooked, " << numFailed << " failed, "
+			  << jobs.size() - staleJobs.size() << " up to date in " << seconds << "s" << std::endl;
+
+	return numFailed;
+}
+
+void AssetCooker::Log( const String& msg )
+{
+	std::lock_guard<std::mutex> lock(mLogMutex);
+	std::cout << msg << std::endl;
+}
@@ -0,0 +1,189 @@
+#ifndef AssetCooker_h__
+#define AssetCooker_h__
+
+#include <Core/Prerequisites.h>
+#include <Resource/DependencyManifest.h>
+#include <mutex>
+
+using namespace RcEngine;
+
+/**
+ * Source files whose name ends with Match are cooked by running Tool with Args. Args and Outputs
+ * may use {Input}, {InputDir}, {Name}, {OutputDir}, {OutputList} and {DependencyList} tokens. {Name}
+ * is the file name without Match suffix. Tools writing produced files to {OutputList}, one per line,
+ * need no Outputs. Tools may write a DependencyManifest of their outputs to {DependencyList}.
+ */
+struct CookRule
+{
+	String Name;
+	String Match;
+	String Tool;
+	String Args;
+	vector<String> Outputs;
+	bool Relocatable;		// Outputs hold no relative file references, e.g. textures
+
+	uint64_t ToolHash;		// Rebuild all sources of rule if tool binary changed
+};
+
+struct CookOutput
+{
+	String File;
+	uint32_t Size;
+	uint64_t Hash;
+	String SharedWith;		// Deduplicated, content is stored once in this file
+};
+
+/**
+ * File read by tool besides the source, e.g. texture of a FBX file, reported as source file
+ * dependency in {DependencyList}.
+ */
+struct CookReference
+{
+	String File;			// Relative to source root if under it
+	uint32_t Size;
+	uint64_t ModifiedTime;	// Hash is reused if size and time not changed
+	uint64_t Hash;
+};
+
+/**
+ * Manifest record of a cooked source. Key hashes source content, referenced files, tool binary
+ * and command line, source is stale if key changed or an output is missing.
+ */
+struct CookRecord
+{
+	String Source;			// Relative to source root
+	String Rule;
+	uint32_t Size;
+	uint64_t ModifiedTime;	// Source hash is reused if size and time not changed
+	uint64_t SourceHash;
+	uint64_t Key;
+	vector<CookOutput> Outputs;
+	vector<CookReference> References;
+};
+
+class AssetCooker
+{
+public:
+	AssetCooker();
+
+	/**
+	 * <AssetCook source="dir" output="dir" manifest="file" dedup="true" aliases="file"
+	 * dependencies="file" group="name"> with <Rule relocatable="false"> nodes, paths are relative
+	 * to config file. With dedup, identical outputs under output dir are stored once and the others
+	 * are written to alias table for ResourceManager. Dependencies reported by tools are merged into
+	 * one DependencyManifest, resources under output dir are named relative to it in group.
+	 */
+	bool LoadConfig(const String& configFile);
+
+	void LoadManifest();
+	void SaveManifest() const;
+	void SaveAliasTable() const;
+	void SaveDependencies() const;
+
+	/**
+	 * Scan source tree and cook stale sources on all pool threads. Outputs of removed sources
+	 * are deleted if prune. Return number of failed jobs.
+	 */
+	uint32_t Cook(bool force, bool prune);
+
+	const std::map<String, CookRecord>& GetManifest() const		{ return mManifest; }
+
+public:
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t hash);
+	static bool HashFile(const String& file, uint64_t& hash);
+
+	/**
+	 * Check output deduplication and output collisions on in-memory jobs, nothing is cooked.
+	 * Return false and print the failed case if an output is shared where its relative references
+	 * would break, or if jobs writing same file aren't serialized and failed.
+	 */
+	static bool SelfTest();
+
+private:
+	struct CookJob
+	{
+		const CookRule* Rule;
+		CookRecord Record;
+		String Command;
+		String OutputDir;
+		String OutputList;
+		String DependencyList;
+		DependencyManifest Dependencies;	// Source and outputs entries, cooker names
+		bool Stale;
+		bool Succeeded;
+	};
+
+	const CookRule* FindRule(const String& file) const;
+	String ExpandTokens(const String& str, const CookJob& job) const;
+
+	void PrepareJob(CookJob& job);
+	void RunJob(CookJob& job);
+
+	/// Rule outputs with tokens expanded, files listed in {OutputList} are known after run.
+	vector<String> GetDeclaredOutputs(const CookJob& job) const;
+
+	/**
+	 * Group stale jobs by files they are expected to write, declared outputs and outputs of last
+	 * cook. Jobs of one group run one after another, groups run in parallel.
+	 */
+	vector<vector<uint32_t> > GroupStaleJobs(const vector<CookJob>& jobs, const vector<uint32_t>& staleJobs) const;
+
+	/**
+	 * Fail all jobs writing same output file, e.g. two FBX files of one directory with materials
+	 * of same name, file holds content of only one. Return failed jobs, they get no record.
+	 */
+	vector<uint32_t> FailCollidingOutputs(vector<CookJob>& jobs);
+
+	/**
+	 * Hash referenced files of record, hashes of cached references are reused if size and time
+	 * not changed. Missing files hash to 0.
+	 */
+	void HashReferences(CookRecord& record, const vector<CookReference>& cached) const;
+	uint64_t ComputeKey(const CookJob& job) const;
+
+	/**
+	 * Tool dependency names are file paths, outputs are named relative to output root in
+	 * resource group and source files relative to source root.
+	 */
+	String GetResourceName(const String& file) const;
+	String GetSourceName(const String& file) const;
+	void ReadJobDependencies(CookJob& job);
+
+	/**
+	 * Resources resolve referenced files relative to their own directory, e.g. material textures
+	 * and mesh materials. Output is relocatable if its rule says so, or if tool reported it as
+	 * a resource without dependencies.
+	 */
+	bool IsRelocatable(const CookJob& job, const CookOutput& output) const;
+
+	/**
+	 * Return jobs with outputs shared with a file whose content changed, or with a file in other
+	 * directory they can't be shared with, they must be cooked again.
+	 */
+	vector<uint32_t> FindInvalidSharedOutputs(const vector<CookJob>& jobs) const;
+
+	/**
+	 * Group outputs by content, the first file name of each group keeps the content and other
+	 * files are removed. Outputs which are not relocatable are only shared within one directory.
+	 */
+	void DeduplicateOutputs(vector<CookJob>& jobs);
+
+	void Log(const String& msg);
+
+private:
+	String mSourceRoot;
+	String mOutputRoot;
+	String mManifestFile;
+	String mAliasFile;
+	String mDependencyFile;
+	String mResourceGroup;
+	bool mDeduplicate;
+
+	vector<CookRule> mRules;
+	std::map<String, CookRecord> mManifest;
+	DependencyManifest mDependencies;
+
+	std::mutex mLogMutex;
+};
+
+#endif // AssetCooker_h__
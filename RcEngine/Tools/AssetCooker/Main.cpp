@@ -0,0 +1,68 @@
+// Cook source assets with importer tools, only sources whose content, tool or command line
+// changed since last run are cooked again. See AssetCook.xml for rules.
+//
+// Usage: AssetCooker [-j threads] [-force] [-prune] [-selftest] [config.xml]
+//
+// -selftest checks output deduplication without cooking anything.
+
+#include "AssetCooker.h"
+#include <Core/ThreadPool.h>
+#include <Core/Exception.h>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	String configFile = "AssetCook.xml";
+	uint32_t numThreads = 0;
+	bool force = false;
+	bool prune = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		String arg = argv[i];
+		if (arg == "-j" && i + 1 < argc)
+			numThreads = (uint32_t)atoi(argv[++i]);
+		else if (arg == "-force")
+			force = true;
+		else if (arg == "-prune")
+			prune = true;
+		else if (arg == "-selftest")
+			return AssetCooker::SelfTest() ? 0 : 1;
+		else if (arg[0] == '-')
+		{
+			std::cout << "Usage: AssetCooker [-j threads] [-force] [-prune] [-selftest] [config.xml]" << std::endl;
+			return 1;
+		}
+		else
+			configFile = arg;
+	}
+
+	// Calling thread runs jobs as well, default pool uses all cores
+	if (numThreads == 0)
+		ThreadPool::Initialize();
+	else if (numThreads > 1)
+		new ThreadPool(numThreads - 1);
+
+	int result = 0;
+	try
+	{
+		AssetCooker cooker;
+		if (cooker.LoadConfig(configFile))
+		{
+			cooker.LoadManifest();
+			if (cooker.Cook(force, prune))
+				result = 1;
+			cooker.SaveManifest();
+		}
+		else
+			result = 1;
+	}
+	catch (Exception& e)
+	{
+		std::cout << configFile << ": " << e.GetFullDescription() << std::endl;
+		result = 1;
+	}
+
+	ThreadPool::Finalize();
+	return result;
+}
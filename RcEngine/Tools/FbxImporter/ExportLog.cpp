@@ -8,6 +8,7 @@
 #include "ExportLog.h"
 #include <list>
 #include <cassert>
+#include <mutex>
 
 BOOL g_bLoggingEnabled = TRUE;
 UINT g_uLogLevel = 10;
@@ -22,6 +23,7 @@ StringList      g_WarningsList;
 StringList      g_ErrorsList;
 
 CHAR g_strBuf[500];
+std::mutex g_LogMutex;		// Meshes are processed in parallel, guards g_strBuf and lists
 VOID BroadcastMessage( UINT uMessageType, const CHAR* strMsg );
 
 VOID ExportLog::AddListener( ILogListener* pListener )
@@ -137,6 +139,7 @@ VOID ExportLog::LogMsg( UINT uImportance, const CHAR* strFormat, ... )
 {
     if( !g_bLoggingEnabled || ( uImportance > g_uLogLevel ) )
         return;
+    std::lock_guard<std::mutex> lock( g_LogMutex );
     va_list args;
     va_start( args, strFormat );
     vsprintf_s( g_strBuf, strFormat, args );
@@ -159,6 +162,7 @@ VOID ExportLog::LogError( const CHAR* strFormat, ... )
     if( !g_bLoggingEnabled )
         return;
 
+    std::lock_guard<std::mutex> lock( g_LogMutex );
     ++g_dwErrorCount;
 
     strcpy_s( g_strBuf, "ERROR: " );
@@ -175,6 +179,7 @@ VOID ExportLog::LogWarning( const CHAR* strFormat, ... )
     if( !g_bLoggingEnabled )
         return;
 
+    std::lock_guard<std::mutex> lock( g_LogMutex );
     ++g_dwWarningCount;
 
     strcpy_s( g_strBuf, "WARNING: " );
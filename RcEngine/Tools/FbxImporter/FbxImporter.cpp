@@ -1,13 +1,21 @@
 #include "FbxImporter.h"
 #include <Graphics/GraphicsCommon.h>
 #include <Graphics/VertexDeclaration.h>
+#include <Graphics/MeshOptimizer.h>
+#include <Graphics/MeshSimplifier.h>
+#include <Graphics/VertexQuantization.h>
+#include <Graphics/MeshFormat.h>
+#include <Resource/DependencyManifest.h>
+#include <Core/ThreadPool.h>
 #include <Core/XMLDom.h>
 #include <Core/Exception.h>
 #include <Core/Utility.h>
 #include <IO/FileStream.h>
+#include <IO/CompressedStream.h>
 #include <IO/PathUtil.h>
-#include <set>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <limits> 
 
 #include "ExportLog.h"
@@ -23,6 +31,9 @@ ConsoleOutListener g_ConsoleOutListener;
 DebugSpewListener  g_DebugSpewListener;
 ExportSettings     g_ExportSettings;
 
+// Every file written, reported to asset cooker with -outputs
+vector<String>     g_OutputFiles;
+
 #define MAXBONES_PER_VERTEX 4
 
 namespace {
@@ -43,61 +54,128 @@ uint32_t CalculateVertexSize(uint32_t vertexFlag)
 	return size;
 }
 
-void GetVertexDeclaration(uint32_t vertexFlag, std::vector<VertexElement>& elements, uint32_t& vertexSize)
+void GetVertexDeclaration(uint32_t vertexFlag, bool quantize, std::vector<VertexElement>& elements, uint32_t& vertexSize)
 {
 	size_t offset = 0;
 
 	if (vertexFlag & Vertex::ePosition)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float3, VEU_Position, 0));
-		offset += 12;
+		elements.push_back(VertexElement(offset, quantize ? VEF_UShort4N : VEF_Float3, VEU_Position, 0));
+		offset += quantize ? 8 : 12;
 	}
 
 	if (vertexFlag & Vertex::eBlendWeight)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float4, VEU_BlendWeight, 0));
-		offset += 16;
+		elements.push_back(VertexElement(offset, quantize ? VEF_UByte4N : VEF_Float4, VEU_BlendWeight, 0));
+		offset += quantize ? 4 : 16;
 	}
 
 	if (vertexFlag & Vertex::eBlendIndices)
 	{
-		elements.push_back(VertexElement(offset, VEF_UInt4, VEU_BlendIndices, 0));
-		offset += 16;
+		elements.push_back(VertexElement(offset, quantize ? VEF_UByte4 : VEF_UInt4, VEU_BlendIndices, 0));
+		offset += quantize ? 4 : 16;
 	}
 
 	if (vertexFlag & Vertex::eNormal)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float3, VEU_Normal, 0));
-		offset += 12;
+		elements.push_back(VertexElement(offset, quantize ? VEF_Short2N : VEF_Float3, VEU_Normal, 0));
+		offset += quantize ? 4 : 12;
 	}
 
 	if (vertexFlag & Vertex::eTexcoord0)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float2, VEU_TextureCoordinate, 0));
-		offset += 8;
+		elements.push_back(VertexElement(offset, quantize ? VEF_Half2 : VEF_Float2, VEU_TextureCoordinate, 0));
+		offset += quantize ? 4 : 8;
 	}
 
 	if (vertexFlag & Vertex::eTexcoord1)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float2, VEU_TextureCoordinate, 1));
-		offset += 8;
+		elements.push_back(VertexElement(offset, quantize ? VEF_Half2 : VEF_Float2, VEU_TextureCoordinate, 1));
+		offset += quantize ? 4 : 8;
 	}
 
 	if (vertexFlag & Vertex::eTangent)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float3, VEU_Tangent, 0));
-		offset += 12;
+		elements.push_back(VertexElement(offset, quantize ? VEF_Short2N : VEF_Float3, VEU_Tangent, 0));
+		offset += quantize ? 4 : 12;
 	}
 
 	if (vertexFlag & Vertex::eBinormal)
 	{
-		elements.push_back(VertexElement(offset, VEF_Float3, VEU_Binormal, 0));
-		offset += 12;
+		elements.push_back(VertexElement(offset, quantize ? VEF_Short2N : VEF_Float3, VEU_Binormal, 0));
+		offset += quantize ? 4 : 12;
 	}
 
 	vertexSize = offset;
 }
 
+void WriteQuantizedVertex(Stream& stream, const Vertex& vertex, const BoundingBoxf& bound)
+{
+	uint32_t vertexFlag = vertex.Flags;
+
+	if (vertexFlag & Vertex::ePosition)
+	{
+		uint16_t position[4];
+		VertexQuantization::QuantizePosition(position, vertex.Position, bound.Min, bound.Max);
+		stream.Write(position, sizeof(position));
+	}
+
+	if (vertexFlag & Vertex::eBlendWeight)
+	{
+		assert(vertex.BlendWeights.size() == 4);
+		uint8_t weights[4];
+		VertexQuantization::QuantizeBlendWeights(weights, &vertex.BlendWeights[0]);
+		stream.Write(weights, sizeof(weights));
+	}
+
+	if (vertexFlag & Vertex::eBlendIndices)
+	{
+		assert(vertex.BlendIndices.size() == 4);
+		uint8_t indices[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			if (vertex.BlendIndices[i] > 255)
+				ENGINE_EXCEPT(Exception::ERR_INVALID_PARAMS, "Bone index exceeds 255, can't quantize", "WriteQuantizedVertex");
+			indices[i] = (uint8_t)vertex.BlendIndices[i];
+		}
+		stream.Write(indices, sizeof(indices));
+	}
+
+	int16_t octahedral[2];
+	if (vertexFlag & Vertex::eNormal)
+	{
+		VertexQuantization::EncodeOctahedral(octahedral, vertex.Normal);
+		stream.Write(octahedral, sizeof(octahedral));
+	}
+
+	uint16_t texcoord[2];
+	if (vertexFlag & Vertex::eTexcoord0)
+	{
+		texcoord[0] = VertexQuantization::FloatToHalf(vertex.Tex0.X());
+		texcoord[1] = VertexQuantization::FloatToHalf(vertex.Tex0.Y());
+		stream.Write(texcoord, sizeof(texcoord));
+	}
+
+	if (vertexFlag & Vertex::eTexcoord1)
+	{
+		texcoord[0] = VertexQuantization::FloatToHalf(vertex.Tex1.X());
+		texcoord[1] = VertexQuantization::FloatToHalf(vertex.Tex1.Y());
+		stream.Write(texcoord, sizeof(texcoord));
+	}
+
+	if (vertexFlag & Vertex::eTangent)
+	{
+		VertexQuantization::EncodeOctahedral(octahedral, vertex.Tangent);
+		stream.Write(octahedral, sizeof(octahedral));
+	}
+
+	if (vertexFlag & Vertex::eBinormal)
+	{
+		VertexQuantization::EncodeOctahedral(octahedral, vertex.Binormal);
+		stream.Write(octahedral, sizeof(octahedral));
+	}
+}
+
 void CorrectName(String& matName)
 {
 	std::replace(matName.begin(), matName.end(), ':', '_');
@@ -177,6 +255,27 @@ bool GetMaterialTexture(const FbxSurfaceMaterial *pMaterial, const char *pProper
 	return true;
 }
 
+// FNV-1a hash of file content, false if file can't be read
+bool HashFileContent(const String& file, uint64_t& hash)
+{
+	FILE* fp = fopen(file.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	hash = 14695981039346656037ULL;
+
+	uint8_t buffer[4096];
+	size_t bytesRead;
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+	{
+		for (size_t i = 0; i < bytesRead; ++i)
+			hash = (hash ^ buffer[i]) * 1099511628211ULL;
+	}
+
+	fclose(fp);
+	return true;
+}
+
 FbxNode* GetBoneRoot(FbxNode* boneNode)
 {
 	assert(boneNode &&
@@ -306,6 +405,172 @@ float3 BakeDirection(const float3& dir, const float4x4& globalTransform)
 	return float3(baked[0], baked[1], baked[2]);
 }
 
+/**
+ * Open addressing hash table of welded vertices, stores indices into vertex array.
+ * Epsilon 0 welds vertices with equal position, normal and texcoords. Otherwise vertices within
+ * epsilon in every component are welded, table is keyed by position cell and neighbor cells are probed.
+ */
+class VertexWeldTable
+{
+public:
+	static const uint32_t InvalidIndex = UINT32_MAX;
+
+public:
+	VertexWeldTable(const vector<Vertex>& vertices, float epsilon)
+		: mVertices(vertices),
+		  mEpsilon(epsilon),
+		  mCount(0)
+	{
+		mSlots.resize(1024);
+	}
+
+	/// Return index of an existing vertex to weld with, InvalidIndex if none.
+	uint32_t Find(const Vertex& vertex) const
+	{
+		if (mEpsilon == 0.0f)
+			return Probe(HashVertex(vertex), vertex);
+
+		int64_t cell[3];
+		GetCell(vertex.Position, cell);
+
+		for (int64_t x = cell[0] - 1; x <= cell[0] + 1; ++x)
+		{
+			for (int64_t y = cell[1] - 1; y <= cell[1] + 1; ++y)
+			{
+				for (int64_t z = cell[2] - 1; z <= cell[2] + 1; ++z)
+				{
+					int64_t neighbor[3] = { x, y, z };
+					uint32_t index = Probe(HashCell(neighbor), vertex);
+					if (index != InvalidIndex)
+						return index;
+				}
+			}
+		}
+
+		return InvalidIndex;
+	}
+
+	/// Add vertex at index of vertex array.
+	void Insert(uint32_t index)
+	{
+		if ((mCount + 1) * 2 > mSlots.size())
+		{
+			vector<Slot> oldSlots(mSlots.size() * 2);
+			oldSlots.swap(mSlots);
+
+			for (const Slot& slot : oldSlots)
+			{
+				if (slot.Index != InvalidIndex)
+					Place(slot);
+			}
+		}
+
+		const Vertex& vertex = mVertices[index];
+
+		Slot slot;
+		slot.Index = index;
+		if (mEpsilon == 0.0f)
+			slot.Hash = HashVertex(vertex);
+		else
+		{
+			int64_t cell[3];
+			GetCell(vertex.Position, cell);
+			slot.Hash = HashCell(cell);
+		}
+
+		Place(slot);
+		mCount++;
+	}
+
+private:
+	struct Slot
+	{
+		Slot() : Hash(0), Index(InvalidIndex) {}
+
+		uint32_t Hash;
+		uint32_t Index;
+	};
+
+	static inline uint32_t HashFloat(uint32_t hash, float value)
+	{
+		// -0 and 0 compare equal, so hash same bits
+		value += 0.0f;
+
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return (hash ^ bits) * 16777619u;
+	}
+
+	static uint32_t HashVertex(const Vertex& vertex)
+	{
+		uint32_t hash = 2166136261u;
+		for (int i = 0; i < 3; ++i) hash = HashFloat(hash, vertex.Position[i]);
+		for (int i = 0; i < 3; ++i) hash = HashFloat(hash, vertex.Normal[i]);
+		for (int i = 0; i < 2; ++i) hash = HashFloat(hash, vertex.Tex0[i]);
+		for (int i = 0; i < 2; ++i) hash = HashFloat(hash, vertex.Tex1[i]);
+		return hash;
+	}
+
+	static uint32_t HashCell(const int64_t cell[3])
+	{
+		uint64_t hash = uint64_t(cell[0]) * 73856093u ^ uint64_t(cell[1]) * 19349663u ^ uint64_t(cell[2]) * 83492791u;
+		return uint32_t(hash ^ (hash >> 32));
+	}
+
+	void GetCell(const float3& position, int64_t cell[3]) const
+	{
+		for (int i = 0; i < 3; ++i)
+			cell[i] = (int64_t)floor(position[i] / mEpsilon);
+	}
+
+	bool Equal(const Vertex& lhs, const Vertex& rhs) const
+	{
+		// Component compare, Vector::operator== compares bits
+		for (int i = 0; i < 3; ++i)
+		{
+			if (fabs(lhs.Position[i] - rhs.Position[i]) > mEpsilon || fabs(lhs.Normal[i] - rhs.Normal[i]) > mEpsilon)
+				return false;
+		}
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (fabs(lhs.Tex0[i] - rhs.Tex0[i]) > mEpsilon || fabs(lhs.Tex1[i] - rhs.Tex1[i]) > mEpsilon)
+				return false;
+		}
+
+		return true;
+	}
+
+	uint32_t Probe(uint32_t hash, const Vertex& vertex) const
+	{
+		size_t mask = mSlots.size() - 1;
+		for (size_t i = hash & mask; mSlots[i].Index != InvalidIndex; i = (i + 1) & mask)
+		{
+			if (mSlots[i].Hash == hash && Equal(mVertices[mSlots[i].Index], vertex))
+				return mSlots[i].Index;
+		}
+
+		return InvalidIndex;
+	}
+
+	void Place(const Slot& slot)
+	{
+		size_t mask = mSlots.size() - 1;
+		size_t i = slot.Hash & mask;
+		while (mSlots[i].Index != InvalidIndex)
+			i = (i + 1) & mask;
+
+		mSlots[i] = slot;
+	}
+
+private:
+	const vector<Vertex>& mVertices;
+	float mEpsilon;
+
+	vector<Slot> mSlots;
+	size_t mCount;
+};
+
 } // Namespace
 
 //---------------------------------------------------------------------------------------------
@@ -563,10 +828,19 @@ void FbxProcesser::ProcessScene( )
 	CollectMeshes();
 	CollectAnimations();
 
+	if (g_ExportSettings.DeduplicateMaterials)
+		DeduplicateMaterials();
+
 	if (g_ExportSettings.MergeScene)
 		MergeSceneMeshs();
 
+	if (g_ExportSettings.OptimizeMesh)
+		OptimizeMeshParts();
+
 	MergeMeshParts();
+
+	if (g_ExportSettings.LodCount)
+		GenerateLods();
 }
 
 void FbxProcesser::RunCommand( const vector<String>& arguments )
@@ -634,11 +908,11 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 	// just use layer 0.
 	FbxLayer* layer = pMesh->GetLayer(0);
 
-	int tangentRefMode = layer->GetTangents() ? layer->GetTangents()->GetReferenceMode() : -1;
-	int binormalRefMode = layer->GetBinormals() ? layer->GetBinormals()->GetReferenceMode() : -1;
+	shared_ptr<MeshContext> context = std::make_shared<MeshContext>();
+	context->Node = pNode;
 
 	// group the polygons by material
-	vector< vector<int> > polysByMaterial;
+	vector< vector<int> >& polysByMaterial = context->PolysByMaterial;
 	polysByMaterial.resize((std::max)(1,numMaterial));
     const FbxLayerElementMaterial* materials = layer->GetMaterials();
 
@@ -684,11 +958,38 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 			polysByMaterial[0].push_back(i);
 	}
 
-	// get the uv sets
-	vector<String> uvSets;
-	for (int i = 0; i < layer->GetUVSetCount(); ++i)
-		uvSets.push_back(layer->GetUVSets()[i]->GetName());
-	
+	// Material names and the vertex attributes their textures need
+	int tangentRefMode = layer->GetTangents() ? layer->GetTangents()->GetReferenceMode() : -1;
+	for (size_t mi = 0; mi < polysByMaterial.size(); ++mi)
+	{
+		String materialName = useDefaultMat ? "DefaultMaterial" : pNode->GetMaterial(mi)->GetName();
+		CorrectName(materialName);
+
+		uint32_t vertexFlag = 0;
+		FbxSurfaceMaterial *material = pNode->GetMaterial(mi);
+		if (material)
+		{
+			String filename;
+			if (tangentRefMode != -1)
+			{
+				if (GetMaterialTexture(material, FbxSurfaceMaterial::sBump, &filename) && !filename.empty())
+					vertexFlag |= Vertex::eTexcoord0| Vertex::eTangent;
+
+				if (GetMaterialTexture(material, FbxSurfaceMaterial::sNormalMap, &filename) && !filename.empty())
+					vertexFlag |= Vertex::eTexcoord0| Vertex::eTangent;
+			}
+
+			if (!useDefaultMat)
+			{
+				if (GetMaterialTexture(material, FbxSurfaceMaterial::sDiffuse, &filename) && !filename.empty())
+					vertexFlag |= Vertex::eTexcoord0;
+			}
+		}
+
+		context->MaterialNames.push_back(materialName);
+		context->MaterialVertexFlags.push_back(vertexFlag);
+	}
+
 	// test if had skin
 	bool lHasSkin = false;
 	if (g_ExportSettings.ExportSkeleton)  // Only process skin when ExportSkeleton is set
@@ -701,7 +1002,7 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 	mesh->Name = pNode->GetName();
 	CorrectName(mesh->Name);
 
-	std::vector<BoneWeights> meshBoneWeights;
+	std::vector<BoneWeights>& meshBoneWeights = context->MeshBoneWeights;
 	if (lHasSkin)
 	{
 		meshBoneWeights.resize(pMesh->GetControlPointsCount());
@@ -720,10 +1021,37 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 		}
 	}
  
-	float4x4 totalMatrix = matrixFromFBX( pNode->EvaluateGlobalTransform() * GetGeometry(pNode) );
-	float4x4 totalMatrixNormal = totalMatrix.Inverse();
-	totalMatrixNormal = totalMatrixNormal.Transpose();
-	
+	context->Mesh = mesh;
+	context->HasSkin = lHasSkin;
+	context->TotalMatrix = matrixFromFBX( pNode->EvaluateGlobalTransform() * GetGeometry(pNode) );
+	context->TotalMatrixNormal = context->TotalMatrix.Inverse().Transpose();
+
+	// Keep scene order, mesh parts are filled by ProcessMeshParts
+	mSceneMeshes.push_back(mesh);
+	mMeshContexts.push_back(context);
+}
+
+void FbxProcesser::ProcessMeshParts( MeshContext& context )
+{
+	FbxNode* pNode = context.Node;
+	FbxMesh* pMesh = pNode->GetMesh();
+	FbxLayer* layer = pMesh->GetLayer(0);
+
+	int tangentRefMode = layer->GetTangents() ? layer->GetTangents()->GetReferenceMode() : -1;
+	int binormalRefMode = layer->GetBinormals() ? layer->GetBinormals()->GetReferenceMode() : -1;
+
+	// get the uv sets
+	vector<String> uvSets;
+	for (int i = 0; i < layer->GetUVSetCount(); ++i)
+		uvSets.push_back(layer->GetUVSets()[i]->GetName());
+
+	shared_ptr<MeshData> mesh = context.Mesh;
+	const vector< vector<int> >& polysByMaterial = context.PolysByMaterial;
+	std::vector<BoneWeights>& meshBoneWeights = context.MeshBoneWeights;
+	const float4x4& totalMatrix = context.TotalMatrix;
+	const float4x4& totalMatrixNormal = context.TotalMatrixNormal;
+	bool lHasSkin = context.HasSkin;
+
 	for (size_t mi = 0; mi < polysByMaterial.size(); ++mi)
 	{
 		shared_ptr<MeshPartData> meshPart( new MeshPartData() );
@@ -734,46 +1062,9 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 			meshPart->Name += std::to_string(mi);
 
 		// material name
-		meshPart->MaterialName = useDefaultMat ? "DefaultMaterial" : pNode->GetMaterial(mi)->GetName();
-		CorrectName(meshPart->MaterialName);
+		meshPart->MaterialName = context.MaterialNames[mi];
 
-		uint32_t vertexFlag = 0;
-		
-		if (tangentRefMode != -1)
-		{
-			FbxSurfaceMaterial *material = pNode->GetMaterial(mi);
-			
-			if (material)
-			{
-				String filename;
-				if (GetMaterialTexture(material, FbxSurfaceMaterial::sBump, &filename))
-				{
-					if (!filename.empty())
-						vertexFlag |= Vertex::eTexcoord0| Vertex::eTangent;
-				}
-				
-				if (GetMaterialTexture(material, FbxSurfaceMaterial::sNormalMap, &filename))
-				{
-					if (!filename.empty())
-						vertexFlag |= Vertex::eTexcoord0| Vertex::eTangent;
-				}
-			}		
-		}
-
-		if (!useDefaultMat)
-		{
-			FbxSurfaceMaterial *material = pNode->GetMaterial(mi);
-
-			if (material)
-			{
-				String filename;
-				if (GetMaterialTexture(material, FbxSurfaceMaterial::sDiffuse, &filename))
-				{
-					if (!filename.empty())
-						vertexFlag |= Vertex::eTexcoord0;
-				}
-			}		
-		}
+		uint32_t vertexFlag = context.MaterialVertexFlags[mi];
 
 		if (lHasSkin)
 		{
@@ -781,7 +1072,7 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 			vertexFlag |= Vertex::eBlendWeight;
 		}
 
-		std::set<Vertex> exitingVertices;
+		VertexWeldTable weldTable(meshPart->Vertices, g_ExportSettings.WeldEpsilon);
 
 		for (size_t pi = 0; pi < polysByMaterial[mi].size(); ++pi)
 		{
@@ -884,19 +1175,15 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 					vertex.Binormal.Normalize();		
 				}
 
-				size_t index;
-
-				std::set<Vertex>::iterator exitingIter = exitingVertices.find(vertex);
-				if (exitingIter == exitingVertices.end())
+				uint32_t index = weldTable.Find(vertex);
+				if (index == VertexWeldTable::InvalidIndex)
 				{
 					vertex.Index = meshPart->Vertices.size();
 					index = vertex.Index;
 					vertex.Flags = vertexFlag;
-					exitingVertices.insert(vertex);
 					meshPart->Vertices.push_back(vertex);
+					weldTable.Insert(index);
 				}
-				else
-					index = exitingIter->Index;
 
 				meshPart->Indices.push_back(index);
 			}
@@ -910,8 +1197,6 @@ void FbxProcesser::ProcessMesh( FbxNode* pNode )
 			mesh->MeshParts.push_back(meshPart);
 		}
 	}
-
-	mSceneMeshes.push_back(mesh);
 }
 
 void FbxProcesser::ProcessSkeleton( FbxNode* pNode )
@@ -1161,8 +1446,11 @@ void FbxProcesser::ProcessAnimation( const String& clipName, FbxNode* pNode, dou
 
 			if( pBone )
 			{	
-				AnimationClipData::AnimationTrack track;
-				track.Name = pNode->GetName();
+				// Key frames are decomposed by CollectAnimations
+				mAnimationTracks.push_back(AnimationTrackContext());
+				AnimationTrackContext& context = mAnimationTracks.back();
+				context.Clip = &clip;
+				context.Track.Name = pNode->GetName();
 
 				double fTime = 0;
 				while( fTime <= fStop )
@@ -1170,26 +1458,18 @@ void FbxProcesser::ProcessAnimation( const String& clipName, FbxNode* pNode, dou
 					FbxTime takeTime;
 					takeTime.SetSecondDouble(fTime);
 
-					FbxAMatrix offset = GetGeometry(pNode);
-
 					FbxAMatrix matAbsoluteTransform = GetGlobalPosition(pNode, takeTime);	
 					FbxAMatrix matParentAbsoluteTransform = GetGlobalPosition(pNode->GetParent(), takeTime);
-					FbxAMatrix matLocalTrasform = matParentAbsoluteTransform.Inverse() * matAbsoluteTransform;
+					context.LocalTransforms.push_back(matParentAbsoluteTransform.Inverse() * matAbsoluteTransform);
 
 					AnimationClipData::KeyFrame keyframe;
-
-					float4x4 localTrasform = matrixFromFBX(matLocalTrasform);
-					mFBXTransformer.TransformMatrix(&localTrasform, &localTrasform);
-					MatrixDecompose(keyframe.Scale, keyframe.Rotation, keyframe.Translation, localTrasform);
-
 					keyframe.Time = (float)fTime;
-					track.KeyFrames.push_back(keyframe);
+					context.Track.KeyFrames.push_back(keyframe);
 
 					fTime += 1.0f/fFrameRate;
 				}
 
 				clip.Duration = (float)(fTime-1.0f/fFrameRate);
-				clip.mAnimationTracks.push_back(track);
 			}	
 			else 
 				ExportLog::LogWarning("Bone: %s not found", pNode->GetName());
@@ -1278,6 +1558,7 @@ void FbxProcesser::CollectMaterials( )
 						{
 							 String filepath =  pFileTexture->GetFileName();
 							 matData.Textures[FbxLayerElement::sTextureChannelNames[textureLayerIndex]] = filepath;
+							 mTextureFiles.insert(filepath);
 							 /*std::cout << FbxLayerElement::sTextureChannelNames[textureLayerIndex] << ": " << filepath << std::endl;*/
 						}
 					}  
@@ -1289,6 +1570,89 @@ void FbxProcesser::CollectMaterials( )
 	}
 }
 
+void FbxProcesser::DeduplicateMaterials()
+{
+	// Hash each texture file once, file reads run in parallel
+	vector<String> hashFiles;
+	std::map<String, uint32_t> hashIndices;
+	for (const MaterialData& material : mMaterials)
+	{
+		for (const auto& kv : material.Textures)
+		{
+			if (hashIndices.insert(std::make_pair(kv.second, (uint32_t)hashFiles.size())).second)
+				hashFiles.push_back(kv.second);
+		}
+	}
+
+	vector<uint64_t> fileHashes(hashFiles.size());
+	vector<uint8_t> fileHashed(hashFiles.size());
+	ParallelFor(0, hashFiles.size(), [&](uint32_t i) {
+		fileHashed[i] = HashFileContent(hashFiles[i], fileHashes[i]);
+	});
+
+	// Same texture under different file names, first file name is referenced
+	std::map<uint64_t, String> textureFiles;
+	for (MaterialData& material : mMaterials)
+	{
+		for (auto& kv : material.Textures)
+		{
+			uint32_t hashIndex = hashIndices[kv.second];
+			if (!fileHashed[hashIndex])
+				continue;
+
+			uint64_t hash = fileHashes[hashIndex];
+
+			auto inserted = textureFiles.insert(std::make_pair(hash, kv.second));
+			if (!inserted.second && inserted.first->second != kv.second)
+			{
+				ExportLog::LogMsg(2, "Texture %s is same as %s\n", kv.second.c_str(), inserted.first->second.c_str());
+				kv.second = inserted.first->second;
+			}
+		}
+	}
+
+	// Materials with same content under different names, mesh parts use the first one
+	std::map<String, String> materialKeys;
+	unordered_map<String, String> materialRemap;
+	vector<MaterialData> uniqueMaterials;
+	for (const MaterialData& material : mMaterials)
+	{
+		std::ostringstream key;
+		key << std::setprecision(9);
+		for (int i = 0; i < 3; ++i)
+			key << material.Ambient[i] << ' ' << material.Diffuse[i] << ' ' << material.Specular[i] << ' ' << material.Emissive[i] << ' ';
+		key << material.Power;
+
+		std::map<String, String> textures(material.Textures.begin(), material.Textures.end());
+		for (const auto& kv : textures)
+			key << '|' << kv.first << '=' << kv.second;
+
+		auto inserted = materialKeys.insert(std::make_pair(key.str(), material.Name));
+		if (inserted.second)
+			uniqueMaterials.push_back(material);
+		else
+		{
+			ExportLog::LogMsg(2, "Material %s is same as %s\n", material.Name.c_str(), inserted.first->second.c_str());
+			materialRemap[material.Name] = inserted.first->second;
+		}
+	}
+
+	if (materialRemap.empty())
+		return;
+
+	mMaterials.swap(uniqueMaterials);
+
+	for (shared_ptr<MeshData>& mesh : mSceneMeshes)
+	{
+		for (shared_ptr<MeshPartData>& meshPart : mesh->MeshParts)
+		{
+			auto found = materialRemap.find(meshPart->MaterialName);
+			if (found != materialRemap.end())
+				meshPart->MaterialName = found->second;
+		}
+	}
+}
+
 void DumpBoneTree(std::ofstream& stream, const Bone* node, int depth)
 {
 	if (node)
@@ -1324,6 +1688,13 @@ void FbxProcesser::CollectMeshes( )
 {
 	ExportLog::LogMsg(0, "Collect Meshes.");
 	ProcessNode(mFBXScene->GetRootNode(), FbxNodeAttribute::eMesh);
+
+	// Scene is read serially by ProcessMesh, vertex extraction of different meshes runs in parallel
+	ParallelFor(0, mMeshContexts.size(), [&](uint32_t i) {
+		ProcessMeshParts(*mMeshContexts[i]);
+	});
+
+	mMeshContexts.clear();
 }
 
 void FbxProcesser::CollectAnimations( )
@@ -1380,6 +1751,25 @@ void FbxProcesser::CollectAnimations( )
 			}
 		}
 	}
+
+	// Scene evaluator has one current take and is not thread safe, so takes are sampled
+	// serially above, key frames of all takes are converted and decomposed in parallel
+	ParallelFor(0, mAnimationTracks.size(), [&](uint32_t i) {
+		AnimationTrackContext& context = mAnimationTracks[i];
+		for (size_t k = 0; k < context.LocalTransforms.size(); ++k)
+		{
+			AnimationClipData::KeyFrame& keyframe = context.Track.KeyFrames[k];
+
+			float4x4 localTrasform = matrixFromFBX(context.LocalTransforms[k]);
+			mFBXTransformer.TransformMatrix(&localTrasform, &localTrasform);
+			MatrixDecompose(keyframe.Scale, keyframe.Rotation, keyframe.Translation, localTrasform);
+		}
+	});
+
+	for (AnimationTrackContext& context : mAnimationTracks)
+		context.Clip->mAnimationTracks.push_back(context.Track);
+
+	mAnimationTracks.clear();
 }
 
 void FbxProcesser::MergeSceneMeshs()
@@ -1407,6 +1797,53 @@ void FbxProcesser::MergeSceneMeshs()
 	}	
 }
 
+void FbxProcesser::OptimizeMeshParts()
+{
+	vector<shared_ptr<MeshPartData> > meshParts;
+	for (size_t mi = 0; mi < mSceneMeshes.size(); ++mi)
+		meshParts.insert(meshParts.end(), mSceneMeshes[mi]->MeshParts.begin(), mSceneMeshes[mi]->MeshParts.end());
+
+	// Mesh parts are independent
+	ParallelFor(0, meshParts.size(), [&](uint32_t partIndex) {
+		
+		MeshPartData* meshPart = meshParts[partIndex].get();
+		{
+			vector<uint32_t>& indices = meshPart->Indices;
+			vector<Vertex>& vertices = meshPart->Vertices;
+
+			if (indices.empty() || vertices.empty())
+				return;
+
+			uint32_t indexCount = indices.size();
+			uint32_t vertexCount = vertices.size();
+
+			VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(&indices[0], indexCount, vertexCount);
+
+			MeshOptimizer::OptimizeVertexCache(&indices[0], &indices[0], indexCount, vertexCount);
+			MeshOptimizer::OptimizeOverdraw(&indices[0], &indices[0], indexCount, 
+				vertices[0].Position(), sizeof(Vertex), vertexCount);
+
+			// Vertices in order of first use
+			vector<uint32_t> remap(vertexCount);
+			MeshOptimizer::OptimizeVertexFetchRemap(&remap[0], &indices[0], indexCount, vertexCount);
+			MeshOptimizer::RemapIndices(&indices[0], &indices[0], indexCount, &remap[0]);
+
+			vector<Vertex> remapped(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				remapped[remap[i]] = vertices[i];
+				remapped[remap[i]].Index = remap[i];
+			}
+			vertices.swap(remapped);
+
+			VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(&indices[0], indexCount, vertexCount);
+
+			ExportLog::LogMsg(1, "Optimize mesh part %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", meshPart->Name.c_str(),
+				before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+		}
+	});
+}
+
 void FbxProcesser::MergeMeshParts()
 {
 	for (size_t mi = 0; mi < mSceneMeshes.size(); ++mi)
@@ -1551,6 +1988,105 @@ void FbxProcesser::MergeMeshParts()
 	}
 }
 
+void FbxProcesser::GenerateLods()
+{
+	struct PartLods
+	{
+		MeshData* Mesh;
+		MeshPartData* MeshPart;
+		vector<vector<uint32_t> > Indices;
+	};
+
+	vector<PartLods> partLods;
+	for (size_t mi = 0; mi < mSceneMeshes.size(); ++mi)
+	{
+		for (shared_ptr<MeshPartData>& meshPart : mSceneMeshes[mi]->MeshParts)
+		{
+			PartLods lods;
+			lods.Mesh = mSceneMeshes[mi].get();
+			lods.MeshPart = meshPart.get();
+			partLods.push_back(lods);
+		}
+	}
+
+	// Simplify mesh parts in parallel, index buffers are only read
+	ParallelFor(0, partLods.size(), [&](uint32_t partIndex) {
+
+		MeshData& mesh = *partLods[partIndex].Mesh;
+		MeshPartData* meshPart = partLods[partIndex].MeshPart;
+		if (meshPart->IndexCount == 0)
+			return;
+
+		float targetError = g_ExportSettings.LodMaxError * Length(mesh.Bound.Max - mesh.Bound.Min);
+
+		const vector<uint32_t>& indexBuffer = mesh.Indices[meshPart->IndexBufferIndex];
+		const Vertex* vertices = &mesh.Vertices[meshPart->VertexBufferIndex][meshPart->BaseVertex];
+
+		vector<uint32_t> indices(indexBuffer.begin() + meshPart->StartIndex, indexBuffer.begin() + meshPart->StartIndex + meshPart->IndexCount);
+		uint32_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+
+		// Lock vertices of triangles spanning different dominant bones, keep bone weight borders
+		vector<uint8_t> vertexLock(vertexCount, 0);
+		if (vertices[0].BlendWeights.size())
+		{
+			vector<uint32_t> dominantBone(vertexCount);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				const Vertex& vertex = vertices[v];
+				size_t maxWeight = std::max_element(vertex.BlendWeights.begin(), vertex.BlendWeights.end()) - vertex.BlendWeights.begin();
+				dominantBone[v] = vertex.BlendIndices.size() ? vertex.BlendIndices[maxWeight] : 0;
+			}
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t i0 = indices[i], i1 = indices[i+1], i2 = indices[i+2];
+				if (dominantBone[i0] != dominantBone[i1] || dominantBone[i0] != dominantBone[i2])
+					vertexLock[i0] = vertexLock[i1] = vertexLock[i2] = 1;
+			}
+		}
+
+		// Each level is simplified from full mesh part, so error is measured against source geometry
+		uint32_t previousCount = meshPart->IndexCount;
+		vector<uint32_t> lodIndices(indices.size());
+		for (uint32_t level = 0; level < g_ExportSettings.LodCount; ++level)
+		{
+			uint32_t targetCount = uint32_t(previousCount * g_ExportSettings.LodReduction) / 3 * 3;
+
+			float lodError;
+			uint32_t lodCount = MeshSimplifier::Simplify(&lodIndices[0], &indices[0], indices.size(), vertices[0].Position(), sizeof(Vertex), 
+				vertexCount, targetCount, targetError, &vertexLock[0], &lodError);
+
+			// Stop if error bound or locked vertices keep triangle count
+			if (lodCount == 0 || lodCount > previousCount * (1.0f + g_ExportSettings.LodReduction) / 2)
+				break;
+
+			MeshOptimizer::OptimizeVertexCache(&lodIndices[0], &lodIndices[0], lodCount, vertexCount);
+
+			MeshLodLevel lod;
+			lod.IndexStart = 0;
+			lod.IndexCount = lodCount;
+			lod.Error = lodError;
+			meshPart->Lods.push_back(lod);
+
+			partLods[partIndex].Indices.push_back( vector<uint32_t>(lodIndices.begin(), lodIndices.begin() + lodCount) );
+			previousCount = lodCount;
+
+			ExportLog::LogMsg(1, "Mesh part %s LOD %u: %u triangles, error %f\n", meshPart->Name.c_str(), level + 1, lodCount / 3, lodError);
+		}
+	});
+
+	// Append LOD indices in mesh part order, so output doesn't depend on scheduling
+	for (PartLods& lods : partLods)
+	{
+		vector<uint32_t>& indexBuffer = lods.Mesh->Indices[lods.MeshPart->IndexBufferIndex];
+		for (size_t level = 0; level < lods.Indices.size(); ++level)
+		{
+			lods.MeshPart->Lods[level].IndexStart = indexBuffer.size();
+			indexBuffer.insert(indexBuffer.end(), lods.Indices[level].begin(), lods.Indices[level].end());
+		}
+	}
+}
+
 void FbxProcesser::ExportMaterial()
 {
 	XMLDoc materialxml;
@@ -1605,6 +2141,8 @@ void FbxProcesser::ExportMaterial()
 	std::ofstream xmlFile(mOutputPath + mSceneName + ".materials.xml");
 	materialxml.Print(xmlFile);
 	xmlFile.close();
+
+	g_OutputFiles.push_back(mOutputPath + mSceneName + ".materials.xml");
 }
 
 //void FbxProcesser::BuildAndSaveXML( )
@@ -1876,62 +2414,71 @@ void FbxProcesser::ExportMaterial()
 //	ExportMaterial();
 //}
 
-void FbxProcesser::BuildAndSaveBinary( )
+shared_ptr<Stream> OpenOutputStream( const String& filename )
 {
-	const uint32_t MeshId = ('M' << 24) | ('E' << 16) | ('S' << 8) | ('H');
+	shared_ptr<FileStream> fileStream( new FileStream(filename, FILE_WRITE) );
+	g_OutputFiles.push_back(filename);
+
+	if (g_ExportSettings.CompressOutput)
+		return std::make_shared<CompressedStreamWriter>(fileStream);
+
+	return fileStream;
+}
 
+void FbxProcesser::BuildAndSaveBinary( )
+{
 	for (size_t mi = 0; mi < mSceneMeshes.size(); ++mi)
 	{
 		MeshData& mesh  = *(mSceneMeshes[mi]);
 
-		FileStream stream;
-		stream.Open(mOutputPath + mesh.Name + ".mesh", FILE_WRITE);
+		shared_ptr<Stream> meshStream = OpenOutputStream(mOutputPath + mesh.Name + ".mesh");
+		Stream& stream = *meshStream;
+
 		ExportLog::LogMsg(0, "Build mesh: %s\n", mesh.Name.c_str());
 
-		// Write mesh id
-		stream.WriteUInt(MeshId);
+		// Positions are quantized within mesh bounds, make sure it covers every vertex
+		if (g_ExportSettings.QuantizeVertex)
+		{
+			for (size_t i = 0; i < mesh.Vertices.size(); ++i)
+			{
+				for (const Vertex& vertex : mesh.Vertices[i])
+					mesh.Bound.Merge(vertex.Position);
+			}
+		}
 
-		// write mesh name
-		stream.WriteString(mesh.Name);
+		MeshFileWriter writer;
 
-		// write mesh bounding box
-		stream.Write(&mesh.Bound.Min, sizeof(float3));
-		stream.Write(&mesh.Bound.Max, sizeof(float3));
+		// Write mesh name and mesh parts
+		Stream& partStream = writer.BeginSection(MST_MeshParts, 0, mesh.MeshParts.size());
+		partStream.WriteString(mesh.Name);
 
-		// write mesh part count
-		stream.WriteUInt( mesh.MeshParts.size() );
-		stream.WriteUInt( (g_ExportSettings.ExportSkeleton && mesh.Skeleton) ? mesh.Skeleton->GetNumBones() : 0 );
-		stream.WriteUInt( mesh.Vertices.size() );
-		stream.WriteUInt( mesh.Indices.size() );
-			
-		// Write mesh part 
 		for (size_t mpi = 0; mpi < mesh.MeshParts.size(); ++mpi)
 		{
 			const shared_ptr<MeshPartData>& meshPart = mesh.MeshParts[mpi];
 
 			// write sub mesh name
-			stream.WriteString(meshPart->Name);	
+			partStream.WriteString(meshPart->Name);	
 
 			// write material name
-			stream.WriteString(meshPart->MaterialName + ".material.xml");
+			partStream.WriteString(meshPart->MaterialName + ".material.xml");
 
 			// write sub mesh bounding sphere
-			stream.Write(&meshPart->Bound.Min, sizeof(float3));
-			stream.Write(&meshPart->Bound.Max, sizeof(float3));
+			partStream.Write(&meshPart->Bound.Min, sizeof(float3));
+			partStream.Write(&meshPart->Bound.Max, sizeof(float3));
 
-			stream.WriteUInt(meshPart->VertexBufferIndex);
-			stream.WriteUInt(meshPart->IndexBufferIndex);
+			partStream.WriteUInt(meshPart->VertexBufferIndex);
+			partStream.WriteUInt(meshPart->IndexBufferIndex);
 
 			// write vertex count and vertex size
-			stream.WriteUInt(meshPart->StartIndex);
-			stream.WriteUInt(meshPart->IndexCount);
-			stream.WriteInt(meshPart->BaseVertex);
+			partStream.WriteUInt(meshPart->StartIndex);
+			partStream.WriteUInt(meshPart->IndexCount);
+			partStream.WriteInt(meshPart->BaseVertex);
 		}
 
 		// Write skeleton
 		if (g_ExportSettings.ExportSkeleton && mesh.Skeleton)
 		{
-			// write bone count
+			Stream& boneStream = writer.BeginSection(MST_Skeleton, 0, mesh.Skeleton->GetNumBones());
 			for (size_t iBone = 0; iBone < mesh.Skeleton->GetNumBones(); ++iBone)
 			{
 				Bone* bone = mesh.Skeleton->GetBone(iBone);
@@ -1941,12 +2488,12 @@ void FbxProcesser::BuildAndSaveBinary( )
 				float3 scale = bone->GetScale();
 				Quaternionf rot = bone->GetRotation();
 
-				stream.WriteString(bone->GetName());
-				stream.WriteInt(parentBone ? parentBone->GetBoneIndex() : -1);
+				boneStream.WriteString(bone->GetName());
+				boneStream.WriteInt(parentBone ? parentBone->GetBoneIndex() : -1);
 
-				stream.Write(&pos, sizeof(float3));
-				stream.Write(&rot, sizeof(Quaternionf));
-				stream.Write(&scale, sizeof(float3));
+				boneStream.Write(&pos, sizeof(float3));
+				boneStream.Write(&rot, sizeof(Quaternionf));
+				boneStream.Write(&scale, sizeof(float3));
 			}
 		}
 
@@ -1955,98 +2502,165 @@ void FbxProcesser::BuildAndSaveBinary( )
 		{
 			uint32_t vertexSize;
 			std::vector<VertexElement> vertexElements;
-			GetVertexDeclaration(mesh.Vertices[i].front().Flags, vertexElements, vertexSize);
+			GetVertexDeclaration(mesh.Vertices[i].front().Flags, g_ExportSettings.QuantizeVertex, vertexElements, vertexSize);
+
+			if (g_ExportSettings.QuantizeVertex)
+			{
+				uint32_t vertexCount = mesh.Vertices[i].size();
+				ExportLog::LogMsg(0, "Quantize vertex buffer %d: %d bytes -> %d bytes\n", (int)i,
+					CalculateVertexSize(mesh.Vertices[i].front().Flags) * vertexCount, vertexSize * vertexCount);
+			}
 
-			stream.WriteUInt(mesh.Vertices[i].size()); // Vertex Count
-			stream.WriteUInt(vertexElements.size());   // Vertex Size
+			Stream& layoutStream = writer.BeginSection(MST_VertexLayout, i, vertexElements.size());
 			for (const VertexElement& ve : vertexElements)
 			{
-				stream.WriteUInt(ve.Offset);
-				stream.WriteUInt(ve.Type);
-				stream.WriteUInt(ve.Usage);
-				stream.WriteUShort(ve.UsageIndex);
+				MeshVertexElementDesc desc;
+				desc.Offset = ve.Offset;
+				desc.Type = ve.Type;
+				desc.Usage = ve.Usage;
+				desc.UsageIndex = ve.UsageIndex;
+				layoutStream.Write(&desc, sizeof(desc));
 			}
 
+			Stream& dataStream = writer.BeginSection(MST_VertexData, i, mesh.Vertices[i].size());
 			for (const Vertex& vertex : mesh.Vertices[i])
 			{
+				if (g_ExportSettings.QuantizeVertex)
+				{
+					WriteQuantizedVertex(dataStream, vertex, mesh.Bound);
+					continue;
+				}
+
 				uint32_t vertexFlag = vertex.Flags;
 
 				if (vertexFlag & Vertex::ePosition)
-					stream.Write(&vertex.Position, sizeof(float3));
+					dataStream.Write(&vertex.Position, sizeof(float3));
 
 				if (vertexFlag & Vertex::eBlendWeight)
 				{
 					assert(vertex.BlendWeights.size() == 4);
-					stream.Write(&vertex.BlendWeights[0], sizeof(float) * 4);
+					dataStream.Write(&vertex.BlendWeights[0], sizeof(float) * 4);
 				}
 
 				if (vertexFlag & Vertex::eBlendIndices)
 				{
 					assert(vertex.BlendIndices.size() == 4);
-					stream.WriteUInt(vertex.BlendIndices[0]);
-					stream.WriteUInt(vertex.BlendIndices[1]);
-					stream.WriteUInt(vertex.BlendIndices[2]);
-					stream.WriteUInt(vertex.BlendIndices[3]);
+					dataStream.WriteUInt(vertex.BlendIndices[0]);
+					dataStream.WriteUInt(vertex.BlendIndices[1]);
+					dataStream.WriteUInt(vertex.BlendIndices[2]);
+					dataStream.WriteUInt(vertex.BlendIndices[3]);
 				}
 
 				if (vertexFlag & Vertex::eNormal)
-					stream.Write(&vertex.Normal, sizeof(float3));
+					dataStream.Write(&vertex.Normal, sizeof(float3));
 
 				if (vertexFlag & Vertex::eTexcoord0)
-					stream.Write(&vertex.Tex0, sizeof(float2));
+					dataStream.Write(&vertex.Tex0, sizeof(float2));
 
 				if (vertexFlag & Vertex::eTexcoord1)
-					stream.Write(&vertex.Tex1, sizeof(float2));
+					dataStream.Write(&vertex.Tex1, sizeof(float2));
 
 				if (vertexFlag & Vertex::eTangent)
-					stream.Write(&vertex.Tangent, sizeof(float3));
+					dataStream.Write(&vertex.Tangent, sizeof(float3));
 
 				if (vertexFlag & Vertex::eBinormal)
-					stream.Write(&vertex.Binormal, sizeof(float3));		
+					dataStream.Write(&vertex.Binormal, sizeof(float3));		
 			}
 		}
 
 		for (size_t i = 0; i < mesh.Indices.size(); ++i)
 		{
+			Stream& indexStream = writer.BeginSection(MST_IndexData, i, mesh.Indices[i].size(), mesh.IndexTypes[i]);
+
 			if (mesh.IndexTypes[i] == IBT_Bit16)
 			{
-				stream.WriteUInt(mesh.Indices[i].size());
-				stream.WriteUInt(IBT_Bit16);
 				if (g_ExportSettings.SwapWindOrder)
 				{
 					for (size_t j = 0; j < mesh.Indices[i].size() / 3; ++j)
 					{
-						stream.WriteUShort(mesh.Indices[i][3*j+0]);
-						stream.WriteUShort(mesh.Indices[i][3*j+2]);
-						stream.WriteUShort(mesh.Indices[i][3*j+1]);
+						indexStream.WriteUShort(mesh.Indices[i][3*j+0]);
+						indexStream.WriteUShort(mesh.Indices[i][3*j+2]);
+						indexStream.WriteUShort(mesh.Indices[i][3*j+1]);
 					}
 				}
 				else
 				{
 					for (size_t j = 0; j < mesh.Indices[i].size(); ++j)
-						stream.WriteUShort(mesh.Indices[i][j]);
+						indexStream.WriteUShort(mesh.Indices[i][j]);
 				}
 			}
 			else
 			{
-				stream.WriteUInt(mesh.Indices[i].size());
-				stream.WriteUInt(IBT_Bit32);
 				if (g_ExportSettings.SwapWindOrder)
 				{
 					for (size_t j = 0; j < mesh.Indices[i].size() / 3; ++j)
 					{
-						stream.WriteUInt(mesh.Indices[i][3*j+0]);
-						stream.WriteUInt(mesh.Indices[i][3*j+2]);
-						stream.WriteUInt(mesh.Indices[i][3*j+1]);
+						indexStream.WriteUInt(mesh.Indices[i][3*j+0]);
+						indexStream.WriteUInt(mesh.Indices[i][3*j+2]);
+						indexStream.WriteUInt(mesh.Indices[i][3*j+1]);
 					}
 				}
-				else
+				else if (mesh.Indices[i].size())
 				{
-					stream.Write(&mesh.Indices[i], sizeof(uint32_t) * mesh.Indices[i].size());
+					indexStream.Write(&mesh.Indices[i][0], sizeof(uint32_t) * mesh.Indices[i].size());
 				}
 			}
 		}
 
+		// Write mesh part clusters, skinned mesh has none
+		bool buildClusters = g_ExportSettings.BuildClusters && !(g_ExportSettings.ExportSkeleton && mesh.Skeleton);
+		for (size_t mpi = 0; mpi < mesh.MeshParts.size(); ++mpi)
+		{
+			const MeshPartData& meshPart = *mesh.MeshParts[mpi];
+
+			vector<MeshCluster> clusters;
+			if (buildClusters && meshPart.IndexCount)
+			{
+				// Use index order as written, so cluster cones match wind order
+				const vector<uint32_t>& indices = mesh.Indices[meshPart.IndexBufferIndex];
+				vector<uint32_t> partIndices(indices.begin() + meshPart.StartIndex, indices.begin() + meshPart.StartIndex + meshPart.IndexCount);
+				if (g_ExportSettings.SwapWindOrder)
+				{
+					for (size_t j = 0; j < partIndices.size() / 3; ++j)
+						std::swap(partIndices[3*j+1], partIndices[3*j+2]);
+				}
+
+				const Vertex& baseVertex = mesh.Vertices[meshPart.VertexBufferIndex][meshPart.BaseVertex];
+				MeshOptimizer::BuildClusters(clusters, &partIndices[0], partIndices.size(), baseVertex.Position(), sizeof(Vertex));
+
+				for (MeshCluster& cluster : clusters)
+					cluster.IndexStart += meshPart.StartIndex;
+			}
+
+			if (clusters.size())
+			{
+				Stream& clusterStream = writer.BeginSection(MST_Clusters, mpi, clusters.size());
+				for (const MeshCluster& cluster : clusters)
+					cluster.Write(clusterStream);
+			}
+		}
+
+		// Write mesh part LOD levels
+		for (size_t mpi = 0; mpi < mesh.MeshParts.size(); ++mpi)
+		{
+			const MeshPartData& meshPart = *mesh.MeshParts[mpi];
+
+			if (meshPart.Lods.size())
+			{
+				Stream& lodStream = writer.BeginSection(MST_Lods, mpi, meshPart.Lods.size());
+				lodStream.Write(&meshPart.Lods[0], sizeof(MeshLodLevel) * meshPart.Lods.size());
+			}
+		}
+
+		MeshFileHeader header;
+		header.BoundMin = mesh.Bound.Min;
+		header.BoundMax = mesh.Bound.Max;
+		header.NumMeshParts = mesh.MeshParts.size();
+		header.NumBones = (g_ExportSettings.ExportSkeleton && mesh.Skeleton) ? mesh.Skeleton->GetNumBones() : 0;
+		header.NumVertexBuffers = mesh.Vertices.size();
+		header.NumIndexBuffers = mesh.Indices.size();
+
+		writer.Save(stream, header);
 		stream.Close();
 	}
 
@@ -2063,8 +2677,8 @@ void FbxProcesser::BuildAndSaveBinary( )
 					String clipName = kv.first + ".anim";
 					const AnimationClipData& clip = kv.second;
 
-					FileStream clipStream;
-					clipStream.Open(mOutputPath + clipName, FILE_WRITE);
+					shared_ptr<Stream> clipStreamPtr = OpenOutputStream(mOutputPath + clipName);
+					Stream& clipStream = *clipStreamPtr;
 
 					clipStream.WriteFloat(clip.Duration);
 					clipStream.WriteUInt(clip.mAnimationTracks.size());
@@ -2255,6 +2869,12 @@ void FbxProcesser::BuildAndSaveMaterial()
 
 		rootNode->AppendNode(effectNode);
 
+		// Same effect name as Material::LoadImpl builds from effect file and flags
+		String effectName = effectNode->AttributeString("name", "");
+		for (XMLNodePtr flagNode = effectNode->FirstNode("Flag"); flagNode; flagNode = flagNode->NextSibling("Flag"))
+			effectName += " " + flagNode->AttributeString("name", "");
+		mMaterialEffects[mMaterials[i].Name] = effectName;
+
 		renderQueueNode->AppendAttribute(materialXML.AllocateAttributeString("name", "Opaque"));
 		rootNode->AppendNode(renderQueueNode);
 		
@@ -2263,11 +2883,104 @@ void FbxProcesser::BuildAndSaveMaterial()
 		std::ofstream xmlFile(outputPath);
 		materialXML.Print(xmlFile);
 		xmlFile.close();
+
+		g_OutputFiles.push_back(outputPath);
+	}
+}
+
+void FbxProcesser::SaveDependencies( const String& inputFile, const String& filename )
+{
+	DependencyManifest manifest;
+
+	uint32_t inputEntry = manifest.AddEntry(RT_Undefined, inputFile, "");
+	for (const String& textureFile : mTextureFiles)
+		manifest.AddDependency(inputEntry, manifest.AddEntry(RT_Undefined, textureFile, ""));
+
+	// Texture channels written as material parameters by BuildAndSaveMaterial
+	const char* TextureChannels[] = { "DiffuseColor", "SpecularColor", "NormalMap" };
+
+	// Mesh loads quantized parts with _QuantizedVertex material flag, see Mesh::AddMeshParts
+	String materialFlags = g_ExportSettings.QuantizeVertex ? " _QuantizedVertex" : "";
+
+	for (const MaterialData& material : mMaterials)
+	{
+		uint32_t materialEntry = manifest.AddEntry(RT_Material, mOutputPath + material.Name + ".material.xml" + materialFlags, "");
+
+		// Effects are shared, not in output directory
+		auto effect = mMaterialEffects.find(material.Name);
+		if (effect != mMaterialEffects.end())
+			manifest.AddDependency(materialEntry, manifest.AddEntry(RT_Effect, effect->second + materialFlags, "General"));
+
+		for (const char* channel : TextureChannels)
+		{
+			auto texture = material.Textures.find(channel);
+			if (texture != material.Textures.end())
+			{
+				String textureName = mOutputPath + PathUtil::GetFileName(texture->second) + ".dds";
+				manifest.AddDependency(materialEntry, manifest.AddEntry(RT_Texture, textureName, ""));
+			}
+		}
 	}
+
+	for (const shared_ptr<MeshData>& mesh : mSceneMeshes)
+	{
+		uint32_t meshEntry = manifest.AddEntry(RT_Mesh, mOutputPath + mesh->Name + ".mesh", "");
+		for (const shared_ptr<MeshPartData>& meshPart : mesh->MeshParts)
+		{
+			// Parts without exported material, e.g. DefaultMaterial, are skipped by Mesh
+			int32_t materialEntry = manifest.FindEntry(RT_Material, mOutputPath + meshPart->MaterialName + ".material.xml" + materialFlags, "");
+			if (materialEntry >= 0)
+				manifest.AddDependency(meshEntry, materialEntry);
+		}
+	}
+
+	FileStream stream;
+	if (!stream.Open(filename, FILE_WRITE))
+	{
+		ExportLog::LogError("Can't write %s\n", filename.c_str());
+		return;
+	}
+
+	manifest.Write(stream);
+	stream.Close();
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	String inputFile, outputPath, sceneName, animationName, outputListFile, dependencyFile;
+	for (int i = 1; i < argc; ++i)
+	{
+		String arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+			outputPath = PathUtil::AddTrailingSlash(argv[++i]);
+		else if (arg == "-name" && i + 1 < argc)
+			sceneName = argv[++i];
+		else if (arg == "-anim" && i + 1 < argc)
+			animationName = argv[++i];
+		else if (arg == "-outputs" && i + 1 < argc)
+			outputListFile = argv[++i];
+		else if (arg == "-deps" && i + 1 < argc)
+			dependencyFile = argv[++i];
+		else if (arg == "-lods" && i + 1 < argc)
+			g_ExportSettings.LodCount = (uint32_t)atoi(argv[++i]);
+		else if (arg == "-quantize")
+			g_ExportSettings.QuantizeVertex = true;
+		else if (arg == "-compress")
+			g_ExportSettings.CompressOutput = true;
+		else if (arg == "-nocompress")
+			g_ExportSettings.CompressOutput = false;
+		else if (arg == "-nodedup")
+			g_ExportSettings.DeduplicateMaterials = false;
+		else
+			inputFile = arg;
+	}
+
+	if (inputFile.empty())
+	{
+		printf("Usage: FbxImporter [-o outputDir] [-name scene] [-anim clip] [-lods n] [-quantize] [-compress] [-nodedup] [-outputs listFile] [-deps file] file.fbx\n");
+		return 1;
+	}
+
 	ExportLog::AddListener( &g_ConsoleOutListener );
 #if _MSC_VER >= 1500
 	if( IsDebuggerPresent() )
@@ -2281,20 +2994,39 @@ int main()
 	//g_ExportSettings.MergeScene = true;
 	g_ExportSettings.MergeWithSameMaterial = true;
 	//g_ExportSettings.SwapWindOrder = false;
+	//g_ExportSettings.QuantizeVertex = true;
+	//g_ExportSettings.LodCount = 0;
+
+	// Mesh processing and LOD generation run on the pool
+	ThreadPool::Initialize();
 
 	FbxProcesser fbxProcesser;
 	fbxProcesser.Initialize();
 
-	if (fbxProcesser.LoadScene("F:/RcEngine/Media/Mesh/Arthas/Arthas_Random.FBX"))
-	{
-		fbxProcesser.mSceneName = "Arthas";
-		fbxProcesser.mAnimationName = "Random";
+	if (!fbxProcesser.LoadScene(inputFile))
+		return 1;
+
+	if (!outputPath.empty())
+		fbxProcesser.mOutputPath = outputPath;
+	if (!sceneName.empty())
+		fbxProcesser.mSceneName = sceneName;
+	if (!animationName.empty())
+		fbxProcesser.mAnimationName = animationName;
+
+	fbxProcesser.ProcessScene();
+	//fbxProcesser.BuildAndSaveXML();
+ 	fbxProcesser.BuildAndSaveBinary();
+	fbxProcesser.BuildAndSaveMaterial();
+	fbxProcesser.ExportMaterial();
 
-		fbxProcesser.ProcessScene();
-		//fbxProcesser.BuildAndSaveXML();
- 		fbxProcesser.BuildAndSaveBinary();
-		fbxProcesser.BuildAndSaveMaterial();
-		fbxProcesser.ExportMaterial();
+	if (!dependencyFile.empty())
+		fbxProcesser.SaveDependencies(inputFile, dependencyFile);
+
+	if (!outputListFile.empty())
+	{
+		std::ofstream listFile(outputListFile);
+		for (const String& file : g_OutputFiles)
+			listFile << file << std::endl;
 	}
 
 	return 0;
@@ -7,6 +7,7 @@
 #include <Graphics/VertexDeclaration.h>
 #include <Math/MathUtil.h>
 #include <Math/ColorRGBA.h>
+#include <set>
 
 using namespace RcEngine;
 
@@ -17,14 +18,32 @@ struct ExportSettings
 	bool ExportAnimation; 
 	bool MergeScene;
 	bool MergeWithSameMaterial; // Merge sub mesh with same material
+	bool DeduplicateMaterials; // Share one material and texture among identical ones under different names
 	bool SwapWindOrder;
+	bool CompressOutput;       // Write block compressed mesh and animation files, smaller but compressed meshes can't be memory mapped
+	bool OptimizeMesh;		   // Reorder triangles and vertices for vertex cache, overdraw and fetch
+	bool QuantizeVertex;	   // Write compact vertex formats, mesh loads materials with _QuantizedVertex flag
+	bool BuildClusters;		   // Write triangle clusters of static mesh parts for CPU cluster culling
+	uint32_t LodCount;		   // Simplified LOD levels generated for each mesh part
+	float LodReduction;		   // Triangle ratio of each LOD level to previous level
+	float LodMaxError;		   // Max LOD error, relative to mesh bounding box diagonal
+	float WeldEpsilon;		   // Tolerance of each vertex component when welding, 0 welds equal vertices only
 
 	ExportSettings()
 		: SwapWindOrder(true),
 		  ExportSkeleton(true),
 		  ExportAnimation(true),
 		  MergeScene(false),
-		  MergeWithSameMaterial(false)
+		  MergeWithSameMaterial(false),
+		  DeduplicateMaterials(true),
+		  CompressOutput(false),
+		  OptimizeMesh(true),
+		  QuantizeVertex(false),
+		  BuildClusters(true),
+		  LodCount(3),
+		  LodReduction(0.5f),
+		  LodMaxError(0.02f),
+		  WeldEpsilon(0.0f)
 	{}
 };
 
@@ -85,20 +104,10 @@ struct Vertex
 		eBinormal		= 1 << 7,	
 	};
 
-	friend bool operator< (const Vertex& lhs, const Vertex& rhs)
-	{
-#define CMP(value, size)							\
-	for (int i = 0; i < 3; ++i) {				    \
-	if (lhs.value[i] < rhs.value[i]) return true;   \
-	if (rhs.value[i] < lhs.value[i]) return false;  \
-	}
-		CMP(Position, 3);
-		CMP(Normal, 3);
-		CMP(Tex0, 2);
-#undef CMP
-
-		return false;
-	}
+	// Attributes not read from FBX stay zero, so welding compares defined values only
+	Vertex()
+		: Position(0, 0, 0), Normal(0, 0, 0), Binormal(0, 0, 0), Tangent(0, 0, 0),
+		  Tex0(0, 0), Tex1(0, 0), Flags(0), Index(0) {}
 
 	float3 Position;
 	float3 Normal;
@@ -134,6 +143,9 @@ struct MeshPartData
 	uint32_t VertexBufferIndex;
 	uint32_t IndexBufferIndex;
 
+	// Simplified levels appended to index buffer
+	vector<MeshLodLevel> Lods;
+
 	MeshPartData() : VertexFlags(0), StartIndex(0), BaseVertex(0), IndexCount(0) {}
 };
 
@@ -174,6 +186,39 @@ struct AnimationClipData
 	vector<AnimationTrack> mAnimationTracks;
 };
 
+/**
+ * Per mesh state from ProcessMesh, it reads the scene serially (triangulation, skin,
+ * transforms, materials) before vertices are extracted in parallel.
+ */
+struct MeshContext
+{
+	FbxNode* Node;
+	shared_ptr<MeshData> Mesh;
+
+	vector< vector<int> > PolysByMaterial;
+	std::vector<BoneWeights> MeshBoneWeights;
+
+	// Per material slot, FBX materials are shared between meshes and not read in parallel
+	vector<String> MaterialNames;
+	vector<uint32_t> MaterialVertexFlags;
+
+	bool HasSkin;
+
+	float4x4 TotalMatrix;
+	float4x4 TotalMatrixNormal;
+};
+
+/**
+ * Bone track of one take, local transforms are sampled serially from the scene evaluator,
+ * key frames are decomposed from them in parallel.
+ */
+struct AnimationTrackContext
+{
+	AnimationClipData* Clip;
+	AnimationClipData::AnimationTrack Track;
+	vector<FbxAMatrix> LocalTransforms;
+};
+
 class FbxProcesser
 {
 public:
@@ -189,6 +234,12 @@ public:
 	void ProcessNode(FbxNode* pNode, FbxNodeAttribute::EType attriType);
 	void ProcessSkeleton(FbxNode* pNode);
 	void ProcessMesh(FbxNode* pNode);
+	
+	/**
+	 * Extract and weld vertices of each mesh part, only reads from its own FbxMesh, so
+	 * called in parallel for different meshes.
+	 */
+	void ProcessMeshParts(MeshContext& context);
 	void ProcessSubDiv(FbxNode* pNode);
 
 	shared_ptr<Skeleton> ProcessBoneWeights(FbxMesh* pMesh, std::vector<BoneWeights>& meshBoneWeights);
@@ -204,17 +255,39 @@ public:
 
 	void MergeSceneMeshs();
 
+	/**
+	 * Textures with same file content and materials with same content are exported once, mesh
+	 * parts are remapped to the first one, so they can be merged.
+	 */
+	void DeduplicateMaterials();
+
+	/**
+	 * Vertex cache, overdraw and vertex fetch optimization of each mesh part.
+	 */
+	void OptimizeMeshParts();
+
 	/**
 	 * Merge mesh part vertices into one big VertexBuffer if VertexFormat are same.
 	 */
 	void MergeMeshParts();
 
+	/**
+	 * Simplify merged mesh parts into LOD chain, LOD indices are appended to part's index buffer.
+	 */
+	void GenerateLods();
+
 	void BuildAndSaveXML();
 	void BuildAndSaveBinary();	
 	void BuildAndSaveMaterial();
 
 	void ExportMaterial();
 
+	/**
+	 * Dependency manifest for asset cooker: written meshes -> materials -> textures/effects, and
+	 * input file -> referenced texture files. Names are file paths, written files have no group.
+	 */
+	void SaveDependencies(const String& inputFile, const String& filename);
+
 public:
 	FbxManager* mFBXSdkManager;
 	FbxScene* mFBXScene;
@@ -236,7 +309,19 @@ public:
 
 	vector<MaterialData> mMaterials;
 
+	// Every texture file referenced by scene, before deduplication
+	std::set<String> mTextureFiles;
+
+	// Effect name with flags of each exported material
+	std::map<String, String> mMaterialEffects;
+
 	vector<shared_ptr<MeshData> > mSceneMeshes;
+
+	// Meshes read by ProcessMesh, waiting for ProcessMeshParts
+	vector<shared_ptr<MeshContext> > mMeshContexts;
+
+	// Tracks sampled by ProcessAnimation, in scene order
+	vector<AnimationTrackContext> mAnimationTracks;
 	
 private:
 	FBXTransformer mFBXTransformer;
@@ -0,0 +1,195 @@
+#include "DistanceMap.h"
+#include "edtaa3func.h"
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+// Squared distance of pixels without feature, large enough to never win but finite, so
+// parabola intersections stay defined
+const double FarDistance = 1e20;
+
+// Lower envelope of parabolas rooted at f, d[q] = min over p of (q-p)^2 + f[p]
+void edt_1d(const double *f, int n, double *d, int *v, double *z)
+{
+	int k = 0;
+	v[0] = 0;
+	z[0] = -2*FarDistance;
+	z[1] = +FarDistance;
+
+	// Far pixel parabolas are so high that every intersection lies right of z[0]
+	for (int q = 1; q < n; ++q)
+	{
+		double s = ((f[q] + double(q)*q) - (f[v[k]] + double(v[k])*v[k])) / (2.0*(q - v[k]));
+		while (s <= z[k])
+		{
+			--k;
+			s = ((f[q] + double(q)*q) - (f[v[k]] + double(v[k])*v[k])) / (2.0*(q - v[k]));
+		}
+
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = +FarDistance;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; ++q)
+	{
+		while (z[k+1] < q)
+			++k;
+
+		double dq = q - v[k];
+		d[q] = dq*dq + f[v[k]];
+	}
+}
+
+// Distance of every pixel to the nearest pixel whose feature flag equals feature
+void edt_2d(const double *data, int width, int height, bool inside, double *dist)
+{
+	const int n = (std::max)(width, height);
+	std::vector<double> f(width*height), column(n), result(n);
+	std::vector<int> v(n);
+	std::vector<double> z(n+1);
+
+	for (int i = 0; i < width*height; ++i)
+		f[i] = ((data[i] >= 0.5) == inside) ? 0.0 : FarDistance;
+
+	for (int x = 0; x < width; ++x)
+	{
+		for (int y = 0; y < height; ++y)
+			column[y] = f[y*width+x];
+
+		edt_1d(&column[0], height, &result[0], &v[0], &z[0]);
+		for (int y = 0; y < height; ++y)
+			f[y*width+x] = result[y];
+	}
+
+	for (int y = 0; y < height; ++y)
+	{
+		edt_1d(&f[y*width], width, &dist[y*width], &v[0], &z[0]);
+		for (int x = 0; x < width; ++x)
+			dist[y*width+x] = sqrt(dist[y*width+x]);
+	}
+}
+
+double MitchellNetravali(double x)
+{
+	const double B = 1/3.0, C = 1/3.0;
+
+	x = fabs(x);
+	if (x < 1)
+		return ((12 - 9*B - 6*C)*x*x*x + (-18 + 12*B + 6*C)*x*x + (6 - 2*B)) / 6;
+	else if (x < 2)
+		return ((-B - 6*C)*x*x*x + (6*B + 30*C)*x*x + (-12*B - 48*C)*x + (8*B + 24*C)) / 6;
+	else
+		return 0;
+}
+
+double interpolate(double x, double y0, double y1, double y2, double y3)
+{
+	double r = MitchellNetravali(x+1)*y0 + MitchellNetravali(x)*y1 + MitchellNetravali(x-1)*y2 + MitchellNetravali(x-2)*y3;
+	return (std::min)((std::max)(r, 0.0), 1.0);
+}
+
+}
+
+void distance_map(double *data, int width, int height, DistanceMethod method)
+{
+	const int size = width*height;
+	std::vector<double> outside(size), inside(size);
+
+	if (method == DM_EXACT)
+	{
+		// Pixel centers are half a pixel away from the contour between them
+		edt_2d(data, width, height, true, &outside[0]);
+		edt_2d(data, width, height, false, &inside[0]);
+		for (int i = 0; i < size; ++i)
+		{
+			outside[i] = (std::max)(0.0, outside[i] - 0.5);
+			inside[i] = (std::max)(0.0, inside[i] - 0.5);
+		}
+	}
+	else
+	{
+		std::vector<short> xdist(size), ydist(size);
+		std::vector<double> gx(size), gy(size);
+
+		// Transform background
+		computegradient(data, width, height, &gx[0], &gy[0]);
+		edtaa3(data, &gx[0], &gy[0], width, height, &xdist[0], &ydist[0], &outside[0]);
+
+		// Transform foreground
+		std::fill(gx.begin(), gx.end(), 0.0);
+		std::fill(gy.begin(), gy.end(), 0.0);
+		for (int i = 0; i < size; ++i)
+			data[i] = 1 - data[i];
+
+		computegradient(data, width, height, &gx[0], &gy[0]);
+		edtaa3(data, &gx[0], &gy[0], width, height, &xdist[0], &ydist[0], &inside[0]);
+
+		for (int i = 0; i < size; ++i)
+		{
+			outside[i] = (std::max)(0.0, outside[i]);
+			inside[i] = (std::max)(0.0, inside[i]);
+		}
+	}
+
+	// Bipolar distance field, clamped to deepest inside distance. Empty glyphs are all outside.
+	double vmin = 0;
+	for (int i = 0; i < size; ++i)
+	{
+		outside[i] -= inside[i];
+		vmin = (std::min)(vmin, outside[i]);
+	}
+	vmin = fabs(vmin);
+
+	for (int i = 0; i < size; ++i)
+	{
+		double v = (std::min)((std::max)(outside[i], -vmin), vmin);
+		data[i] = vmin > 0 ? (v + vmin) / (2*vmin) : 1.0;
+	}
+}
+
+void resize(const double *src, int src_width, int src_height, double *dst, int dst_width, int dst_height)
+{
+	if (src_width == dst_width && src_height == dst_height)
+	{
+		memcpy(dst, src, sizeof(double)*src_width*src_height);
+		return;
+	}
+
+	const double xscale = src_width / double(dst_width);
+	const double yscale = src_height / double(dst_height);
+
+	for (int j = 0; j < dst_height; ++j)
+	{
+		double sy = j*yscale;
+		int src_j = int(floor(sy));
+
+		int rows[4];
+		for (int k = 0; k < 4; ++k)
+			rows[k] = (std::min)((std::max)(0, src_j - 1 + k), src_height - 1);
+
+		for (int i = 0; i < dst_width; ++i)
+		{
+			double sx = i*xscale;
+			int src_i = int(floor(sx));
+
+			int cols[4];
+			for (int k = 0; k < 4; ++k)
+				cols[k] = (std::min)((std::max)(0, src_i - 1 + k), src_width - 1);
+
+			double t[4];
+			for (int k = 0; k < 4; ++k)
+			{
+				const double *row = src + rows[k]*src_width;
+				t[k] = interpolate(sx - src_i, row[cols[0]], row[cols[1]], row[cols[2]], row[cols[3]]);
+			}
+
+			dst[j*dst_width+i] = interpolate(sy - src_j, t[0], t[1], t[2], t[3]);
+		}
+	}
+}
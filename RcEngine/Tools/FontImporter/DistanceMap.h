@@ -0,0 +1,21 @@
+#ifndef _DISTANCE_MAP_H_
+#define _DISTANCE_MAP_H_
+
+enum DistanceMethod
+{
+	// Anti-aliased sweep (edtaa3), sub-pixel edges but sweeps until converged
+	DM_EDTAA3,
+
+	// Exact Euclidean transform of the 0.5 contour (Felzenszwalb and Huttenlocher), two
+	// linear passes over columns and rows
+	DM_EXACT
+};
+
+// Replace coverage values in [0,1] with bipolar distance, 0.5 on the edge and 0 deepest inside.
+// Distances are scaled by the largest inside distance, like freetype-gl.
+void distance_map(double *data, int width, int height, DistanceMethod method = DM_EDTAA3);
+
+// Mitchell-Netravali bicubic resample
+void resize(const double *src, int src_width, int src_height, double *dst, int dst_width, int dst_height);
+
+#endif
@@ -7,6 +7,9 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include <GL/glew.h>
 #include <GL/glut.h>
 
@@ -19,16 +22,13 @@
 #include FT_FREETYPE_H
 
 #include "pfm.h"
+#include "DistanceMap.h"
 
 #pragma comment(lib, "freetype")
 #pragma comment(lib, "opengl32")
 #pragma comment(lib, "glew32")
 
-#define INFINITY 99999999999
-#define max(a,b) ((a) > (b) ? (a) : (b))
-#define min(a,b) ((a) < (b) ? (a) : (b))
-
-// Round and INFINITY only defined in C99
+// Round only defined in C99
 double round(double r) {
 	return (r > 0.0) ? floor(r + 0.5) : ceil(r - 0.5);
 }
@@ -50,16 +50,35 @@ GLint  gTexParam;
 FontGlyph gGlyph;
 float angle = 0;
 
-void load_glyph( const char *  filename,  const wchar_t charcode,
-				 const float   highres_size, const float lowres_size,
-				 const float   padding, FontGlyph& glyph )
+struct FontAtlas
 {
-	FT_Library library;
-	FT_Face face;
+	int Width, Height;
+	std::vector<unsigned char> Data;
+
+	std::vector<wchar_t> Chars;
+	std::vector<FontGlyph> Glyphs;
+	std::vector<int> X, Y;			// Glyph top left in atlas
+};
+
+bool open_face( const char * filename, FT_Library& library, FT_Face& face )
+{
+	if (FT_Init_FreeType( &library ))
+		return false;
+
+	if (FT_New_Face( library, filename, 0, &face ))
+	{
+		FT_Done_FreeType( library );
+		return false;
+	}
 
-	FT_Init_FreeType( &library );
-	FT_New_Face( library, filename, 0, &face );
 	FT_Select_Charmap( face, FT_ENCODING_UNICODE );
+	return true;
+}
+
+void load_glyph( FT_Face face, const wchar_t charcode,
+				 const float   highres_size, const float lowres_size,
+				 const float   padding, DistanceMethod method, FontGlyph& glyph )
+{
 	FT_UInt glyph_index = FT_Get_Char_Index( face, charcode );
 
 	// Render glyph at high resolution (highres_size points)
@@ -86,7 +105,7 @@ void load_glyph( const char *  filename,  const wchar_t charcode,
 	}
 
 	// Compute distance map
-	distance_map( highres_data, highres_width, highres_height );
+	distance_map( highres_data, highres_width, highres_height, method );
 
 	// Allocate low resolution buffer
 	size_t lowres_width  = round(highres_width * lowres_size/highres_size);
@@ -128,6 +147,264 @@ void load_glyph( const char *  filename,  const wchar_t charcode,
 	//free(data);
 }
 
+void load_glyph( const char *  filename,  const wchar_t charcode,
+				 const float   highres_size, const float lowres_size,
+				 const float   padding, FontGlyph& glyph )
+{
+	FT_Library library;
+	FT_Face face;
+
+	if (!open_face( filename, library, face ))
+		throw std::exception("Could not open font");
+
+	load_glyph( face, charcode, highres_size, lowres_size, padding, DM_EDTAA3, glyph );
+
+	FT_Done_Face( face );
+	FT_Done_FreeType( library );
+}
+
+// Call worker on num_threads threads, workers share items through an atomic counter
+template <typename Worker>
+void run_workers( int num_threads, Worker worker )
+{
+	if (num_threads <= 1)
+	{
+		worker();
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; ++i)
+		threads.push_back(std::thread(worker));
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
+
+/**
+ * Render distance field of every char on num_threads threads and pack them into an atlas
+ * atlas_width wide. Glyphs are placed on shelves in char order after all are rendered, so
+ * the atlas doesn't depend on thread count, only the pixel copies run concurrently.
+ */
+bool build_font_atlas( const char * filename, const std::vector<wchar_t>& chars,
+					   const float highres_size, const float lowres_size, const float padding,
+					   DistanceMethod method, int num_threads, int atlas_width, FontAtlas& atlas )
+{
+	const int count = (int)chars.size();
+
+	atlas.Chars = chars;
+	atlas.Glyphs.assign(count, FontGlyph());
+	atlas.X.assign(count, 0);
+	atlas.Y.assign(count, 0);
+
+	// FreeType faces can't be shared between threads, each worker opens its own
+	std::atomic<int> next_glyph(0);
+	std::atomic<bool> face_failed(false);
+	run_workers(num_threads, [&]() {
+		FT_Library library;
+		FT_Face face;
+		if (!open_face( filename, library, face ))
+		{
+			face_failed = true;
+			return;
+		}
+
+		for (int i; (i = next_glyph++) < count; )
+			load_glyph( face, chars[i], highres_size, lowres_size, padding, method, atlas.Glyphs[i] );
+
+		FT_Done_Face( face );
+		FT_Done_FreeType( library );
+	});
+
+	if (face_failed)
+		return false;
+
+	// Shelf packing, one texel gap between glyphs
+	int x = 0, y = 0, shelf_height = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const FontGlyph& glyph = atlas.Glyphs[i];
+		if (glyph.Width > atlas_width)
+			return false;
+
+		if (x + glyph.Width > atlas_width)
+		{
+			x = 0;
+			y += shelf_height + 1;
+			shelf_height = 0;
+		}
+
+		atlas.X[i] = x;
+		atlas.Y[i] = y;
+
+		x += glyph.Width + 1;
+		shelf_height = (std::max)(shelf_height, glyph.Height);
+	}
+
+	atlas.Width = atlas_width;
+	atlas.Height = y + shelf_height;
+	atlas.Data.assign(atlas.Width * atlas.Height, 0);
+
+	// Glyph rectangles don't overlap
+	std::atomic<int> next_copy(0);
+	run_workers(num_threads, [&]() {
+		for (int i; (i = next_copy++) < count; )
+		{
+			const FontGlyph& glyph = atlas.Glyphs[i];
+			for (int row = 0; row < glyph.Height; ++row)
+				memcpy(&atlas.Data[(atlas.Y[i] + row) * atlas.Width + atlas.X[i]], &glyph.Data[row * glyph.Width], glyph.Width);
+		}
+	});
+
+	return true;
+}
+
+bool same_atlas( const FontAtlas& a, const FontAtlas& b )
+{
+	if (a.Width != b.Width || a.Height != b.Height || a.Data != b.Data || a.Glyphs.size() != b.Glyphs.size())
+		return false;
+
+	for (size_t i = 0; i < a.Glyphs.size(); ++i)
+	{
+		const FontGlyph& ga = a.Glyphs[i];
+		const FontGlyph& gb = b.Glyphs[i];
+		if (a.X[i] != b.X[i] || a.Y[i] != b.Y[i] || ga.Width != gb.Width || ga.Height != gb.Height ||
+			ga.OffsetX != gb.OffsetX || ga.OffsetY != gb.OffsetY || ga.Advance != gb.Advance)
+			return false;
+	}
+
+	return true;
+}
+
+// UTF-8 text to unique chars in order of first use, line breaks skipped
+bool read_chars( const char * filename, std::vector<wchar_t>& chars )
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::vector<bool> used(0x10000, false);
+
+	for (size_t i = 0; i < text.size(); )
+	{
+		unsigned char c = text[i];
+		int length = (c < 0x80) ? 1 : (c < 0xE0) ? 2 : (c < 0xF0) ? 3 : 4;
+		
+		unsigned code = (length == 1) ? c : c & (0x3F >> (length - 1));
+		for (int k = 1; k < length && i + k < text.size(); ++k)
+			code = (code << 6) | (text[i + k] & 0x3F);
+		i += length;
+
+		// wchar_t holds basic multilingual plane only, skip BOM too
+		if (code == '\r' || code == '\n' || code == 0xFEFF || code > 0xFFFF || used[code])
+			continue;
+
+		used[code] = true;
+		chars.push_back((wchar_t)code);
+	}
+
+	return true;
+}
+
+// Atlas as one channel PFM, glyph table as text: char x y width height offsetx offsety advance
+bool write_font_atlas( const std::string& prefix, const FontAtlas& atlas )
+{
+	std::vector<float> pixels(atlas.Data.size());
+	for (size_t i = 0; i < pixels.size(); ++i)
+		pixels[i] = atlas.Data[i] / 255.0f;
+
+	if (pixels.empty() || WritePfm((prefix + ".pfm").c_str(), atlas.Width, atlas.Height, 1, &pixels[0]) < 0)
+		return false;
+
+	std::ofstream table(prefix + ".txt");
+	if (!table)
+		return false;
+
+	for (size_t i = 0; i < atlas.Glyphs.size(); ++i)
+	{
+		const FontGlyph& glyph = atlas.Glyphs[i];
+		table << (unsigned)atlas.Chars[i] << " " << atlas.X[i] << " " << atlas.Y[i] << " " << glyph.Width << " " << glyph.Height
+			  << " " << glyph.OffsetX << " " << glyph.OffsetY << " " << glyph.Advance << std::endl;
+	}
+
+	return true;
+}
+
+// FontImporter -atlas font.ttf chars.txt out [-size px] [-width px] [-threads n] [-exact] [-verify]
+int build_atlas_main( int argc, char** argv )
+{
+	if (argc < 5)
+	{
+		printf("Usage: FontImporter -atlas font.ttf chars.txt out [-size px] [-width px] [-threads n] [-exact] [-verify]\n");
+		return 1;
+	}
+
+	const char* font_file = argv[2];
+	const char* chars_file = argv[3];
+	std::string prefix = argv[4];
+
+	float lowres_size = 32;
+	int atlas_width = 1024;
+	int num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+	DistanceMethod method = DM_EDTAA3;
+	bool verify = false;
+
+	for (int i = 5; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-size" && i + 1 < argc)
+			lowres_size = (float)atof(argv[++i]);
+		else if (arg == "-width" && i + 1 < argc)
+			atlas_width = atoi(argv[++i]);
+		else if (arg == "-threads" && i + 1 < argc)
+			num_threads = (std::max)(1, atoi(argv[++i]));
+		else if (arg == "-exact")
+			method = DM_EXACT;
+		else if (arg == "-verify")
+			verify = true;
+	}
+
+	std::vector<wchar_t> chars;
+	if (!read_chars(chars_file, chars) || chars.empty())
+	{
+		printf("Can't read chars from %s\n", chars_file);
+		return 1;
+	}
+
+	// Same ratio as glyph preview, 16 texels rendered for each atlas texel
+	const float highres_size = lowres_size * 16;
+	const float padding = 0.1f;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	FontAtlas atlas;
+	if (!build_font_atlas(font_file, chars, highres_size, lowres_size, padding, method, num_threads, atlas_width, atlas))
+	{
+		printf("Can't build atlas of %s\n", font_file);
+		return 1;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	printf("%d glyphs, %dx%d atlas in %d ms on %d threads\n", (int)chars.size(), atlas.Width, atlas.Height,
+		(int)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(), num_threads);
+
+	if (verify)
+	{
+		FontAtlas serial;
+		build_font_atlas(font_file, chars, highres_size, lowres_size, padding, method, 1, atlas_width, serial);
+		printf("Serial build %s\n", same_atlas(atlas, serial) ? "matches" : "DIFFERS");
+	}
+
+	if (!write_font_atlas(prefix, atlas))
+	{
+		printf("Can't write %s\n", prefix.c_str());
+		return 1;
+	}
+
+	return 0;
+}
+
 int Size = 128;
 
 void init(void)
@@ -318,6 +595,9 @@ void timer( int fps )
 
 int main ( int argc, char** argv )   // Create Main Function For Bringing It All Together
 {
+	if (argc > 1 && strcmp(argv[1], "-atlas") == 0)
+		return build_atlas_main(argc, argv);
+
 	glutInit            ( &argc, argv ); // Erm Just Write It =)
 	glutInitDisplayMode ( GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGB  ); // Display Mode
 	glutInitWindowPosition (0,0);
@@ -0,0 +1,16 @@
+#ifndef _EDTAA3FUNC_H_
+#define _EDTAA3FUNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void computegradient(double *img, int w, int h, double *gx, double *gy);
+
+void edtaa3(double *img, double *gx, double *gy, int w, int h, short *distx, short *disty, double *dist);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
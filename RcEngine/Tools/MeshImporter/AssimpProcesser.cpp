@@ -8,9 +8,11 @@
 #include "Math/MathUtil.h"
 #include "Math/BoundingSphere.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/MeshOptimizer.h"
 #include "MainApp/Application.h"
 #include "Core/Exception.h"
 #include "IO/FileStream.h"
+#include "IO/CompressedStream.h"
 #include "Core/XMLDom.h"
 #include "Core/Utility.h"
 #include "IO/PathUtil.h"
@@ -304,6 +306,7 @@ void PrintLine(const String& str)
 }
 
 AssimpProcesser::AssimpProcesser(void)
+	: mCompressOutput(false)
 {
 }
 
@@ -655,18 +658,20 @@ void AssimpProcesser::ExportBinary( OutModel& outModel )
 {
 	const uint32_t MeshId = ('M' << 24) | ('E' << 16) | ('S' << 8) | ('H');
 
-	FileStream stream(outModel.OutName + ".mdl", FILE_WRITE);
+	shared_ptr<Stream> stream( new FileStream(outModel.OutName + ".mdl", FILE_WRITE) );
+	if (mCompressOutput)
+		stream = std::make_shared<CompressedStreamWriter>(stream);
 
-	stream.WriteUInt(MeshId);
+	stream->WriteUInt(MeshId);
 
 	// write mesh name, for test
-	stream.WriteString(outModel.OutName);
+	stream->WriteString(outModel.OutName);
 
 	// write mesh bounding sphere
 	float3 center = outModel.MeshBoundingSphere.Center;
 	float radius = outModel.MeshBoundingSphere.Radius;
-	stream.Write(&center, sizeof(float3));
-	stream.WriteFloat(radius);
+	stream->Write(&center, sizeof(float3));
+	stream->WriteFloat(radius);
 
 	// write material
 	//stream.WriteUInt(outModel.Materials.size());
@@ -802,7 +807,7 @@ void AssimpProcesser::ExportBinary( OutModel& outModel )
 	//	}
 	//}
 	
-	stream.Close();
+	stream->Close();
 }
 
 void AssimpProcesser::CollectMeshes( OutModel& outModel, aiNode* node )
@@ -935,6 +940,77 @@ void AssimpProcesser::CollectAnimations( OutModel& model, aiScene* scene )
 	}
 }
 
+template <typename T>
+static void RemapVertexChannel(T* channel, uint32_t vertexCount, const vector<uint32_t>& remap)
+{
+	if (!channel)
+		return;
+
+	vector<T> source(channel, channel + vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+		channel[remap[i]] = source[i];
+}
+
+void AssimpProcesser::OptimizeMeshes( OutModel& outModel )
+{
+	std::set<aiMesh*> optimized;
+
+	for (aiMesh* mesh : outModel.Meshes)
+	{
+		if (optimized.insert(mesh).second == false)
+			continue;
+
+		if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || mesh->mNumFaces == 0)
+		{
+			PrintLine("Skip optimizing mesh " + String(mesh->mName.C_Str()) + ", not a triangle mesh");
+			continue;
+		}
+
+		uint32_t vertexCount = mesh->mNumVertices;
+		uint32_t indexCount = mesh->mNumFaces * 3;
+
+		vector<uint32_t> indices(indexCount);
+		for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
+		{
+			assert(mesh->mFaces[f].mNumIndices == 3);
+			std::copy(mesh->mFaces[f].mIndices, mesh->mFaces[f].mIndices + 3, &indices[f*3]);
+		}
+
+		VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(&indices[0], indexCount, vertexCount);
+
+		MeshOptimizer::OptimizeVertexCache(&indices[0], &indices[0], indexCount, vertexCount);
+		MeshOptimizer::OptimizeOverdraw(&indices[0], &indices[0], indexCount, &mesh->mVertices[0].x, sizeof(aiVector3D), vertexCount);
+
+		vector<uint32_t> remap(vertexCount);
+		MeshOptimizer::OptimizeVertexFetchRemap(&remap[0], &indices[0], indexCount, vertexCount);
+		MeshOptimizer::RemapIndices(&indices[0], &indices[0], indexCount, &remap[0]);
+
+		for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
+			std::copy(&indices[f*3], &indices[f*3] + 3, mesh->mFaces[f].mIndices);
+
+		RemapVertexChannel(mesh->mVertices, vertexCount, remap);
+		RemapVertexChannel(mesh->mNormals, vertexCount, remap);
+		RemapVertexChannel(mesh->mTangents, vertexCount, remap);
+		RemapVertexChannel(mesh->mBitangents, vertexCount, remap);
+		for (uint32_t c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c)
+			RemapVertexChannel(mesh->mColors[c], vertexCount, remap);
+		for (uint32_t c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++c)
+			RemapVertexChannel(mesh->mTextureCoords[c], vertexCount, remap);
+
+		for (uint32_t b = 0; b < mesh->mNumBones; ++b)
+		{
+			aiBone* bone = mesh->mBones[b];
+			for (uint32_t w = 0; w < bone->mNumWeights; ++w)
+				bone->mWeights[w].mVertexId = remap[bone->mWeights[w].mVertexId];
+		}
+
+		VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(&indices[0], indexCount, vertexCount);
+
+		cout << "Optimize mesh " << mesh->mName.C_Str() << ": ACMR " << before.ACMR << " -> " << after.ACMR
+			 << ", ATVR " << before.ATVR << " -> " << after.ATVR << endl;
+	}
+}
+
 void AssimpProcesser::ExportModel( OutModel& outModel, const String& outName )
 {
 	outModel.OutName = outName;
@@ -943,6 +1019,8 @@ void AssimpProcesser::ExportModel( OutModel& outModel, const String& outName )
 	
 	CollectMeshes(outModel, outModel.RootNode);
 
+	OptimizeMeshes(outModel);
+
 	CollectBones(outModel);
 
 	BuildAndSaveModel(outModel);
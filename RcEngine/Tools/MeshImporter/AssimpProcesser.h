@@ -98,6 +98,9 @@ public:
 
 	bool Process(const char* filePath, const char* skeleton, const vector<String>& clips);
 
+	// Same as FbxImporter -compress, compressed meshes are smaller but can't be memory mapped
+	void SetCompressOutput(bool compress)		{ mCompressOutput = compress; }
+
 private:
 	void ProcessScene(const aiScene* scene);
 
@@ -119,6 +122,9 @@ private:
 	void CollectBonesFinal(vector<aiNode*>& bones, const set<aiNode*>& necessary, aiNode* node);
 	void CollectAnimations(OutModel& model, aiScene* scene);
 
+	// Reorder triangles and vertices for vertex cache, overdraw and fetch
+	void OptimizeMeshes(OutModel& outModel);
+
 	void BuildAndSaveModel(OutModel& outModel);
 	void BuildAndSaveAnimations(OutModel& model);
 	void BuildBoneCollisions();
@@ -132,6 +138,7 @@ private:
 	String mFilename;
 	vector<String> mAnimationClips;
 	String mName;
+	bool mCompressOutput;
 	
 	OutModel mModel;
 };
\ No newline at end of file
@@ -4,6 +4,12 @@
 int main(int argc, char** argv)
 {
 	AssimpProcesser processer;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-compress") == 0)
+			processer.SetCompressOutput(true);
+	}
 	//processer.Process("media/Dwarves/dwarf-lod0_rotating_hand.X");
 	//processer.Process("media/ninja.mesh.xml");
 
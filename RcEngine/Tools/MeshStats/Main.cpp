@@ -0,0 +1,123 @@
+// Report post-transform vertex cache efficiency (ACMR/ATVR) of exported meshes,
+// as stored and after MeshOptimizer reordering.
+//
+// Usage: MeshStats [-cache size] file.mesh ...
+
+#include <Core/Prerequisites.h>
+#include <Core/Exception.h>
+#include <Graphics/MeshOptimizer.h>
+#include <Graphics/MeshFormat.h>
+#include <Math/Vector.h>
+#include <iostream>
+#include <iomanip>
+
+using namespace RcEngine;
+
+struct StatsSummary
+{
+	StatsSummary() : Triangles(0), VerticesBefore(0), VerticesAfter(0) {}
+
+	uint64_t Triangles;
+	uint64_t VerticesBefore;
+	uint64_t VerticesAfter;
+};
+
+static void PrintStats(const String& name, uint32_t triangles, const VertexCacheStatistics& before, const VertexCacheStatistics& after)
+{
+	std::cout << "  " << std::left << std::setw(32) << name << std::right
+			  << std::setw(10) << triangles
+			  << std::fixed << std::setprecision(3)
+			  << "   ACMR " << before.ACMR << " -> " << after.ACMR
+			  << "   ATVR " << before.ATVR << " -> " << after.ATVR << std::endl;
+}
+
+static bool ProcessMesh(const String& fileName, uint32_t cacheSize, StatsSummary& summary)
+{
+	MeshFileGeometry mesh;
+	if (!ReadMeshFileGeometry(fileName, mesh))
+	{
+		std::cerr << "Can't read mesh " << fileName << std::endl;
+		return false;
+	}
+
+	std::cout << fileName << " (" << mesh.Name << ")" << std::endl;
+
+	for (const MeshFileGeometry::Part& part : mesh.MeshParts)
+	{
+		const MeshFileGeometry::VertexBuffer& vertexBuffer = mesh.VertexBuffers[part.VertexBufferIndex];
+		const vector<uint32_t>& indexBuffer = mesh.IndexBuffers[part.IndexBufferIndex];
+
+		if (part.IndexCount < 3 || vertexBuffer.PositionOffset == UINT32_MAX)
+			continue;
+
+		vector<uint32_t> indices(indexBuffer.begin() + part.StartIndex, indexBuffer.begin() + part.StartIndex + part.IndexCount);
+		uint32_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+
+		vector<float3> positions(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+			positions[i] = mesh.GetPosition(part, i);
+
+		VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(&indices[0], part.IndexCount, vertexCount, cacheSize);
+
+		MeshOptimizer::OptimizeVertexCache(&indices[0], &indices[0], part.IndexCount, vertexCount);
+		MeshOptimizer::OptimizeOverdraw(&indices[0], &indices[0], part.IndexCount, positions[0](), sizeof(float3), vertexCount);
+
+		VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(&indices[0], part.IndexCount, vertexCount, cacheSize);
+
+		PrintStats(part.Name, part.IndexCount / 3, before, after);
+
+		summary.Triangles += part.IndexCount / 3;
+		summary.VerticesBefore += before.VerticesTransformed;
+		summary.VerticesAfter += after.VerticesTransformed;
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t cacheSize = MeshOptimizer::DefaultCacheSize;
+	vector<String> files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		String arg = argv[i];
+		if (arg == "-cache" && i + 1 < argc)
+			cacheSize = (uint32_t)atoi(argv[++i]);
+		else
+			files.push_back(arg);
+	}
+
+	if (files.empty())
+	{
+		std::cout << "Usage: MeshStats [-cache size] file.mesh ..." << std::endl;
+		return 1;
+	}
+
+	StatsSummary summary;
+	int result = 0;
+
+	for (const String& file : files)
+	{
+		try 
+		{
+			if (!ProcessMesh(file, cacheSize, summary))
+				result = 1;
+		}
+		catch (Exception& e)
+		{
+			std::cerr << file << ": " << e.what() << std::endl;
+			result = 1;
+		}
+	}
+
+	if (summary.Triangles)
+	{
+		std::cout << std::fixed << std::setprecision(3)
+				  << "Total " << summary.Triangles << " triangles, cache size " << cacheSize 
+				  << ", ACMR " << double(summary.VerticesBefore) / summary.Triangles 
+				  << " -> " << double(summary.VerticesAfter) / summary.Triangles << std::endl;
+	}
+
+	return result;
+}
@@ -0,0 +1,408 @@
+// Bake irradiance probe volume of a static scene on CPU. Rays from every probe gather sky
+// light and sun light bounced off scene meshes, result is projected to SH and written as
+// IrradianceVolume file. Direct sun is left to real-time lighting.
+//
+// Usage: ProbeBaker bake.xml out.probes
+//
+// <Bake>
+//   <Mesh file="room.mesh" position="0 0 0" rotation="0 0 0" scale="1 1 1"/>
+//   <Sky color="0.6 0.7 1.0" ground="0.2 0.2 0.2"/>
+//   <Sun direction="-0.3 -1 -0.2" color="3 3 3"/>
+//   <Volume min="-10 0 -10" max="10 5 10" count="16 4 16"/>
+//   <Settings rays="256" bounces="2" albedo="0.5"/>
+// </Bake>
+//
+// Rotation is yaw, pitch, roll in degrees. Volume defaults to scene bounds.
+
+#include <Core/Prerequisites.h>
+#include <Core/Exception.h>
+#include <Core/ThreadPool.h>
+#include <Core/XMLDom.h>
+#include <Graphics/MeshFormat.h>
+#include <Graphics/IrradianceVolume.h>
+#include <IO/FileStream.h>
+#include <Math/MathUtil.h>
+#include "TriangleBVH.h"
+#include <iostream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <atomic>
+
+namespace {
+
+// Probes seeing more back faces than this are inside geometry
+const float MaxBackFaceFraction = 0.25f;
+
+// Ray origin offset along surface normal
+const float RayBias = 1e-3f;
+
+struct BakeSettings
+{
+	float3 SkyColor;
+	float3 GroundColor;
+	float3 SunDirection;		// Direction light travels
+	float3 SunColor;
+
+	BoundingBoxf Bounds;
+	uint32_t Dims[3];
+
+	uint32_t NumRays;
+	uint32_t NumBounces;
+	float Albedo;
+};
+
+float3 ParseFloat3(const String& value, const float3& defaultValue)
+{
+	float3 result = defaultValue;
+
+	std::istringstream stream(value);
+	stream >> result[0] >> result[1] >> result[2];
+	return stream.fail() ? defaultValue : result;
+}
+
+bool LoadScene(const String& bakeFile, TriangleBVH& bvh, BakeSettings& settings)
+{
+	FileStream source;
+	if (!source.Open(bakeFile, FILE_READ))
+	{
+		std::cout << "Can't open " << bakeFile << std::endl;
+		return false;
+	}
+
+	XMLDoc doc;
+	XMLNodePtr root = doc.Parse(source);
+	source.Close();
+
+	for (XMLNodePtr meshNode = root->FirstNode("Mesh"); meshNode; meshNode = meshNode->NextSibling("Mesh"))
+	{
+		String meshFile = meshNode->AttributeString("file", "");
+
+		MeshFileGeometry mesh;
+		if (!ReadMeshFileGeometry(meshFile, mesh))
+		{
+			std::cout << "Can't read mesh " << meshFile << std::endl;
+			return false;
+		}
+
+		float3 position = ParseFloat3(meshNode->AttributeString("position", ""), float3(0, 0, 0));
+		float3 rotation = ParseFloat3(meshNode->AttributeString("rotation", ""), float3(0, 0, 0));
+		float3 scale = ParseFloat3(meshNode->AttributeString("scale", ""), float3(1, 1, 1));
+
+		float4x4 world = CreateScaling(scale.X(), scale.Y(), scale.Z()) *
+			CreateRotationYawPitchRoll(Mathf::ToRadian(rotation.X()), Mathf::ToRadian(rotation.Y()), Mathf::ToRadian(rotation.Z())) *
+			CreateTranslation(position);
+
+		for (const MeshFileGeometry::Part& part : mesh.MeshParts)
+		{
+			if (mesh.VertexBuffers[part.VertexBufferIndex].PositionOffset == UINT32_MAX)
+				continue;
+
+			const vector<uint32_t>& indexBuffer = mesh.IndexBuffers[part.IndexBufferIndex];
+			for (uint32_t i = part.StartIndex; i + 2 < part.StartIndex + part.IndexCount; i += 3)
+			{
+				bvh.AddTriangle(Transform(mesh.GetPosition(part, indexBuffer[i]), world),
+								Transform(mesh.GetPosition(part, indexBuffer[i+1]), world),
+								Transform(mesh.GetPosition(part, indexBuffer[i+2]), world));
+			}
+		}
+	}
+
+	if (bvh.GetNumTriangles() == 0)
+	{
+		std::cout << bakeFile << ": no triangles to bake" << std::endl;
+		return false;
+	}
+
+	bvh.Build();
+
+	XMLNodePtr skyNode = root->FirstNode("Sky");
+	settings.SkyColor = ParseFloat3(skyNode ? skyNode->AttributeString("color", "") : "", float3(0.6f, 0.7f, 1.0f));
+	settings.GroundColor = ParseFloat3(skyNode ? skyNode->AttributeString("ground", "") : "", float3(0.2f, 0.2f, 0.2f));
+
+	XMLNodePtr sunNode = root->FirstNode("Sun");
+	settings.SunDirection = Normalize(ParseFloat3(sunNode ? sunNode->AttributeString("direction", "") : "", float3(0, -1, 0)));
+	settings.SunColor = ParseFloat3(sunNode ? sunNode->AttributeString("color", "") : "", float3(0, 0, 0));
+
+	XMLNodePtr volumeNode = root->FirstNode("Volume");
+	settings.Bounds.Min = ParseFloat3(volumeNode ? volumeNode->AttributeString("min", "") : "", bvh.GetBounds().Min);
+	settings.Bounds.Max = ParseFloat3(volumeNode ? volumeNode->AttributeString("max", "") : "", bvh.GetBounds().Max);
+
+	float3 count = ParseFloat3(volumeNode ? volumeNode->AttributeString("count", "") : "", float3(8, 8, 8));
+	for (int axis = 0; axis < 3; ++axis)
+		settings.Dims[axis] = (std::max)(2U, uint32_t(count[axis]));
+
+	XMLNodePtr settingsNode = root->FirstNode("Settings");
+	settings.NumRays = settingsNode ? settingsNode->AttributeUInt("rays", 256) : 256;
+	settings.NumBounces = settingsNode ? settingsNode->AttributeUInt("bounces", 2) : 2;
+	settings.Albedo = settingsNode ? settingsNode->AttributeFloat("albedo", 0.5f) : 0.5f;
+
+	settings.NumRays = (std::max)(settings.NumRays, 16U);
+	return true;
+}
+
+// Spherical Fibonacci point i of n, evenly covers the sphere with equal weights
+float3 FibonacciDirection(uint32_t i, uint32_t n)
+{
+	const float goldenAngle = Mathf::PI * (3.0f - sqrtf(5.0f));
+
+	float z = 1.0f - (2.0f * i + 1.0f) / n;
+	float r = sqrtf((std::max)(0.0f, 1.0f - z * z));
+	float phi = goldenAngle * i;
+
+	return float3(r * cosf(phi), r * sinf(phi), z);
+}
+
+float3 CosineSampleHemisphere(const float3& normal, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	float u1 = uniform(rng), u2 = uniform(rng);
+
+	float r = sqrtf(u1);
+	float phi = Mathf::TWO_PI * u2;
+
+	float3 tangent = fabs(normal.X()) > 0.9f ? float3(0, 1, 0) : float3(1, 0, 0);
+	tangent = Normalize(Cross(tangent, normal));
+	float3 bitangent = Cross(normal, tangent);
+
+	return tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) + normal * sqrtf((std::max)(0.0f, 1.0f - u1));
+}
+
+class ProbeTracer
+{
+public:
+	ProbeTracer(const TriangleBVH& bvh, const BakeSettings& settings, uint32_t seed)
+		: mBVH(bvh),
+		  mSettings(settings),
+		  mRandom(seed)
+	{
+
+	}
+
+	/// Radiance arriving at origin from dir, back face set if primary ray hit a back face.
+	float3 Trace(const float3& origin, const float3& dir, uint32_t bounce, bool& backFace)
+	{
+		backFace = false;
+
+		RayHit hit;
+		if (!mBVH.Intersect(origin, dir, FLT_MAX, hit))
+		{
+			float t = Clamp(dir.Y() * 0.5f + 0.5f, 0.0f, 1.0f);
+			return Lerp(mSettings.GroundColor, mSettings.SkyColor, t);
+		}
+
+		if (hit.BackFace)
+		{
+			backFace = true;
+			return float3(0, 0, 0);
+		}
+
+		float3 normal = mBVH.GetNormal(hit.Triangle);
+		float3 position = origin + dir * hit.Distance + normal * RayBias;
+
+		// Lambert surface, cosine sampled bounce cancels PI of irradiance integral
+		float3 toSun = -mSettings.SunDirection;
+		float nDotL = Dot(normal, toSun);
+
+		float3 radiance(0, 0, 0);
+		if (nDotL > 0.0f && !mBVH.Occluded(position, toSun, FLT_MAX))
+			radiance += mSettings.SunColor * (nDotL * Mathf::INV_PI);
+
+		if (bounce + 1 < mSettings.NumBounces)
+		{
+			bool bounceBackFace;
+			radiance += Trace(position, CosineSampleHemisphere(normal, mRandom), bounce + 1, bounceBackFace);
+		}
+
+		return radiance * mSettings.Albedo;
+	}
+
+private:
+	const TriangleBVH& mBVH;
+	const BakeSettings& mSettings;
+	std::mt19937 mRandom;
+};
+
+bool BakeProbe(const TriangleBVH& bvh, const BakeSettings& settings, const float3& position, uint32_t seed, SHRadiance& sh)
+{
+	ProbeTracer tracer(bvh, settings, seed);
+
+	memset(&sh, 0, sizeof(sh));
+
+	uint32_t numBackFaces = 0;
+	for (uint32_t i = 0; i < settings.NumRays; ++i)
+	{
+		float3 dir = FibonacciDirection(i, settings.NumRays);
+
+		bool backFace;
+		float3 radiance = tracer.Trace(position, dir, 0, backFace);
+		if (backFace)
+			numBackFaces++;
+
+		float basis[9];
+		IrradianceVolume::EvalBasis(dir, basis);
+		for (uint32_t k = 0; k < 9; ++k)
+			sh.Coeffs[k] += radiance * basis[k];
+	}
+
+	// Each direction covers equal solid angle
+	const float weight = 4.0f * Mathf::PI / settings.NumRays;
+	for (uint32_t k = 0; k < 9; ++k)
+		sh.Coeffs[k] *= weight;
+
+	return numBackFaces <= MaxBackFaceFraction * settings.NumRays;
+}
+
+// Probes inside geometry would leak dark light through walls, take average of valid neighbours,
+// growing into larger invalid regions pass by pass
+uint32_t FillInvalidProbes(IrradianceVolume& volume, vector<bool>& valid)
+{
+	const int dims[3] = { int(volume.GetDimension(0)), int(volume.GetDimension(1)), int(volume.GetDimension(2)) };
+
+	uint32_t numFilled = 0;
+	for (;;)
+	{
+		vector<uint32_t> filled;
+		for (int z = 0; z < dims[2]; ++z)
+		for (int y = 0; y < dims[1]; ++y)
+		for (int x = 0; x < dims[0]; ++x)
+		{
+			uint32_t index = volume.GetProbeIndex(x, y, z);
+			if (valid[index])
+				continue;
+
+			SHRadiance sum;
+			memset(&sum, 0, sizeof(sum));
+
+			uint32_t numNeighbours = 0;
+			for (int dz = -1; dz <= 1; ++dz)
+			for (int dy = -1; dy <= 1; ++dy)
+			for (int dx = -1; dx <= 1; ++dx)
+			{
+				int nx = x + dx, ny = y + dy, nz = z + dz;
+				if (nx < 0 || ny < 0 || nz < 0 || nx >= dims[0] || ny >= dims[1] || nz >= dims[2])
+					continue;
+
+				uint32_t neighbour = volume.GetProbeIndex(nx, ny, nz);
+				if (!valid[neighbour])
+					continue;
+
+				for (uint32_t k = 0; k < 9; ++k)
+					sum.Coeffs[k] += volume.GetProbe(neighbour).Coeffs[k];
+				numNeighbours++;
+			}
+
+			if (numNeighbours)
+			{
+				for (uint32_t k = 0; k < 9; ++k)
+					sum.Coeffs[k] *= 1.0f / numNeighbours;
+
+				volume.SetProbe(index, sum);
+				filled.push_back(index);
+			}
+		}
+
+		if (filled.empty())
+			break;
+
+		for (uint32_t index : filled)
+			valid[index] = true;
+
+		numFilled += filled.size();
+	}
+
+	return numFilled;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: ProbeBaker bake.xml out.probes" << std::endl;
+		return 1;
+	}
+
+	String bakeFile = argv[1];
+	String outputFile = argv[2];
+
+	ThreadPool::Initialize();
+
+	int result = 0;
+	try
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		TriangleBVH bvh;
+		BakeSettings settings;
+		if (!LoadScene(bakeFile, bvh, settings))
+		{
+			ThreadPool::Finalize();
+			return 1;
+		}
+
+		auto buildTime = std::chrono::high_resolution_clock::now();
+
+		IrradianceVolume volume;
+		volume.Create(settings.Bounds, settings.Dims[0], settings.Dims[1], settings.Dims[2]);
+
+		const uint32_t numProbes = volume.GetNumProbes();
+		vector<bool> valid(numProbes);
+
+		// vector<bool> isn't safe to write from several threads
+		vector<uint8_t> probeValid(numProbes);
+		std::atomic<uint32_t> numBaked(0);
+
+		ParallelFor(0, numProbes, [&](uint32_t index) {
+			uint32_t x = index % settings.Dims[0];
+			uint32_t y = (index / settings.Dims[0]) % settings.Dims[1];
+			uint32_t z = index / (settings.Dims[0] * settings.Dims[1]);
+
+			SHRadiance sh;
+			probeValid[index] = BakeProbe(bvh, settings, volume.GetProbePosition(x, y, z), index, sh);
+			volume.SetProbe(index, sh);
+
+			numBaked++;
+		});
+
+		uint32_t numInvalid = 0;
+		for (uint32_t i = 0; i < numProbes; ++i)
+		{
+			valid[i] = probeValid[i] != 0;
+			if (!valid[i])
+				numInvalid++;
+		}
+
+		uint32_t numFilled = FillInvalidProbes(volume, valid);
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+
+		FileStream output;
+		if (!output.Open(outputFile, FILE_WRITE))
+		{
+			std::cout << outputFile << ": can't write file" << std::endl;
+			result = 1;
+		}
+		else
+		{
+			volume.Save(output);
+			output.Close();
+		}
+
+		typedef std::chrono::milliseconds ms;
+		std::cout << bvh.GetNumTriangles() << " triangles, " << bvh.GetNumNodes() << " BVH nodes in "
+				  << std::chrono::duration_cast<ms>(buildTime - startTime).count() << " ms" << std::endl
+				  << numBaked << " probes x " << settings.NumRays << " rays, " << settings.NumBounces << " bounces in "
+				  << std::chrono::duration_cast<ms>(endTime - buildTime).count() << " ms" << std::endl
+				  << numInvalid << " probes inside geometry, " << numFilled << " filled from neighbours" << std::endl;
+	}
+	catch (Exception& e)
+	{
+		std::cout << bakeFile << ": " << e.GetFullDescription() << std::endl;
+		result = 1;
+	}
+
+	ThreadPool::Finalize();
+	return result;
+}
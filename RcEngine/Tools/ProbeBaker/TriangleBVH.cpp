@@ -0,0 +1,298 @@
+#include "TriangleBVH.h"
+
+namespace {
+
+// Traversal stack holds at most one node per level plus one
+const uint32_t MaxDepth = 60;
+const uint32_t StackSize = 64;
+
+float SurfaceArea(const BoundingBoxf& box)
+{
+	if (!box.IsValid())
+		return 0.0f;
+
+	float3 extent = box.Max - box.Min;
+	return 2.0f * (extent.X() * extent.Y() + extent.Y() * extent.Z() + extent.Z() * extent.X());
+}
+
+// Slab test, entry distance is clamped to ray start
+bool IntersectBox(const BoundingBoxf& box, const float3& origin, const float3& invDir, float maxDistance, float& entry)
+{
+	float tMin = 0.0f, tMax = maxDistance;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float t0 = (box.Min[axis] - origin[axis]) * invDir[axis];
+		float t1 = (box.Max[axis] - origin[axis]) * invDir[axis];
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		tMin = (std::max)(tMin, t0);
+		tMax = (std::min)(tMax, t1);
+	}
+
+	entry = tMin;
+	return tMin <= tMax;
+}
+
+}
+
+TriangleBVH::TriangleBVH()
+{
+
+}
+
+void TriangleBVH::AddTriangle( const float3& v0, const float3& v1, const float3& v2 )
+{
+	Triangle triangle;
+	triangle.V0 = v0;
+	triangle.Edge1 = v1 - v0;
+	triangle.Edge2 = v2 - v0;
+
+	mTriangles.push_back(triangle);
+	mNodes.clear();
+}
+
+float3 TriangleBVH::GetNormal( uint32_t triangle ) const
+{
+	return Normalize(Cross(mTriangles[triangle].Edge1, mTriangles[triangle].Edge2));
+}
+
+void TriangleBVH::Build()
+{
+	mNodes.clear();
+	if (mTriangles.empty())
+		return;
+
+	vector<BoundingBoxf> triBounds(mTriangles.size());
+	vector<float3> centroids(mTriangles.size());
+	for (size_t i = 0; i < mTriangles.size(); ++i)
+	{
+		const Triangle& triangle = mTriangles[i];
+
+		triBounds[i].Merge(triangle.V0);
+		triBounds[i].Merge(triangle.V0 + triangle.Edge1);
+		triBounds[i].Merge(triangle.V0 + triangle.Edge2);
+		centroids[i] = triBounds[i].Center();
+	}
+
+	mIndices.resize(mTriangles.size());
+	for (uint32_t i = 0; i < mIndices.size(); ++i)
+		mIndices[i] = i;
+
+	mNodes.reserve(mTriangles.size() * 2 / MaxLeafTriangles + 1);
+	BuildNode(0, mTriangles.size(), triBounds, centroids, 0);
+
+	// Leaves reference contiguous triangles
+	vector<Triangle> sorted(mTriangles.size());
+	for (size_t i = 0; i < mIndices.size(); ++i)
+		sorted[i] = mTriangles[mIndices[i]];
+
+	mTriangles.swap(sorted);
+	vector<uint32_t>().swap(mIndices);
+}
+
+uint32_t TriangleBVH::BuildNode( uint32_t first, uint32_t count, const vector<BoundingBoxf>& triBounds, const vector<float3>& centroids, uint32_t depth )
+{
+	uint32_t nodeIndex = mNodes.size();
+	mNodes.push_back(Node());
+
+	BoundingBoxf bounds, centroidBounds;
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		bounds.Merge(triBounds[mIndices[i]]);
+		centroidBounds.Merge(centroids[mIndices[i]]);
+	}
+
+	mNodes[nodeIndex].Bounds = bounds;
+	mNodes[nodeIndex].First = first;
+	mNodes[nodeIndex].Count = count;
+
+	if (count <= MaxLeafTriangles || depth >= MaxDepth)
+		return nodeIndex;
+
+	// Bin centroids along each axis, split where left and right area times count is lowest
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		BoundingBoxf binBounds[NumBins];
+		uint32_t binCounts[NumBins] = { 0 };
+
+		float scale = NumBins / extent;
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			uint32_t bin = (std::min)(NumBins - 1, uint32_t((centroids[mIndices[i]][axis] - centroidBounds.Min[axis]) * scale));
+			binBounds[bin].Merge(triBounds[mIndices[i]]);
+			binCounts[bin]++;
+		}
+
+		float rightArea[NumBins];
+		uint32_t rightCount[NumBins];
+
+		BoundingBoxf accum;
+		uint32_t accumCount = 0;
+		for (uint32_t bin = NumBins - 1; bin > 0; --bin)
+		{
+			accum.Merge(binBounds[bin]);
+			accumCount += binCounts[bin];
+			rightArea[bin] = SurfaceArea(accum);
+			rightCount[bin] = accumCount;
+		}
+
+		accum.SetNull();
+		accumCount = 0;
+		for (uint32_t bin = 0; bin + 1 < NumBins; ++bin)
+		{
+			accum.Merge(binBounds[bin]);
+			accumCount += binCounts[bin];
+
+			if (accumCount == 0 || rightCount[bin + 1] == 0)
+				continue;
+
+			float cost = accumCount * SurfaceArea(accum) + rightCount[bin + 1] * rightArea[bin + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	uint32_t mid = first + count / 2;
+	if (bestAxis >= 0)
+	{
+		float minCentroid = centroidBounds.Min[bestAxis];
+		float scale = NumBins / (centroidBounds.Max[bestAxis] - minCentroid);
+
+		uint32_t* split = std::partition(&mIndices[first], &mIndices[first] + count, [&](uint32_t index) {
+			return (std::min)(NumBins - 1, uint32_t((centroids[index][bestAxis] - minCentroid) * scale)) <= bestBin;
+		});
+		mid = split - &mIndices[0];
+	}
+
+	// Coincident centroids split by order
+	if (mid == first || mid == first + count)
+		mid = first + count / 2;
+
+	BuildNode(first, mid - first, triBounds, centroids, depth + 1);
+	uint32_t right = BuildNode(mid, first + count - mid, triBounds, centroids, depth + 1);
+
+	mNodes[nodeIndex].First = right;
+	mNodes[nodeIndex].Count = 0;
+	return nodeIndex;
+}
+
+template <bool AnyHit>
+bool TriangleBVH::Traverse( const float3& origin, const float3& dir, float maxDistance, RayHit& hit ) const
+{
+	if (mNodes.empty())
+		return false;
+
+	const float3 invDir(1.0f / dir.X(), 1.0f / dir.Y(), 1.0f / dir.Z());
+
+	struct StackEntry
+	{
+		uint32_t Node;
+		float Entry;
+	};
+
+	StackEntry stack[StackSize];
+	uint32_t stackSize = 0;
+
+	float entry;
+	if (!IntersectBox(mNodes[0].Bounds, origin, invDir, maxDistance, entry))
+		return false;
+
+	StackEntry root = { 0, entry };
+	stack[stackSize++] = root;
+
+	bool found = false;
+	hit.Distance = maxDistance;
+
+	while (stackSize)
+	{
+		StackEntry current = stack[--stackSize];
+		if (current.Entry > hit.Distance)
+			continue;
+
+		const Node& node = mNodes[current.Node];
+		if (node.Count)
+		{
+			// Moller-Trumbore, two sided
+			for (uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				const Triangle& triangle = mTriangles[i];
+
+				float3 p = Cross(dir, triangle.Edge2);
+				float det = Dot(triangle.Edge1, p);
+				if (fabs(det) < 1e-12f)
+					continue;
+
+				float invDet = 1.0f / det;
+				float3 s = origin - triangle.V0;
+				float u = Dot(s, p) * invDet;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+
+				float3 q = Cross(s, triangle.Edge1);
+				float v = Dot(dir, q) * invDet;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+
+				float t = Dot(triangle.Edge2, q) * invDet;
+				if (t <= 0.0f || t >= hit.Distance)
+					continue;
+
+				hit.Distance = t;
+				hit.Triangle = i;
+				hit.BackFace = det < 0.0f;
+				found = true;
+
+				if (AnyHit)
+					return true;
+			}
+		}
+		else
+		{
+			StackEntry left = { current.Node + 1, 0.0f };
+			StackEntry right = { node.First, 0.0f };
+
+			bool hitLeft = IntersectBox(mNodes[left.Node].Bounds, origin, invDir, hit.Distance, left.Entry);
+			bool hitRight = IntersectBox(mNodes[right.Node].Bounds, origin, invDir, hit.Distance, right.Entry);
+
+			if (hitLeft && hitRight)
+			{
+				// Nearer child is popped first
+				if (left.Entry < right.Entry)
+					std::swap(left, right);
+
+				stack[stackSize++] = left;
+				stack[stackSize++] = right;
+			}
+			else if (hitLeft)
+				stack[stackSize++] = left;
+			else if (hitRight)
+				stack[stackSize++] = right;
+		}
+	}
+
+	return found;
+}
+
+bool TriangleBVH::Intersect( const float3& origin, const float3& dir, float maxDistance, RayHit& hit ) const
+{
+	return Traverse<false>(origin, dir, maxDistance, hit);
+}
+
+bool TriangleBVH::Occluded( const float3& origin, const float3& dir, float maxDistance ) const
+{
+	RayHit hit;
+	return Traverse<true>(origin, dir, maxDistance, hit);
+}
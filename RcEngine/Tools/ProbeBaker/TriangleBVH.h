@@ -0,0 +1,72 @@
+#ifndef TriangleBVH_h__
+#define TriangleBVH_h__
+
+#include <Core/Prerequisites.h>
+#include <Math/Vector.h>
+#include <Math/BoundingBox.h>
+
+using namespace RcEngine;
+
+struct RayHit
+{
+	float Distance;
+	uint32_t Triangle;
+	bool BackFace;			// Ray hit side opposite to counter clockwise winding normal
+};
+
+/**
+ * Bounding volume hierarchy over world space triangles, built with binned surface area
+ * heuristic. Nodes are stored depth first, so the left child follows its parent and only
+ * the right child index is kept.
+ */
+class TriangleBVH
+{
+public:
+	static const uint32_t MaxLeafTriangles = 4;
+	static const uint32_t NumBins = 16;
+
+public:
+	TriangleBVH();
+
+	void AddTriangle(const float3& v0, const float3& v1, const float3& v2);
+
+	void Build();
+
+	/// Closest hit within maxDistance, triangles are two sided.
+	bool Intersect(const float3& origin, const float3& dir, float maxDistance, RayHit& hit) const;
+
+	/// Any hit within maxDistance, for shadow rays.
+	bool Occluded(const float3& origin, const float3& dir, float maxDistance) const;
+
+	uint32_t GetNumTriangles() const				{ return mTriangles.size(); }
+	uint32_t GetNumNodes() const					{ return mNodes.size(); }
+	const BoundingBoxf& GetBounds() const			{ return mNodes.empty() ? mEmptyBounds : mNodes[0].Bounds; }
+
+	float3 GetNormal(uint32_t triangle) const;
+
+private:
+	struct Triangle
+	{
+		float3 V0, Edge1, Edge2;
+	};
+
+	struct Node
+	{
+		BoundingBoxf Bounds;
+		uint32_t First;			// Right child of inner node, first triangle index of leaf
+		uint32_t Count;			// Zero for inner node
+	};
+
+	uint32_t BuildNode(uint32_t first, uint32_t count, const vector<BoundingBoxf>& triBounds, const vector<float3>& centroids, uint32_t depth);
+
+	template <bool AnyHit>
+	bool Traverse(const float3& origin, const float3& dir, float maxDistance, RayHit& hit) const;
+
+private:
+	vector<Triangle> mTriangles;
+	vector<Node> mNodes;
+	vector<uint32_t> mIndices;		// Triangle order while building
+	BoundingBoxf mEmptyBounds;
+};
+
+#endif // TriangleBVH_h__
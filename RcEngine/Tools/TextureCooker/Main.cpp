@@ -0,0 +1,307 @@
+// Compress TGA, PFM or uncompressed DDS images to BCn DDS textures with full mip chain.
+//
+// Usage: TextureCooker [-f bc1|bc1a|bc3|bc4|bc5|bc7] [-q fast|normal|high] [-srgb] [-nomips]
+//                      [-filter box|kaiser] [-alpharef value] [-o out.dds] input
+
+#include <Graphics/Image.h>
+#include <Graphics/BlockCompression.h>
+#include <Graphics/VertexQuantization.h>
+#include <Core/ThreadPool.h>
+#include <Core/Exception.h>
+#include <iostream>
+
+using namespace RcEngine;
+
+namespace {
+
+String GetExtension(const String& filename)
+{
+	size_t dot = filename.rfind('.');
+	if (dot == String::npos)
+		return "";
+
+	String ext = filename.substr(dot);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext;
+}
+
+uint8_t FloatToUNorm8(float value)
+{
+	value = (std::min)(1.0f, (std::max)(0.0f, value));
+	return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+/**
+ * Convert top level of one surface to tightly packed RGBA8, return false on unsupported format.
+ */
+bool ConvertToRGBA8(Image& image, uint32_t layer, CubeMapFace face, vector<uint8_t>& pixels)
+{
+	const uint32_t width = image.GetWidth();
+	const uint32_t height = image.GetHeight();
+	const uint8_t* src = static_cast<const uint8_t*>(image.GetLevel(0, layer, face));
+
+	pixels.resize(width * height * 4);
+	uint8_t* dest = &pixels[0];
+
+	const uint32_t numPixels = width * height;
+	switch (image.GetFormat())
+	{
+	case PF_RGBA8_UNORM:
+	case PF_SRGB8_ALPHA8_UNORM:
+		memcpy(dest, src, numPixels * 4);
+		break;
+	case PF_BGRA8_UNORM:
+	case PF_BGRX8_UNORM:
+	case PF_SBGR8_ALPHA8_UNORM:
+	case PF_SBGRX8_UNORM:
+		{
+			bool hasAlpha = image.GetFormat() == PF_BGRA8_UNORM || image.GetFormat() == PF_SBGR8_ALPHA8_UNORM;
+			for (uint32_t i = 0; i < numPixels; ++i, src += 4, dest += 4)
+			{
+				dest[0] = src[2];
+				dest[1] = src[1];
+				dest[2] = src[0];
+				dest[3] = hasAlpha ? src[3] : 255;
+			}
+		}
+		break;
+	case PF_R8_UNORM:
+		for (uint32_t i = 0; i < numPixels; ++i, src += 1, dest += 4)
+		{
+			dest[0] = src[0];
+			dest[1] = dest[2] = 0;
+			dest[3] = 255;
+		}
+		break;
+	case PF_RG8_UNORM:
+		for (uint32_t i = 0; i < numPixels; ++i, src += 2, dest += 4)
+		{
+			dest[0] = src[0];
+			dest[1] = src[1];
+			dest[2] = 0;
+			dest[3] = 255;
+		}
+		break;
+	case PF_RGBA32F:
+	case PF_RGB32F:
+	case PF_R32F:
+		{
+			// No BC6H encoder, HDR values are clamped
+			uint32_t numChannels = (image.GetFormat() == PF_RGBA32F) ? 4 : ((image.GetFormat() == PF_RGB32F) ? 3 : 1);
+			const float* srcFloat = reinterpret_cast<const float*>(src);
+			for (uint32_t i = 0; i < numPixels; ++i, srcFloat += numChannels, dest += 4)
+			{
+				dest[0] = FloatToUNorm8(srcFloat[0]);
+				dest[1] = (numChannels > 1) ? FloatToUNorm8(srcFloat[1]) : 0;
+				dest[2] = (numChannels > 2) ? FloatToUNorm8(srcFloat[2]) : 0;
+				dest[3] = (numChannels > 3) ? FloatToUNorm8(srcFloat[3]) : 255;
+			}
+		}
+		break;
+	case PF_RGBA16F:
+		{
+			const uint16_t* srcHalf = reinterpret_cast<const uint16_t*>(src);
+			for (uint32_t i = 0; i < numPixels * 4; ++i)
+				dest[i] = FloatToUNorm8(VertexQuantization::HalfToFloat(srcHalf[i]));
+		}
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool GetTargetFormat(const String& name, bool srgb, PixelFormat& format)
+{
+	if (name == "bc1")
+		format = srgb ? PF_SRGB_DXT1_UNORM : PF_RGB_DXT1_UNORM;
+	else if (name == "bc1a")
+		format = srgb ? PF_SRGB_ALPHA_DXT1_UNORM : PF_RGBA_DXT1_UNORM;
+	else if (name == "bc3")
+		format = srgb ? PF_SRGB_ALPHA_DXT5_UNORM : PF_RGBA_DXT5_UNORM;
+	else if (name == "bc4")
+		format = PF_R_ATI1N_UNORM;
+	else if (name == "bc5")
+		format = PF_RG_ATI2N_UNORM;
+	else if (name == "bc7")
+		format = srgb ? PF_SRGB_BP_UNORM : PF_RGB_BP_UNORM;
+	else
+		return false;
+
+	return true;
+}
+
+void PrintUsage()
+{
+	std::cout << "Usage: TextureCooker [-f bc1|bc1a|bc3|bc4|bc5|bc7] [-q fast|normal|high] [-srgb] [-nomips] "
+		"[-filter box|kaiser] [-alpharef value] [-o out.dds] input" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	String inputFile, outputFile, formatName;
+	BlockCompressionQuality quality = BCQ_Normal;
+	bool srgb = false;
+	bool mips = true;
+	MipFilter filter = MF_Kaiser;
+	float alphaRef = 0.0f;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		String arg = argv[i];
+		if (arg == "-f" && i + 1 < argc)
+			formatName = argv[++i];
+		else if (arg == "-q" && i + 1 < argc)
+		{
+			String q = argv[++i];
+			if (q == "fast")
+				quality = BCQ_Fast;
+			else if (q == "high")
+				quality = BCQ_High;
+			else
+				quality = BCQ_Normal;
+		}
+		else if (arg == "-srgb")
+			srgb = true;
+		else if (arg == "-nomips")
+			mips = false;
+		else if (arg == "-filter" && i + 1 < argc)
+			filter = (String(argv[++i]) == "box") ? MF_Box : MF_Kaiser;
+		else if (arg == "-alpharef" && i + 1 < argc)
+			alphaRef = static_cast<float>(atof(argv[++i]));
+		else if (arg == "-o" && i + 1 < argc)
+			outputFile = argv[++i];
+		else if (arg[0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			inputFile = arg;
+	}
+
+	if (inputFile.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (outputFile.empty())
+	{
+		size_t dot = inputFile.rfind('.');
+		outputFile = inputFile.substr(0, dot) + ".dds";
+		if (outputFile == inputFile)
+		{
+			std::cout << inputFile << ": output would overwrite input, use -o" << std::endl;
+			return 1;
+		}
+	}
+
+	Image source;
+	String ext = GetExtension(inputFile);
+	bool loaded = false;
+	if (ext == ".tga")
+		loaded = source.LoadImageFromTGA(inputFile);
+	else if (ext == ".pfm")
+		loaded = source.LoadImageFromPFM(inputFile);
+	else if (ext == ".dds")
+		loaded = source.LoadImageFromDDS(inputFile);
+
+	if (!loaded)
+	{
+		std::cout << inputFile << ": can't load image" << std::endl;
+		return 1;
+	}
+
+	if (source.GetType() == TT_Texture3D || source.GetType() == TT_Texture1D)
+	{
+		std::cout << inputFile << ": only 2D, array and cube textures are supported" << std::endl;
+		return 1;
+	}
+
+	ThreadPool::Initialize();
+
+	int result = 0;
+	try
+	{
+		const uint32_t width = source.GetWidth();
+		const uint32_t height = source.GetHeight();
+		const uint32_t numFaces = (source.GetType() == TT_TextureCube) ? CMF_Count : 1;
+
+		// Convert all surfaces first, default format depends on alpha of every surface. sRGB
+		// content is tagged so mips are filtered in linear space.
+		Image rgba;
+		rgba.CreateImage(source.GetType(), srgb ? PF_SRGB8_ALPHA8_UNORM : PF_RGBA8_UNORM, width, height, 1, 1, source.GetLayers());
+
+		bool hasAlpha = false;
+		for (uint32_t layer = 0; layer < source.GetLayers(); ++layer)
+		{
+			for (uint32_t face = 0; face < numFaces; ++face)
+			{
+				vector<uint8_t> pixels;
+				if (!ConvertToRGBA8(source, layer, CubeMapFace(face), pixels))
+				{
+					std::cout << inputFile << ": unsupported source pixel format" << std::endl;
+					ThreadPool::Finalize();
+					return 1;
+				}
+
+				for (size_t i = 3; i < pixels.size() && !hasAlpha; i += 4)
+					hasAlpha = pixels[i] < 255;
+
+				memcpy(rgba.GetLevel(0, layer, CubeMapFace(face)), &pixels[0], pixels.size());
+			}
+		}
+
+		if (mips)
+			rgba.GenerateMipmaps(filter, alphaRef);
+
+		if (formatName.empty())
+			formatName = hasAlpha ? "bc3" : "bc1";
+
+		PixelFormat format;
+		if (!GetTargetFormat(formatName, srgb, format))
+		{
+			PrintUsage();
+			ThreadPool::Finalize();
+			return 1;
+		}
+
+		const uint32_t numLevels = rgba.GetLevels();
+
+		Image output;
+		output.CreateImage(source.GetType(), format, width, height, 1, numLevels, source.GetLayers());
+
+		for (uint32_t layer = 0; layer < source.GetLayers(); ++layer)
+		{
+			for (uint32_t face = 0; face < numFaces; ++face)
+			{
+				for (uint32_t i = 0; i < numLevels; ++i)
+				{
+					uint32_t levelWidth = (std::max)(1U, width >> i);
+					uint32_t levelHeight = (std::max)(1U, height >> i);
+
+					BlockCompression::CompressSurface(format, static_cast<const uint8_t*>(rgba.GetLevel(i, layer, CubeMapFace(face))),
+						levelWidth, levelHeight, levelWidth * 4, output.GetLevel(i, layer, CubeMapFace(face)), quality);
+				}
+			}
+		}
+
+		if (!output.SaveImageToDDS(outputFile))
+		{
+			std::cout << outputFile << ": can't write file" << std::endl;
+			result = 1;
+		}
+	}
+	catch (Exception& e)
+	{
+		std::cout << inputFile << ": " << e.GetFullDescription() << std::endl;
+		result = 1;
+	}
+
+	ThreadPool::Finalize();
+	return result;
+}
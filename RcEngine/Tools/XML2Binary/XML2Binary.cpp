@@ -1,27 +1,89 @@
 #include <iostream>
-#include <fstream>
-#include <unordered_map>
-#include <assimp/Importer.hpp>      // C++ importer interface
-#include <assimp/scene.h>           // Output data structure
-#include <assimp/postprocess.h>     // Post processing flags
-
 #include "Core/Prerequisites.h"
-#include "Graphics/GraphicsCommon.h"
-#include "Graphics/VertexDeclaration.h"
-#include "Math/MathUtil.h"
-#include "IO/FileSystem.h"
 #include "Core/XMLDom.h"
-
+#include "Core/Exception.h"
+#include "IO/FileStream.h"
+#include "Graphics/GraphicsScriptLoader.h"
 
 using namespace RcEngine;
-using namespace RcEngine::Core;
-using namespace RcEngine::Math;
-using namespace RcEngine::Render;
 
-int main(int argc, char** argv)
+namespace {
+
+/**
+ * Cook effect or material XML into binary file next to it, see Internal::GetCookedScriptName.
+ */
+bool CookScript(const String& xmlFile)
 {
-	return 0;
+	FileStream source;
+	if (!source.Open(xmlFile, FILE_READ))
+	{
+		std::cout << "Can't open " << xmlFile << std::endl;
+		return false;
+	}
+
+	// Loader falls back to XML if it doesn't match this hash anymore
+	uint64_t sourceHash = Internal::HashScriptSource(source);
+	source.Seek(0);
+
+	XMLDoc doc;
+	XMLNodePtr root = doc.Parse(source);
+	source.Close();
+
+	String cookedFile = Internal::GetCookedScriptName(xmlFile);
+	String rootName = root->NodeName();
+
+	if (rootName == "Effect")
+	{
+		Internal::EffectScript script;
+		Internal::LoadEffectScript(root, script);
+
+		FileStream dest(cookedFile, FILE_WRITE);
+		Internal::SaveEffectScript(dest, script, sourceHash);
+		dest.Close();
+	}
+	else if (rootName == "Material")
+	{
+		Internal::MaterialScript script;
+		Internal::LoadMaterialScript(root, script);
+
+		FileStream dest(cookedFile, FILE_WRITE);
+		Internal::SaveMaterialScript(dest, script, sourceHash);
+		dest.Close();
+	}
+	else
+	{
+		std::cout << "Skip " << xmlFile << ", unsupported script: " << rootName << std::endl;
+		return false;
+	}
+
+	std::cout << xmlFile << " -> " << cookedFile << std::endl;
+	return true;
+}
+
 }
 
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: XML2Binary file.effect.xml|file.material.xml ..." << std::endl;
+		return 1;
+	}
 
+	int numFailed = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		try
+		{
+			if (!CookScript(argv[i]))
+				numFailed++;
+		}
+		catch (Exception& e)
+		{
+			std::cout << argv[i] << ": " << e.GetFullDescription() << std::endl;
+			numFailed++;
+		}
+	}
 
+	return numFailed ? 1 : 0;
+}
@@ -1,6 +1,14 @@
 #include "CubeMapProcessor.h"
+#include "pfm.h"
 #include <stdint.h>
 #include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <xmmintrin.h>
 
 namespace {
 
@@ -156,12 +164,14 @@ glm::vec3 TexelCoordToVect(int faceID, float U, float V, int edgeLength, int fix
 	return retVal;
 }
 
-void VectToTexelCoord(glm::vec3 XYZ, int edgeLength, int *oFaceIdx, int *oU, int *oV )
+/**
+ * Face of direction and its -1..1 coordinates on that face
+ */
+int VectToFaceCoord(const glm::vec3& XYZ, float* oNvcU, float* oNvcV)
 {
 	float nvcU, nvcV;
 	float maxCoord;
 	int   faceIdx;
-	int   u, v;
 
 	//absolute value 3
 	glm::vec3 abxXYZ = glm::abs(XYZ);
@@ -212,10 +222,21 @@ void VectToTexelCoord(glm::vec3 XYZ, int edgeLength, int *oFaceIdx, int *oU, int
 	nvcU = glm::dot(Face2DMapping[ faceIdx ][CP_UDIR], onFaceXYZ );
 	nvcV = glm::dot(Face2DMapping[ faceIdx ][CP_VDIR], onFaceXYZ );
 
+	*oNvcU = nvcU;
+	*oNvcV = nvcV;
+
+	return faceIdx;
+}
+
+void VectToTexelCoord(glm::vec3 XYZ, int edgeLength, int *oFaceIdx, int *oU, int *oV )
+{
+	float nvcU, nvcV;
+	int faceIdx = VectToFaceCoord(XYZ, &nvcU, &nvcV);
+
 	// SL BEGIN
 	// Modify original AMD code to return value from 0 to Size - 1
-	u = (int)floor( (edgeLength - 1) * 0.5f * (nvcU + 1.0f) );
-	v = (int)floor( (edgeLength - 1) * 0.5f * (nvcV + 1.0f) );
+	int u = (int)floor( (edgeLength - 1) * 0.5f * (nvcU + 1.0f) );
+	int v = (int)floor( (edgeLength - 1) * 0.5f * (nvcV + 1.0f) );
 	// SL END
 
 	if(oFaceIdx) *oFaceIdx = faceIdx;
@@ -326,11 +347,333 @@ void EvalSHBasis(int order, const float* dir, double* res )
 	}
 }
 
+// Textbook associated Legendre recurrence in double with explicit angles, reference for orders
+// above MAX_SH_ORDER. Same normalization and sign convention as EvalSHBasis.
+void EvalSHBasisReference(int order, const float* dir, double* res)
+{
+	const double z = (std::max)(-1.0, (std::min)(1.0, double(dir[2])));
+	const double sinTheta = sqrt(1.0 - z * z);
+	const double phi = atan2(double(dir[1]), double(dir[0]));
+
+	double pmm = 1.0;
+	for (int m = 0; m <= order; ++m)
+	{
+		// P(m, m) = (-1)^m (2m-1)!! sin(theta)^m
+		if (m > 0)
+			pmm *= -(2.0 * m - 1.0) * sinTheta;
+
+		double pPrev = 0.0, p = pmm;
+		for (int l = m; l <= order; ++l)
+		{
+			if (l > m)
+			{
+				double pNext = ((2.0 * l - 1.0) * z * p - (l + m - 1.0) * pPrev) / (l - m);
+				pPrev = p;
+				p = pNext;
+			}
+
+			double factorialRatio = 1.0;
+			for (int i = l - m + 1; i <= l + m; ++i)
+				factorialRatio /= i;
+
+			const double k = sqrt((2.0 * l + 1.0) / (4.0 * CP_PI) * factorialRatio);
+			const int center = l * (l + 1);
+			if (m == 0)
+			{
+				res[center] = k * p;
+			}
+			else
+			{
+				res[center + m] = sqrt(2.0) * k * p * cos(m * phi);
+				res[center - m] = sqrt(2.0) * k * p * sin(m * phi);
+			}
+		}
+	}
+}
+
+// Parallel projection evaluates bands by recurrence, so it isn't limited to MAX_SH_ORDER
+const int SHMaxParallelBasis = (CubeMapProcessor::MaxParallelSHOrder + 1) * (CubeMapProcessor::MaxParallelSHOrder + 1);
+
+// Associated Legendre recurrence constants, same normalization and sign convention as EvalSHBasis
+struct SHRecurrence
+{
+	float K[CubeMapProcessor::MaxParallelSHOrder+1][CubeMapProcessor::MaxParallelSHOrder+1];	// sqrt(2) included for m != 0
+	float A[CubeMapProcessor::MaxParallelSHOrder+1][CubeMapProcessor::MaxParallelSHOrder+1];
+	float B[CubeMapProcessor::MaxParallelSHOrder+1][CubeMapProcessor::MaxParallelSHOrder+1];
+	float Pmm[CubeMapProcessor::MaxParallelSHOrder+1];
+};
+
+void BuildSHRecurrence(int order, SHRecurrence& rec)
+{
+	double pmm = 1.0;
+	for (int m = 0; m <= order; ++m)
+	{
+		// P(m, m) = (-1)^m (2m-1)!!
+		rec.Pmm[m] = float(pmm);
+		pmm *= -(2.0 * m + 1.0);
+
+		for (int l = m; l <= order; ++l)
+		{
+			// (l-m)! / (l+m)!
+			double factorialRatio = 1.0;
+			for (int i = l - m + 1; i <= l + m; ++i)
+				factorialRatio /= i;
+
+			double k = sqrt((2.0 * l + 1.0) / (4.0 * CP_PI) * factorialRatio);
+			rec.K[l][m] = float(m == 0 ? k : sqrt(2.0) * k);
+
+			// P(l, m) = (A * z * P(l-1, m) - B * P(l-2, m))
+			if (l > m)
+			{
+				rec.A[l][m] = float((2.0 * l - 1.0) / (l - m));
+				rec.B[l][m] = float((l + m - 1.0) / (l - m));
+			}
+		}
+	}
+}
+
+// SH basis of four directions at once
+void EvalSHBasis4(const SHRecurrence& rec, int order, __m128 x, __m128 y, __m128 z, __m128* res)
+{
+	__m128 cosM = _mm_set1_ps(1.0f);
+	__m128 sinM = _mm_setzero_ps();
+
+	for (int m = 0; m <= order; ++m)
+	{
+		if (m > 0)
+		{
+			// sin(theta)^m * cos/sin(m*phi), multiply by (x + iy)
+			__m128 c = _mm_sub_ps(_mm_mul_ps(x, cosM), _mm_mul_ps(y, sinM));
+			sinM = _mm_add_ps(_mm_mul_ps(x, sinM), _mm_mul_ps(y, cosM));
+			cosM = c;
+		}
+
+		__m128 pPrev = _mm_setzero_ps();
+		__m128 p = _mm_set1_ps(rec.Pmm[m]);
+		for (int l = m; l <= order; ++l)
+		{
+			if (l > m)
+			{
+				__m128 pNext = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(rec.A[l][m]), z), p), _mm_mul_ps(_mm_set1_ps(rec.B[l][m]), pPrev));
+				pPrev = p;
+				p = pNext;
+			}
+
+			__m128 kp = _mm_mul_ps(_mm_set1_ps(rec.K[l][m]), p);
+
+			const int center = l * (l + 1);
+			if (m == 0)
+			{
+				res[center] = kp;
+			}
+			else
+			{
+				res[center + m] = _mm_mul_ps(kp, cosM);
+				res[center - m] = _mm_mul_ps(kp, sinM);
+			}
+		}
+	}
+}
+
+double HorizontalSum(__m128 v)
+{
+	float lanes[4];
+	_mm_storeu_ps(lanes, v);
+	return double(lanes[0]) + double(lanes[1]) + double(lanes[2]) + double(lanes[3]);
+}
+
+// Call tileFunc(tile) for every tile on all cores, tiles are handed out in turn
+template <typename TileFunc>
+void ParallelForTiles(int numTiles, TileFunc tileFunc)
+{
+	std::atomic<int> nextTile(0);
+
+	auto worker = [&]()
+	{
+		for (int tile = nextTile++; tile < numTiles; tile = nextTile++)
+		{
+			tileFunc(tile);
+		}
+	};
+
+	const int numThreads = (std::min)((std::max)(int(std::thread::hardware_concurrency()), 1), numTiles);
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++)
+	{
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
+
+// GGX lobe sample in tangent space of N = V = R
+struct GGXSample
+{
+	float X, Y, Z;		// Light direction
+	float Weight;		// N.L
+	int SrcMip;			// Source level whose texels cover about the sample's solid angle
+};
+
+float RadicalInverse(uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return float(bits) * 2.3283064365386963e-10f;
+}
+
+/**
+ * Importance sample GGX lobe with Hammersley points. Each sample reads the source mip whose texel 
+ * solid angle matches the sample's (filtered importance sampling), so few samples don't alias.
+ */
+void BuildGGXSampleTable(float roughness, int numSamples, int srcSize, int numSrcMips, std::vector<GGXSample>& samples)
+{
+	samples.clear();
+
+	if (roughness <= 0.0f)
+	{
+		// Mirror, reflected direction only
+		GGXSample sample = { 0.0f, 0.0f, 1.0f, 1.0f, 0 };
+		samples.push_back(sample);
+		return;
+	}
+
+	const double alpha = roughness * roughness;
+	const double alpha2 = alpha * alpha;
+	const double texelSolidAngle = 4.0 * CP_PI / (6.0 * srcSize * srcSize);
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		const double phi = 2.0 * CP_PI * i / numSamples;
+		const double e = RadicalInverse(uint32_t(i));
+
+		const double cosTheta = sqrt((1.0 - e) / (1.0 + (alpha2 - 1.0) * e));
+		const double sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+		// Reflect V = N about half vector
+		const double NdotL = 2.0 * cosTheta * cosTheta - 1.0;
+		if (NdotL <= 0.0)
+		{
+			continue;
+		}
+
+		GGXSample sample;
+		sample.X = float(2.0 * cosTheta * sinTheta * cos(phi));
+		sample.Y = float(2.0 * cosTheta * sinTheta * sin(phi));
+		sample.Z = float(NdotL);
+		sample.Weight = float(NdotL);
+
+		// Density of L is D(H) / 4 when N = V
+		const double d = cosTheta * cosTheta * (alpha2 - 1.0) + 1.0;
+		const double pdf = alpha2 / (CP_PI * d * d) / 4.0;
+		const double sampleSolidAngle = 1.0 / (numSamples * pdf);
+
+		const double srcMip = 0.5 * log(sampleSolidAngle / texelSolidAngle) / log(2.0) + 1.0;
+		sample.SrcMip = (std::min)((std::max)(int(srcMip + 0.5), 0), numSrcMips - 1);
+
+		samples.push_back(sample);
+	}
+}
+
+// Bilinear lookup on face of direction, texels outside face are clamped to its border
+void SampleCubeBilinear(SurfaceImage* faces, const glm::vec3& dir, float* color)
+{
+	float nvcU, nvcV;
+	SurfaceImage& face = faces[VectToFaceCoord(dir, &nvcU, &nvcV)];
+
+	const int size = face.GetWidth();
+	const int numChannels = face.GetNumChannels();
+
+	const float s = (std::min)((std::max)((nvcU + 1.0f) * 0.5f * size - 0.5f, 0.0f), float(size - 1));
+	const float t = (std::min)((std::max)((nvcV + 1.0f) * 0.5f * size - 0.5f, 0.0f), float(size - 1));
+
+	const int x0 = int(s), y0 = int(t);
+	const int x1 = (std::min)(x0 + 1, size - 1), y1 = (std::min)(y0 + 1, size - 1);
+	const float fx = s - x0, fy = t - y0;
+
+	const float* data = face.GetImageData();
+	const float* t00 = &data[(y0 * size + x0) * numChannels];
+	const float* t10 = &data[(y0 * size + x1) * numChannels];
+	const float* t01 = &data[(y1 * size + x0) * numChannels];
+	const float* t11 = &data[(y1 * size + x1) * numChannels];
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		float top = t00[c] + (t10[c] - t00[c]) * fx;
+		float bottom = t01[c] + (t11[c] - t01[c]) * fx;
+		color[c] = top + (bottom - top) * fy;
+	}
+}
+
+// Append 2x2 box filtered levels down to 1x1, 6 faces per level
+void BuildCubeMipChain(std::vector<SurfaceImage>& levels)
+{
+	while (levels[levels.size() - 6].GetWidth() > 1)
+	{
+		const size_t parent = levels.size() - 6;
+		const int parentSize = levels[parent].GetWidth();
+		const int size = parentSize / 2;
+		const int numChannels = levels[parent].GetNumChannels();
+
+		for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+		{
+			SurfaceImage level;
+			level.Init(size, size, numChannels);
+
+			const float* src = levels[parent + faceIdx].GetImageData();
+			float* dst = level.GetImageData();
+
+			for (int y = 0; y < size; y++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					const float* t00 = &src[((2*y) * parentSize + 2*x) * numChannels];
+					const float* t01 = &src[((2*y+1) * parentSize + 2*x) * numChannels];
+
+					for (int c = 0; c < numChannels; c++)
+					{
+						dst[(y * size + x) * numChannels + c] = 0.25f * (t00[c] + t00[numChannels + c] + t01[c] + t01[numChannels + c]);
+					}
+				}
+			}
+
+			levels.push_back(level);
+		}
+	}
+}
+
+#pragma pack(push, 1)
+struct DDSPixelFormat
+{
+	uint32_t Size, Flags, FourCC, RGBBitCount;
+	uint32_t RBitMask, GBitMask, BBitMask, ABitMask;
+};
+
+struct DDSHeader
+{
+	uint32_t Size, Flags, Height, Width;
+	uint32_t PitchOrLinearSize, Depth, MipMapCount;
+	uint32_t Reserved1[11];
+	DDSPixelFormat PixelFormat;
+	uint32_t Caps, Caps2, Caps3, Caps4, Reserved2;
+};
+#pragma pack(pop)
+
 
 }
 
 CubeMapProcessor::CubeMapProcessor(void)
 {
+	mSHTable.Size = 0;
+	mSHTable.FixupType = -1;
+	mSHTable.RowStride = 0;
 }
 
 
@@ -389,7 +732,10 @@ void CubeMapProcessor::SHProjectCubeMap( int order, bool useSolidAngleWeighting,
 					weight = 1.0;   
 				}
 
-				EvalSHBasis(order, texelVect, &SHBais[0]);
+				if (order <= MAX_SH_ORDER)
+					EvalSHBasis(order, texelVect, &SHBais[0]);
+				else
+					EvalSHBasisReference(order, texelVect, &SHBais[0]);
 
 				// Convert to float64
 				double R = srcCubeRowStartPtr[(SrcCubeMapNumChannels * x) + 0];
@@ -418,6 +764,390 @@ void CubeMapProcessor::SHProjectCubeMap( int order, bool useSolidAngleWeighting,
 	}
 }
 
+void CubeMapProcessor::SHProjectCubeMapParallel( int order, bool useSolidAngleWeighting, int fixupType, double* pROut, double* pGOut, double* pBOut )
+{
+	if (order > MaxParallelSHOrder)
+	{
+		throw std::exception("SH Order overflow");
+	}
+
+	const int srcSize = mSrcCubeMap[0].GetWidth();
+	if (mSHTable.Size != srcSize || mSHTable.FixupType != fixupType)
+	{
+		BuildSHDirectionTable(srcSize, fixupType);
+	}
+
+	SHRecurrence rec;
+	BuildSHRecurrence(order, rec);
+
+	const int basisNum = (order+1) * (order+1);
+	const int rowStride = mSHTable.RowStride;
+
+	// Tiles of rows over all six faces, handed out to threads in turn
+	const int numRows = 6 * srcSize;
+	const int rowsPerTile = 8;
+	const int numTiles = (numRows + rowsPerTile - 1) / rowsPerTile;
+
+	// Each tile sums into own slot and slots are merged in order, so result doesn't depend on scheduling
+	const int tileSumSize = 3 * basisNum + 1;
+	std::vector<double> tileSums(numTiles * tileSumSize, 0.0);
+
+	ParallelForTiles(numTiles, [&](int tile)
+	{
+		std::vector<float> rowR(rowStride, 0.0f), rowG(rowStride, 0.0f), rowB(rowStride, 0.0f);
+
+		__m128 basis[SHMaxParallelBasis];
+		__m128 accum[3 * SHMaxParallelBasis];
+
+		double* sums = &tileSums[tile * tileSumSize];
+
+		const int rowEnd = (std::min)((tile + 1) * rowsPerTile, numRows);
+		for (int row = tile * rowsPerTile; row < rowEnd; row++)
+		{
+			const int faceIdx = row / srcSize;
+			const int y = row % srcSize;
+
+			// Gather colors into planes, padding texels stay zero
+			const int srcNumChannels = mSrcCubeMap[faceIdx].GetNumChannels();
+			const float* srcRow = mSrcCubeMap[faceIdx].GetImageData() + srcNumChannels * (y * srcSize);
+			for (int x = 0; x < srcSize; x++)
+			{
+				rowR[x] = srcRow[srcNumChannels * x + 0];
+				rowG[x] = srcRow[srcNumChannels * x + 1];
+				rowB[x] = srcRow[srcNumChannels * x + 2];
+			}
+
+			const float* dirX = &mSHTable.X[row * rowStride];
+			const float* dirY = &mSHTable.Y[row * rowStride];
+			const float* dirZ = &mSHTable.Z[row * rowStride];
+			const float* weights = useSolidAngleWeighting ? &mSHTable.SolidAngle[row * rowStride] : &mSHTable.Valid[row * rowStride];
+
+			for (int i = 0; i < 3 * basisNum; i++)
+			{
+				accum[i] = _mm_setzero_ps();
+			}
+			__m128 weightSum = _mm_setzero_ps();
+
+			for (int x = 0; x < rowStride; x += 4)
+			{
+				EvalSHBasis4(rec, order, _mm_loadu_ps(dirX + x), _mm_loadu_ps(dirY + x), _mm_loadu_ps(dirZ + x), basis);
+
+				__m128 weight = _mm_loadu_ps(weights + x);
+				__m128 R = _mm_mul_ps(_mm_loadu_ps(&rowR[x]), weight);
+				__m128 G = _mm_mul_ps(_mm_loadu_ps(&rowG[x]), weight);
+				__m128 B = _mm_mul_ps(_mm_loadu_ps(&rowB[x]), weight);
+
+				for (int i = 0; i < basisNum; i++)
+				{
+					accum[i] = _mm_add_ps(accum[i], _mm_mul_ps(basis[i], R));
+					accum[basisNum + i] = _mm_add_ps(accum[basisNum + i], _mm_mul_ps(basis[i], G));
+					accum[2 * basisNum + i] = _mm_add_ps(accum[2 * basisNum + i], _mm_mul_ps(basis[i], B));
+				}
+
+				weightSum = _mm_add_ps(weightSum, weight);
+			}
+
+			// Float sums of one row are short enough, longer sums in double
+			for (int i = 0; i < 3 * basisNum; i++)
+			{
+				sums[i] += HorizontalSum(accum[i]);
+			}
+			sums[3 * basisNum] += HorizontalSum(weightSum);
+		}
+	});
+
+	double weightAccum = 0.0;
+	for (int tile = 0; tile < numTiles; tile++)
+	{
+		const double* sums = &tileSums[tile * tileSumSize];
+		for (int i = 0; i < basisNum; i++)
+		{
+			pROut[i] += sums[i];
+			pGOut[i] += sums[basisNum + i];
+			pBOut[i] += sums[2 * basisNum + i];
+		}
+		weightAccum += sums[3 * basisNum];
+	}
+
+	//Normalization - same as SHProjectCubeMap
+	for (int i = 0; i < basisNum; ++i)
+	{
+		pROut[i] *= 4.0 * CP_PI / weightAccum;
+		pGOut[i] *= 4.0 * CP_PI / weightAccum;
+		pBOut[i] *= 4.0 * CP_PI / weightAccum;
+	}
+}
+
+void CubeMapProcessor::BenchmarkSHProjection( int numProbes, int faceSize, int order )
+{
+	// Serial path uses closed form up to MAX_SH_ORDER and reference recurrence above
+	order = (std::max)(0, (std::min)(order, int(MaxParallelSHOrder)));
+
+	CubeMapProcessor processor;
+	processor.Init(faceSize, faceSize, 3);
+
+	if (order > MAX_SH_ORDER)
+	{
+		// Check reference basis against closed form on bands both evaluate
+		double refBasis[SHMaxParallelBasis], closedBasis[NUM_SH_COEFFICIENT];
+		double maxBasisDiff = 0.0;
+
+		srand(2);
+		for (int i = 0; i < 4096; i++)
+		{
+			glm::vec3 dir = glm::normalize(glm::vec3(float(rand()) / RAND_MAX - 0.5f, float(rand()) / RAND_MAX - 0.5f, float(rand()) / RAND_MAX - 0.49f));
+			EvalSHBasisReference(order, &dir.x, refBasis);
+			EvalSHBasis(MAX_SH_ORDER, &dir.x, closedBasis);
+
+			for (int j = 0; j < NUM_SH_COEFFICIENT; j++)
+			{
+				maxBasisDiff = (std::max)(maxBasisDiff, fabs(refBasis[j] - closedBasis[j]));
+			}
+		}
+
+		printf("SH reference basis order %d, max difference to closed form up to order %d: %g\n", order, MAX_SH_ORDER, maxBasisDiff);
+	}
+
+	const int basisNum = (order+1) * (order+1);
+	std::vector<double> serial(3 * basisNum), parallel(3 * basisNum);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	double serialSeconds = 0.0, parallelSeconds = 0.0;
+	double maxError = 0.0;
+
+	srand(1);
+	for (int probe = 0; probe < numProbes; probe++)
+	{
+		// Random HDR radiance, several orders of magnitude
+		for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+		{
+			float* data = processor.mSrcCubeMap[faceIdx].GetImageData();
+			for (int i = 0; i < faceSize * faceSize * 3; i++)
+			{
+				data[i] = float(exp(8.0 * rand() / RAND_MAX - 4.0));
+			}
+		}
+
+		std::fill(serial.begin(), serial.end(), 0.0);
+		std::fill(parallel.begin(), parallel.end(), 0.0);
+
+		Clock::time_point start = Clock::now();
+		processor.SHProjectCubeMap(order, true, EF_Stretch, &serial[0], &serial[basisNum], &serial[2*basisNum]);
+		Clock::time_point middle = Clock::now();
+		processor.SHProjectCubeMapParallel(order, true, EF_Stretch, &parallel[0], &parallel[basisNum], &parallel[2*basisNum]);
+		Clock::time_point end = Clock::now();
+
+		serialSeconds += std::chrono::duration<double>(middle - start).count();
+		parallelSeconds += std::chrono::duration<double>(end - middle).count();
+
+		// Error relative to largest coefficient of the probe
+		double maxCoeff = 0.0, maxDiff = 0.0;
+		for (int i = 0; i < 3 * basisNum; i++)
+		{
+			maxCoeff = (std::max)(maxCoeff, fabs(serial[i]));
+			maxDiff = (std::max)(maxDiff, fabs(serial[i] - parallel[i]));
+		}
+		maxError = (std::max)(maxError, maxDiff / maxCoeff);
+	}
+
+	printf("SH projection order %d, %d probes of 6x%dx%d: serial %.3f ms, parallel %.3f ms per probe (%.1fx), max relative error %g\n",
+		order, numProbes, faceSize, faceSize, serialSeconds * 1000.0 / numProbes, parallelSeconds * 1000.0 / numProbes,
+		serialSeconds / parallelSeconds, maxError);
+}
+
+void CubeMapProcessor::GGXSpecularFilterCubeMap( int numMips, int numSamples, int fixupType )
+{
+	int maxMips = 1;
+	while ((mOutputSize >> maxMips) > 0)
+	{
+		maxMips++;
+	}
+	numMips = (std::min)((std::max)(numMips, 1), maxMips);
+
+	// Box filtered source chain for filtered importance sampling
+	std::vector<SurfaceImage> srcMips(mSrcCubeMap, mSrcCubeMap + 6);
+	BuildCubeMipChain(srcMips);
+
+	const int srcSize = mSrcCubeMap[0].GetWidth();
+	const int numSrcMips = int(srcMips.size() / 6);
+
+	// Sample directions are the same for every texel of a level, only rotated into its frame
+	std::vector< std::vector<GGXSample> > sampleTables(numMips);
+	for (int mip = 0; mip < numMips; mip++)
+	{
+		float roughness = (numMips > 1) ? float(mip) / float(numMips - 1) : 0.0f;
+		BuildGGXSampleTable(roughness, numSamples, srcSize, numSrcMips, sampleTables[mip]);
+	}
+
+	mSpecularCubeMap.assign(6 * numMips, SurfaceImage());
+	for (int mip = 0; mip < numMips; mip++)
+	{
+		const int size = (std::max)(mOutputSize >> mip, 1);
+		for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+		{
+			mSpecularCubeMap[mip * 6 + faceIdx].Init(size, size, mNumChannels);
+		}
+	}
+
+	// Rows of all levels and faces in tiles, rough levels first since they cost the most
+	struct FilterTile
+	{
+		int Mip, FaceIdx;
+		int RowStart, RowEnd;
+	};
+
+	const int rowsPerTile = 4;
+
+	std::vector<FilterTile> tiles;
+	for (int mip = numMips - 1; mip >= 0; mip--)
+	{
+		const int size = mSpecularCubeMap[mip * 6].GetWidth();
+		for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+		{
+			for (int row = 0; row < size; row += rowsPerTile)
+			{
+				FilterTile tile = { mip, faceIdx, row, (std::min)(row + rowsPerTile, size) };
+				tiles.push_back(tile);
+			}
+		}
+	}
+
+	ParallelForTiles(int(tiles.size()), [&](int tileIdx)
+	{
+		const FilterTile& tile = tiles[tileIdx];
+		const std::vector<GGXSample>& samples = sampleTables[tile.Mip];
+
+		SurfaceImage& dst = mSpecularCubeMap[tile.Mip * 6 + tile.FaceIdx];
+		const int size = dst.GetWidth();
+		const int numChannels = dst.GetNumChannels();
+
+		for (int v = tile.RowStart; v < tile.RowEnd; v++)
+		{
+			for (int u = 0; u < size; u++)
+			{
+				glm::vec3 N = TexelCoordToVect(tile.FaceIdx, (float)u, (float)v, size, fixupType);
+
+				glm::vec3 up = (fabs(N[2]) < 0.999f) ? glm::vec3(0, 0, 1) : glm::vec3(1, 0, 0);
+				glm::vec3 tangentX = glm::normalize(glm::cross(up, N));
+				glm::vec3 tangentY = glm::cross(N, tangentX);
+
+				float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				float weightAccum = 0.0f;
+
+				for (size_t i = 0; i < samples.size(); i++)
+				{
+					const GGXSample& sample = samples[i];
+					glm::vec3 L = tangentX * sample.X + tangentY * sample.Y + N * sample.Z;
+
+					float texel[4];
+					SampleCubeBilinear(&srcMips[sample.SrcMip * 6], L, texel);
+
+					for (int c = 0; c < numChannels; c++)
+					{
+						color[c] += texel[c] * sample.Weight;
+					}
+					weightAccum += sample.Weight;
+				}
+
+				float* dstTexel = dst.GetImageData() + (v * size + u) * numChannels;
+				for (int c = 0; c < numChannels; c++)
+				{
+					dstTexel[c] = color[c] / weightAccum;
+				}
+			}
+		}
+	});
+}
+
+bool CubeMapProcessor::WriteSpecularPfm( const char* filePrefix )
+{
+	char fileName[512];
+
+	const int numMips = int(mSpecularCubeMap.size() / 6);
+	for (int mip = 0; mip < numMips; mip++)
+	{
+		for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+		{
+			SurfaceImage& face = mSpecularCubeMap[mip * 6 + faceIdx];
+
+			sprintf_s(fileName, "%s_mip%d_face%d.pfm", filePrefix, mip, faceIdx);
+			if (WritePfm(fileName, face.GetWidth(), face.GetHeight(), face.GetNumChannels(), face.GetImageData()) != 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CubeMapProcessor::WriteSpecularDDS( const char* fileName )
+{
+	if (mSpecularCubeMap.empty())
+	{
+		return false;
+	}
+
+	std::ofstream file(fileName, std::ios::out | std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	const int numMips = int(mSpecularCubeMap.size() / 6);
+	const int size = mSpecularCubeMap[0].GetWidth();
+
+	// Legacy header with D3DFMT_A32B32G32R32F, so no DX10 extension is needed
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Size = sizeof(DDSHeader);
+	header.Flags = 0x1 | 0x2 | 0x4 | 0x8 | 0x1000 | 0x20000;		// Caps, height, width, pitch, pixel format, mip count
+	header.Height = size;
+	header.Width = size;
+	header.PitchOrLinearSize = size * 4 * sizeof(float);
+	header.MipMapCount = numMips;
+	header.PixelFormat.Size = sizeof(DDSPixelFormat);
+	header.PixelFormat.Flags = 0x4;		// FourCC
+	header.PixelFormat.FourCC = 116;
+	header.Caps = 0x8 | 0x1000 | 0x400000;	// Complex, texture, mipmap
+	header.Caps2 = 0x200 | 0xFC00;			// Cube map with all faces
+
+	const uint32_t magic = 0x20534444;		// "DDS "
+	file.write((const char*)&magic, sizeof(magic));
+	file.write((const char*)&header, sizeof(header));
+
+	// Face major, mips of each face follow it
+	std::vector<float> rgba;
+	for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+	{
+		for (int mip = 0; mip < numMips; mip++)
+		{
+			SurfaceImage& face = mSpecularCubeMap[mip * 6 + faceIdx];
+
+			const int numTexels = face.GetWidth() * face.GetHeight();
+			const int numChannels = face.GetNumChannels();
+			const float* data = face.GetImageData();
+
+			rgba.resize(numTexels * 4);
+			for (int i = 0; i < numTexels; i++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					// Gray replicated, missing alpha is opaque
+					if (c < numChannels)
+						rgba[i * 4 + c] = data[i * numChannels + c];
+					else
+						rgba[i * 4 + c] = (c == 3) ? 1.0f : data[i * numChannels];
+				}
+			}
+
+			file.write((const char*)&rgba[0], rgba.size() * sizeof(float));
+		}
+	}
+
+	return file.good();
+}
+
 void CubeMapProcessor::SHIrrandianceFilterCubeMap(int order,  bool useSolidAngleWeighting, int fixupType )
 {
 	double weightAccum = 0.0;
@@ -436,7 +1166,7 @@ void CubeMapProcessor::SHIrrandianceFilterCubeMap(int order,  bool useSolidAngle
 	std::vector<double> SHg(baisNum, 0.0);
 	std::vector<double> SHb(baisNum, 0.0);
 
-	SHProjectCubeMap(order, useSolidAngleWeighting, fixupType, &SHr[0], &SHg[0], &SHb[0]);
+	SHProjectCubeMapParallel(order, useSolidAngleWeighting, fixupType, &SHr[0], &SHg[0], &SHb[0]);
 
 	//Second step - Generate cubemap from SH coefficient
 
@@ -559,6 +1289,40 @@ void CubeMapProcessor::BuildNormalizerCubemap( int size, SurfaceImage* surface,
 	}
 }
 
+void CubeMapProcessor::BuildSHDirectionTable( int size, int fixupType )
+{
+	const int rowStride = (size + 3) & ~3;
+
+	mSHTable.Size = size;
+	mSHTable.FixupType = fixupType;
+	mSHTable.RowStride = rowStride;
+
+	const size_t numTexels = 6 * size * rowStride;
+	mSHTable.X.assign(numTexels, 0.0f);
+	mSHTable.Y.assign(numTexels, 0.0f);
+	mSHTable.Z.assign(numTexels, 0.0f);
+	mSHTable.SolidAngle.assign(numTexels, 0.0f);
+	mSHTable.Valid.assign(numTexels, 0.0f);
+
+	for (int iCubeFace = 0; iCubeFace < 6; iCubeFace++)
+	{
+		for (int v = 0; v < size; v++)
+		{
+			const int rowStart = (iCubeFace * size + v) * rowStride;
+			for (int u = 0; u < size; u++)
+			{
+				glm::vec3 dir = TexelCoordToVect(iCubeFace, (float)u, (float)v, size, fixupType);
+
+				mSHTable.X[rowStart + u] = dir[0];
+				mSHTable.Y[rowStart + u] = dir[1];
+				mSHTable.Z[rowStart + u] = dir[2];
+				mSHTable.SolidAngle[rowStart + u] = SolidAngleTerm(u, v, size);
+				mSHTable.Valid[rowStart + u] = 1.0f;
+			}
+		}
+	}
+}
+
 void CubeMapProcessor::Init( int inputSize, int outputSize, int numChannels )
 {
 	mInputSize = inputSize;
@@ -34,20 +34,66 @@ public:
 
 	void SetInputFaceData(int faceIdx, int srcType, int srcNumChannels, int srcPitch, void* srcDataPtr );
 
+	/**
+	 * Serial reference projection in double. Orders above 4 are evaluated by a textbook recurrence,
+	 * up to MaxParallelSHOrder.
+	 */
 	void SHProjectCubeMap(int order, bool useSolidAngleWeighting, int fixupType, double* pROut, double* pGOut, double* pBOut);
+
+	/**
+	 * Same as SHProjectCubeMap within float precision, for order up to MaxParallelSHOrder. Direction 
+	 * and solid angle tables are built once per face size, tiles of rows are projected on all cores,
+	 * four texels at once with SSE.
+	 */
+	void SHProjectCubeMapParallel(int order, bool useSolidAngleWeighting, int fixupType, double* pROut, double* pGOut, double* pBOut);
+
+	/**
+	 * Project a batch of random HDR probes with both paths, print time per probe and largest
+	 * relative difference. Orders above 4 first check the reference basis against closed form.
+	 */
+	static void BenchmarkSHProjection(int numProbes, int faceSize, int order);
+
 	void SHIrrandianceFilterCubeMap(int order, bool useSolidAngleWeighting, int fixupType);
 
+	/**
+	 * Prefilter source cube map with GGX lobe into mSpecularCubeMap, level i has roughness
+	 * i / (numMips - 1) and size mOutputSize >> i. Lobe samples are precomputed once per level,
+	 * tiles of rows are filtered on all cores.
+	 */
+	void GGXSpecularFilterCubeMap(int numMips, int numSamples, int fixupType);
+
+	// One file per level and face, named <prefix>_mip<level>_face<face>.pfm
+	bool WriteSpecularPfm(const char* filePrefix);
+
+	// RGBA32F cube map with all prefiltered levels
+	bool WriteSpecularDDS(const char* fileName);
+
 	void Dump( const char* file, SurfaceImage* cubeMap );
 
+	static const int MaxParallelSHOrder = 8;
+
 private:
 	void BuildNormalizerSolidAngleCubemap(int size, SurfaceImage* surface, int fixupType);
 	void BuildNormalizerCubemap(int size, SurfaceImage* surface, int fixupType);
+	void BuildSHDirectionTable(int size, int fixupType);
+
+private:
+	// Texel directions and solid angles of all faces, rows padded to multiple of 4 texels
+	struct SHDirectionTable
+	{
+		int Size, FixupType;
+		int RowStride;
+		std::vector<float> X, Y, Z, SolidAngle, Valid;
+	};
+	SHDirectionTable mSHTable;
 
 public:
 	SurfaceImage mDstCubeMap[6];
 	SurfaceImage mSrcCubeMap[6]; //normalizer cube map and solid angle lookup table
 	SurfaceImage mNormCubeMap[6];
 
+	std::vector<SurfaceImage> mSpecularCubeMap;		// 6 faces per level, sharpest level first
+
 	int mInputSize, mOutputSize, mNumChannels;
 	
 
@@ -0,0 +1,229 @@
+#include "HalfFloat.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define CP_HALF_SSE2
+#include <emmintrin.h>
+#endif
+
+//--------------------------------------------------------------------------------------
+// convert D3D 16 bit float to standard 32 bit float
+// Format:
+// 
+// 1 sign bit in MSB, (s) 
+// 5 bits of biased exponent, (e) 
+// 10 bits of fraction, (f), with an additional hidden bit 
+// A float16 value, v, made from the format above takes the following meaning:
+//
+// (a) if e == 31 and f != 0, then v is NaN regardless of s 
+// (b) if e == 31 and f == 0, then v = (-1)^s * infinity (signed infinity) 
+// (c) if 0 < e < 31, then v = (-1)^s * 2^(e-15) * (1.f) 
+// (d) if e == 0 and f != 0, then v = (-1)^s * 2^(e-14) * (0.f) (denormalized numbers) 
+// (e) if e == 0 and f == 0, then v = (-1)^s *0 (signed zero) 
+//
+//--------------------------------------------------------------------------------------
+float CPf16Tof32(unsigned short aVal)
+{
+	unsigned int signVal = (aVal >> 15);              //sign bit in MSB
+	unsigned int exponent = ((aVal >> 10) & 0x01f);   //next 5 bits after signbit
+	unsigned int mantissa = (aVal & 0x03ff);          //lower 10 bits
+	unsigned int rawfloatData;                      //raw binary float data
+
+	//convert s10e5  5-bit exponent to IEEE754 s23e8  8-bit exponent
+	if(exponent == 31)
+	{  // infinity or Nan depending on mantissa
+		exponent = 255;
+	}
+	else if(exponent == 0) 
+	{  //  denormalized floats  mantissa is treated as = 0.f
+		exponent = 0;
+	}
+	else
+	{  //change 15base exponent to 127base exponent 
+		//normalized floats mantissa is treated as = 1.f
+		exponent += (127 - 15);
+	}
+
+	//convert 10-bit mantissa to 23-bit mantissa
+	mantissa <<= (23 - 10);
+
+	//assemble s23e8 number using logical operations
+	rawfloatData = (signVal << 31) |  (exponent << 23) | mantissa ;
+
+	//treat raw data as a 32 bit float
+	return *((float *) &rawfloatData );
+}
+
+
+//--------------------------------------------------------------------------------------
+// convert standard 32 bit float to D3D 16 bit float
+//
+// 16-bit float format:
+// 
+// 1 sign bit in MSB, (s) 
+// 5 bits of biased exponent, (e) 
+// 10 bits of fraction, (f), with an additional hidden bit 
+// A float16 value, v, made from the format above takes the following meaning:
+//
+// (a) if e == 31 and f != 0, then v is NaN regardless of s 
+// (b) if e == 31 and f == 0, then v = (-1)s*infinity (signed infinity) 
+// (c) if 0 < e < 31, then v = (-1)s*2(e-15)*(1.f) 
+// (d) if e == 0 and f != 0, then v = (-1)s*2(e-14)*(0.f) (denormalized numbers) 
+// (e) if e == 0 and f == 0, then v = (-1)s*0 (signed zero) 
+//--------------------------------------------------------------------------------------
+unsigned short CPf32Tof16(float aVal)
+{
+	unsigned int rawf32Data = *((unsigned int *)&aVal); //raw binary float data
+
+	unsigned int signVal = (rawf32Data >> 31);              //sign bit in MSB
+	unsigned int exponent = ((rawf32Data >> 23) & 0xff);    //next 8 bits after signbit
+	unsigned int mantissa = (rawf32Data & 0x7fffff);        //mantissa = lower 23 bits
+
+	unsigned short rawf16Data;
+
+	//convert IEEE754 s23e8 8-bit exponent to s10e5  5-bit exponent      
+	if(exponent == 255 ) 
+	{//special case 32 bit float is inf or NaN, use mantissa as is
+		exponent = 31;
+	}
+	else if(exponent < ((127-15)-10)  ) 
+	{//special case, if  32-bit float exponent is out of 16-bit float range, then set 16-bit float to 0
+		exponent = 0;
+		mantissa = 0;
+	}
+	else if(exponent >= (127+(31-15)) )
+	{  // max 15based exponent for s10e5 is 31
+		// force s10e5 number to represent infinity by setting mantissa to 0
+		//  and exponent to 31
+		exponent = 31;
+		mantissa = 0;
+	}
+	else if( exponent <= (127-15) )
+	{  //convert normalized s23e8 float to denormalized s10e5 float
+
+		//add implicit 1.0 to mantissa to convert from 1.f to use as a 0.f mantissa
+		mantissa |= (1<<23);
+
+		//shift over mantissa number of bits equal to exponent underflow
+		mantissa = mantissa >> (1 + ((127-15) - exponent));
+
+		//zero exponent to treat value as a denormalized number
+		exponent = 0;
+	}
+	else
+	{  //change 127base exponent to 15base exponent 
+		// no underflow or overflow of exponent 
+		//normalized floats mantissa is treated as= 1.f, so 
+		// no denormalization or exponent derived shifts to the mantissa         
+		exponent -= (127 - 15);
+	}
+
+	//convert 23-bit mantissa to 10-bit mantissa
+	mantissa >>= (23 - 10);
+
+	//assemble s10e5 number using logical operations
+	rawf16Data = (signVal << 15) | (exponent << 10) | mantissa;
+
+	//return re-assembled raw data as a 32 bit float
+	return rawf16Data;
+}
+
+
+#ifdef CP_HALF_SSE2
+
+namespace {
+
+// Four halfs in low 16 bits of each lane to floats, same cases as CPf16Tof32
+__m128 HalfToFloat4(__m128i h)
+{
+	const __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+	const __m128i exponent = _mm_and_si128(_mm_srli_epi32(h, 10), _mm_set1_epi32(0x1f));
+	const __m128i mantissa = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x3ff)), 23 - 10);
+
+	const __m128i isZero = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+	const __m128i isInf = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(31));
+
+	__m128i exponent32 = _mm_add_epi32(exponent, _mm_set1_epi32(127 - 15));
+	exponent32 = _mm_andnot_si128(isZero, exponent32);
+	exponent32 = _mm_or_si128(_mm_andnot_si128(isInf, exponent32), _mm_and_si128(isInf, _mm_set1_epi32(255)));
+
+	return _mm_castsi128_ps(_mm_or_si128(_mm_or_si128(sign, _mm_slli_epi32(exponent32, 23)), mantissa));
+}
+
+// Four floats to halfs in low 16 bits of each lane, same cases as CPf32Tof16
+__m128i FloatToHalf4(__m128 f)
+{
+	const __m128i bits = _mm_castps_si128(f);
+
+	const __m128i sign = _mm_slli_epi32(_mm_srli_epi32(bits, 31), 15);
+	const __m128i exponent = _mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff));
+	const __m128i mantissa = _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7fffff)), 23 - 10);
+
+	// exponent <= 112: denormal mantissa is (1.f >> shift) >> 13, which is |f| * 2^24 truncated
+	const __m128 absF = _mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x7fffffff)));
+	const __m128i denormal = _mm_cvttps_epi32(_mm_mul_ps(absF, _mm_set1_ps(16777216.0f)));
+
+	// 112 < exponent < 143: rebias
+	const __m128i normal = _mm_or_si128(_mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(127 - 15)), 10), mantissa);
+
+	const __m128i isNaNInf = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(255));
+	const __m128i isUnderflow = _mm_cmplt_epi32(exponent, _mm_set1_epi32((127 - 15) - 10));
+	const __m128i isOverflow = _mm_cmpgt_epi32(exponent, _mm_set1_epi32((127 + (31 - 15)) - 1));
+	const __m128i isDenormal = _mm_cmplt_epi32(exponent, _mm_set1_epi32((127 - 15) + 1));
+
+	// Cases in same precedence as the scalar version
+	__m128i result = normal;
+	result = _mm_or_si128(_mm_andnot_si128(isDenormal, result), _mm_and_si128(isDenormal, denormal));
+	result = _mm_or_si128(_mm_andnot_si128(isOverflow, result), _mm_and_si128(isOverflow, _mm_set1_epi32(31 << 10)));
+	result = _mm_andnot_si128(isUnderflow, result);
+	result = _mm_or_si128(_mm_andnot_si128(isNaNInf, result), _mm_and_si128(isNaNInf, _mm_or_si128(_mm_set1_epi32(31 << 10), mantissa)));
+
+	return _mm_or_si128(result, sign);
+}
+
+}
+
+#endif
+
+void CPf16Tof32Array( const unsigned short* src, float* dst, int count )
+{
+	int i = 0;
+
+#ifdef CP_HALF_SSE2
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+
+		_mm_storeu_ps(dst + i, HalfToFloat4(_mm_unpacklo_epi16(h, _mm_setzero_si128())));
+		_mm_storeu_ps(dst + i + 4, HalfToFloat4(_mm_unpackhi_epi16(h, _mm_setzero_si128())));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		dst[i] = CPf16Tof32(src[i]);
+	}
+}
+
+void CPf32Tof16Array( const float* src, unsigned short* dst, int count )
+{
+	int i = 0;
+
+#ifdef CP_HALF_SSE2
+	// packs_epi32 saturates signed, so move halfs into signed range and back
+	const __m128i bias32 = _mm_set1_epi32(0x8000);
+	const __m128i bias16 = _mm_set1_epi16(short(0x8000));
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i lo = _mm_sub_epi32(FloatToHalf4(_mm_loadu_ps(src + i)), bias32);
+		__m128i hi = _mm_sub_epi32(FloatToHalf4(_mm_loadu_ps(src + i + 4)), bias32);
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		dst[i] = CPf32Tof16(src[i]);
+	}
+}
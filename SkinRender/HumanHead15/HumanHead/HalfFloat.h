@@ -0,0 +1,15 @@
+#ifndef HalfFloat_h__
+#define HalfFloat_h__
+
+// D3D s10e5 half float conversion, denormal halfs read as zero exponent, rounding toward zero
+float CPf16Tof32(unsigned short aVal);
+unsigned short CPf32Tof16(float aVal);
+
+/**
+ * Convert count values at once, results are bit exact with CPf16Tof32 / CPf32Tof16. Eight
+ * values per step with SSE2 integer ops when available, scalar for the rest.
+ */
+void CPf16Tof32Array(const unsigned short* src, float* dst, int count);
+void CPf32Tof16Array(const float* src, unsigned short* dst, int count);
+
+#endif // HalfFloat_h__
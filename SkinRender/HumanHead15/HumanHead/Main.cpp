@@ -4,6 +4,8 @@
 #include "Bloom.h"
 #include "Camera.h"
 #include "Utility.h"
+#include "CubeMapProcessor.h"
+#include "pfm.h"
 #include <nvMath.h>
 #include <nvModel.h>
 #include <nvImage.h>
@@ -2001,8 +2003,96 @@ void Motion(int x, int y)
 	}
 }
 
+// -specular inputPrefix output [outputSize] [mips] [samples]: GGX prefilter cube map with faces
+// <inputPrefix>_face<i>.pfm, output ending with .dds is one cube map, otherwise PFM per level and face
+int FilterSpecularCubeMap(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		printf("Usage: -specular inputPrefix output [outputSize] [mips] [samples]\n");
+		return 1;
+	}
+
+	const char* inputPrefix = argv[2];
+	const char* output = argv[3];
+
+	CubeMapProcessor processor;
+	int inputSize = 0;
+
+	for (int faceIdx = 0; faceIdx < 6; faceIdx++)
+	{
+		char fileName[512];
+		sprintf_s(fileName, "%s_face%d.pfm", inputPrefix, faceIdx);
+
+		int width, height;
+		float* data = 0;
+		int numChannels = ReadPfm(fileName, width, height, data);
+		if (numChannels < 0 || width != height || (faceIdx > 0 && width != inputSize))
+		{
+			printf("Error: %s is missing or not a square face of the same size\n", fileName);
+			delete[] data;
+			return 1;
+		}
+
+		if (faceIdx == 0)
+		{
+			inputSize = width;
+			int outputSize = (argc > 4) ? atoi(argv[4]) : inputSize;
+			processor.Init(inputSize, (std::max)(outputSize, 1), 3);
+		}
+
+		// PFM is RGB or gray, copied as is since SetInputFaceData swaps red and blue of float data
+		float* faceData = processor.mSrcCubeMap[faceIdx].GetImageData();
+		for (int i = 0; i < width * height; i++)
+		{
+			for (int c = 0; c < 3; c++)
+				faceData[i * 3 + c] = data[i * numChannels + (std::min)(c, numChannels - 1)];
+		}
+
+		delete[] data;
+	}
+
+	int numMips = (argc > 5) ? atoi(argv[5]) : 8;
+	int numSamples = (argc > 6) ? atoi(argv[6]) : 256;
+	processor.GGXSpecularFilterCubeMap(numMips, numSamples, CubeMapProcessor::EF_Stretch);
+
+	size_t outputLength = strlen(output);
+	bool dds = outputLength > 4 && _stricmp(output + outputLength - 4, ".dds") == 0;
+	if (!(dds ? processor.WriteSpecularDDS(output) : processor.WriteSpecularPfm(output)))
+	{
+		printf("Error: failed to write %s\n", output);
+		return 1;
+	}
+
+	printf("Prefiltered %d levels of %d samples into %s\n", int(processor.mSpecularCubeMap.size() / 6), numSamples, output);
+	return 0;
+}
+
 int main( int argc, char** argv) {
 
+	// -shbench [probes] [faceSize] [order]: time SH projection of random probes, no window.
+	// Without order all orders up to MaxParallelSHOrder are checked.
+	if (argc > 1 && strcmp(argv[1], "-shbench") == 0)
+	{
+		int numProbes = (argc > 2) ? atoi(argv[2]) : 16;
+		int faceSize = (argc > 3) ? atoi(argv[3]) : 128;
+		if (argc > 4)
+		{
+			CubeMapProcessor::BenchmarkSHProjection(numProbes, faceSize, atoi(argv[4]));
+		}
+		else
+		{
+			for (int order = 1; order <= CubeMapProcessor::MaxParallelSHOrder; order++)
+				CubeMapProcessor::BenchmarkSHProjection(numProbes, faceSize, order);
+		}
+		return 0;
+	}
+
+	if (argc > 1 && strcmp(argv[1], "-specular") == 0)
+	{
+		return FilterSpecularCubeMap(argc, argv);
+	}
+
 	glutInit( &argc, argv);
 	glutInitDisplayMode( GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
 	glutInitWindowSize( gWindowWidth, gWindowHeight);
@@ -1,48 +1,37 @@
 #include "pfm.h"
+#include "HalfFloat.h"
 #include <stdio.h>
 #include <string.h>
+#include <vector>
+#include <algorithm>
+#include <Windows.h>
 
-int ReadPfm(const char *fn, int &resX, int &resY, float*& data)
+// Parse header, return number of channels or -2. Fields may be separated by any whitespace,
+// only the single whitespace (or CR LF) after scale is consumed, so pixel data starting with
+// whitespace bytes isn't skipped
+static int ReadPfmHeader(FILE* f, int &resX, int &resY)
 {
-	FILE* f;
-	errno_t err=fopen_s(&f,fn,"rb");
-	if(err!=0) return -1;
 	char indicator[16];
 	float d;
-	if(fscanf_s(f,"%s\n",indicator,16)!=1||fscanf_s(f,"%d %d\n %f\n",&resX,&resY,&d)!=3||resX<=0||resY<=0)
+	if(fscanf_s(f,"%15s",indicator,16)!=1||fscanf_s(f,"%d %d %f",&resX,&resY,&d)!=3||resX<=0||resY<=0)
 	{
-		fclose(f);
-		return -2;
-	}
-	int num_channels;
-	if(strcmp(indicator,"Pf")==0) num_channels=1;
-	else if(strcmp(indicator,"PF")==0) num_channels=3;
-	else if(strcmp(indicator,"P4")==0) num_channels=4;
-	else
-	{
-		fclose(f);
 		return -2;
 	}
-	if(data==0) data=new float[resX*resY*num_channels];
-	int read=fread_s(data,sizeof(float)*resX*resY*num_channels,sizeof(float)*num_channels,resX*resY,f);
-	if(read!=resX*resY)
+	int c=fgetc(f);
+	if(c=='\r')
 	{
-		fclose(f);
-		return -3;
+		c=fgetc(f);
+		if(c!='\n') return -2;
 	}
-	fclose(f);
-	return num_channels;
+	else if(c!='\n'&&c!=' '&&c!='\t') return -2;
+	if(strcmp(indicator,"Pf")==0) return 1;
+	else if(strcmp(indicator,"PF")==0) return 3;
+	else if(strcmp(indicator,"P4")==0) return 4;
+	return -2;
 }
 
-int WritePfm(const char *fn, int resX, int resY, int channels, const float* data)
+static int WritePfmHeader(FILE* f, int resX, int resY, int channels)
 {
-	if(channels!=1&&channels!=3&&channels!=4)
-	{
-		return -2;
-	}
-	FILE* f;
-	errno_t err=fopen_s(&f,fn,"wb");
-	if(err!=0) return -1;
 	const char* indicator;	
 	switch(channels)
 	{
@@ -56,9 +45,54 @@ int WritePfm(const char *fn, int resX, int resY, int channels, const float* data
 		indicator="P4";
 		break;
 	default:
-		break;
+		return -2;
 	}
-	fprintf_s(f,"%s\n%d %d\n%f\n",indicator,resX,resY,-1.f);		
+	fprintf_s(f,"%s\n%d %d\n%f\n",indicator,resX,resY,-1.f);
+	return 0;
+}
+
+int ReadPfm(const char *fn, int &resX, int &resY, float*& data)
+{
+	// Whole image read by reader straight into data
+	PfmReader reader;
+	int num_channels=reader.Open(fn);
+	if(num_channels<0) return num_channels;
+	resX=reader.GetWidth();
+	resY=reader.GetHeight();
+	if(data==0) data=new float[resX*resY*num_channels];
+	if(reader.ReadRows(data,resY)!=resY) return -3;
+	return num_channels;
+}
+
+int ReadPfmHalf(const char *fn, int &resX, int &resY, unsigned short*& data)
+{
+	// Rows converted from mapped file, no float copy of image
+	PfmMappedView view;
+	int num_channels=view.Open(fn);
+	if(num_channels<0) return num_channels;
+	resX=view.GetWidth();
+	resY=view.GetHeight();
+	if(data==0) data=new unsigned short[resX*resY*num_channels];
+	const int row_size=resX*num_channels;
+	for(int y=0;y<resY;y++)
+	{
+		const float* row=view.GetRows(y,1);
+		if(row==0) return -3;
+		CPf32Tof16Array(row,data+y*row_size,row_size);
+	}
+	return num_channels;
+}
+
+int WritePfm(const char *fn, int resX, int resY, int channels, const float* data)
+{
+	if(channels!=1&&channels!=3&&channels!=4)
+	{
+		return -2;
+	}
+	FILE* f;
+	errno_t err=fopen_s(&f,fn,"wb");
+	if(err!=0) return -1;
+	WritePfmHeader(f,resX,resY,channels);
 	int written=fwrite(data,sizeof(float)*channels,resX*resY,f);
 	if(written!=resX*resY)
 	{
@@ -69,33 +103,257 @@ int WritePfm(const char *fn, int resX, int resY, int channels, const float* data
 	return 0;
 }
 
+int WritePfmHalf(const char *fn, int resX, int resY, int channels, const unsigned short* data)
+{
+	if(channels!=1&&channels!=3&&channels!=4)
+	{
+		return -2;
+	}
+	FILE* f;
+	errno_t err=fopen_s(&f,fn,"wb");
+	if(err!=0) return -1;
+	WritePfmHeader(f,resX,resY,channels);
+	const int row_size=resX*channels;
+	std::vector<float> row(row_size);
+	for(int y=0;y<resY;y++)
+	{
+		CPf16Tof32Array(data+y*row_size,&row[0],row_size);
+		int written=fwrite(&row[0],sizeof(float)*channels,resX,f);
+		if(written!=resX)
+		{
+			fclose(f);
+			return -3;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
 int WritePfm3D(const char *fn, int resX, int resY, int resZ, int tiles, int channels, const float* data, float* buffer/*=NULL*/)
 {
-	bool allocated=false;
-	if(buffer==NULL) 
+	// Tiled image is streamed a row at a time, buffer (if any) is only used as row scratch
+	PfmWriter writer;
+	int err=writer.Open(fn,resX*tiles,resY*tiles,channels);
+	if(err!=0) return err;
+	std::vector<float> row;
+	if(buffer==NULL)
 	{
-		buffer=new float[resX*resY*tiles*tiles*channels];
-		allocated=true;
+		row.resize(resX*tiles*channels);
+		buffer=&row[0];
 	}
-	memset(buffer,0,sizeof(float)*resX*resY*tiles*tiles*channels);
-	for(int z=0;z<resZ;z++)
+	const int slice_row_size=resX*channels;
+	for(int ty=0;ty<tiles;ty++)
 	{
-		int tx=z%tiles;
-		int ty=z/tiles;
-		for(int x=0;x<resX;x++)
-		{			
-			for(int y=0;y<resY;y++)
+		for(int y=0;y<resY;y++)
+		{
+			for(int tx=0;tx<tiles;tx++)
 			{
-				int old_id=x+y*resX+z*resX*resY;
-				int new_id=(tx*resX+x)+(ty*resY+y)*resX*tiles;
-				for(int c=0;c<channels;c++)
-				{
-					buffer[channels*new_id+c]=data[channels*old_id+c];
-				}
+				int z=tx+ty*tiles;
+				float* dst=buffer+tx*slice_row_size;
+				if(z<resZ)
+					memcpy(dst,data+(y*resX+z*resX*resY)*channels,sizeof(float)*slice_row_size);
+				else
+					memset(dst,0,sizeof(float)*slice_row_size);
 			}
+			if(writer.WriteRows(buffer,1)!=1) return -3;
 		}
 	}
-	WritePfm(fn,resX*tiles,resY*tiles,channels,buffer);
-	if(allocated) delete[] buffer;
+	return writer.Close();
+}
+
+//////////////////////////////////////////////////////////////////////////
+PfmReader::PfmReader()
+	: mFile(0), mResX(0), mResY(0), mChannels(0), mNextRow(0)
+{
+}
+
+PfmReader::~PfmReader()
+{
+	Close();
+}
+
+int PfmReader::Open(const char *fn)
+{
+	Close();
+	errno_t err=fopen_s(&mFile,fn,"rb");
+	if(err!=0) 
+	{
+		mFile=0;
+		return -1;
+	}
+	mChannels=ReadPfmHeader(mFile,mResX,mResY);
+	if(mChannels<0)
+	{
+		int result=mChannels;
+		Close();
+		return result;
+	}
+	mNextRow=0;
+	return mChannels;
+}
+
+void PfmReader::Close()
+{
+	if(mFile) fclose(mFile);
+	mFile=0;
+	mResX=mResY=mChannels=mNextRow=0;
+}
+
+int PfmReader::ReadRows(float* rows, int numRows)
+{
+	if(mFile==0) return 0;
+	numRows=(std::min)(numRows,mResY-mNextRow);
+	if(numRows<=0) return 0;
+	const size_t row_size=sizeof(float)*mResX*mChannels;
+	int read=fread_s(rows,row_size*numRows,row_size,numRows,mFile);
+	mNextRow+=read;
+	return read;
+}
+
+//////////////////////////////////////////////////////////////////////////
+PfmWriter::PfmWriter()
+	: mFile(0), mResX(0), mResY(0), mChannels(0), mNextRow(0)
+{
+}
+
+PfmWriter::~PfmWriter()
+{
+	Close();
+}
+
+int PfmWriter::Open(const char *fn, int resX, int resY, int channels)
+{
+	Close();
+	if(channels!=1&&channels!=3&&channels!=4)
+	{
+		return -2;
+	}
+	errno_t err=fopen_s(&mFile,fn,"wb");
+	if(err!=0)
+	{
+		mFile=0;
+		return -1;
+	}
+	WritePfmHeader(mFile,resX,resY,channels);
+	mResX=resX;
+	mResY=resY;
+	mChannels=channels;
+	mNextRow=0;
 	return 0;
 }
+
+int PfmWriter::Close()
+{
+	if(mFile==0) return 0;
+	fclose(mFile);
+	mFile=0;
+	return (mNextRow==mResY)?0:-3;
+}
+
+int PfmWriter::WriteRows(const float* rows, int numRows)
+{
+	if(mFile==0) return 0;
+	numRows=(std::min)(numRows,mResY-mNextRow);
+	if(numRows<=0) return 0;
+	int written=fwrite(rows,sizeof(float)*mResX*mChannels,numRows,mFile);
+	mNextRow+=written;
+	return written;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Smallest view mapped, so walking rows doesn't remap every call
+static const long long MinPfmViewSize=64*1024*1024;
+
+PfmMappedView::PfmMappedView()
+	: mFile(INVALID_HANDLE_VALUE), mMapping(0), mView(0),
+	  mFileSize(0), mDataOffset(0), mViewOffset(0), mViewSize(0),
+	  mResX(0), mResY(0), mChannels(0)
+{
+}
+
+PfmMappedView::~PfmMappedView()
+{
+	Close();
+}
+
+int PfmMappedView::Open(const char *fn)
+{
+	Close();
+
+	// Header is parsed with stdio, pixel data is mapped behind it
+	FILE* f;
+	errno_t err=fopen_s(&f,fn,"rb");
+	if(err!=0) return -1;
+	int channels=ReadPfmHeader(f,mResX,mResY);
+	mDataOffset=_ftelli64(f);
+	fclose(f);
+	if(channels<0)
+	{
+		Close();
+		return channels;
+	}
+	mChannels=channels;
+
+	mFile=CreateFileA(fn,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL|FILE_FLAG_RANDOM_ACCESS,0);
+	if(mFile==INVALID_HANDLE_VALUE)
+	{
+		Close();
+		return -1;
+	}
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(mFile,&size)||size.QuadPart<mDataOffset+(long long)sizeof(float)*mResX*mResY*mChannels)
+	{
+		Close();
+		return -3;
+	}
+	mFileSize=size.QuadPart;
+	mMapping=CreateFileMappingA(mFile,0,PAGE_READONLY,0,0,0);
+	if(mMapping==0)
+	{
+		Close();
+		return -1;
+	}
+	return mChannels;
+}
+
+void PfmMappedView::Close()
+{
+	if(mView) UnmapViewOfFile(mView);
+	if(mMapping) CloseHandle(mMapping);
+	if(mFile!=INVALID_HANDLE_VALUE) CloseHandle(mFile);
+	mFile=INVALID_HANDLE_VALUE;
+	mMapping=0;
+	mView=0;
+	mFileSize=mDataOffset=mViewOffset=mViewSize=0;
+	mResX=mResY=mChannels=0;
+	mAlignedRows.clear();
+}
+
+const float* PfmMappedView::GetRows(int firstRow, int numRows)
+{
+	if(mMapping==0||firstRow<0||numRows<=0||firstRow+numRows>mResY) return 0;
+	const long long row_size=(long long)sizeof(float)*mResX*mChannels;
+	const long long begin=mDataOffset+firstRow*row_size;
+	const long long end=begin+numRows*row_size;
+	if(mView==0||begin<mViewOffset||end>mViewOffset+mViewSize)
+	{
+		if(mView) UnmapViewOfFile(mView);
+		mView=0;
+		// View offset must be multiple of allocation granularity
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		mViewOffset=begin/info.dwAllocationGranularity*info.dwAllocationGranularity;
+		mViewSize=(std::max)(end-mViewOffset,(std::min)(MinPfmViewSize,mFileSize-mViewOffset));
+		mView=(const char*)MapViewOfFile(mMapping,FILE_MAP_READ,DWORD(mViewOffset>>32),DWORD(mViewOffset&0xffffffff),SIZE_T(mViewSize));
+		if(mView==0) return 0;
+	}
+	const char* rows=mView+(begin-mViewOffset);
+	// Header length may leave data unaligned for float loads, rows are copied then
+	if(mDataOffset%sizeof(float)!=0)
+	{
+		mAlignedRows.resize(size_t(numRows*row_size/sizeof(float)));
+		memcpy(&mAlignedRows[0],rows,size_t(numRows*row_size));
+		return &mAlignedRows[0];
+	}
+	return (const float*)rows;
+}
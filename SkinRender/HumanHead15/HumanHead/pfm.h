@@ -1,8 +1,99 @@
 #ifndef _PFM_H_
 #define _PFM_H_
 
+#include <stdio.h>
+#include <vector>
+
 int ReadPfm(const char *fn, int &resX, int &resY, float*& data);
 int WritePfm(const char *fn, int resX, int resY, int channels, const float* data);
 int WritePfm3D(const char *fn, int resX, int resY, int resZ, int tiles, int channels, const float* data, float* buffer=0);
 
+// Half float images, stored as float PFM and converted row by row
+int ReadPfmHalf(const char *fn, int &resX, int &resY, unsigned short*& data);
+int WritePfmHalf(const char *fn, int resX, int resY, int channels, const unsigned short* data);
+
+/**
+ * Reads PFM scanlines in file order, a band of rows at a time, so images larger than memory
+ * can be processed.
+ */
+class PfmReader
+{
+public:
+	PfmReader();
+	~PfmReader();
+
+	// Return number of channels, or same error codes as ReadPfm
+	int Open(const char *fn);
+	void Close();
+
+	int GetWidth() const		{ return mResX; }
+	int GetHeight() const		{ return mResY; }
+	int GetChannels() const		{ return mChannels; }
+	int GetNextRow() const		{ return mNextRow; }
+
+	// Read up to numRows rows of width*channels floats, return rows read
+	int ReadRows(float* rows, int numRows);
+
+private:
+	FILE* mFile;
+	int mResX, mResY, mChannels;
+	int mNextRow;
+};
+
+class PfmWriter
+{
+public:
+	PfmWriter();
+	~PfmWriter();
+
+	int Open(const char *fn, int resX, int resY, int channels);
+
+	// Return -3 if fewer rows than height were written
+	int Close();
+
+	int WriteRows(const float* rows, int numRows);
+
+private:
+	FILE* mFile;
+	int mResX, mResY, mChannels;
+	int mNextRow;
+};
+
+/**
+ * Read only memory mapped PFM. Only a window of rows is mapped at a time and pages are
+ * loaded by the OS on access, so multi-GB volumes work in 32 bit builds too.
+ */
+class PfmMappedView
+{
+public:
+	PfmMappedView();
+	~PfmMappedView();
+
+	int Open(const char *fn);
+	void Close();
+
+	int GetWidth() const		{ return mResX; }
+	int GetHeight() const		{ return mResY; }
+	int GetChannels() const		{ return mChannels; }
+
+	/**
+	 * Rows firstRow .. firstRow+numRows-1 in file order, contiguous. Valid until next call
+	 * that needs other rows, null if out of range or mapping fails. Rows are copied if data
+	 * offset isn't a multiple of 4.
+	 */
+	const float* GetRows(int firstRow, int numRows);
+
+private:
+	void* mFile;
+	void* mMapping;
+	const char* mView;
+
+	long long mFileSize, mDataOffset;
+	long long mViewOffset, mViewSize;
+
+	int mResX, mResY, mChannels;
+
+	std::vector<float> mAlignedRows;
+};
+
 #endif
\ No newline at end of file